@@ -60,6 +60,11 @@
 #include "sockutils.hpp"
 #include "ssl.hpp"
 #include "resolver.hpp"
+#include "shaper.hpp"
+#include "fileio.hpp"
+#include "mmap.hpp"
+#include "events.hpp"
+#include "process.hpp"
 
 namespace NNet {
 #if defined(__APPLE__) || defined(__FreeBSD__)
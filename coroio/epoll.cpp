@@ -1,6 +1,21 @@
 #if defined(__linux__) || defined(_WIN32)
 #include "epoll.hpp"
 
+#ifdef __linux__
+#include <sys/ioctl.h>
+
+// <sys/epoll.h> of glibc 2.40 has them, <linux/eventpoll.h> conflicts with it
+#ifndef EPIOCSPARAMS
+struct epoll_params {
+    uint32_t busy_poll_usecs;
+    uint16_t busy_poll_budget;
+    uint8_t prefer_busy_poll;
+    uint8_t __pad;
+};
+#define EPIOCSPARAMS _IOW(0x8A, 0x01, struct epoll_params)
+#endif
+#endif
+
 namespace NNet {
 
 namespace {
@@ -45,6 +60,18 @@ TEPoll::~TEPoll()
     }
 }
 
+#ifdef __linux__
+void TEPoll::SetBusyPoll(std::chrono::microseconds timeout, unsigned budget, bool prefer) {
+    epoll_params params = {};
+    params.busy_poll_usecs = static_cast<uint32_t>(timeout.count());
+    params.busy_poll_budget = static_cast<uint16_t>(budget);
+    params.prefer_busy_poll = prefer;
+    if (ioctl(Fd_, EPIOCSPARAMS, &params) < 0) {
+        throw std::system_error(errno, std::generic_category(), "EPIOCSPARAMS");
+    }
+}
+#endif
+
 void TEPoll::Poll() {
     auto ts = GetTimeout();
 
@@ -62,17 +89,14 @@ void TEPoll::Poll() {
         if (ch.Handle) {
             newEv = !!ev.Read && !!ev.Write && !!ev.RHup;
             if (ch.Type & TEvent::READ) {
-                eev.events |= EPOLLIN;
                 change |= ev.Read != ch.Handle;
                 ev.Read = ch.Handle;
             }
             if (ch.Type & TEvent::WRITE) {
-                eev.events |= EPOLLOUT;
                 change |= ev.Write != ch.Handle;
                 ev.Write = ch.Handle;
             }
             if (ch.Type & TEvent::RHUP) {
-                eev.events |= EPOLLRDHUP;
                 change |= ev.RHup != ch.Handle;
                 ev.RHup = ch.Handle;
             }
@@ -85,16 +109,21 @@ void TEPoll::Poll() {
                 change |= !!ev.Write;
                 ev.Write = {};
             }
-            if (ev.Read) {
-                eev.events |= EPOLLIN;
-            }
-            if (ev.Write) {
-                eev.events |= EPOLLOUT;
-            }
-            if (ev.RHup) {
-                eev.events |= EPOLLRDHUP;
+            if (ch.Type & TEvent::RHUP) {
+                change |= !!ev.RHup;
+                ev.RHup = {};
             }
         }
+        // the mask must keep the other waiters of this fd, e.g. a writer registered next to a reader
+        if (ev.Read) {
+            eev.events |= EPOLLIN;
+        }
+        if (ev.Write) {
+            eev.events |= EPOLLOUT;
+        }
+        if (ev.RHup) {
+            eev.events |= EPOLLRDHUP;
+        }
 
         if (newEv) {
             if (epoll_ctl(Fd_, EPOLL_CTL_ADD, fd, &eev) < 0) {
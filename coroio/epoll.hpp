@@ -5,6 +5,8 @@
 #include <unistd.h>
 #endif
 
+#include <chrono>
+
 #ifdef _WIN32
 #include "wepoll.h"
 #endif
@@ -25,6 +27,12 @@ public:
 
     void Poll();
 
+#ifdef __linux__
+    // Busy polling of the NAPI queues of the sockets in epoll_wait (EPIOCSPARAMS, Linux 6.9),
+    // without SO_BUSY_POLL on every socket. A budget over 64 needs CAP_NET_ADMIN.
+    void SetBusyPoll(std::chrono::microseconds timeout, unsigned budget = 8, bool prefer = false);
+#endif
+
 private:
 #ifdef __linux__
     int Fd_;
@@ -0,0 +1,103 @@
+#ifndef _WIN32
+
+#include <system_error>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+
+#ifdef __linux__
+#include <sys/eventfd.h>
+#include <sys/timerfd.h>
+#endif
+
+#include "events.hpp"
+
+namespace NNet {
+
+namespace NDetail {
+
+int CreateEventFd(bool nonblock, int* writeFd) {
+#ifdef __linux__
+    int fd = eventfd(0, EFD_CLOEXEC | (nonblock ? EFD_NONBLOCK : 0));
+    if (fd < 0) {
+        throw std::system_error(errno, std::generic_category(), "eventfd");
+    }
+    *writeFd = fd;
+    return fd;
+#else
+    int fds[2];
+    if (::pipe(fds) < 0) {
+        throw std::system_error(errno, std::generic_category(), "pipe");
+    }
+    for (int fd : fds) {
+        fcntl(fd, F_SETFD, FD_CLOEXEC);
+    }
+    if (nonblock) {
+        fcntl(fds[0], F_SETFL, fcntl(fds[0], F_GETFL) | O_NONBLOCK);
+    }
+    // a full pipe is already a pending notification
+    fcntl(fds[1], F_SETFL, fcntl(fds[1], F_GETFL) | O_NONBLOCK);
+    *writeFd = fds[1];
+    return fds[0];
+#endif
+}
+
+void NotifyEventFd(int writeFd) {
+#ifdef __linux__
+    uint64_t one = 1;
+    while (::write(writeFd, &one, sizeof(one)) < 0 && errno == EINTR) { }
+#else
+    char one = 1;
+    while (::write(writeFd, &one, sizeof(one)) < 0 && errno == EINTR) { }
+#endif
+}
+
+#ifdef __linux__
+int CreateSignalFd(std::initializer_list<int> signals, bool nonblock) {
+    sigset_t mask;
+    sigemptyset(&mask);
+    for (int signal : signals) {
+        sigaddset(&mask, signal);
+    }
+    int err = pthread_sigmask(SIG_BLOCK, &mask, nullptr);
+    if (err != 0) {
+        throw std::system_error(err, std::generic_category(), "pthread_sigmask");
+    }
+    int fd = signalfd(-1, &mask, SFD_CLOEXEC | (nonblock ? SFD_NONBLOCK : 0));
+    if (fd < 0) {
+        throw std::system_error(errno, std::generic_category(), "signalfd");
+    }
+    return fd;
+}
+
+int CreateTimerFd(std::chrono::nanoseconds first, std::chrono::nanoseconds interval, bool nonblock) {
+    int fd = timerfd_create(CLOCK_MONOTONIC, TFD_CLOEXEC | (nonblock ? TFD_NONBLOCK : 0));
+    if (fd < 0) {
+        throw std::system_error(errno, std::generic_category(), "timerfd_create");
+    }
+    auto toTimespec = [](std::chrono::nanoseconds ns) {
+        return timespec{
+            static_cast<time_t>(ns.count() / 1000000000),
+            static_cast<long>(ns.count() % 1000000000)
+        };
+    };
+    itimerspec spec = {toTimespec(interval), toTimespec(first)};
+    // a zero value would disarm the timer
+    if (spec.it_value.tv_sec == 0 && spec.it_value.tv_nsec == 0) {
+        spec.it_value.tv_nsec = 1;
+    }
+    if (timerfd_settime(fd, 0, &spec, nullptr) < 0) {
+        int err = errno;
+        ::close(fd);
+        throw std::system_error(err, std::generic_category(), "timerfd_settime");
+    }
+    return fd;
+}
+#endif
+
+} // namespace NDetail
+
+} // namespace NNet
+
+#endif // _WIN32
@@ -0,0 +1,139 @@
+#pragma once
+
+#ifndef _WIN32
+
+#include <chrono>
+#include <cstdint>
+#include <initializer_list>
+#include <type_traits>
+#include <vector>
+
+#ifdef __linux__
+#include <sys/signalfd.h>
+#endif
+#include <unistd.h>
+
+#include "corochain.hpp"
+#include "socket.hpp"
+
+namespace NNet {
+
+namespace NDetail {
+
+// Readiness pollers read nonblocking descriptors after a wakeup, TUring reads block in the ring
+template<typename TPoller>
+constexpr bool NonBlockingHandle = std::is_same_v<typename TPoller::TFileHandle, TFileHandle>;
+
+// An eventfd on Linux (both ends are the same descriptor), a pipe elsewhere
+int CreateEventFd(bool nonblock, int* writeFd);
+void NotifyEventFd(int writeFd);
+
+#ifdef __linux__
+// Blocks the signals in the calling thread and returns a signalfd for them
+int CreateSignalFd(std::initializer_list<int> signals, bool nonblock);
+int CreateTimerFd(std::chrono::nanoseconds first, std::chrono::nanoseconds interval, bool nonblock);
+#endif
+
+} // namespace NDetail
+
+// Wakes a loop from other threads. Notify is thread-safe and never blocks, notifications
+// coalesce until Wait takes them.
+template<typename TPoller>
+class TAsyncEvent {
+public:
+    explicit TAsyncEvent(TPoller& poller)
+        : Handle_(NDetail::CreateEventFd(NDetail::NonBlockingHandle<TPoller>, &WriteFd_), poller)
+    { }
+
+    ~TAsyncEvent() {
+        if (WriteFd_ != Handle_.Fd()) {
+            ::close(WriteFd_);
+        }
+    }
+
+    TAsyncEvent(const TAsyncEvent&) = delete;
+    TAsyncEvent& operator=(const TAsyncEvent&) = delete;
+
+    void Notify() {
+        NDetail::NotifyEventFd(WriteFd_);
+    }
+
+    // The number of notifications taken, at least one
+    TValueTask<uint64_t> Wait() {
+        while (true) {
+            uint64_t value = 0;
+            auto size = co_await Handle_.ReadSome(&value, sizeof(value));
+            if (size > 0) {
+#ifdef __linux__
+                co_return value;
+#else
+                co_return size; // a byte per notification
+#endif
+            }
+        }
+    }
+
+private:
+    int WriteFd_ = -1;
+    typename TPoller::TFileHandle Handle_;
+};
+
+#ifdef __linux__
+// Signals as awaitable events, without handlers or a signal thread. The signals are blocked
+// in the calling thread: construct it before starting other threads, they inherit the mask,
+// a thread with a signal unblocked would take it with the default action instead.
+// The signals stay blocked after destruction.
+template<typename TPoller>
+class TSignals {
+public:
+    TSignals(TPoller& poller, std::initializer_list<int> signals)
+        : Handle_(NDetail::CreateSignalFd(signals, NDetail::NonBlockingHandle<TPoller>), poller)
+    { }
+
+    // The number of the next delivered signal
+    TValueTask<int> Wait() {
+        while (true) {
+            signalfd_siginfo info;
+            auto size = co_await Handle_.ReadSome(&info, sizeof(info));
+            if (size == sizeof(info)) {
+                co_return static_cast<int>(info.ssi_signo);
+            }
+        }
+    }
+
+private:
+    typename TPoller::TFileHandle Handle_;
+};
+
+// Periodic ticks of a timerfd on CLOCK_MONOTONIC with nanosecond resolution. The kernel keeps
+// the schedule, so ticks do not drift and do not go through the timer heap of the poller.
+template<typename TPoller>
+class TPeriodicTimer {
+public:
+    TPeriodicTimer(TPoller& poller, std::chrono::nanoseconds interval)
+        : TPeriodicTimer(poller, interval, interval)
+    { }
+
+    TPeriodicTimer(TPoller& poller, std::chrono::nanoseconds interval, std::chrono::nanoseconds first)
+        : Handle_(NDetail::CreateTimerFd(first, interval, NDetail::NonBlockingHandle<TPoller>), poller)
+    { }
+
+    // The number of expirations since the last Wait, more than one when ticks were missed
+    TValueTask<uint64_t> Wait() {
+        while (true) {
+            uint64_t expirations = 0;
+            auto size = co_await Handle_.ReadSome(&expirations, sizeof(expirations));
+            if (size == sizeof(expirations)) {
+                co_return expirations;
+            }
+        }
+    }
+
+private:
+    typename TPoller::TFileHandle Handle_;
+};
+#endif
+
+} // namespace NNet
+
+#endif // _WIN32
@@ -0,0 +1,210 @@
+#ifndef _WIN32
+
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#ifdef __linux__
+#include <sys/eventfd.h>
+#endif
+
+#include "fileio.hpp"
+
+namespace NNet {
+
+namespace {
+
+struct TReadable {
+    bool await_ready() const { return false; }
+    void await_suspend(std::coroutine_handle<> h) {
+        Poller->AddRead(Fd, h);
+    }
+    void await_resume() const { }
+
+    TPollerBase* Poller;
+    int Fd;
+};
+
+} // namespace
+
+TFileIoPool::TFileIoPool(TPollerBase& poller, int threads)
+    : Poller_(poller)
+{
+#ifdef __linux__
+    WakeRead_ = WakeWrite_ = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+    if (WakeRead_ < 0) {
+        throw std::system_error(errno, std::generic_category(), "eventfd");
+    }
+#else
+    int fds[2];
+    if (::pipe(fds) < 0) {
+        throw std::system_error(errno, std::generic_category(), "pipe");
+    }
+    for (int fd : fds) {
+        fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+        fcntl(fd, F_SETFD, FD_CLOEXEC);
+    }
+    WakeRead_ = fds[0];
+    WakeWrite_ = fds[1];
+#endif
+    for (int i = 0; i < threads; i++) {
+        Threads_.emplace_back([this]() { Work(); });
+    }
+    Drain();
+}
+
+TFileIoPool::~TFileIoPool() {
+    {
+        std::unique_lock<std::mutex> lock(Mutex_);
+        Stop_ = true;
+    }
+    Cond_.notify_all();
+    for (auto& thread : Threads_) {
+        thread.join();
+    }
+    Poller_.RemoveEvent(WakeRead_);
+    if (Drainer_) {
+        Drainer_.destroy();
+    }
+    ::close(WakeRead_);
+    if (WakeWrite_ != WakeRead_) {
+        ::close(WakeWrite_);
+    }
+}
+
+void TFileIoPool::ReadAt(int fd, void* buf, int size, uint64_t offset, std::coroutine_handle<> handle) {
+    Submit({.Op = EOp::Read, .Fd = fd, .Buf = buf, .Size = size, .Offset = offset, .Handle = handle});
+}
+
+void TFileIoPool::WriteAt(int fd, const void* buf, int size, uint64_t offset, std::coroutine_handle<> handle) {
+    Submit({.Op = EOp::Write, .Fd = fd, .Buf = const_cast<void*>(buf), .Size = size, .Offset = offset, .Handle = handle});
+}
+
+void TFileIoPool::Fsync(int fd, std::coroutine_handle<> handle) {
+    Submit({.Op = EOp::Fsync, .Fd = fd, .Handle = handle});
+}
+
+void TFileIoPool::Fdatasync(int fd, std::coroutine_handle<> handle) {
+    Submit({.Op = EOp::Fdatasync, .Fd = fd, .Handle = handle});
+}
+
+void TFileIoPool::Openat(int dirfd, const char* path, int flags, mode_t mode, std::coroutine_handle<> handle) {
+    Submit({.Op = EOp::Openat, .Fd = dirfd, .Path = path, .Flags = flags, .Mode = mode, .Handle = handle});
+}
+
+void TFileIoPool::Close(int fd, std::coroutine_handle<> handle) {
+    Submit({.Op = EOp::Close, .Fd = fd, .Handle = handle});
+}
+
+void TFileIoPool::Fallocate(int fd, int mode, uint64_t offset, uint64_t len, std::coroutine_handle<> handle) {
+    Submit({.Op = EOp::Fallocate, .Fd = fd, .Offset = offset, .Length = len, .Flags = mode, .Handle = handle});
+}
+
+int TFileIoPool::Result() {
+    int r = Results_.front();
+    Results_.pop();
+    return r;
+}
+
+void TFileIoPool::Submit(TJob job) {
+    {
+        std::unique_lock<std::mutex> lock(Mutex_);
+        Jobs_.emplace_back(job);
+    }
+    Cond_.notify_one();
+}
+
+int TFileIoPool::Run(const TJob& job) {
+    int ret = 0;
+    do {
+        switch (job.Op) {
+        case EOp::Read:
+            ret = ::pread(job.Fd, job.Buf, job.Size, job.Offset);
+            break;
+        case EOp::Write:
+            ret = ::pwrite(job.Fd, job.Buf, job.Size, job.Offset);
+            break;
+        case EOp::Fsync:
+            ret = ::fsync(job.Fd);
+            break;
+        case EOp::Fdatasync:
+#ifdef __APPLE__
+            ret = ::fsync(job.Fd);
+#else
+            ret = ::fdatasync(job.Fd);
+#endif
+            break;
+        case EOp::Openat:
+            ret = ::openat(job.Fd, job.Path, job.Flags | O_CLOEXEC, job.Mode);
+            break;
+        case EOp::Close:
+            // close is not retried, the descriptor is released even on EINTR
+            return ::close(job.Fd) < 0 ? -errno : 0;
+        case EOp::Fallocate:
+#if defined(__linux__)
+            ret = ::fallocate(job.Fd, job.Flags, job.Offset, job.Length);
+#elif defined(__APPLE__)
+            return -EOPNOTSUPP;
+#else
+            // posix_fallocate returns the error instead of setting errno
+            if (job.Flags != 0) {
+                return -EOPNOTSUPP;
+            }
+            ret = ::posix_fallocate(job.Fd, job.Offset, job.Length);
+            return ret == 0 ? 0 : -ret;
+#endif
+            break;
+        }
+    } while (ret < 0 && errno == EINTR);
+    return ret < 0 ? -errno : ret;
+}
+
+void TFileIoPool::Work() {
+    while (true) {
+        TJob job;
+        {
+            std::unique_lock<std::mutex> lock(Mutex_);
+            Cond_.wait(lock, [&]() { return Stop_ || !Jobs_.empty(); });
+            if (Stop_) {
+                return;
+            }
+            job = Jobs_.front();
+            Jobs_.pop_front();
+        }
+        job.Result = Run(job);
+        bool wakeup;
+        {
+            std::unique_lock<std::mutex> lock(Mutex_);
+            // the loop is woken once per batch, later completions join the pending one
+            wakeup = Done_.empty();
+            Done_.emplace_back(job);
+        }
+        if (wakeup) {
+            uint64_t one = 1;
+            while (::write(WakeWrite_, &one, sizeof(one)) < 0 && errno == EINTR) { }
+        }
+    }
+}
+
+TVoidTask TFileIoPool::Drain() {
+    Drainer_ = co_await Self();
+    while (true) {
+        co_await TReadable{&Poller_, WakeRead_};
+        // reset the wakeup before taking the completions, a later completion wakes us again
+        char buf[64];
+        while (::read(WakeRead_, buf, sizeof(buf)) > 0) { }
+        {
+            std::unique_lock<std::mutex> lock(Mutex_);
+            Completed_.swap(Done_);
+        }
+        for (auto& job : Completed_) {
+            Results_.push(job.Result);
+            job.Handle.resume();
+        }
+        Completed_.clear();
+    }
+}
+
+} // namespace NNet
+
+#endif // _WIN32
@@ -0,0 +1,211 @@
+#pragma once
+
+#ifndef _WIN32
+
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <queue>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "corochain.hpp"
+#include "fileop.hpp"
+#include "poller.hpp"
+#include "promises.hpp"
+
+namespace NNet {
+
+// Runs blocking file operations on worker threads for the readiness pollers: a regular file
+// is always "ready" for them, so read(2) would block the loop on disk. The interface mirrors
+// the file operations of TUring: an operation is submitted with the handle to resume, the
+// resumed coroutine takes Result(), negative results are -errno. Workers report completions
+// through an eventfd (a pipe outside Linux) watched by the poller, one wakeup delivers all
+// completions ready by then.
+// Destroy the pool outside of the loop and before the poller, operations still in flight
+// are never completed.
+class TFileIoPool {
+public:
+    TFileIoPool(TPollerBase& poller, int threads = 4);
+    ~TFileIoPool();
+
+    TFileIoPool(const TFileIoPool&) = delete;
+    TFileIoPool& operator=(const TFileIoPool&) = delete;
+
+    void ReadAt(int fd, void* buf, int size, uint64_t offset, std::coroutine_handle<> handle);
+    void WriteAt(int fd, const void* buf, int size, uint64_t offset, std::coroutine_handle<> handle);
+    void Fsync(int fd, std::coroutine_handle<> handle);
+    void Fdatasync(int fd, std::coroutine_handle<> handle);
+    void Openat(int dirfd, const char* path, int flags, mode_t mode, std::coroutine_handle<> handle);
+    void Close(int fd, std::coroutine_handle<> handle);
+    void Fallocate(int fd, int mode, uint64_t offset, uint64_t len, std::coroutine_handle<> handle);
+
+    int Result();
+
+    TPollerBase& Poller() {
+        return Poller_;
+    }
+
+private:
+    enum class EOp {
+        Read,
+        Write,
+        Fsync,
+        Fdatasync,
+        Openat,
+        Close,
+        Fallocate,
+    };
+
+    struct TJob {
+        EOp Op;
+        int Fd;
+        void* Buf = nullptr;
+        int Size = 0;
+        uint64_t Offset = 0;
+        uint64_t Length = 0;
+        const char* Path = nullptr;
+        int Flags = 0;
+        mode_t Mode = 0;
+        int Result = 0;
+        std::coroutine_handle<> Handle;
+    };
+
+    void Submit(TJob job);
+    void Work();
+    static int Run(const TJob& job);
+    TVoidTask Drain();
+
+    TPollerBase& Poller_;
+    int WakeRead_ = -1;
+    int WakeWrite_ = -1;
+
+    std::mutex Mutex_;
+    std::condition_variable Cond_;
+    std::deque<TJob> Jobs_;
+    std::vector<TJob> Done_;
+    bool Stop_ = false;
+    std::vector<std::thread> Threads_;
+
+    std::vector<TJob> Completed_;
+    std::queue<int> Results_;
+    std::coroutine_handle<> Drainer_;
+};
+
+// A regular file on TUring (native operations) or on TFileIoPool (the readiness pollers).
+// ReadSome/WriteSome advance the position of the handle, so TByteReader/TByteWriter work on it.
+template<typename TBackend>
+class TAsyncFile {
+public:
+    TAsyncFile(int fd, TBackend& backend)
+        : Fd_(fd)
+        , Backend_(&backend)
+    { }
+
+    TAsyncFile(TAsyncFile&& other)
+        : Fd_(other.Fd_)
+        , Backend_(other.Backend_)
+        , Position_(other.Position_)
+    {
+        other.Fd_ = -1;
+    }
+
+    TAsyncFile& operator=(TAsyncFile&& other) {
+        if (this != &other) {
+            if (Fd_ >= 0) {
+                ::close(Fd_);
+            }
+            Fd_ = other.Fd_;
+            Backend_ = other.Backend_;
+            Position_ = other.Position_;
+            other.Fd_ = -1;
+        }
+        return *this;
+    }
+
+    TAsyncFile(const TAsyncFile&) = delete;
+    TAsyncFile& operator=(const TAsyncFile&) = delete;
+
+    ~TAsyncFile() {
+        if (Fd_ >= 0) {
+            ::close(Fd_);
+        }
+    }
+
+    static TValueTask<TAsyncFile> Open(TBackend& backend, std::string path, int flags, mode_t mode = 0644) {
+        int fd = co_await NDetail::FileOp(&backend, [&](auto h) { backend.Openat(AT_FDCWD, path.c_str(), flags, mode, h); });
+        co_return TAsyncFile(fd, backend);
+    }
+
+    auto ReadAt(void* buf, size_t size, uint64_t offset) {
+        return Op([=, this](auto h) { Backend_->ReadAt(Fd_, buf, NDetail::ClampFileIo(size), offset, h); });
+    }
+
+    auto WriteAt(const void* buf, size_t size, uint64_t offset) {
+        return Op([=, this](auto h) { Backend_->WriteAt(Fd_, buf, NDetail::ClampFileIo(size), offset, h); });
+    }
+
+    auto ReadSome(void* buf, size_t size) {
+        return Op([=, this](auto h) { Backend_->ReadAt(Fd_, buf, NDetail::ClampFileIo(size), Position_, h); }, &Position_);
+    }
+
+    auto WriteSome(const void* buf, size_t size) {
+        return Op([=, this](auto h) { Backend_->WriteAt(Fd_, buf, NDetail::ClampFileIo(size), Position_, h); }, &Position_);
+    }
+
+    auto Fsync() {
+        return Op([this](auto h) { Backend_->Fsync(Fd_, h); });
+    }
+
+    auto Fdatasync() {
+        return Op([this](auto h) { Backend_->Fdatasync(Fd_, h); });
+    }
+
+    auto Fallocate(int mode, uint64_t offset, uint64_t len) {
+        return Op([=, this](auto h) { Backend_->Fallocate(Fd_, mode, offset, len, h); });
+    }
+
+    // The write linked with fdatasync, only for backends that submit both at once (TUring).
+    // Returns the bytes written and whether they are synced
+    auto WriteAtSync(const void* buf, size_t size, uint64_t offset) {
+        return NDetail::TSyncWriteOp<TBackend>{Backend_, Fd_, buf, NDetail::ClampFileIo(size), offset, true};
+    }
+
+    TValueTask<void> Close() {
+        int fd = Fd_;
+        Fd_ = -1;
+        co_await Op([=, this](auto h) { Backend_->Close(fd, h); });
+    }
+
+    void Seek(uint64_t position) {
+        Position_ = position;
+    }
+
+    uint64_t Position() const {
+        return Position_;
+    }
+
+    int Fd() const {
+        return Fd_;
+    }
+
+private:
+    template<typename TSubmit>
+    auto Op(TSubmit submit, uint64_t* position = nullptr) {
+        return NDetail::FileOp(Backend_, std::move(submit), position);
+    }
+
+    int Fd_ = -1;
+    TBackend* Backend_;
+    uint64_t Position_ = 0;
+};
+
+} // namespace NNet
+
+#endif // _WIN32
@@ -0,0 +1,85 @@
+#pragma once
+
+#include <algorithm>
+#include <coroutine>
+#include <cstddef>
+#include <cstdint>
+#include <system_error>
+#include <utility>
+
+namespace NNet {
+
+// The result of WriteAtSync: the bytes written, synced when the whole write is done and
+// fsync succeeded after it. A short write leaves the data unsynced, it is not an error
+struct TSyncWriteResult {
+    int Written = 0;
+    bool Synced = false;
+};
+
+namespace NDetail {
+
+// A file operation of TUring or TFileIoPool, the one awaitable of TAsyncFile and of the
+// file handle of the ring. The operation is submitted with the handle to resume, a negative
+// result is thrown as -errno. With a position, the result advances it (ReadSome, WriteSome)
+template<typename TBackend, typename TSubmit>
+struct TFileOp {
+    bool await_ready() const { return false; }
+    void await_suspend(std::coroutine_handle<> h) {
+        Submit(h);
+    }
+
+    int await_resume() {
+        int ret = Backend->Result();
+        if (ret < 0) {
+            throw std::system_error(-ret, std::generic_category());
+        }
+        if (Position) {
+            *Position += ret;
+        }
+        return ret;
+    }
+
+    TSubmit Submit;
+    TBackend* Backend;
+    uint64_t* Position = nullptr;
+};
+
+// WriteAtSync of a backend that links the write with fsync in one submission (TUring).
+// A failed write or fsync is thrown
+template<typename TBackend>
+struct TSyncWriteOp {
+    bool await_ready() const { return false; }
+    void await_suspend(std::coroutine_handle<> h) {
+        Backend->WriteAtSync(Fd, Buf, Size, Offset, Datasync, &Result, h);
+    }
+
+    TSyncWriteResult await_resume() {
+        int ret = Backend->Result();
+        if (ret < 0) {
+            throw std::system_error(-ret, std::generic_category());
+        }
+        return Result;
+    }
+
+    TBackend* Backend;
+    int Fd;
+    const void* Buf;
+    int Size;
+    uint64_t Offset;
+    bool Datasync;
+    TSyncWriteResult Result = {};
+};
+
+// The size of one read or write, a short one is reported to the caller as usual
+inline int ClampFileIo(size_t size) {
+    return static_cast<int>(std::min<size_t>(size, 1 << 30));
+}
+
+template<typename TBackend, typename TSubmit>
+auto FileOp(TBackend* backend, TSubmit submit, uint64_t* position = nullptr) {
+    return TFileOp<TBackend, TSubmit>{std::move(submit), backend, position};
+}
+
+} // namespace NDetail
+
+} // namespace NNet
@@ -0,0 +1,31 @@
+#include "client.hpp"
+
+#include <charconv>
+
+namespace NNet {
+
+void HttpSerializeRequest(std::string& out, const THttpClientRequest& request, std::string_view host) {
+    out.append(request.Method);
+    out.push_back(' ');
+    out.append(request.Target);
+    out.append(" HTTP/1.1\r\nHost: ");
+    out.append(host);
+    out.append("\r\n");
+    for (const auto& [name, value] : request.Headers) {
+        out.append(name);
+        out.append(": ");
+        out.append(value);
+        out.append("\r\n");
+    }
+    if (!request.Body.empty()) {
+        char buf[24];
+        auto [end, ec] = std::to_chars(buf, buf + sizeof(buf), request.Body.size());
+        out.append("Content-Length: ");
+        out.append(buf, end - buf);
+        out.append("\r\n");
+    }
+    out.append("\r\n");
+    out.append(request.Body);
+}
+
+} // namespace NNet
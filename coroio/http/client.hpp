@@ -0,0 +1,529 @@
+#pragma once
+
+#include <map>
+#include <memory>
+#include <string>
+#include <system_error>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <string.h>
+
+#include "parser.hpp"
+#include "../corochain.hpp"
+#include "../socket.hpp"
+#include "../sockutils.hpp"
+
+namespace NNet {
+
+struct THttpClientRequest {
+    std::string_view Method = "GET";
+    std::string_view Target = "/";
+    // defaults to the address the request is sent to
+    std::string_view Host;
+    std::vector<std::pair<std::string_view, std::string_view>> Headers;
+    std::string_view Body;
+    // covers connecting, waiting behind pipelined requests and reading the body
+    TTime Deadline = TTime::max();
+};
+
+// Appends the serialized request to out, Content-Length is added for non-empty bodies
+void HttpSerializeRequest(std::string& out, const THttpClientRequest& request, std::string_view host);
+
+struct THttpClientOptions {
+    size_t MaxConnectionsPerHost = 8;
+    // requests written to a connection before their responses are read,
+    // 1 disables pipelining
+    size_t MaxPipeline = 16;
+    size_t ReadChunk = 16 * 1024;
+    size_t MaxHeadSize = 64 * 1024;
+    std::chrono::milliseconds ConnectTimeout = std::chrono::seconds(5);
+};
+
+template<typename TSocket>
+class THttpClient;
+
+namespace NDetail {
+
+template<typename TSocket>
+struct THttpConnection {
+    using TPoller = typename TSocket::TPoller;
+
+    THttpConnection(TAddress addr, TPoller& poller, size_t readChunk)
+        : Poller(poller)
+        , Socket(std::move(addr), poller)
+        , Buffer(readChunk)
+        , ReadChunk(readChunk)
+    { }
+
+    size_t Inflight() const {
+        return NextSeq - ReadSeq;
+    }
+
+    bool Usable() const {
+        return !Error && !Closing;
+    }
+
+    void Fail(std::exception_ptr error) {
+        if (!Error) {
+            Error = std::move(error);
+        }
+        if (!ShutDown) {
+            ShutDown = true;
+            // wakes up a pending read or write on the socket
+#ifdef _WIN32
+            ::shutdown(Socket.Fd(), SD_BOTH);
+#else
+            ::shutdown(Socket.Fd(), SHUT_RDWR);
+#endif
+        }
+    }
+
+    // Called from the deadline timer: the connection is unusable after a missed deadline
+    // because the remaining part of the response cannot be skipped.
+    void Expire(uint64_t seq) {
+        Fail(std::make_exception_ptr(std::system_error(std::make_error_code(std::errc::timed_out))));
+        auto it = Waiters.find(seq);
+        if (it != Waiters.end()) {
+            auto h = it->second;
+            Waiters.erase(it);
+            // resumed on the next loop iteration, not from inside the timer coroutine,
+            // the timer is removed if the waiter is gone before
+            Expired[seq] = Poller.AddTimer(TTime{}, h);
+        }
+    }
+
+    // The response with sequence number ReadSeq is consumed, the next one may be read.
+    // After a failure every waiter is resumed to observe the error, one at a time:
+    // a resumed caller may destroy the waiters after it.
+    void Advance() {
+        ReadSeq++;
+        if (Error) {
+            while (!Waiters.empty()) {
+                auto h = Waiters.begin()->second;
+                Waiters.erase(Waiters.begin());
+                h.resume();
+            }
+            return;
+        }
+        auto it = Waiters.find(ReadSeq);
+        if (it != Waiters.end()) {
+            auto h = it->second;
+            Waiters.erase(it);
+            h.resume();
+        }
+    }
+
+    auto WaitTurn(uint64_t seq) {
+        struct TAwaitable {
+            // the caller is gone (its future is destroyed) before its turn
+            ~TAwaitable() {
+                if (!handle) {
+                    return;
+                }
+                auto it = conn->Waiters.find(seq);
+                if (it != conn->Waiters.end() && it->second == handle) {
+                    conn->Waiters.erase(it);
+                }
+                auto expired = conn->Expired.find(seq);
+                if (expired != conn->Expired.end()) {
+                    conn->Poller.RemoveTimer(expired->second, TTime{});
+                    conn->Expired.erase(expired);
+                }
+            }
+
+            bool await_ready() const {
+                return conn->ReadSeq == seq || conn->Error;
+            }
+
+            void await_suspend(std::coroutine_handle<> h) {
+                handle = h;
+                conn->Waiters[seq] = h;
+            }
+
+            void await_resume() {
+                handle = {};
+                conn->Expired.erase(seq);
+            }
+
+            THttpConnection* conn;
+            uint64_t seq;
+            std::coroutine_handle<> handle = {};
+        };
+        return TAwaitable{this, seq};
+    }
+
+    // Makes room for at least ReadChunk/2 bytes after WPos, keeps [RPos, WPos)
+    void Compact() {
+        if (RPos == WPos) {
+            RPos = WPos = 0;
+        }
+        if (Buffer.size() - WPos < ReadChunk / 2) {
+            if (RPos > 0) {
+                memmove(Buffer.data(), Buffer.data() + RPos, WPos - RPos);
+                WPos -= RPos;
+                RPos = 0;
+            }
+            if (Buffer.size() - WPos < ReadChunk / 2) {
+                Buffer.resize(Buffer.size() * 2);
+            }
+        }
+    }
+
+    // Returns false on EOF
+    TFuture<bool> Fill() {
+        Compact();
+        ssize_t size;
+        do {
+            size = co_await Socket.ReadSome(Buffer.data() + WPos, Buffer.size() - WPos);
+        } while (size < 0);
+        if (Error) {
+            std::rethrow_exception(Error);
+        }
+        WPos += size;
+        co_return size > 0;
+    }
+
+    TPoller& Poller;
+    TSocket Socket;
+    std::vector<char> Buffer;
+    size_t ReadChunk;
+    size_t RPos = 0;
+    size_t WPos = 0;
+
+    // requests serialized but not yet written, flushed by one writer at a time
+    std::string Output;
+    bool Writing = false;
+
+    uint64_t NextSeq = 0;
+    uint64_t ReadSeq = 0;
+    std::map<uint64_t, std::coroutine_handle<>> Waiters;
+    // waiters of the expired deadlines, resumed by a timer
+    std::map<uint64_t, unsigned> Expired;
+
+    std::exception_ptr Error;
+    bool Closing = false;
+    bool ShutDown = false;
+};
+
+} // namespace NDetail
+
+// Response with the head read and the body left on the connection.
+// The body must be read to the end before the connection can deliver the next
+// pipelined response; a response dropped before that closes its connection.
+template<typename TSocket>
+class THttpClientResponse {
+public:
+    THttpClientResponse() = default;
+    THttpClientResponse(THttpClientResponse&& other) = default;
+    THttpClientResponse& operator=(THttpClientResponse&& other) {
+        if (this != &other) {
+            Abandon();
+            Head_ = std::move(other.Head_);
+            Reply_ = std::move(other.Reply_);
+            Conn_ = std::move(other.Conn_);
+            Timer_ = std::move(other.Timer_);
+            BodyType_ = other.BodyType_;
+            Left_ = other.Left_;
+            Decoder_ = other.Decoder_;
+            Deadline_ = other.Deadline_;
+            Seq_ = other.Seq_;
+        }
+        return *this;
+    }
+
+    ~THttpClientResponse() {
+        Abandon();
+    }
+
+    // Status, reason and headers stay valid for the lifetime of the response
+    const THttpReply& Head() const { return Reply_; }
+    int Status() const { return Reply_.Status; }
+
+    // Next piece of the body, valid until the next call; empty at the end of the body
+    TFuture<std::string_view> Next() {
+        while (Conn_) {
+            auto& c = *Conn_;
+            if (c.Error) {
+                Throw();
+            }
+            std::string_view data(c.Buffer.data() + c.RPos, c.WPos - c.RPos);
+            switch (BodyType_) {
+            case EHttpBody::None:
+                Done();
+                co_return std::string_view{};
+            case EHttpBody::Length:
+                if (!Left_) {
+                    Done();
+                    co_return std::string_view{};
+                }
+                if (!data.empty()) {
+                    auto n = std::min<uint64_t>(Left_, data.size());
+                    c.RPos += n;
+                    Left_ -= n;
+                    co_return data.substr(0, n);
+                }
+                break;
+            case EHttpBody::Chunked: {
+                size_t consumed = 0;
+                std::string_view payload;
+                auto status = Decoder_.Decode(data.data(), data.size(), &consumed, &payload);
+                c.RPos += consumed;
+                if (status == EHttpParseStatus::Error) {
+                    c.Fail(std::make_exception_ptr(std::runtime_error("Bad chunked encoding")));
+                    Throw();
+                }
+                if (status == EHttpParseStatus::Done) {
+                    Done();
+                    co_return std::string_view{};
+                }
+                if (!payload.empty()) {
+                    co_return payload;
+                }
+                break;
+            }
+            case EHttpBody::UntilClose:
+                if (!data.empty()) {
+                    c.RPos = c.WPos;
+                    co_return data;
+                }
+                break;
+            }
+
+            bool more = false;
+            try {
+                more = co_await c.Fill();
+            } catch (...) {
+                c.Fail(std::current_exception());
+            }
+            if (!more && !c.Error) {
+                if (BodyType_ == EHttpBody::UntilClose) {
+                    BodyType_ = EHttpBody::None;
+                } else {
+                    c.Fail(std::make_exception_ptr(std::system_error(std::make_error_code(std::errc::connection_reset))));
+                }
+            }
+        }
+        co_return std::string_view{};
+    }
+
+    TFuture<std::string> ReadAll() {
+        std::string body;
+        if (BodyType_ == EHttpBody::Length) {
+            body.reserve(Left_);
+        }
+        while (true) {
+            auto piece = co_await Next();
+            if (piece.empty()) {
+                break;
+            }
+            body.append(piece);
+        }
+        co_return body;
+    }
+
+private:
+    friend class THttpClient<TSocket>;
+    using TConnection = NDetail::THttpConnection<TSocket>;
+
+    [[noreturn]] void Throw() {
+        auto error = Conn_->Error;
+        Abandon();
+        if (TClock::now() >= Deadline_) {
+            throw std::system_error(std::make_error_code(std::errc::timed_out));
+        }
+        std::rethrow_exception(error);
+    }
+
+    void Done() {
+        auto conn = std::move(Conn_);
+        Timer_ = {};
+        if (!Reply_.KeepAlive) {
+            conn->Closing = true;
+            conn->Fail(std::make_exception_ptr(std::system_error(std::make_error_code(std::errc::connection_aborted))));
+        }
+        // a response abandoned before its turn has failed the connection,
+        // the one reading now advances and resumes the rest with the error
+        if (conn->ReadSeq == Seq_) {
+            conn->Advance();
+        }
+    }
+
+    // The rest of the body is unread, the connection cannot be reused
+    void Abandon() {
+        if (Conn_) {
+            Conn_->Fail(std::make_exception_ptr(std::system_error(std::make_error_code(std::errc::connection_aborted))));
+            Done();
+        }
+    }
+
+    std::vector<char> Head_;
+    THttpReply Reply_;
+    std::shared_ptr<TConnection> Conn_;
+    TFuture<void> Timer_;
+    EHttpBody BodyType_ = EHttpBody::None;
+    uint64_t Left_ = 0;
+    THttpChunkDecoder Decoder_;
+    TTime Deadline_ = TTime::max();
+    uint64_t Seq_ = 0;
+};
+
+// HTTP/1.1 client keeping a pool of keep-alive connections per address.
+// Concurrent requests to the same address are spread over up to MaxConnectionsPerHost
+// connections and pipelined on them; requests issued while a connection is busy
+// writing are coalesced into its next write.
+template<typename TSocket>
+class THttpClient {
+public:
+    using TPoller = typename TSocket::TPoller;
+    using TResponse = THttpClientResponse<TSocket>;
+
+    THttpClient(TPoller& poller, THttpClientOptions options = {})
+        : Poller_(poller)
+        , Options_(options)
+    { }
+
+    // Sends the request and waits for the head of its response
+    TFuture<TResponse> Send(const TAddress& address, const THttpClientRequest& request) {
+        auto key = address.ToString();
+        auto [conn, fresh] = Pick(key, address);
+        auto seq = conn->NextSeq++;
+        // the reply to HEAD has the headers of the body but not the body (RFC 9112 6.3)
+        bool headRequest = request.Method == "HEAD";
+
+        TResponse response;
+        response.Conn_ = conn;
+        response.Seq_ = seq;
+        response.Deadline_ = request.Deadline;
+        if (request.Deadline != TTime::max()) {
+            response.Timer_ = Watch(conn, seq, request.Deadline);
+        }
+
+        HttpSerializeRequest(conn->Output, request, request.Host.empty() ? std::string_view(key) : request.Host);
+        try {
+            if (fresh) {
+                auto deadline = std::min(request.Deadline, TClock::now() + Options_.ConnectTimeout);
+                co_await conn->Socket.Connect(deadline);
+                conn->Writing = false;
+            }
+            if (!conn->Writing) {
+                // requests serialized while a write is in progress go out with the next write
+                co_await Flush(*conn);
+            }
+        } catch (...) {
+            conn->Fail(std::current_exception());
+        }
+
+        co_await conn->WaitTurn(seq);
+        if (conn->Error) {
+            response.Throw();
+        }
+
+        THttpReplyParser parser(Options_.MaxHeadSize);
+        while (true) {
+            parser.SetHeadOnly(true);
+            parser.SetNoBody(headRequest);
+            auto& c = *conn;
+            auto status = parser.Parse(c.Buffer.data() + c.RPos, c.WPos - c.RPos);
+            if (status == EHttpParseStatus::Done) {
+                c.RPos += parser.Consumed();
+                auto code = parser.Message().Status;
+                if (code >= 100 && code < 200 && code != 101) {
+                    parser.Reset(); // interim response
+                    continue;
+                }
+                break;
+            }
+            if (status == EHttpParseStatus::Error || status == EHttpParseStatus::TooLarge) {
+                c.Fail(std::make_exception_ptr(std::runtime_error("Bad HTTP reply")));
+                response.Throw();
+            }
+            bool more = false;
+            try {
+                more = co_await c.Fill();
+            } catch (...) {
+                c.Fail(std::current_exception());
+            }
+            if (!more) {
+                c.Fail(std::make_exception_ptr(std::system_error(std::make_error_code(std::errc::connection_reset))));
+                response.Throw();
+            }
+        }
+
+        // copy the head so that it outlives buffer compaction while the body is read
+        const char* base = conn->Buffer.data() + conn->RPos - parser.HeadSize();
+        response.Head_.assign(base, base + parser.HeadSize());
+        response.Reply_ = parser.Message();
+        const char* newBase = response.Head_.data();
+        response.Reply_.Reason = std::string_view(newBase + (response.Reply_.Reason.data() - base), response.Reply_.Reason.size());
+        response.Reply_.Headers.Rebase(base, newBase);
+        response.BodyType_ = parser.BodyType();
+        response.Left_ = parser.ContentLength();
+        if (!response.Reply_.KeepAlive) {
+            conn->Closing = true;
+        }
+        co_return std::move(response);
+    }
+
+    // Sends the request and reads the whole response body
+    TFuture<std::pair<TResponse, std::string>> Fetch(const TAddress& address, const THttpClientRequest& request) {
+        auto response = co_await Send(address, request);
+        auto body = co_await response.ReadAll();
+        co_return std::make_pair(std::move(response), std::move(body));
+    }
+
+    size_t Connections() const {
+        size_t n = 0;
+        for (const auto& [_, conns] : Hosts_) {
+            n += conns.size();
+        }
+        return n;
+    }
+
+private:
+    using TConnection = NDetail::THttpConnection<TSocket>;
+
+    std::pair<std::shared_ptr<TConnection>, bool> Pick(const std::string& key, const TAddress& address) {
+        auto& conns = Hosts_[key];
+        std::erase_if(conns, [](auto& c) { return !c->Usable(); });
+        std::shared_ptr<TConnection> best;
+        for (auto& c : conns) {
+            if (!best || c->Inflight() < best->Inflight()) {
+                best = c;
+            }
+        }
+        if (best && (best->Inflight() < Options_.MaxPipeline || conns.size() >= Options_.MaxConnectionsPerHost)) {
+            return {best, false};
+        }
+        auto conn = std::make_shared<TConnection>(address, Poller_, Options_.ReadChunk);
+        // the connecting request flushes the output once connected
+        conn->Writing = true;
+        conns.emplace_back(conn);
+        return {conn, true};
+    }
+
+    TFuture<void> Flush(TConnection& conn) {
+        conn.Writing = true;
+        std::string pending;
+        while (!conn.Output.empty() && !conn.Error) {
+            pending.clear();
+            std::swap(pending, conn.Output);
+            co_await TByteWriter(conn.Socket).Write(pending.data(), pending.size());
+        }
+        conn.Writing = false;
+        co_return;
+    }
+
+    TFuture<void> Watch(std::shared_ptr<TConnection> conn, uint64_t seq, TTime deadline) {
+        co_await Poller_.Sleep(deadline);
+        conn->Expire(seq);
+        co_return;
+    }
+
+    TPoller& Poller_;
+    THttpClientOptions Options_;
+    std::unordered_map<std::string, std::vector<std::shared_ptr<TConnection>>> Hosts_;
+};
+
+} // namespace NNet
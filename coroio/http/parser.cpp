@@ -0,0 +1,629 @@
+#include "parser.hpp"
+
+#include <algorithm>
+#include <type_traits>
+
+#include <string.h>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+namespace NNet {
+
+namespace {
+
+inline char ToLower(char ch) {
+    return (ch >= 'A' && ch <= 'Z') ? ch - 'A' + 'a' : ch;
+}
+
+inline bool IsTokenChar(char ch) {
+    if ((ch >= 'a' && ch <= 'z') || (ch >= 'A' && ch <= 'Z') || (ch >= '0' && ch <= '9')) {
+        return true;
+    }
+    return strchr("!#$%&'*+-.^_`|~", ch) != nullptr && ch != 0;
+}
+
+inline bool IsToken(std::string_view s) {
+    if (s.empty()) {
+        return false;
+    }
+    for (auto ch : s) {
+        if (!IsTokenChar(ch)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+inline std::string_view Trim(std::string_view s) {
+    while (!s.empty() && (s.front() == ' ' || s.front() == '\t')) {
+        s.remove_prefix(1);
+    }
+    while (!s.empty() && (s.back() == ' ' || s.back() == '\t')) {
+        s.remove_suffix(1);
+    }
+    return s;
+}
+
+bool ParseDecimal(std::string_view s, uint64_t* value) {
+    if (s.empty() || s.size() > 19) {
+        return false;
+    }
+    uint64_t v = 0;
+    for (auto ch : s) {
+        if (ch < '0' || ch > '9') {
+            return false;
+        }
+        v = v * 10 + (ch - '0');
+    }
+    *value = v;
+    return true;
+}
+
+bool ParseHex(std::string_view s, uint64_t* value) {
+    if (s.empty() || s.size() > 15) {
+        return false;
+    }
+    uint64_t v = 0;
+    for (auto ch : s) {
+        int d;
+        if (ch >= '0' && ch <= '9') {
+            d = ch - '0';
+        } else if (ch >= 'a' && ch <= 'f') {
+            d = ch - 'a' + 10;
+        } else if (ch >= 'A' && ch <= 'F') {
+            d = ch - 'A' + 10;
+        } else {
+            return false;
+        }
+        v = (v << 4) | d;
+    }
+    *value = v;
+    return true;
+}
+
+bool ParseVersion(std::string_view s, int* minor) {
+    if (s.size() != 8 || s.substr(0, 7) != "HTTP/1." || s[7] < '0' || s[7] > '9') {
+        return false;
+    }
+    *minor = s[7] - '0';
+    return true;
+}
+
+inline void RebaseView(std::string_view& v, const char* oldBase, const char* newBase) {
+    if (v.data()) {
+        v = std::string_view(newBase + (v.data() - oldBase), v.size());
+    }
+}
+
+void RebaseMessage(THttpRequest& r, const char* oldBase, const char* newBase) {
+    RebaseView(r.Method, oldBase, newBase);
+    RebaseView(r.Target, oldBase, newBase);
+    RebaseView(r.Path, oldBase, newBase);
+    RebaseView(r.Query, oldBase, newBase);
+    RebaseView(r.Body, oldBase, newBase);
+    r.Headers.Rebase(oldBase, newBase);
+}
+
+void RebaseMessage(THttpReply& r, const char* oldBase, const char* newBase) {
+    RebaseView(r.Reason, oldBase, newBase);
+    RebaseView(r.Body, oldBase, newBase);
+    r.Headers.Rebase(oldBase, newBase);
+}
+
+void ResetMessage(THttpRequest& r) {
+    r.Method = r.Target = r.Path = r.Query = r.Body = {};
+    r.VersionMinor = 1;
+    r.Headers.Clear();
+    r.KeepAlive = true;
+    r.Chunked = false;
+}
+
+void ResetMessage(THttpReply& r) {
+    r.Status = 0;
+    r.Reason = r.Body = {};
+    r.VersionMinor = 1;
+    r.Headers.Clear();
+    r.KeepAlive = true;
+    r.Chunked = false;
+}
+
+bool ParseStartLine(THttpRequest& r, std::string_view line) {
+    auto p1 = line.find(' ');
+    if (p1 == std::string_view::npos) {
+        return false;
+    }
+    auto p2 = line.find(' ', p1 + 1);
+    if (p2 == std::string_view::npos) {
+        return false;
+    }
+    r.Method = line.substr(0, p1);
+    r.Target = line.substr(p1 + 1, p2 - p1 - 1);
+    if (!IsToken(r.Method) || r.Target.empty()) {
+        return false;
+    }
+    if (!ParseVersion(line.substr(p2 + 1), &r.VersionMinor)) {
+        return false;
+    }
+    auto q = r.Target.find('?');
+    if (q == std::string_view::npos) {
+        r.Path = r.Target;
+    } else {
+        r.Path = r.Target.substr(0, q);
+        r.Query = r.Target.substr(q + 1);
+    }
+    return true;
+}
+
+bool ParseStartLine(THttpReply& r, std::string_view line) {
+    if (line.size() < 12 || !ParseVersion(line.substr(0, 8), &r.VersionMinor) || line[8] != ' ') {
+        return false;
+    }
+    uint64_t status;
+    if (!ParseDecimal(line.substr(9, 3), &status) || status < 100 || status > 999) {
+        return false;
+    }
+    r.Status = static_cast<int>(status);
+    if (line.size() > 12) {
+        if (line[12] != ' ') {
+            return false;
+        }
+        r.Reason = line.substr(13);
+    }
+    return true;
+}
+
+} // namespace
+
+const char* HttpFindChar(const char* p, const char* end, char ch) {
+#if defined(__SSE2__)
+    const __m128i needle = _mm_set1_epi8(ch);
+    while (end - p >= 16) {
+        __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+        int mask = _mm_movemask_epi8(_mm_cmpeq_epi8(chunk, needle));
+        if (mask) {
+            return p + __builtin_ctz(mask);
+        }
+        p += 16;
+    }
+#elif defined(__ARM_NEON)
+    const uint8x16_t needle = vdupq_n_u8(static_cast<uint8_t>(ch));
+    while (end - p >= 16) {
+        uint8x16_t eq = vceqq_u8(vld1q_u8(reinterpret_cast<const uint8_t*>(p)), needle);
+        // 4 bits per input byte
+        uint64_t mask = vget_lane_u64(vreinterpret_u64_u8(vshrn_n_u16(vreinterpretq_u16_u8(eq), 4)), 0);
+        if (mask) {
+            return p + (__builtin_ctzll(mask) >> 2);
+        }
+        p += 16;
+    }
+#endif
+    for (; p < end; ++p) {
+        if (*p == ch) {
+            return p;
+        }
+    }
+    return end;
+}
+
+size_t HttpFindHeadEnd(const char* data, size_t size, size_t from) {
+    const char* end = data + size;
+    const char* p = data + from;
+    while ((p = HttpFindChar(p, end, '\r')) != end) {
+        if (end - p < 4) {
+            return std::string_view::npos;
+        }
+        if (p[1] == '\n' && p[2] == '\r' && p[3] == '\n') {
+            return p - data;
+        }
+        ++p;
+    }
+    return std::string_view::npos;
+}
+
+bool HttpIEquals(std::string_view a, std::string_view b) {
+    if (a.size() != b.size()) {
+        return false;
+    }
+    for (size_t i = 0; i < a.size(); i++) {
+        if (ToLower(a[i]) != ToLower(b[i])) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool HttpHasToken(std::string_view value, std::string_view token) {
+    while (!value.empty()) {
+        auto pos = value.find(',');
+        if (HttpIEquals(Trim(value.substr(0, pos)), token)) {
+            return true;
+        }
+        if (pos == std::string_view::npos) {
+            break;
+        }
+        value.remove_prefix(pos + 1);
+    }
+    return false;
+}
+
+std::string_view THttpHeaders::Get(std::string_view name) const {
+    for (const auto& h : *this) {
+        if (HttpIEquals(h.Name, name)) {
+            return h.Value;
+        }
+    }
+    return {};
+}
+
+bool THttpHeaders::Has(std::string_view name) const {
+    for (const auto& h : *this) {
+        if (HttpIEquals(h.Name, name)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool THttpHeaders::Add(std::string_view name, std::string_view value) {
+    if (Size_ == MaxHeaders) {
+        return false;
+    }
+    Headers_[Size_++] = THttpHeader{name, value};
+    return true;
+}
+
+void THttpHeaders::Rebase(const char* oldBase, const char* newBase) {
+    for (size_t i = 0; i < Size_; i++) {
+        RebaseView(Headers_[i].Name, oldBase, newBase);
+        RebaseView(Headers_[i].Value, oldBase, newBase);
+    }
+}
+
+template<typename TMessage>
+void THttpParser<TMessage>::Reset() {
+    ResetMessage(Message_);
+    Base_ = nullptr;
+    Scanned_ = HeadSize_ = Consumed_ = 0;
+    BodyType_ = EHttpBody::None;
+    ContentLength_ = 0;
+    NoBody_ = false;
+    HeadOnly_ = false;
+    ChunkState_ = EChunk::Size;
+    ChunkReadPos_ = ChunkWritePos_ = 0;
+    ChunkLeft_ = 0;
+}
+
+template<typename TMessage>
+void THttpParser<TMessage>::Rebase(const char* newBase) {
+    RebaseMessage(Message_, Base_, newBase);
+    Base_ = newBase;
+}
+
+template<typename TMessage>
+EHttpParseStatus THttpParser<TMessage>::Parse(char* data, size_t size) {
+    if (Consumed_) {
+        return EHttpParseStatus::Done;
+    }
+    if (HeadSize_ && Base_ != data) {
+        Rebase(data);
+    }
+    Base_ = data;
+
+    if (!HeadSize_) {
+        auto pos = HttpFindHeadEnd(data, size, Scanned_);
+        if (pos == std::string_view::npos) {
+            if (size > MaxHeadSize_) {
+                return EHttpParseStatus::TooLarge;
+            }
+            Scanned_ = size > 3 ? size - 3 : 0;
+            return EHttpParseStatus::Incomplete;
+        }
+        if (pos + 4 > MaxHeadSize_) {
+            return EHttpParseStatus::TooLarge;
+        }
+        HeadSize_ = pos + 4;
+        if (!ParseHead(data)) {
+            return EHttpParseStatus::Error;
+        }
+        if (ContentLength_ > MaxBodySize_) {
+            return EHttpParseStatus::TooLarge;
+        }
+        ChunkReadPos_ = ChunkWritePos_ = HeadSize_;
+        if (HeadOnly_) {
+            Consumed_ = HeadSize_;
+            return EHttpParseStatus::Done;
+        }
+    }
+
+    return ParseBody(data, size);
+}
+
+template<typename TMessage>
+EHttpParseStatus THttpParser<TMessage>::Finish(char* data, size_t size) {
+    auto status = Parse(data, size);
+    if (status != EHttpParseStatus::Incomplete) {
+        return status;
+    }
+    if (!HeadSize_) {
+        return size == 0 ? EHttpParseStatus::Incomplete : EHttpParseStatus::Error;
+    }
+    if (BodyType_ == EHttpBody::UntilClose) {
+        Message_.Body = std::string_view(data + HeadSize_, size - HeadSize_);
+        Consumed_ = size;
+        return EHttpParseStatus::Done;
+    }
+    return EHttpParseStatus::Error;
+}
+
+template<typename TMessage>
+bool THttpParser<TMessage>::ParseHead(char* data) {
+    const char* p = data;
+    const char* end = data + HeadSize_;
+    // RFC 9112 2.2: ignore empty line(s) received prior to the start line
+    while (end - p > 4 && p[0] == '\r' && p[1] == '\n') {
+        p += 2;
+    }
+
+    const char* eol = HttpFindChar(p, end, '\r');
+    if (eol == end || !ParseStartLine(Message_, std::string_view(p, eol - p))) {
+        return false;
+    }
+    p = eol + 2;
+
+    bool hasLength = false;
+    bool encoded = false;
+    while (p < end) {
+        eol = HttpFindChar(p, end, '\r');
+        if (eol == end || eol[1] != '\n') {
+            return false;
+        }
+        if (eol == p) {
+            break; // empty line
+        }
+        std::string_view line(p, eol - p);
+        p = eol + 2;
+        if (line[0] == ' ' || line[0] == '\t') {
+            return false; // obsolete line folding
+        }
+        auto colon = line.find(':');
+        if (colon == std::string_view::npos) {
+            return false;
+        }
+        auto name = line.substr(0, colon);
+        auto value = Trim(line.substr(colon + 1));
+        if (!IsToken(name) || !Message_.Headers.Add(name, value)) {
+            return false;
+        }
+
+        if (HttpIEquals(name, "content-length")) {
+            uint64_t length;
+            if (!ParseDecimal(value, &length) || (hasLength && length != ContentLength_)) {
+                return false;
+            }
+            hasLength = true;
+            ContentLength_ = length;
+        } else if (HttpIEquals(name, "transfer-encoding")) {
+            // the codings of all of the lines in order, chunked is only valid as the last one (RFC 9112 6.1)
+            while (!value.empty()) {
+                auto pos = value.find(',');
+                auto coding = Trim(value.substr(0, pos));
+                if (!coding.empty()) {
+                    if constexpr (std::is_same_v<TMessage, THttpRequest>) {
+                        if (Message_.Chunked) {
+                            return false;
+                        }
+                    }
+                    encoded = true;
+                    Message_.Chunked = HttpIEquals(coding, "chunked");
+                }
+                if (pos == std::string_view::npos) {
+                    break;
+                }
+                value.remove_prefix(pos + 1);
+            }
+        } else if (HttpIEquals(name, "connection")) {
+            if (HttpHasToken(value, "close")) {
+                Message_.KeepAlive = false;
+            }
+        }
+    }
+
+    if (Message_.VersionMinor == 0 && !HttpHasToken(Message_.Headers.Get("connection"), "keep-alive")) {
+        Message_.KeepAlive = false;
+    }
+
+    if constexpr (std::is_same_v<TMessage, THttpRequest>) {
+        if ((Message_.Chunked && hasLength) || (encoded && !Message_.Chunked)) {
+            return false; // request smuggling guard, RFC 9112 6.3: 400
+        }
+    } else {
+        if (NoBody_ || Message_.Status < 200 || Message_.Status == 204 || Message_.Status == 304) {
+            BodyType_ = EHttpBody::None;
+            return true;
+        }
+    }
+
+    if (Message_.Chunked) {
+        BodyType_ = EHttpBody::Chunked;
+    } else if (encoded) {
+        // only replies get here: without chunked at the end the body lasts until the close
+        BodyType_ = EHttpBody::UntilClose;
+        Message_.KeepAlive = false;
+    } else if (hasLength) {
+        BodyType_ = ContentLength_ ? EHttpBody::Length : EHttpBody::None;
+    } else if constexpr (std::is_same_v<TMessage, THttpReply>) {
+        BodyType_ = EHttpBody::UntilClose;
+        Message_.KeepAlive = false;
+    } else {
+        BodyType_ = EHttpBody::None;
+    }
+
+    return true;
+}
+
+template<typename TMessage>
+EHttpParseStatus THttpParser<TMessage>::ParseBody(char* data, size_t size) {
+    switch (BodyType_) {
+    case EHttpBody::None:
+        Consumed_ = HeadSize_;
+        return EHttpParseStatus::Done;
+    case EHttpBody::Length:
+        if (size - HeadSize_ < ContentLength_) {
+            return EHttpParseStatus::Incomplete;
+        }
+        Message_.Body = std::string_view(data + HeadSize_, ContentLength_);
+        Consumed_ = HeadSize_ + ContentLength_;
+        return EHttpParseStatus::Done;
+    case EHttpBody::Chunked:
+        return ParseChunked(data, size);
+    case EHttpBody::UntilClose:
+        return size - HeadSize_ > MaxBodySize_
+            ? EHttpParseStatus::TooLarge
+            : EHttpParseStatus::Incomplete;
+    }
+    return EHttpParseStatus::Error;
+}
+
+template<typename TMessage>
+EHttpParseStatus THttpParser<TMessage>::ParseChunked(char* data, size_t size) {
+    static constexpr size_t maxLine = 4096;
+    const char* end = data + size;
+    while (true) {
+        switch (ChunkState_) {
+        case EChunk::Size:
+        case EChunk::Trailer: {
+            const char* p = data + ChunkReadPos_;
+            const char* eol = HttpFindChar(p, end, '\r');
+            if (eol == end || eol + 1 == end) {
+                return static_cast<size_t>(end - p) > maxLine
+                    ? EHttpParseStatus::Error
+                    : EHttpParseStatus::Incomplete;
+            }
+            if (eol[1] != '\n') {
+                return EHttpParseStatus::Error;
+            }
+            std::string_view line(p, eol - p);
+            ChunkReadPos_ = eol + 2 - data;
+            if (ChunkState_ == EChunk::Trailer) {
+                if (line.empty()) {
+                    Message_.Body = std::string_view(data + HeadSize_, ChunkWritePos_ - HeadSize_);
+                    Consumed_ = ChunkReadPos_;
+                    return EHttpParseStatus::Done;
+                }
+                continue; // trailer fields are ignored
+            }
+            auto ext = line.find(';');
+            if (!ParseHex(Trim(line.substr(0, ext)), &ChunkLeft_)) {
+                return EHttpParseStatus::Error;
+            }
+            if (ChunkWritePos_ - HeadSize_ + ChunkLeft_ > MaxBodySize_) {
+                return EHttpParseStatus::TooLarge;
+            }
+            ChunkState_ = ChunkLeft_ ? EChunk::Data : EChunk::Trailer;
+            break;
+        }
+        case EChunk::Data: {
+            size_t n = std::min<uint64_t>(size - ChunkReadPos_, ChunkLeft_);
+            if (n == 0) {
+                return EHttpParseStatus::Incomplete;
+            }
+            if (ChunkWritePos_ != ChunkReadPos_) {
+                memmove(data + ChunkWritePos_, data + ChunkReadPos_, n);
+            }
+            ChunkWritePos_ += n;
+            ChunkReadPos_ += n;
+            ChunkLeft_ -= n;
+            if (ChunkLeft_) {
+                return EHttpParseStatus::Incomplete;
+            }
+            ChunkState_ = EChunk::DataCrlf;
+            break;
+        }
+        case EChunk::DataCrlf:
+            if (size - ChunkReadPos_ < 2) {
+                return EHttpParseStatus::Incomplete;
+            }
+            if (data[ChunkReadPos_] != '\r' || data[ChunkReadPos_ + 1] != '\n') {
+                return EHttpParseStatus::Error;
+            }
+            ChunkReadPos_ += 2;
+            ChunkState_ = EChunk::Size;
+            break;
+        }
+    }
+}
+
+EHttpParseStatus THttpChunkDecoder::Decode(const char* data, size_t size, size_t* consumed, std::string_view* payload) {
+    static constexpr size_t maxLine = 4096;
+    const char* p = data;
+    const char* end = data + size;
+    *payload = {};
+    while (true) {
+        switch (State_) {
+        case EState::Size:
+        case EState::Trailer: {
+            const char* eol = HttpFindChar(p, end, '\r');
+            if (eol == end || eol + 1 == end) {
+                *consumed = p - data;
+                return static_cast<size_t>(end - p) > maxLine
+                    ? EHttpParseStatus::Error
+                    : EHttpParseStatus::Incomplete;
+            }
+            if (eol[1] != '\n') {
+                return EHttpParseStatus::Error;
+            }
+            std::string_view line(p, eol - p);
+            p = eol + 2;
+            if (State_ == EState::Trailer) {
+                if (line.empty()) {
+                    *consumed = p - data;
+                    return EHttpParseStatus::Done;
+                }
+                continue;
+            }
+            auto ext = line.find(';');
+            if (!ParseHex(Trim(line.substr(0, ext)), &Left_)) {
+                return EHttpParseStatus::Error;
+            }
+            State_ = Left_ ? EState::Data : EState::Trailer;
+            break;
+        }
+        case EState::Data: {
+            size_t n = std::min<uint64_t>(end - p, Left_);
+            *payload = std::string_view(p, n);
+            p += n;
+            Left_ -= n;
+            if (!Left_) {
+                State_ = EState::DataCrlf;
+            }
+            *consumed = p - data;
+            return EHttpParseStatus::Incomplete;
+        }
+        case EState::DataCrlf:
+            if (end - p < 2) {
+                *consumed = p - data;
+                return EHttpParseStatus::Incomplete;
+            }
+            if (p[0] != '\r' || p[1] != '\n') {
+                return EHttpParseStatus::Error;
+            }
+            p += 2;
+            State_ = EState::Size;
+            break;
+        }
+    }
+}
+
+void THttpChunkDecoder::Reset() {
+    State_ = EState::Size;
+    Left_ = 0;
+}
+
+template class THttpParser<THttpRequest>;
+template class THttpParser<THttpReply>;
+
+} // namespace NNet
@@ -0,0 +1,181 @@
+#pragma once
+
+#include <array>
+#include <string_view>
+#include <cstddef>
+#include <cstdint>
+
+namespace NNet {
+
+enum class EHttpParseStatus {
+    Incomplete,
+    Done,
+    Error,
+    // the head or the body is over its limit, HeadDone() tells which
+    TooLarge
+};
+
+// How the body of a message is delimited, RFC 9112 6.3
+enum class EHttpBody {
+    None,
+    Length,
+    Chunked,
+    UntilClose
+};
+
+struct THttpHeader {
+    std::string_view Name;
+    std::string_view Value;
+};
+
+// Fixed capacity header list, views point into the parsed buffer
+class THttpHeaders {
+public:
+    static constexpr size_t MaxHeaders = 64;
+
+    // case-insensitive lookup, returns empty view if not found
+    std::string_view Get(std::string_view name) const;
+    bool Has(std::string_view name) const;
+
+    bool Add(std::string_view name, std::string_view value);
+    void Clear() { Size_ = 0; }
+
+    size_t Size() const { return Size_; }
+    const THttpHeader* begin() const { return Headers_.data(); }
+    const THttpHeader* end() const { return Headers_.data() + Size_; }
+
+    void Rebase(const char* oldBase, const char* newBase);
+
+private:
+    std::array<THttpHeader, MaxHeaders> Headers_;
+    size_t Size_ = 0;
+};
+
+struct THttpRequest {
+    std::string_view Method;
+    std::string_view Target;
+    std::string_view Path;
+    std::string_view Query;
+    int VersionMinor = 1;
+    THttpHeaders Headers;
+    std::string_view Body;
+    bool KeepAlive = true;
+    bool Chunked = false;
+};
+
+struct THttpReply {
+    int Status = 0;
+    std::string_view Reason;
+    int VersionMinor = 1;
+    THttpHeaders Headers;
+    std::string_view Body;
+    bool KeepAlive = true;
+    bool Chunked = false;
+};
+
+// Incremental zero-copy parser for HTTP/1.x messages.
+// The caller owns the input buffer: on every call it passes the start of the current
+// message and the number of bytes received so far. The buffer may be moved or grown
+// between calls, parsed views are rebased on the new location.
+// Chunked bodies are decoded in place, so the buffer must be writable.
+template<typename TMessage>
+class THttpParser {
+public:
+    THttpParser(size_t maxHeadSize = 64 * 1024, size_t maxBodySize = 64 * 1024 * 1024)
+        : MaxHeadSize_(maxHeadSize)
+        , MaxBodySize_(maxBodySize)
+    { }
+
+    EHttpParseStatus Parse(char* data, size_t size);
+    // Signals that no more data will arrive (peer closed the connection).
+    // Completes replies delimited by connection close.
+    EHttpParseStatus Finish(char* data, size_t size);
+
+    // Number of bytes occupied by the message, valid after Done
+    size_t Consumed() const { return Consumed_; }
+    // Number of head bytes, valid once head is parsed
+    size_t HeadSize() const { return HeadSize_; }
+    bool HeadDone() const { return HeadSize_ != 0; }
+
+    const TMessage& Message() const { return Message_; }
+
+    // For replies to HEAD requests and 1xx/204/304 status codes
+    void SetNoBody(bool noBody) { NoBody_ = noBody; }
+    // Stop after the head, Consumed() then covers the head only and the body
+    // is left to the caller (streaming readers)
+    void SetHeadOnly(bool headOnly) { HeadOnly_ = headOnly; }
+
+    // Valid once head is parsed
+    EHttpBody BodyType() const { return BodyType_; }
+    uint64_t ContentLength() const { return ContentLength_; }
+
+    void Reset();
+
+private:
+    bool ParseHead(char* data);
+    EHttpParseStatus ParseBody(char* data, size_t size);
+    EHttpParseStatus ParseChunked(char* data, size_t size);
+    void Rebase(const char* newBase);
+
+    enum class EChunk {
+        Size,
+        Data,
+        DataCrlf,
+        Trailer
+    };
+
+    TMessage Message_;
+    size_t MaxHeadSize_;
+    size_t MaxBodySize_;
+    const char* Base_ = nullptr;
+    size_t Scanned_ = 0;
+    size_t HeadSize_ = 0;
+    size_t Consumed_ = 0;
+    EHttpBody BodyType_ = EHttpBody::None;
+    uint64_t ContentLength_ = 0;
+    bool NoBody_ = false;
+    bool HeadOnly_ = false;
+
+    // chunked decoder state, offsets relative to Base_
+    EChunk ChunkState_ = EChunk::Size;
+    size_t ChunkReadPos_ = 0;
+    size_t ChunkWritePos_ = 0;
+    uint64_t ChunkLeft_ = 0;
+};
+
+// Incremental decoder of the chunked transfer coding for bodies that are consumed
+// piece by piece instead of being buffered whole.
+class THttpChunkDecoder {
+public:
+    // Decodes data[0, size): on return *consumed bytes of input may be dropped and
+    // *payload (pointing into data) holds the next piece of the body, possibly empty.
+    // Incomplete means more input is needed unless payload is not empty.
+    EHttpParseStatus Decode(const char* data, size_t size, size_t* consumed, std::string_view* payload);
+
+    void Reset();
+
+private:
+    enum class EState {
+        Size,
+        Data,
+        DataCrlf,
+        Trailer
+    };
+
+    EState State_ = EState::Size;
+    uint64_t Left_ = 0;
+};
+
+using THttpRequestParser = THttpParser<THttpRequest>;
+using THttpReplyParser = THttpParser<THttpReply>;
+
+// SIMD accelerated search for the first occurrence of ch, returns end if not found
+const char* HttpFindChar(const char* begin, const char* end, char ch);
+// Returns offset of the "\r\n\r\n" terminating a message head, or npos
+size_t HttpFindHeadEnd(const char* data, size_t size, size_t from);
+
+bool HttpIEquals(std::string_view a, std::string_view b);
+// Checks whether a comma separated header value contains token (case-insensitive)
+bool HttpHasToken(std::string_view value, std::string_view token);
+
+} // namespace NNet
@@ -0,0 +1,217 @@
+#include "server.hpp"
+
+#include <charconv>
+#include <time.h>
+
+namespace NNet {
+
+namespace {
+
+// bodies up to this size are copied next to the head instead of being referenced
+constexpr size_t inlineBodySize = 512;
+
+void AppendNumber(std::string& out, uint64_t value, int base = 10) {
+    char buf[24];
+    auto [end, ec] = std::to_chars(buf, buf + sizeof(buf), value, base);
+    out.append(buf, end - buf);
+}
+
+} // namespace
+
+const char* HttpStatusReason(int status) {
+    switch (status) {
+    case 100: return "Continue";
+    case 101: return "Switching Protocols";
+    case 200: return "OK";
+    case 201: return "Created";
+    case 202: return "Accepted";
+    case 204: return "No Content";
+    case 206: return "Partial Content";
+    case 301: return "Moved Permanently";
+    case 302: return "Found";
+    case 304: return "Not Modified";
+    case 307: return "Temporary Redirect";
+    case 308: return "Permanent Redirect";
+    case 400: return "Bad Request";
+    case 401: return "Unauthorized";
+    case 403: return "Forbidden";
+    case 404: return "Not Found";
+    case 405: return "Method Not Allowed";
+    case 408: return "Request Timeout";
+    case 409: return "Conflict";
+    case 411: return "Length Required";
+    case 413: return "Content Too Large";
+    case 414: return "URI Too Long";
+    case 429: return "Too Many Requests";
+    case 431: return "Request Header Fields Too Large";
+    case 500: return "Internal Server Error";
+    case 501: return "Not Implemented";
+    case 502: return "Bad Gateway";
+    case 503: return "Service Unavailable";
+    case 504: return "Gateway Timeout";
+    default: return "Unknown";
+    }
+}
+
+std::string_view HttpDate() {
+    static thread_local time_t last = 0;
+    static thread_local char buf[64];
+    static thread_local size_t len = 0;
+    time_t now = time(nullptr);
+    if (now != last) {
+        tm t;
+#ifdef _WIN32
+        gmtime_s(&t, &now);
+#else
+        gmtime_r(&now, &t);
+#endif
+        len = strftime(buf, sizeof(buf), "%a, %d %b %Y %H:%M:%S GMT", &t);
+        last = now;
+    }
+    return std::string_view(buf, len);
+}
+
+void THttpResponse::SetStatus(int status, std::string_view reason) {
+    Status_ = status;
+    Reason_ = reason;
+}
+
+void THttpResponse::AddHeader(std::string_view name, std::string_view value) {
+    Headers_.append(name);
+    Headers_.append(": ");
+    Headers_.append(value);
+    Headers_.append("\r\n");
+}
+
+void THttpResponse::SetBody(std::string body) {
+    Body_ = std::move(body);
+    BodyView_ = {};
+}
+
+void THttpResponse::SetBodyView(std::string_view body) {
+    Body_.clear();
+    BodyView_ = body;
+}
+
+void THttpResponse::AddChunk(std::string chunk) {
+    Chunked_ = true;
+    if (!chunk.empty()) {
+        Chunks_.emplace_back(std::move(chunk));
+    }
+}
+
+void THttpResponse::Reset() {
+    Status_ = 200;
+    Reason_.clear();
+    Headers_.clear();
+    Body_.clear();
+    BodyView_ = {};
+    Chunks_.clear();
+    Chunked_ = false;
+    Close_ = false;
+}
+
+void THttpOutput::Copy(std::string_view data) {
+    if (data.empty()) {
+        return;
+    }
+    if (!Segments_.empty() && !Segments_.back().Ptr && Segments_.back().Offset + Segments_.back().Size == Arena_.size()) {
+        Segments_.back().Size += data.size();
+    } else {
+        Segments_.emplace_back(TSegment{nullptr, Arena_.size(), data.size()});
+    }
+    Arena_.append(data);
+    Size_ += data.size();
+}
+
+void THttpOutput::Ref(std::string_view data) {
+    if (data.size() <= inlineBodySize) {
+        Copy(data);
+    } else {
+        Segments_.emplace_back(TSegment{data.data(), 0, data.size()});
+        Size_ += data.size();
+    }
+}
+
+void THttpOutput::Own(std::string&& data) {
+    if (data.size() <= inlineBodySize) {
+        Copy(data);
+    } else {
+        // std::deque never relocates its elements, the string buffer stays in place
+        Ref(Owned_.emplace_back(std::move(data)));
+    }
+}
+
+void THttpOutput::Append(THttpResponse& response, int versionMinor, bool keepAlive, bool headRequest) {
+    auto status = response.Status_;
+    bool noBody = headRequest || status < 200 || status == 204 || status == 304;
+    bool noLength = status < 200 || status == 204;
+
+    std::string head;
+    head.reserve(128 + response.Headers_.size());
+    head.append("HTTP/1.1 ");
+    AppendNumber(head, status);
+    head.push_back(' ');
+    head.append(response.Reason_.empty() ? HttpStatusReason(status) : response.Reason_);
+    head.append("\r\nDate: ");
+    head.append(HttpDate());
+    head.append("\r\n");
+    if (noLength) {
+        // no framing headers
+    } else if (response.Chunked_) {
+        head.append("Transfer-Encoding: chunked\r\n");
+    } else {
+        head.append("Content-Length: ");
+        AppendNumber(head, response.BodyView_.data() ? response.BodyView_.size() : response.Body_.size());
+        head.append("\r\n");
+    }
+    if (!keepAlive) {
+        head.append("Connection: close\r\n");
+    } else if (versionMinor == 0) {
+        head.append("Connection: keep-alive\r\n");
+    }
+    head.append(response.Headers_);
+    head.append("\r\n");
+    Copy(head);
+
+    if (noBody) {
+        return;
+    }
+
+    if (response.Chunked_) {
+        std::string line;
+        for (auto& chunk : response.Chunks_) {
+            line.clear();
+            AppendNumber(line, chunk.size(), 16);
+            line.append("\r\n");
+            Copy(line);
+            Own(std::move(chunk));
+            Copy("\r\n");
+        }
+        Copy("0\r\n\r\n");
+    } else if (response.BodyView_.data()) {
+        Ref(response.BodyView_);
+    } else {
+        Own(std::move(response.Body_));
+    }
+}
+
+std::vector<iovec>& THttpOutput::Iovecs() {
+    Iovecs_.clear();
+    Iovecs_.reserve(Segments_.size());
+    for (const auto& s : Segments_) {
+        const char* p = s.Ptr ? s.Ptr : Arena_.data() + s.Offset;
+        Iovecs_.emplace_back(iovec{const_cast<char*>(p), s.Size});
+    }
+    return Iovecs_;
+}
+
+void THttpOutput::Clear() {
+    Arena_.clear();
+    Owned_.clear();
+    Segments_.clear();
+    Iovecs_.clear();
+    Size_ = 0;
+}
+
+} // namespace NNet
@@ -0,0 +1,229 @@
+#pragma once
+
+#include <deque>
+#include <functional>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include <string.h>
+
+#include "parser.hpp"
+#include "../corochain.hpp"
+#include "../promises.hpp"
+#include "../sockutils.hpp"
+
+namespace NNet {
+
+const char* HttpStatusReason(int status);
+// Cached RFC 9110 IMF-fixdate, updated once per second
+std::string_view HttpDate();
+
+class THttpResponse {
+public:
+    void SetStatus(int status, std::string_view reason = {});
+    // Content-Length, Transfer-Encoding, Connection and Date are set by the server
+    void AddHeader(std::string_view name, std::string_view value);
+    void SetBody(std::string body);
+    // The body is not copied and must stay valid until the response is written
+    void SetBodyView(std::string_view body);
+    // Switches the response to chunked transfer encoding, one call produces one chunk
+    void AddChunk(std::string chunk);
+    void SetClose() { Close_ = true; }
+
+    int Status() const { return Status_; }
+    bool Closing() const { return Close_; }
+
+    void Reset();
+
+private:
+    friend class THttpOutput;
+
+    int Status_ = 200;
+    std::string Reason_;
+    std::string Headers_;
+    std::string Body_;
+    std::string_view BodyView_;
+    std::vector<std::string> Chunks_;
+    bool Chunked_ = false;
+    bool Close_ = false;
+};
+
+// Serialized responses waiting to be written with one gather write
+class THttpOutput {
+public:
+    void Append(THttpResponse& response, int versionMinor, bool keepAlive, bool headRequest);
+
+    bool Empty() const { return Segments_.empty(); }
+    size_t Size() const { return Size_; }
+
+    // Valid until Clear()
+    std::vector<iovec>& Iovecs();
+    void Clear();
+
+private:
+    struct TSegment {
+        const char* Ptr; // nullptr for data in Arena_
+        size_t Offset;
+        size_t Size;
+    };
+
+    void Copy(std::string_view data);
+    void Ref(std::string_view data);
+    void Own(std::string&& data);
+
+    std::string Arena_;
+    std::deque<std::string> Owned_;
+    std::vector<TSegment> Segments_;
+    std::vector<iovec> Iovecs_;
+    size_t Size_ = 0;
+};
+
+struct THttpServerOptions {
+    size_t ReadChunk = 16 * 1024;
+    size_t MaxHeadSize = 64 * 1024;
+    size_t MaxBodySize = 16 * 1024 * 1024;
+    // pipelined responses are written when this many bytes are pending
+    size_t MaxOutputSize = 256 * 1024;
+};
+
+using THttpHandler = std::function<TFuture<void>(const THttpRequest&, THttpResponse&)>;
+
+// Serves HTTP/1.x requests on one connection until the peer closes it or keep-alive ends.
+// Pipelined requests are handled in order, their responses are collected and written
+// with one gather write once the input buffer holds no more complete requests.
+// The handler is either synchronous or returns an awaitable.
+template<typename TSocket, typename THandler>
+TFuture<void> ServeHttpConnection(TSocket& socket, THandler& handler, const THttpServerOptions& options = {})
+{
+    std::vector<char> buffer(options.ReadChunk);
+    size_t rpos = 0, wpos = 0;
+    THttpRequestParser parser(options.MaxHeadSize, options.MaxBodySize);
+    THttpOutput output;
+    THttpResponse response;
+    bool keepAlive = true;
+
+    while (keepAlive) {
+        auto status = parser.Parse(buffer.data() + rpos, wpos - rpos);
+        if (status == EHttpParseStatus::Done) {
+            const auto& request = parser.Message();
+            response.Reset();
+            std::exception_ptr error;
+            try {
+                if constexpr (std::is_void_v<decltype(handler(request, response))>) {
+                    handler(request, response);
+                } else {
+                    co_await handler(request, response);
+                }
+            } catch (...) {
+                error = std::current_exception();
+            }
+            if (error) {
+                response.Reset();
+                response.SetStatus(500);
+                response.SetClose();
+            }
+            keepAlive = request.KeepAlive && !response.Closing();
+            output.Append(response, request.VersionMinor, keepAlive, request.Method == "HEAD");
+            rpos += parser.Consumed();
+            parser.Reset();
+            if (output.Size() >= options.MaxOutputSize) {
+                auto& iov = output.Iovecs();
+                co_await TByteWriter(socket).Writev(iov.data(), iov.size());
+                output.Clear();
+            }
+            continue;
+        }
+
+        if (status == EHttpParseStatus::Error || status == EHttpParseStatus::TooLarge) {
+            response.Reset();
+            if (status == EHttpParseStatus::Error) {
+                response.SetStatus(400);
+            } else {
+                response.SetStatus(parser.HeadDone() ? 413 : 431);
+            }
+            output.Append(response, 1, false, false);
+            break;
+        }
+
+        if (!output.Empty()) {
+            auto& iov = output.Iovecs();
+            co_await TByteWriter(socket).Writev(iov.data(), iov.size());
+            output.Clear();
+        }
+
+        if (rpos == wpos) {
+            rpos = wpos = 0;
+        }
+        if (buffer.size() - wpos < options.ReadChunk / 2) {
+            if (rpos > 0) {
+                memmove(buffer.data(), buffer.data() + rpos, wpos - rpos);
+                wpos -= rpos;
+                rpos = 0;
+            }
+            if (buffer.size() - wpos < options.ReadChunk / 2) {
+                buffer.resize(buffer.size() * 2);
+            }
+        }
+
+        auto size = co_await socket.ReadSome(buffer.data() + wpos, buffer.size() - wpos);
+        if (size == 0) {
+            break;
+        }
+        if (size < 0) {
+            continue;
+        }
+        wpos += size;
+    }
+
+    if (!output.Empty()) {
+        auto& iov = output.Iovecs();
+        co_await TByteWriter(socket).Writev(iov.data(), iov.size());
+    }
+    co_return;
+}
+
+// Accept loop on top of a listening TSocket, TPollerDrivenSocket or TSslSocket.
+// Must outlive the connections it spawns.
+template<typename TSocket>
+class THttpServer {
+public:
+    THttpServer(TSocket& listener, THttpHandler handler, THttpServerOptions options = {})
+        : Listener_(listener)
+        , Handler_(std::move(handler))
+        , Options_(options)
+    { }
+
+    TFuture<void> Serve() {
+        while (true) {
+            auto client = co_await Listener_.Accept();
+            Serve(std::move(client));
+        }
+        co_return;
+    }
+
+    size_t Connections() const {
+        return Connections_;
+    }
+
+private:
+    using TClient = std::decay_t<decltype(std::declval<TSocket&>().Accept().await_resume())>;
+
+    TVoidTask Serve(TClient client) {
+        Connections_++;
+        try {
+            co_await ServeHttpConnection(client, Handler_, Options_);
+        } catch (const std::exception& ) {
+            // connection reset by peer, nothing to report back
+        }
+        Connections_--;
+        co_return;
+    }
+
+    TSocket& Listener_;
+    THttpHandler Handler_;
+    THttpServerOptions Options_;
+    size_t Connections_ = 0;
+};
+
+} // namespace NNet
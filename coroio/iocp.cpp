@@ -51,6 +51,22 @@ void TIOCp::Send(int fd, const void* buf, int size, std::coroutine_handle<> hand
     }
 }
 
+void TIOCp::Writev(int fd, const iovec* iov, int iovcnt, std::coroutine_handle<> handle)
+{
+    TIO* tio = NewTIO();
+    tio->handle = handle;
+    std::vector<WSABUF> sendBufs(iovcnt);
+    for (int i = 0; i < iovcnt; i++) {
+        sendBufs[i] = WSABUF{(ULONG)iov[i].iov_len, (char*)iov[i].iov_base};
+    }
+    DWORD outSize = 0;
+    auto ret = WSASend((SOCKET)fd, sendBufs.data(), iovcnt, &outSize, 0, (WSAOVERLAPPED*)tio, nullptr);
+    if (ret != 0 && WSAGetLastError() != WSA_IO_PENDING) {
+        FreeTIO(tio);
+        throw std::system_error(WSAGetLastError(), std::generic_category(), "WSASend");
+    }
+}
+
 void TIOCp::Accept(int fd, struct sockaddr* addr, socklen_t* len, std::coroutine_handle<> handle)
 {
     TIO* tio = NewTIO();
@@ -66,6 +66,7 @@ public:
     void Write(int fd, const void* buf, int size, std::coroutine_handle<> handle);
     void Recv(int fd, void* buf, int size, std::coroutine_handle<> handle);
     void Send(int fd, const void* buf, int size, std::coroutine_handle<> handle);
+    void Writev(int fd, const iovec* iov, int iovcnt, std::coroutine_handle<> handle);
     void Accept(int fd, struct sockaddr* addr, socklen_t* len, std::coroutine_handle<> handle);
     void Connect(int fd, const sockaddr* addr, socklen_t len, std::coroutine_handle<> handle);
     void Cancel(int fd);
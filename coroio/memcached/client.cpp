@@ -0,0 +1,99 @@
+#include "client.hpp"
+
+#include <algorithm>
+#include <charconv>
+
+namespace NNet {
+
+namespace {
+
+// FNV-1a with a murmur3 finalizer for a better spread of the ring points
+uint64_t Hash(std::string_view s) {
+    uint64_t h = 14695981039346656037ULL;
+    for (unsigned char c : s) {
+        h ^= c;
+        h *= 1099511628211ULL;
+    }
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    h *= 0xc4ceb9fe1a85ec53ULL;
+    h ^= h >> 33;
+    return h;
+}
+
+template<typename T>
+bool ToNumber(std::string_view s, T* value) {
+    auto [end, ec] = std::from_chars(s.data(), s.data() + s.size(), *value);
+    return ec == std::errc{} && end == s.data() + s.size() && !s.empty();
+}
+
+std::string_view NextToken(std::string_view& s) {
+    auto p = s.find(' ');
+    auto token = s.substr(0, p);
+    s = p == std::string_view::npos ? std::string_view{} : s.substr(p + 1);
+    return token;
+}
+
+} // namespace
+
+TConsistentHash::TConsistentHash(const std::vector<std::string>& servers, int replicas) {
+    Ring_.reserve(servers.size() * replicas);
+    for (uint32_t i = 0; i < servers.size(); i++) {
+        for (int j = 0; j < replicas; j++) {
+            Ring_.emplace_back(Hash(servers[i] + "-" + std::to_string(j)), i);
+        }
+    }
+    std::sort(Ring_.begin(), Ring_.end());
+}
+
+size_t TConsistentHash::Find(std::string_view key) const {
+    if (Ring_.empty()) {
+        throw std::runtime_error("No servers");
+    }
+    auto it = std::lower_bound(Ring_.begin(), Ring_.end(), std::make_pair(Hash(key), uint32_t{0}));
+    if (it == Ring_.end()) {
+        it = Ring_.begin();
+    }
+    return it->second;
+}
+
+bool MemcachedParseValue(std::string_view line, TMemcachedValueHeader* header) {
+    if (NextToken(line) != "VALUE") {
+        return false;
+    }
+    header->Key = NextToken(line);
+    if (header->Key.empty()
+        || !ToNumber(NextToken(line), &header->Flags)
+        || !ToNumber(NextToken(line), &header->Bytes))
+    {
+        return false;
+    }
+    header->Cas = 0;
+    return line.empty() || ToNumber(line, &header->Cas);
+}
+
+bool MemcachedValidKey(std::string_view key) {
+    if (key.empty() || key.size() > 250) {
+        return false;
+    }
+    return std::all_of(key.begin(), key.end(), [](unsigned char c) { return c > ' ' && c != 127; });
+}
+
+std::string_view MemcachedLine(const TLine& line, std::string& scratch) {
+    std::string_view text = line.Part1;
+    if (!line.Part2.empty()) {
+        scratch.assign(line.Part1);
+        scratch.append(line.Part2);
+        text = scratch;
+    }
+    if (text.ends_with('\n')) {
+        text.remove_suffix(1);
+        if (text.ends_with('\r')) {
+            text.remove_suffix(1);
+        }
+    }
+    return text;
+}
+
+} // namespace NNet
@@ -0,0 +1,428 @@
+#pragma once
+
+#include <coroutine>
+#include <deque>
+#include <memory>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "../corochain.hpp"
+#include "../promises.hpp"
+#include "../sockutils.hpp"
+#include "../waiter.hpp"
+
+namespace NNet {
+
+struct TMemcachedOptions {
+    size_t ReadChunk = 16 * 1024;
+    // items up to this size can be read, memcached defaults to 1MB
+    size_t MaxValueSize = 1024 * 1024;
+    // keys per coalesced get command
+    size_t MaxKeysPerGet = 128;
+    // points per server on the hash ring
+    int Replicas = 160;
+};
+
+// Ketama-style consistent hashing: each server owns Replicas points on a ring,
+// a key belongs to the first point at or after its hash. Adding or removing
+// a server only remaps the keys of its own points.
+class TConsistentHash {
+public:
+    TConsistentHash(const std::vector<std::string>& servers, int replicas = 160);
+
+    size_t Find(std::string_view key) const;
+
+private:
+    std::vector<std::pair<uint64_t, uint32_t>> Ring_;
+};
+
+// "VALUE <key> <flags> <bytes> [<cas unique>]"
+struct TMemcachedValueHeader {
+    std::string_view Key;
+    uint32_t Flags = 0;
+    size_t Bytes = 0;
+    uint64_t Cas = 0;
+};
+
+bool MemcachedParseValue(std::string_view line, TMemcachedValueHeader* header);
+// No more than 250 bytes without spaces or control characters
+bool MemcachedValidKey(std::string_view key);
+// Line contents without CRLF, copied to scratch only if it wraps around the splitter buffer
+std::string_view MemcachedLine(const TLine& line, std::string& scratch);
+
+namespace NDetail {
+
+// One server connection speaking the text protocol. Gets issued during one loop
+// iteration are coalesced into multi-key get commands, replies come in request order.
+template<typename TSocket>
+class TMemcachedConnection {
+public:
+    TMemcachedConnection(TSocket& socket, const TMemcachedOptions& options)
+        : Socket_(socket)
+        , Options_(options)
+        , Splitter_(static_cast<int>(options.MaxValueSize + 1024))
+    {
+        Writer_ = WriterTask();
+        Reader_ = ReaderTask();
+    }
+
+    TFuture<std::optional<std::string>> Get(std::string_view key) {
+        if (Error_) {
+            std::rethrow_exception(Error_);
+        }
+        if (Pending_ && Pending_->Waiters.size() >= Options_.MaxKeysPerGet && !Pending_->Waiters.contains(std::string(key))) {
+            Seal();
+        }
+        if (!Pending_) {
+            Pending_ = std::make_unique<TGetBatch>();
+        }
+        TWaiter waiter;
+        waiter.Attach(&Pending_->Waiters[std::string(key)].emplace_back());
+        Wake();
+        co_await waiter;
+        if (waiter.Error) {
+            std::rethrow_exception(waiter.Error);
+        }
+        co_return std::move(waiter.Value);
+    }
+
+    // Sends a command with an optional data block, returns the reply line
+    TFuture<std::string> Command(std::string_view command, const std::string_view* data) {
+        if (Error_) {
+            std::rethrow_exception(Error_);
+        }
+        Seal();
+        Output_.append(command);
+        Output_.append("\r\n");
+        if (data) {
+            Output_.append(*data);
+            Output_.append("\r\n");
+        }
+        TWaiter waiter;
+        waiter.Attach(&Ops_.emplace_back().Waiter);
+        Wake();
+        co_await waiter;
+        if (waiter.Error) {
+            std::rethrow_exception(waiter.Error);
+        }
+        if (IsErrorLine(waiter.Line)) {
+            throw std::runtime_error(waiter.Line);
+        }
+        co_return std::move(waiter.Line);
+    }
+
+    size_t Inflight() const {
+        return Ops_.size() + (Pending_ ? 1 : 0);
+    }
+
+private:
+    // null in its slot when the caller is gone
+    struct TWaiter: NDetail::TReplyWaiter<TWaiter> {
+        std::optional<std::string> Value;
+        std::string Line;
+    };
+
+    struct TGetBatch {
+        // callers asking for the same key share one slot
+        std::unordered_map<std::string, std::deque<TWaiter*>> Waiters;
+    };
+
+    // Either a get batch or a single-line reply, the one being read is the front of Ops_
+    struct TOp {
+        std::unique_ptr<TGetBatch> Batch;
+        TWaiter* Waiter = nullptr;
+    };
+
+    static bool IsErrorLine(std::string_view line) {
+        return line == "ERROR" || line.starts_with("CLIENT_ERROR") || line.starts_with("SERVER_ERROR");
+    }
+
+    void Wake() {
+        if (WriterSuspended_) {
+            WriterSuspended_.resume();
+        }
+    }
+
+    // Moves the pending get batch to the output keeping the request order
+    void Seal() {
+        if (!Pending_) {
+            return;
+        }
+        Output_.append("get");
+        for (auto& [key, _] : Pending_->Waiters) {
+            Output_.push_back(' ');
+            Output_.append(key);
+        }
+        Output_.append("\r\n");
+        Ops_.push_back({std::move(Pending_), nullptr});
+    }
+
+    TFuture<void> WriterTask() {
+        std::string pending;
+        auto* poller = Socket_.Poller();
+        try {
+            while (true) {
+                while (Output_.empty() && !Pending_) {
+                    WriterSuspended_ = co_await Self();
+                    co_await std::suspend_always{};
+                }
+                WriterSuspended_ = {};
+                // let the other coroutines of this loop iteration add their keys
+                co_await poller->Yield();
+                Seal();
+                pending.clear();
+                std::swap(pending, Output_);
+                co_await TByteWriter(Socket_).Write(pending.data(), pending.size());
+            }
+        } catch (...) {
+            Fail(std::current_exception());
+        }
+        co_return;
+    }
+
+    // A line if size is 0, otherwise exactly size bytes
+    TFuture<TLine> Read(size_t size) {
+        auto line = size ? Splitter_.Pop(size) : Splitter_.Pop();
+        while (!line) {
+            auto buf = Splitter_.Acquire(Options_.ReadChunk);
+            auto readSize = co_await Socket_.ReadSome(buf.data(), buf.size());
+            if (readSize == 0) {
+                throw std::runtime_error("Connection closed");
+            }
+            if (readSize < 0) {
+                continue;
+            }
+            Splitter_.Commit(readSize);
+            line = size ? Splitter_.Pop(size) : Splitter_.Pop();
+        }
+        co_return line;
+    }
+
+    TFuture<void> ReaderTask() {
+        std::string scratch, key;
+        try {
+            while (!Error_) {
+                auto line = co_await Read(0);
+                if (Error_) {
+                    break;
+                }
+                auto text = MemcachedLine(line, scratch);
+                if (Ops_.empty()) {
+                    throw std::runtime_error("Unexpected memcached reply");
+                }
+
+                if (!Ops_.front().Batch) {
+                    auto* waiter = TWaiter::Take(Ops_.front().Waiter);
+                    Ops_.pop_front();
+                    if (waiter) {
+                        waiter->Line = text;
+                        waiter->Resume();
+                    }
+                    continue;
+                }
+
+                auto& waiters = Ops_.front().Batch->Waiters;
+                TMemcachedValueHeader header;
+                if (text.starts_with("VALUE ")) {
+                    if (!MemcachedParseValue(text, &header)) {
+                        throw std::runtime_error("Bad memcached VALUE line");
+                    }
+                    // the buffer holds MaxValueSize and the VALUE line, not more
+                    if (header.Bytes > Options_.MaxValueSize) {
+                        throw std::runtime_error("Memcached value too large");
+                    }
+                    // the line is overwritten by the next read
+                    key.assign(header.Key);
+                    auto data = co_await Read(header.Bytes + 2);
+                    if (Error_) {
+                        break;
+                    }
+                    auto value = MemcachedLine(data, scratch);
+                    if (value.size() != header.Bytes) {
+                        throw std::runtime_error("Bad memcached data block");
+                    }
+                    auto it = waiters.find(key);
+                    if (it == waiters.end()) {
+                        continue;
+                    }
+                    auto slot = std::move(it->second);
+                    waiters.erase(it);
+                    while (!slot.empty()) {
+                        auto* waiter = TWaiter::Take(slot.front());
+                        slot.pop_front();
+                        if (waiter) {
+                            waiter->Value.emplace(value);
+                            waiter->Resume();
+                        }
+                    }
+                } else if (text == "END") {
+                    auto batch = std::move(Ops_.front().Batch);
+                    Ops_.pop_front();
+                    Resume(*batch, nullptr);
+                } else if (IsErrorLine(text)) {
+                    auto batch = std::move(Ops_.front().Batch);
+                    Ops_.pop_front();
+                    Resume(*batch, std::make_exception_ptr(std::runtime_error(std::string(text))));
+                } else {
+                    throw std::runtime_error("Bad memcached reply");
+                }
+            }
+        } catch (...) {
+            Fail(std::current_exception());
+        }
+        co_return;
+    }
+
+    void Fail(std::exception_ptr error) {
+        if (!Error_) {
+            Error_ = error;
+        }
+        if (Pending_) {
+            Ops_.push_back({std::move(Pending_), nullptr});
+        }
+        // one at a time, a resumed caller may destroy the waiters after it
+        while (!Ops_.empty()) {
+            auto* waiter = TWaiter::Take(Ops_.front().Waiter);
+            auto batch = std::move(Ops_.front().Batch);
+            Ops_.pop_front();
+            if (waiter) {
+                waiter->Error = Error_;
+                waiter->Resume();
+            }
+            if (batch) {
+                Resume(*batch, Error_);
+            }
+        }
+    }
+
+    // The callers left in the batch: not found, or failed with error
+    void Resume(TGetBatch& batch, std::exception_ptr error) {
+        for (auto& [_, slot] : batch.Waiters) {
+            for (auto& entry : slot) {
+                if (auto* waiter = TWaiter::Take(entry)) {
+                    waiter->Error = error;
+                    waiter->Resume();
+                }
+            }
+        }
+    }
+
+    TSocket& Socket_;
+    TMemcachedOptions Options_;
+    TZeroCopyLineSplitter Splitter_;
+    std::string Output_;
+    std::unique_ptr<TGetBatch> Pending_;
+    std::deque<TOp> Ops_;
+    std::exception_ptr Error_;
+    std::coroutine_handle<> WriterSuspended_;
+
+    TFuture<void> Writer_;
+    TFuture<void> Reader_;
+};
+
+} // namespace NDetail
+
+// Memcached client over connected sockets, one per server. Keys are sharded
+// with consistent hashing on the server addresses.
+template<typename TSocket>
+class TMemcachedClient {
+public:
+    TMemcachedClient(std::vector<TSocket*> servers, TMemcachedOptions options = {})
+        : Options_(options)
+        , Ring_(Names(servers), options.Replicas)
+    {
+        for (auto* socket : servers) {
+            Connections_.emplace_back(std::make_unique<NDetail::TMemcachedConnection<TSocket>>(*socket, Options_));
+        }
+    }
+
+    TMemcachedClient(const TMemcachedClient&) = delete;
+    TMemcachedClient& operator=(const TMemcachedClient&) = delete;
+
+    TFuture<std::optional<std::string>> Get(std::string_view key) {
+        CheckKey(key);
+        return Connection(key).Get(key);
+    }
+
+    TFuture<bool> Set(std::string_view key, std::string_view value, uint32_t exptime = 0, uint32_t flags = 0) {
+        return Store("set", key, value, exptime, flags);
+    }
+
+    TFuture<bool> Add(std::string_view key, std::string_view value, uint32_t exptime = 0, uint32_t flags = 0) {
+        return Store("add", key, value, exptime, flags);
+    }
+
+    TFuture<bool> Replace(std::string_view key, std::string_view value, uint32_t exptime = 0, uint32_t flags = 0) {
+        return Store("replace", key, value, exptime, flags);
+    }
+
+    TFuture<bool> Delete(std::string_view key) {
+        CheckKey(key);
+        auto line = co_await Connection(key).Command("delete " + std::string(key), nullptr);
+        co_return line == "DELETED";
+    }
+
+    // nullopt if the key does not exist
+    TFuture<std::optional<uint64_t>> Incr(std::string_view key, uint64_t delta) {
+        return Arith("incr", key, delta);
+    }
+
+    TFuture<std::optional<uint64_t>> Decr(std::string_view key, uint64_t delta) {
+        return Arith("decr", key, delta);
+    }
+
+    // Index of the server owning the key
+    size_t Server(std::string_view key) const {
+        return Ring_.Find(key);
+    }
+
+private:
+    static std::vector<std::string> Names(const std::vector<TSocket*>& servers) {
+        std::vector<std::string> names;
+        for (auto* socket : servers) {
+            names.emplace_back(socket->Addr().ToString());
+        }
+        return names;
+    }
+
+    static void CheckKey(std::string_view key) {
+        if (!MemcachedValidKey(key)) {
+            throw std::runtime_error("Bad memcached key");
+        }
+    }
+
+    NDetail::TMemcachedConnection<TSocket>& Connection(std::string_view key) {
+        return *Connections_[Ring_.Find(key)];
+    }
+
+    TFuture<bool> Store(std::string_view cmd, std::string_view key, std::string_view value, uint32_t exptime, uint32_t flags) {
+        CheckKey(key);
+        std::string command;
+        command.append(cmd).append(" ").append(key);
+        command.append(" ").append(std::to_string(flags));
+        command.append(" ").append(std::to_string(exptime));
+        command.append(" ").append(std::to_string(value.size()));
+        auto line = co_await Connection(key).Command(command, &value);
+        co_return line == "STORED";
+    }
+
+    TFuture<std::optional<uint64_t>> Arith(std::string_view cmd, std::string_view key, uint64_t delta) {
+        CheckKey(key);
+        std::string command;
+        command.append(cmd).append(" ").append(key).append(" ").append(std::to_string(delta));
+        auto line = co_await Connection(key).Command(command, nullptr);
+        if (line == "NOT_FOUND") {
+            co_return std::nullopt;
+        }
+        co_return std::stoull(line);
+    }
+
+    TMemcachedOptions Options_;
+    TConsistentHash Ring_;
+    std::vector<std::unique_ptr<NDetail::TMemcachedConnection<TSocket>>> Connections_;
+};
+
+} // namespace NNet
@@ -0,0 +1,94 @@
+#ifndef _WIN32
+
+#include <system_error>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "mmap.hpp"
+
+namespace NNet {
+
+TMappedFile::TMappedFile(const std::string& path) {
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        throw std::system_error(errno, std::generic_category(), path);
+    }
+    struct stat st;
+    if (fstat(fd, &st) < 0) {
+        int err = errno;
+        ::close(fd);
+        throw std::system_error(err, std::generic_category(), path);
+    }
+    Size_ = st.st_size;
+    // an empty file cannot be mapped, it is an empty view
+    if (Size_ > 0) {
+        void* data = mmap(nullptr, Size_, PROT_READ, MAP_SHARED, fd, 0);
+        if (data == MAP_FAILED) {
+            int err = errno;
+            ::close(fd);
+            throw std::system_error(err, std::generic_category(), path);
+        }
+        Data_ = static_cast<char*>(data);
+    }
+    // the mapping keeps the file
+    ::close(fd);
+}
+
+TMappedFile::~TMappedFile() {
+    if (Data_) {
+        munmap(Data_, Size_);
+    }
+}
+
+TMappedFile::TMappedFile(TMappedFile&& other)
+    : Data_(other.Data_)
+    , Size_(other.Size_)
+{
+    other.Data_ = nullptr;
+    other.Size_ = 0;
+}
+
+TMappedFile& TMappedFile::operator=(TMappedFile&& other) {
+    if (this != &other) {
+        if (Data_) {
+            munmap(Data_, Size_);
+        }
+        Data_ = other.Data_;
+        Size_ = other.Size_;
+        other.Data_ = nullptr;
+        other.Size_ = 0;
+    }
+    return *this;
+}
+
+void TMappedFile::Advise(int advice) const {
+    if (Data_) {
+        madvise(Data_, Size_, advice);
+    }
+}
+
+void TMappedFile::Prefetch(uint64_t offset, size_t size) const {
+    auto [addr, len] = Pages(offset, size);
+    if (len) {
+        // WILLNEED schedules the reads and returns
+        madvise(addr, len, MADV_WILLNEED);
+    }
+}
+
+std::pair<void*, size_t> TMappedFile::Pages(uint64_t offset, size_t size) const {
+    static const uint64_t pageSize = sysconf(_SC_PAGESIZE);
+    auto view = View(offset, size);
+    if (view.empty()) {
+        return {nullptr, 0};
+    }
+    uint64_t begin = (view.data() - Data_) / pageSize * pageSize;
+    uint64_t end = view.data() - Data_ + view.size();
+    return {Data_ + begin, end - begin};
+}
+
+} // namespace NNet
+
+#endif // _WIN32
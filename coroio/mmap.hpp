@@ -0,0 +1,116 @@
+#pragma once
+
+#ifndef _WIN32
+
+#include <algorithm>
+#include <coroutine>
+#include <string>
+#include <string_view>
+#include <utility>
+
+#include <sys/mman.h>
+#include <sys/uio.h>
+
+namespace NNet {
+
+// Read-only mapping of a whole file for read-heavy static data. Views are zero-copy:
+// a range goes to a socket with TByteWriter::Write/Writev straight from the page cache.
+// Touching a page that is not cached blocks the loop on disk, Prefetch starts the
+// readahead without waiting for it: madvise(MADV_WILLNEED), on TUring IORING_OP_MADVISE.
+class TMappedFile {
+public:
+    TMappedFile() = default;
+    explicit TMappedFile(const std::string& path);
+    ~TMappedFile();
+
+    TMappedFile(TMappedFile&& other);
+    TMappedFile& operator=(TMappedFile&& other);
+    TMappedFile(const TMappedFile&) = delete;
+    TMappedFile& operator=(const TMappedFile&) = delete;
+
+    const char* Data() const {
+        return Data_;
+    }
+
+    size_t Size() const {
+        return Size_;
+    }
+
+    // Clamped to the end of the file
+    std::string_view View(uint64_t offset, size_t size) const {
+        offset = std::min<uint64_t>(offset, Size_);
+        return {Data_ + offset, std::min<size_t>(size, Size_ - offset)};
+    }
+
+    iovec Iov(uint64_t offset, size_t size) const {
+        auto view = View(offset, size);
+        return {const_cast<char*>(view.data()), view.size()};
+    }
+
+    // MADV_SEQUENTIAL, MADV_RANDOM, ... for the whole mapping
+    void Advise(int advice) const;
+
+    void Prefetch(uint64_t offset, size_t size) const;
+
+    template<typename TPoller>
+    void Prefetch(TPoller& poller, uint64_t offset, size_t size) const {
+        if constexpr (requires { poller.Madvise(nullptr, 0, 0, std::coroutine_handle<>{}); }) {
+            auto [addr, len] = Pages(offset, size);
+            if (len) {
+                poller.Madvise(addr, len, MADV_WILLNEED, nullptr);
+            }
+        } else {
+            Prefetch(offset, size);
+        }
+    }
+
+private:
+    // Whole pages covering the range, madvise wants an aligned address
+    std::pair<void*, size_t> Pages(uint64_t offset, size_t size) const;
+
+    char* Data_ = nullptr;
+    size_t Size_ = 0;
+};
+
+// Sequential reads of a mapped file that keep the prefetch ReadAhead bytes in front of
+// the position, one hint per half a window
+template<typename TPoller>
+class TMappedReader {
+public:
+    TMappedReader(const TMappedFile& file, TPoller& poller, size_t readAhead = 1024 * 1024, uint64_t offset = 0)
+        : File_(file)
+        , Poller_(poller)
+        , ReadAhead_(readAhead)
+        , Position_(offset)
+        , PrefetchEnd_(offset)
+    { }
+
+    // The next up to size bytes, empty at the end of the file
+    std::string_view Next(size_t size) {
+        if (Position_ + ReadAhead_ / 2 >= PrefetchEnd_ && PrefetchEnd_ < File_.Size()) {
+            uint64_t from = std::max(Position_, PrefetchEnd_);
+            PrefetchEnd_ = std::min<uint64_t>(Position_ + ReadAhead_, File_.Size());
+            if (PrefetchEnd_ > from) {
+                File_.Prefetch(Poller_, from, PrefetchEnd_ - from);
+            }
+        }
+        auto view = File_.View(Position_, size);
+        Position_ += view.size();
+        return view;
+    }
+
+    uint64_t Position() const {
+        return Position_;
+    }
+
+private:
+    const TMappedFile& File_;
+    TPoller& Poller_;
+    size_t ReadAhead_;
+    uint64_t Position_;
+    uint64_t PrefetchEnd_;
+};
+
+} // namespace NNet
+
+#endif // _WIN32
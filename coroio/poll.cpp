@@ -94,17 +94,24 @@ void TPoll::Poll()
             }
 #endif
             if (Fds_[idx].events == 0) {
-                std::swap(Fds_[idx], Fds_.back());
-                std::get<1>(InEvents_[Fds_[idx].fd]) = idx;
-                Fds_.back().events = 0;
                 idx = -1;
             }
         }
     }
 
-    while (!Fds_.empty() && !Fds_.back().events) {
-        Fds_.pop_back();
+    // Drop the entries nobody waits on. Swapping them out one by one could leave a stale
+    // entry for a live fd, and poll reports POLLHUP even for entries without events
+    size_t size = 0;
+    for (size_t i = 0; i < Fds_.size(); i++) {
+        if (Fds_[i].events) {
+            Fds_[size] = Fds_[i];
+            std::get<1>(InEvents_[Fds_[size].fd]) = size;
+            size++;
+        } else if (std::get<1>(InEvents_[Fds_[i].fd]) == static_cast<int>(i)) {
+            std::get<1>(InEvents_[Fds_[i].fd]) = -1;
+        }
     }
+    Fds_.resize(size);
 
     Reset();
     if (ppoll(&Fds_[0], Fds_.size(), &ts, nullptr) < 0) {
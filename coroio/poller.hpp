@@ -15,6 +15,49 @@
 
 namespace NNet {
 
+namespace NDetail {
+
+// Sleep of a poller: on the timer heap of TPollerBase, or on the timers of a poller
+// that hides AddTimer and RemoveTimer with its own
+template<typename TPoller>
+struct TAwaitableSleep {
+    TAwaitableSleep(TPoller* poller, TTime n)
+        : poller(poller)
+        , n(n)
+    { }
+    ~TAwaitableSleep() {
+        if (poller) {
+            poller->RemoveTimer(timerId, n);
+        }
+    }
+
+    TAwaitableSleep(TAwaitableSleep&& other)
+        : poller(other.poller)
+        , n(other.n)
+    {
+        other.poller = nullptr;
+    }
+
+    TAwaitableSleep(const TAwaitableSleep&) = delete;
+    TAwaitableSleep& operator=(const TAwaitableSleep&) = delete;
+
+    bool await_ready() {
+        return false;
+    }
+
+    void await_suspend(std::coroutine_handle<> h) {
+        timerId = poller->AddTimer(n, h);
+    }
+
+    void await_resume() { poller = nullptr; }
+
+    TPoller* poller;
+    TTime n;
+    unsigned timerId = 0;
+};
+
+} // namespace NDetail
+
 class TPollerBase {
 public:
     TPollerBase() = default;
@@ -61,43 +104,7 @@ public:
     }
 
     auto Sleep(TTime until) {
-        struct TAwaitableSleep {
-            TAwaitableSleep(TPollerBase* poller, TTime n)
-                : poller(poller)
-                , n(n)
-            { }
-            ~TAwaitableSleep() {
-                if (poller) {
-                    poller->RemoveTimer(timerId, n);
-                }
-            }
-
-            TAwaitableSleep(TAwaitableSleep&& other)
-                : poller(other.poller)
-                , n(other.n)
-            {
-                other.poller = nullptr;
-            }
-
-            TAwaitableSleep(const TAwaitableSleep&) = delete;
-            TAwaitableSleep& operator=(const TAwaitableSleep&) = delete;
-
-            bool await_ready() {
-                return false;
-            }
-
-            void await_suspend(std::coroutine_handle<> h) {
-                timerId = poller->AddTimer(n, h);
-            }
-
-            void await_resume() { poller = nullptr; }
-
-            TPollerBase* poller;
-            TTime n;
-            unsigned timerId = 0;
-        };
-
-        return TAwaitableSleep{this,until};
+        return NDetail::TAwaitableSleep<TPollerBase>{this, until};
     }
 
     template<typename Rep, typename Period>
@@ -110,16 +117,25 @@ public:
     }
 
     void Wakeup(TEvent&& change) {
+        size_t from = Changes_.empty() ? 0 : Changes_.size() - 1;
         change.Handle.resume();
-        if (Changes_.empty() || !Changes_.back().Match(change)) {
-            if (change.Fd >= 0) {
-                change.Handle = {};
-                Changes_.emplace_back(std::move(change));
+        // the resumed coroutine may register several events (e.g. start a reader and a writer),
+        // so look for a re-registration among all of them, not only the last one
+        for (size_t i = from; i < Changes_.size(); i++) {
+            if (Changes_[i].Match(change)) {
+                return;
             }
         }
+        if (change.Fd >= 0) {
+            change.Handle = {};
+            Changes_.emplace_back(std::move(change));
+        }
     }
 
     void WakeupReadyHandles() {
+        if (SpinBudget_.count() && !ReadyEvents_.empty()) {
+            SpinUntil_ = TClock::now() + SpinBudget_;
+        }
         for (auto&& ev : ReadyEvents_) {
             Wakeup(std::move(ev));
         }
@@ -130,12 +146,23 @@ public:
         MaxDurationTs_ = GetMaxDuration(MaxDuration_);
     }
 
+    // Spin mode: after a wakeup the poller is polled with a zero timeout for up to budget and
+    // blocks again only when nothing came during that time. A core is burnt for the latency
+    // of a blocking wakeup. Zero, the default, always blocks.
+    void SetSpin(std::chrono::microseconds budget) {
+        SpinBudget_ = budget;
+        SpinUntil_ = {};
+    }
+
     auto TimersSize() const {
         return Timers_.size();
     }
 
 protected:
     timespec GetTimeout() const {
+        if (SpinBudget_.count() && TClock::now() < SpinUntil_) {
+            return {0, 0};
+        }
         return Timers_.empty()
             ? MaxDurationTs_
             : Timers_.top().Deadline == TTime{}
@@ -187,6 +214,8 @@ protected:
     unsigned LastFiredTimer_ = (unsigned)(-1);
     std::chrono::milliseconds MaxDuration_ = std::chrono::milliseconds(100);
     timespec MaxDurationTs_ = GetMaxDuration(MaxDuration_);
+    std::chrono::microseconds SpinBudget_{0};
+    TTime SpinUntil_;
 };
 
 } // namespace NNet
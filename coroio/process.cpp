@@ -0,0 +1,148 @@
+#ifdef __linux__
+
+#include <stdexcept>
+#include <system_error>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <spawn.h>
+#include <sys/syscall.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "process.hpp"
+
+#ifndef SYS_pidfd_open
+#define SYS_pidfd_open 434
+#endif
+
+#ifndef SYS_pidfd_send_signal
+#define SYS_pidfd_send_signal 424
+#endif
+
+#ifndef P_PIDFD
+#define P_PIDFD 3
+#endif
+
+extern char** environ;
+
+namespace NNet {
+
+namespace NDetail {
+
+namespace {
+
+void CloseAll(std::initializer_list<int> fds) {
+    for (int fd : fds) {
+        if (fd >= 0) {
+            ::close(fd);
+        }
+    }
+}
+
+} // namespace
+
+TSpawned Spawn(const std::vector<std::string>& argv, const TProcessOptions& options, bool nonblock) {
+    if (argv.empty()) {
+        throw std::invalid_argument("empty argv");
+    }
+    bool piped[3] = {options.PipeStdin, options.PipeStdout, options.PipeStderr};
+    // parent and child ends of every stream, O_CLOEXEC keeps them out of other children
+    int parent[3] = {-1, -1, -1};
+    int child[3] = {-1, -1, -1};
+    for (int i = 0; i < 3; i++) {
+        if (!piped[i]) {
+            continue;
+        }
+        int fds[2];
+        if (pipe2(fds, O_CLOEXEC) < 0) {
+            int err = errno;
+            CloseAll({parent[0], parent[1], parent[2], child[0], child[1], child[2]});
+            throw std::system_error(err, std::generic_category(), "pipe2");
+        }
+        parent[i] = i == 0 ? fds[1] : fds[0];
+        child[i] = i == 0 ? fds[0] : fds[1];
+        if (nonblock) {
+            fcntl(parent[i], F_SETFL, fcntl(parent[i], F_GETFL) | O_NONBLOCK);
+        }
+    }
+
+    posix_spawn_file_actions_t actions;
+    posix_spawn_file_actions_init(&actions);
+    for (int i = 0; i < 3; i++) {
+        if (piped[i]) {
+            // dup2 clears O_CLOEXEC on the target
+            posix_spawn_file_actions_adddup2(&actions, child[i], i);
+        }
+    }
+
+    std::vector<char*> args;
+    for (auto& arg : argv) {
+        args.push_back(const_cast<char*>(arg.c_str()));
+    }
+    args.push_back(nullptr);
+    std::vector<char*> env;
+    for (auto& var : options.Env) {
+        env.push_back(const_cast<char*>(var.c_str()));
+    }
+    env.push_back(nullptr);
+
+    pid_t pid;
+    int err = posix_spawnp(&pid, args[0], &actions, nullptr, args.data(), options.Env.empty() ? environ : env.data());
+    posix_spawn_file_actions_destroy(&actions);
+    CloseAll({child[0], child[1], child[2]});
+    if (err != 0) {
+        CloseAll({parent[0], parent[1], parent[2]});
+        throw std::system_error(err, std::generic_category(), "posix_spawnp " + argv[0]);
+    }
+
+    // the child is not reaped yet, so its pid cannot be reused before the pidfd is taken
+    int pidFd = syscall(SYS_pidfd_open, pid, 0);
+    if (pidFd < 0) {
+        err = errno;
+        ::kill(pid, SIGKILL);
+        waitpid(pid, nullptr, 0);
+        CloseAll({parent[0], parent[1], parent[2]});
+        throw std::system_error(err, std::generic_category(), "pidfd_open");
+    }
+
+    TSpawned spawned;
+    spawned.Pid = pid;
+    spawned.PidFd = pidFd;
+    for (int i = 0; i < 3; i++) {
+        spawned.Stdio[i] = parent[i];
+    }
+    return spawned;
+}
+
+bool TryReap(int pidFd, int* status) {
+    siginfo_t info = {};
+    while (waitid(static_cast<idtype_t>(P_PIDFD), pidFd, &info, WEXITED | WNOHANG) < 0) {
+        if (errno != EINTR) {
+            throw std::system_error(errno, std::generic_category(), "waitid");
+        }
+    }
+    if (info.si_pid == 0) {
+        return false;
+    }
+    *status = info.si_code == CLD_EXITED ? info.si_status : -info.si_status;
+    return true;
+}
+
+void KillAndReap(int pidFd) {
+    syscall(SYS_pidfd_send_signal, pidFd, SIGKILL, nullptr, 0);
+    siginfo_t info;
+    while (waitid(static_cast<idtype_t>(P_PIDFD), pidFd, &info, WEXITED) < 0 && errno == EINTR) { }
+}
+
+void SendSignal(int pidFd, int signal) {
+    if (syscall(SYS_pidfd_send_signal, pidFd, signal, nullptr, 0) < 0) {
+        throw std::system_error(errno, std::generic_category(), "pidfd_send_signal");
+    }
+}
+
+} // namespace NDetail
+
+} // namespace NNet
+
+#endif // __linux__
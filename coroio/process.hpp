@@ -0,0 +1,149 @@
+#pragma once
+
+#ifdef __linux__
+
+#include <optional>
+#include <string>
+#include <vector>
+
+#include <poll.h>
+#include <signal.h>
+#include <sys/types.h>
+
+#include "corochain.hpp"
+#include "events.hpp"
+#include "socket.hpp"
+
+namespace NNet {
+
+struct TProcessOptions {
+    // a pipe for the stream, otherwise it is inherited
+    bool PipeStdin = true;
+    bool PipeStdout = true;
+    bool PipeStderr = false;
+    // the environment of the child, empty for the one of the parent
+    std::vector<std::string> Env;
+};
+
+namespace NDetail {
+
+struct TSpawned {
+    pid_t Pid = -1;
+    int PidFd = -1;
+    int Stdio[3] = {-1, -1, -1};
+};
+
+// posix_spawnp with pipes for the requested streams and a pidfd of the child
+TSpawned Spawn(const std::vector<std::string>& argv, const TProcessOptions& options, bool nonblock);
+// Reaps the exited child without blocking, the status is the exit code or -signal
+bool TryReap(int pidFd, int* status);
+// Kills and reaps the child, blocking
+void KillAndReap(int pidFd);
+void SendSignal(int pidFd, int signal);
+
+} // namespace NDetail
+
+// A child process with its stdio as file handles of the loop. The exit is awaited through
+// the readiness of a pidfd, so no SIGCHLD handler or reaper thread is involved, and
+// thousands of children cost a pidfd and their pipes each.
+// Pipes are nonblocking for the readiness pollers, TUring reads and writes them in the ring.
+// A child that was not awaited is killed and reaped by the destructor.
+template<typename TPoller>
+class TProcess {
+public:
+    using THandle = typename TPoller::TFileHandle;
+
+    TProcess(TPoller& poller, const std::vector<std::string>& argv, const TProcessOptions& options = {})
+        : Poller_(poller)
+    {
+        auto spawned = NDetail::Spawn(argv, options, NDetail::NonBlockingHandle<TPoller>);
+        Pid_ = spawned.Pid;
+        PidFd_ = spawned.PidFd;
+        for (int i = 0; i < 3; i++) {
+            if (spawned.Stdio[i] >= 0) {
+                Stdio_[i].emplace(spawned.Stdio[i], poller);
+            }
+        }
+    }
+
+    ~TProcess() {
+        if (!Status_) {
+            NDetail::KillAndReap(PidFd_);
+        }
+        ::close(PidFd_);
+    }
+
+    TProcess(const TProcess&) = delete;
+    TProcess& operator=(const TProcess&) = delete;
+
+    THandle& Stdin() {
+        return *Stdio_[0];
+    }
+
+    THandle& Stdout() {
+        return *Stdio_[1];
+    }
+
+    THandle& Stderr() {
+        return *Stdio_[2];
+    }
+
+    // EOF for the child
+    void CloseStdin() {
+        Stdio_[0].reset();
+    }
+
+    pid_t Pid() const {
+        return Pid_;
+    }
+
+    void Kill(int signal = SIGTERM) {
+        if (!Status_) {
+            NDetail::SendSignal(PidFd_, signal);
+        }
+    }
+
+    // The exit code, or -signal for a killed child
+    TValueTask<int> Wait() {
+        while (!Status_) {
+            int status;
+            if (NDetail::TryReap(PidFd_, &status)) {
+                Status_ = status;
+                break;
+            }
+            co_await TExited{&Poller_, PidFd_};
+        }
+        co_return *Status_;
+    }
+
+private:
+    // A pidfd becomes readable when the process exits
+    struct TExited {
+        bool await_ready() const { return false; }
+        void await_suspend(std::coroutine_handle<> h) {
+            if constexpr (requires { poller->PollAdd(fd, POLLIN, h); }) {
+                poller->PollAdd(fd, POLLIN, h);
+            } else {
+                poller->AddRead(fd, h);
+            }
+        }
+        void await_resume() {
+            if constexpr (requires { poller->PollAdd(fd, POLLIN, std::coroutine_handle<>{}); }) {
+                poller->Result();
+            }
+        }
+
+        TPoller* poller;
+        int fd;
+    };
+
+    TPoller& Poller_;
+    pid_t Pid_;
+    int PidFd_;
+    std::optional<THandle> Stdio_[3];
+    std::optional<int> Status_;
+};
+
+} // namespace NNet
+
+#endif // __linux__
@@ -0,0 +1,227 @@
+#pragma once
+
+#include <array>
+#include <coroutine>
+#include <deque>
+#include <functional>
+#include <optional>
+#include <span>
+
+#include <string.h>
+
+#include "resp.hpp"
+#include "../corochain.hpp"
+#include "../promises.hpp"
+#include "../sockutils.hpp"
+#include "../waiter.hpp"
+
+namespace NNet {
+
+struct TRedisOptions {
+    size_t ReadChunk = 16 * 1024;
+    // 3 switches the connection to RESP3 with HELLO before the first command
+    int Protocol = 2;
+};
+
+// Redis client over a connected TSocket, TPollerDrivenSocket or TSslSocket.
+// Commands issued by concurrent coroutines during one loop iteration are written
+// with a single write, replies are matched to callers in FIFO order.
+template<typename TSocket>
+class TRedisClient {
+public:
+    TRedisClient(TSocket& socket, TRedisOptions options = {})
+        : Socket_(socket)
+        , Options_(options)
+        , Buffer_(std::make_shared<std::vector<char>>(options.ReadChunk))
+    {
+        if (Options_.Protocol == 3) {
+            std::array<std::string_view, 2> hello = {"HELLO", "3"};
+            RespSerialize(Output_, hello.data(), hello.size());
+            Waiters_.push_back(nullptr); // reply is dropped
+        }
+        // Start tasks after fields initialization
+        Writer_ = WriterTask();
+        Reader_ = ReaderTask();
+    }
+
+    TRedisClient(const TRedisClient&) = delete;
+    TRedisClient& operator=(const TRedisClient&) = delete;
+
+    TFuture<TRespReply> Command(std::span<const std::string_view> args) {
+        if (Error_) {
+            std::rethrow_exception(Error_);
+        }
+        RespSerialize(Output_, args.data(), args.size());
+        TWaiter waiter;
+        waiter.Attach(&Waiters_.emplace_back());
+        if (WriterSuspended_) {
+            WriterSuspended_.resume();
+        }
+        co_await waiter;
+        if (waiter.Error) {
+            std::rethrow_exception(waiter.Error);
+        }
+        co_return std::move(waiter.Reply);
+    }
+
+    template<typename... TArgs>
+    TFuture<TRespReply> Command(const TArgs&... args) {
+        std::array<std::string_view, sizeof...(TArgs)> list = {std::string_view(args)...};
+        return Command(std::span<const std::string_view>(list));
+    }
+
+    TFuture<std::optional<std::string>> Get(std::string_view key) {
+        auto reply = co_await Command("GET", key);
+        if (reply.IsError()) {
+            throw std::runtime_error(std::string(reply.String()));
+        }
+        if (reply.IsNull()) {
+            co_return std::nullopt;
+        }
+        co_return std::string(reply.String());
+    }
+
+    TFuture<void> Set(std::string_view key, std::string_view value) {
+        auto reply = co_await Command("SET", key, value);
+        if (reply.IsError()) {
+            throw std::runtime_error(std::string(reply.String()));
+        }
+        co_return;
+    }
+
+    // RESP3 out-of-band pushes (pub/sub messages, invalidations)
+    void OnPush(std::function<void(const TRespReply&)> handler) {
+        PushHandler_ = std::move(handler);
+    }
+
+    // Commands waiting for their replies
+    size_t Inflight() const {
+        return Waiters_.size();
+    }
+
+private:
+    // null in Waiters_ when the caller is gone
+    struct TWaiter: NDetail::TReplyWaiter<TWaiter> {
+        TRespReply Reply;
+    };
+
+    TFuture<void> WriterTask() {
+        std::string pending;
+        auto* poller = Socket_.Poller();
+        try {
+            while (true) {
+                while (Output_.empty()) {
+                    WriterSuspended_ = co_await Self();
+                    co_await std::suspend_always{};
+                }
+                WriterSuspended_ = {};
+                // let the other coroutines of this loop iteration add their commands
+                co_await poller->Yield();
+                pending.clear();
+                std::swap(pending, Output_);
+                co_await TByteWriter(Socket_).Write(pending.data(), pending.size());
+            }
+        } catch (...) {
+            Fail(std::current_exception());
+        }
+        co_return;
+    }
+
+    TFuture<void> ReaderTask() {
+        std::vector<TRespNode> nodes;
+        size_t rpos = 0, wpos = 0, need = 0;
+        try {
+            while (true) {
+                // need is counted from rpos, no point in parsing before it is reached
+                while (wpos - rpos >= need) {
+                    size_t consumed = 0;
+                    auto status = RespParse(Buffer_->data() + rpos, wpos - rpos, nodes, &consumed, &need);
+                    if (status == ERespStatus::Error) {
+                        throw std::runtime_error("Bad RESP reply");
+                    }
+                    if (status == ERespStatus::Incomplete) {
+                        break;
+                    }
+                    rpos += consumed;
+                    need = 0;
+                    TRespReply reply(nodes, Buffer_);
+                    if (reply.Type() == ERespType::Push) {
+                        if (PushHandler_) {
+                            PushHandler_(reply);
+                        }
+                        continue;
+                    }
+                    if (Waiters_.empty()) {
+                        throw std::runtime_error("Unexpected RESP reply");
+                    }
+                    auto* waiter = TWaiter::Take(Waiters_.front());
+                    Waiters_.pop_front();
+                    if (waiter) {
+                        waiter->Reply = std::move(reply);
+                        waiter->Resume();
+                    }
+                }
+
+                if (rpos == wpos) {
+                    rpos = wpos = 0;
+                }
+                size_t required = std::max(need, (wpos - rpos) + Options_.ReadChunk / 2);
+                if (Buffer_.use_count() > 1) {
+                    // replies still reference the buffer, continue in a fresh one
+                    auto buffer = std::make_shared<std::vector<char>>(std::max(Options_.ReadChunk, required));
+                    memcpy(buffer->data(), Buffer_->data() + rpos, wpos - rpos);
+                    Buffer_ = std::move(buffer);
+                    wpos -= rpos;
+                    rpos = 0;
+                } else if (Buffer_->size() - rpos < required || Buffer_->size() - wpos < Options_.ReadChunk / 2) {
+                    memmove(Buffer_->data(), Buffer_->data() + rpos, wpos - rpos);
+                    wpos -= rpos;
+                    rpos = 0;
+                    if (Buffer_->size() < required) {
+                        Buffer_->resize(required);
+                    }
+                }
+
+                auto size = co_await Socket_.ReadSome(Buffer_->data() + wpos, Buffer_->size() - wpos);
+                if (size == 0) {
+                    throw std::runtime_error("Connection closed");
+                }
+                if (size > 0) {
+                    wpos += size;
+                }
+            }
+        } catch (...) {
+            Fail(std::current_exception());
+        }
+        co_return;
+    }
+
+    void Fail(std::exception_ptr error) {
+        if (!Error_) {
+            Error_ = error;
+        }
+        // one at a time, a resumed caller may destroy the waiters after it
+        while (!Waiters_.empty()) {
+            auto* waiter = TWaiter::Take(Waiters_.front());
+            Waiters_.pop_front();
+            if (waiter) {
+                waiter->Error = Error_;
+                waiter->Resume();
+            }
+        }
+    }
+
+    TSocket& Socket_;
+    TRedisOptions Options_;
+    std::shared_ptr<std::vector<char>> Buffer_;
+    std::string Output_;
+    std::deque<TWaiter*> Waiters_;
+    std::function<void(const TRespReply&)> PushHandler_;
+    std::exception_ptr Error_;
+    std::coroutine_handle<> WriterSuspended_;
+
+    TFuture<void> Writer_;
+    TFuture<void> Reader_;
+};
+
+} // namespace NNet
@@ -0,0 +1,217 @@
+#include "resp.hpp"
+
+#include <charconv>
+
+#include <string.h>
+
+namespace NNet {
+
+namespace {
+
+constexpr int maxDepth = 64;
+
+class TRespReader {
+public:
+    TRespReader(const char* data, size_t size, std::vector<TRespNode>& nodes)
+        : Begin_(data)
+        , P_(data)
+        , End_(data + size)
+        , Nodes_(nodes)
+    { }
+
+    ERespStatus Parse(int depth);
+
+    size_t Offset() const { return P_ - Begin_; }
+    size_t Need() const { return Need_; }
+
+private:
+    // Returns the line before CRLF and moves past it
+    ERespStatus Line(std::string_view* line) {
+        const char* eol = static_cast<const char*>(memchr(P_, '\r', End_ - P_));
+        if (!eol || eol + 1 >= End_) {
+            Need_ = (End_ - Begin_) + 1;
+            return ERespStatus::Incomplete;
+        }
+        if (eol[1] != '\n') {
+            return ERespStatus::Error;
+        }
+        *line = std::string_view(P_, eol - P_);
+        P_ = eol + 2;
+        return ERespStatus::Done;
+    }
+
+    static bool ToInteger(std::string_view s, int64_t* value) {
+        auto [end, ec] = std::from_chars(s.data(), s.data() + s.size(), *value);
+        return ec == std::errc{} && end == s.data() + s.size() && !s.empty();
+    }
+
+    ERespStatus Blob(int64_t length, std::string_view* blob) {
+        if (length < 0) {
+            return ERespStatus::Error;
+        }
+        size_t required = static_cast<size_t>(length) + 2;
+        if (static_cast<size_t>(End_ - P_) < required) {
+            Need_ = (P_ - Begin_) + required;
+            return ERespStatus::Incomplete;
+        }
+        if (P_[length] != '\r' || P_[length + 1] != '\n') {
+            return ERespStatus::Error;
+        }
+        *blob = std::string_view(P_, length);
+        P_ += required;
+        return ERespStatus::Done;
+    }
+
+    const char* Begin_;
+    const char* P_;
+    const char* End_;
+    std::vector<TRespNode>& Nodes_;
+    size_t Need_ = 0;
+};
+
+ERespStatus TRespReader::Parse(int depth) {
+    if (depth > maxDepth) {
+        return ERespStatus::Error;
+    }
+    if (P_ == End_) {
+        Need_ = (End_ - Begin_) + 1;
+        return ERespStatus::Incomplete;
+    }
+    char prefix = *P_++;
+    std::string_view line;
+    if (auto status = Line(&line); status != ERespStatus::Done) {
+        return status;
+    }
+
+    size_t index = Nodes_.size();
+    Nodes_.emplace_back();
+    auto node = [&]() -> TRespNode& { return Nodes_[index]; };
+
+    switch (prefix) {
+    case '+':
+        node().Type = ERespType::SimpleString;
+        node().String = line;
+        return ERespStatus::Done;
+    case '-':
+        node().Type = ERespType::Error;
+        node().String = line;
+        return ERespStatus::Done;
+    case ':':
+        node().Type = ERespType::Integer;
+        return ToInteger(line, &node().Integer) ? ERespStatus::Done : ERespStatus::Error;
+    case '(':
+        node().Type = ERespType::BigNumber;
+        node().String = line;
+        return ERespStatus::Done;
+    case '_':
+        node().Type = ERespType::Null;
+        return line.empty() ? ERespStatus::Done : ERespStatus::Error;
+    case '#':
+        node().Type = ERespType::Boolean;
+        node().Integer = line == "t";
+        return line == "t" || line == "f" ? ERespStatus::Done : ERespStatus::Error;
+    case ',': {
+        node().Type = ERespType::Double;
+        auto [end, ec] = std::from_chars(line.data(), line.data() + line.size(), node().Double);
+        return ec == std::errc{} && end == line.data() + line.size() ? ERespStatus::Done : ERespStatus::Error;
+    }
+    case '$':
+    case '!':
+    case '=': {
+        int64_t length;
+        if (!ToInteger(line, &length)) {
+            return ERespStatus::Error;
+        }
+        if (length == -1 && prefix == '$') {
+            node().Type = ERespType::Null;
+            return ERespStatus::Done;
+        }
+        node().Type = prefix == '$'
+            ? ERespType::BulkString
+            : prefix == '!' ? ERespType::BulkError : ERespType::VerbatimString;
+        std::string_view blob;
+        auto status = Blob(length, &blob);
+        node().String = blob;
+        return status;
+    }
+    case '*':
+    case '%':
+    case '~':
+    case '>':
+    case '|': {
+        int64_t count;
+        if (!ToInteger(line, &count) || count < -1) {
+            return ERespStatus::Error;
+        }
+        if (count == -1 && prefix == '*') {
+            node().Type = ERespType::Null;
+            return ERespStatus::Done;
+        }
+        if (count < 0 || count > (1 << 30)) {
+            return ERespStatus::Error;
+        }
+        if (prefix == '%' || prefix == '|') {
+            count *= 2;
+        }
+        for (int64_t i = 0; i < count; i++) {
+            if (auto status = Parse(depth + 1); status != ERespStatus::Done) {
+                return status;
+            }
+        }
+        if (prefix == '|') {
+            // attributes describe the value that follows, they are dropped
+            Nodes_.resize(index);
+            return Parse(depth);
+        }
+        node().Type = prefix == '*'
+            ? ERespType::Array
+            : prefix == '%' ? ERespType::Map
+            : prefix == '~' ? ERespType::Set : ERespType::Push;
+        node().Count = count;
+        node().Subtree = Nodes_.size() - index;
+        return ERespStatus::Done;
+    }
+    default:
+        return ERespStatus::Error;
+    }
+}
+
+} // namespace
+
+TRespValue TRespValue::operator[](size_t i) const {
+    auto it = begin();
+    while (i--) {
+        ++it;
+    }
+    return *it;
+}
+
+ERespStatus RespParse(const char* data, size_t size, std::vector<TRespNode>& nodes, size_t* consumed, size_t* need) {
+    nodes.clear();
+    TRespReader reader(data, size, nodes);
+    auto status = reader.Parse(0);
+    if (status == ERespStatus::Done) {
+        *consumed = reader.Offset();
+    } else if (status == ERespStatus::Incomplete) {
+        *need = reader.Need();
+    }
+    return status;
+}
+
+void RespSerialize(std::string& out, const std::string_view* args, size_t count) {
+    char buf[24];
+    out.push_back('*');
+    auto [end, ec] = std::to_chars(buf, buf + sizeof(buf), count);
+    out.append(buf, end - buf);
+    out.append("\r\n");
+    for (size_t i = 0; i < count; i++) {
+        out.push_back('$');
+        auto [end, ec] = std::to_chars(buf, buf + sizeof(buf), args[i].size());
+        out.append(buf, end - buf);
+        out.append("\r\n");
+        out.append(args[i]);
+        out.append("\r\n");
+    }
+}
+
+} // namespace NNet
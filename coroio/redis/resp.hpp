@@ -0,0 +1,122 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace NNet {
+
+enum class ERespStatus {
+    Incomplete,
+    Done,
+    Error
+};
+
+// RESP2 and RESP3 value types
+enum class ERespType : uint8_t {
+    SimpleString,   // +
+    Error,          // -
+    Integer,        // :
+    BulkString,     // $
+    Array,          // *
+    Null,           // _ and RESP2 $-1 / *-1
+    Double,         // ,
+    Boolean,        // #
+    BigNumber,      // (
+    BulkError,      // !
+    VerbatimString, // =
+    Map,            // %
+    Set,            // ~
+    Push            // >
+};
+
+// Values are stored flat in pre-order, an aggregate is followed by its subtree
+struct TRespNode {
+    ERespType Type = ERespType::Null;
+    // number of direct children, a map has two per entry
+    uint32_t Count = 0;
+    // number of nodes in the subtree including this one
+    uint32_t Subtree = 1;
+    std::string_view String;
+    int64_t Integer = 0;
+    double Double = 0;
+};
+
+// Lightweight view of one value in a parsed reply
+class TRespValue {
+public:
+    explicit TRespValue(const TRespNode* node)
+        : Node_(node)
+    { }
+
+    ERespType Type() const { return Node_->Type; }
+    bool IsNull() const { return Node_->Type == ERespType::Null; }
+    bool IsError() const { return Node_->Type == ERespType::Error || Node_->Type == ERespType::BulkError; }
+    bool IsAggregate() const {
+        auto t = Node_->Type;
+        return t == ERespType::Array || t == ERespType::Map || t == ERespType::Set || t == ERespType::Push;
+    }
+
+    // payload of string-like types, verbatim strings keep their "txt:" prefix
+    std::string_view String() const { return Node_->String; }
+    int64_t Integer() const { return Node_->Integer; }
+    double Double() const { return Node_->Double; }
+    bool Boolean() const { return Node_->Integer != 0; }
+
+    size_t Size() const { return Node_->Count; }
+    // O(i) walk over the preceding siblings
+    TRespValue operator[](size_t i) const;
+
+    struct TIterator {
+        TRespValue operator*() const { return TRespValue(Node); }
+        TIterator& operator++() { Node += Node->Subtree; return *this; }
+        bool operator==(const TIterator& other) const = default;
+
+        const TRespNode* Node;
+    };
+
+    TIterator begin() const { return {Node_ + 1}; }
+    TIterator end() const { return {Node_ + Node_->Subtree}; }
+
+private:
+    const TRespNode* Node_;
+};
+
+// Parsed reply. String views point into the connection read buffer which is kept
+// alive (and not compacted) for as long as the reply exists.
+class TRespReply {
+public:
+    TRespReply() = default;
+    TRespReply(std::vector<TRespNode> nodes, std::shared_ptr<const std::vector<char>> buffer)
+        : Nodes_(std::move(nodes))
+        , Buffer_(std::move(buffer))
+    { }
+
+    TRespValue Value() const { return TRespValue(Nodes_.data()); }
+
+    ERespType Type() const { return Value().Type(); }
+    bool IsNull() const { return Value().IsNull(); }
+    bool IsError() const { return Value().IsError(); }
+    std::string_view String() const { return Value().String(); }
+    int64_t Integer() const { return Value().Integer(); }
+    size_t Size() const { return Value().Size(); }
+    TRespValue operator[](size_t i) const { return Value()[i]; }
+
+private:
+    std::vector<TRespNode> Nodes_ = {TRespNode{}};
+    std::shared_ptr<const std::vector<char>> Buffer_;
+};
+
+// Parses one complete top-level value from data without copying strings.
+// Done: nodes hold the value and *consumed its size.
+// Incomplete: *need is a lower bound for the size of data that may complete it,
+// so the caller can avoid rescanning a large bulk string on every read.
+ERespStatus RespParse(const char* data, size_t size, std::vector<TRespNode>& nodes, size_t* consumed, size_t* need);
+
+// Appends a command as an array of bulk strings
+void RespSerialize(std::string& out, const std::string_view* args, size_t count);
+
+} // namespace NNet
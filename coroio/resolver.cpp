@@ -5,6 +5,7 @@
 #ifdef __linux__
 #include "uring.hpp"
 #endif
+#include <optional>
 #include <string_view>
 #include <utility>
 #include <fstream>
@@ -250,31 +251,82 @@ void TResolver<TPoller>::ResumeWaiters(TResolveResult&& result, const TResolveRe
 
 template<typename TPoller>
 TFuture<void> TResolver<TPoller>::ReceiverTask() {
+#ifdef __linux__
+    if constexpr (std::is_same_v<TPoller, TUring>) {
+        // Answers come into the buffers of the ring through one multishot recvmsg,
+        // the one-shot receives below are left for the kernels without it
+        std::optional<TBufferRing> buffers;
+        try {
+            buffers.emplace(Poller, 16, 1024);
+        } catch (const std::system_error& ) { }
+        if (buffers) {
+            TMultishot multishot(Poller);
+            msghdr msg = {}; // the socket is connected: no name and no control data
+            while (true) {
+                if (!multishot.Armed()) {
+                    Poller.RecvMsgMultishot(Socket.Fd(), &msg, *buffers, multishot);
+                }
+                auto completion = co_await multishot.Next();
+                if (!(completion.Flags & IORING_CQE_F_BUFFER)) {
+                    if (completion.Result >= 0 || completion.Result == -ENOBUFS) {
+                        continue; // the request is over or out of buffers, it is resubmitted
+                    }
+                    if (completion.Result != -EINVAL) { // EINVAL: before Linux 6.0
+                        // the socket is broken (closed, cancelled), the one-shot receives below
+                        // get the error too and end the task like on the other pollers
+                        auto error = std::make_exception_ptr(std::system_error(-completion.Result, std::generic_category(), "recvmsg"));
+                        std::vector<TResolveRequest> pending;
+                        for (auto& [req, _] : WaitingAddrs) {
+                            pending.push_back(req);
+                        }
+                        for (auto& req : pending) {
+                            ResumeWaiters({.Exception = error}, req);
+                        }
+                    }
+                    break;
+                }
+                unsigned short id = completion.Flags >> IORING_CQE_BUFFER_SHIFT;
+                auto* out = io_uring_recvmsg_validate(buffers->Buffer(id), completion.Result, &msg);
+                if (out && !(out->flags & MSG_TRUNC)) {
+                    OnPacket(
+                        static_cast<char*>(io_uring_recvmsg_payload(out, &msg)),
+                        io_uring_recvmsg_payload_length(out, completion.Result, &msg));
+                }
+                buffers->Release(id);
+            }
+        }
+    }
+#endif
     char buf[512];
     while (true) {
         auto size = co_await Socket.ReadSome(buf, sizeof(buf));
         if (size < 0) {
             continue;
         }
-        if (size < static_cast<int>(sizeof(TDnsHeader))) {
-            continue;
-        }
+        OnPacket(buf, size);
+    }
+    co_return;
+}
 
-        std::vector<TAddress> addresses;
-        std::exception_ptr exception;
-        uint16_t xid;
-        try {
-            ParsePacket(&xid, addresses, buf, size);
-        } catch (const std::exception& ex) {
-            exception = std::current_exception();
-        }
+template<typename TPoller>
+void TResolver<TPoller>::OnPacket(char* buf, ssize_t size) {
+    if (size < static_cast<int>(sizeof(TDnsHeader))) {
+        return;
+    }
 
-        ResumeWaiters(std::move(TResolveResult {
-            .Addresses = std::move(addresses),
-            .Exception = exception
-        }), Inflight[xid]);
+    std::vector<TAddress> addresses;
+    std::exception_ptr exception;
+    uint16_t xid;
+    try {
+        ParsePacket(&xid, addresses, buf, size);
+    } catch (const std::exception& ex) {
+        exception = std::current_exception();
     }
-    co_return;
+
+    ResumeWaiters(std::move(TResolveResult {
+        .Addresses = std::move(addresses),
+        .Exception = exception
+    }), Inflight[xid]);
 }
 
 template<typename TPoller>
@@ -26,6 +26,21 @@ enum class EDNSType {
     AAAA = 28,
 };
 
+namespace NDetail {
+
+// TPollerBase stands for the readiness pollers, the others bring their own socket
+template<typename TPoller>
+struct TResolverSocket {
+    using T = typename TPoller::TSocket;
+};
+
+template<>
+struct TResolverSocket<TPollerBase> {
+    using T = TSocket;
+};
+
+} // namespace NDetail
+
 template<typename TPoller>
 class TResolver {
 public:
@@ -41,8 +56,9 @@ private:
     TFuture<void> TimeoutsTask();
 
     void ResumeSender();
+    void OnPacket(char* buf, ssize_t size);
 
-    TSocket Socket;
+    typename NDetail::TResolverSocket<TPoller>::T Socket;
     TPoller& Poller;
     EDNSType DefaultType;
 
@@ -93,6 +109,10 @@ private:
     uint16_t Xid = 1;
 };
 
+// The resolver of a poller: the readiness pollers share TResolver<TPollerBase>
+template<typename TPoller>
+using TResolverFor = TResolver<std::conditional_t<std::is_same_v<typename TPoller::TSocket, TSocket>, TPollerBase, TPoller>>;
+
 class THostPort {
 public:
     THostPort(const std::string& hostPort);
@@ -0,0 +1,49 @@
+#include "rpc.hpp"
+
+namespace NNet {
+
+namespace {
+
+template<typename T>
+void Store(char* p, T value) {
+    for (size_t i = 0; i < sizeof(T); i++) {
+        p[i] = static_cast<char>(value >> (8 * i));
+    }
+}
+
+template<typename T>
+T Load(const char* p) {
+    T value = 0;
+    for (size_t i = 0; i < sizeof(T); i++) {
+        value |= static_cast<T>(static_cast<unsigned char>(p[i])) << (8 * i);
+    }
+    return value;
+}
+
+} // namespace
+
+bool RpcParseFrameHeader(const char* data, TRpcFrameHeader* header) {
+    auto type = static_cast<uint8_t>(data[4]);
+    if (type < static_cast<uint8_t>(ERpcFrame::Request) || type > static_cast<uint8_t>(ERpcFrame::Cancel)) {
+        return false;
+    }
+    header->Size = Load<uint32_t>(data);
+    header->Type = static_cast<ERpcFrame>(type);
+    header->Id = Load<uint64_t>(data + 8);
+    header->Method = Load<uint32_t>(data + 16);
+    header->Timeout = Load<uint32_t>(data + 20);
+    return true;
+}
+
+void RpcAppendFrame(std::string& out, TRpcFrameHeader header, std::string_view payload) {
+    char buf[RpcFrameHeaderSize] = {};
+    Store<uint32_t>(buf, payload.size());
+    buf[4] = static_cast<char>(header.Type);
+    Store<uint64_t>(buf + 8, header.Id);
+    Store<uint32_t>(buf + 16, header.Method);
+    Store<uint32_t>(buf + 20, header.Timeout);
+    out.append(buf, sizeof(buf));
+    out.append(payload);
+}
+
+} // namespace NNet
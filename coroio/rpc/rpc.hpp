@@ -0,0 +1,568 @@
+#pragma once
+
+#include <chrono>
+#include <coroutine>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <unordered_map>
+#include <vector>
+
+#include <string.h>
+
+#include "../corochain.hpp"
+#include "../promises.hpp"
+#include "../sockutils.hpp"
+#include "../waiter.hpp"
+
+namespace NNet {
+
+enum class ERpcFrame : uint8_t {
+    Request = 1,
+    Response = 2,
+    Error = 3,  // payload is the error message
+    Cancel = 4, // the caller is no longer interested in the response
+};
+
+// Wire layout, little-endian:
+// Size u32 | Type u8 | 3 reserved | Id u64 | Method u32 | Timeout u32
+struct TRpcFrameHeader {
+    ERpcFrame Type = ERpcFrame::Request;
+    uint64_t Id = 0;
+    uint32_t Method = 0;
+    // milliseconds left until the caller's deadline, 0 for none
+    uint32_t Timeout = 0;
+    uint32_t Size = 0;
+};
+
+constexpr size_t RpcFrameHeaderSize = 24;
+
+// False for unknown frame types
+bool RpcParseFrameHeader(const char* data, TRpcFrameHeader* header);
+// Appends the header with Size set to the payload size and the payload
+void RpcAppendFrame(std::string& out, TRpcFrameHeader header, std::string_view payload);
+
+struct TRpcOptions {
+    size_t ReadChunk = 16 * 1024;
+    size_t MaxFrameSize = 16 * 1024 * 1024;
+};
+
+namespace NDetail {
+
+template<typename TSocket>
+class TRpcFrameReader {
+public:
+    TRpcFrameReader(TSocket& socket, TRpcOptions options)
+        : Socket_(socket)
+        , Options_(options)
+        , Buffer_(options.ReadChunk)
+    { }
+
+    // False on EOF, the payload is valid until the next call
+    TFuture<bool> Next(TRpcFrameHeader* header, std::string_view* payload) {
+        RPos_ += Skip_;
+        Skip_ = 0;
+        while (true) {
+            size_t need = RpcFrameHeaderSize;
+            if (WPos_ - RPos_ >= RpcFrameHeaderSize) {
+                if (!RpcParseFrameHeader(Buffer_.data() + RPos_, header)) {
+                    throw std::runtime_error("Bad RPC frame type");
+                }
+                if (header->Size > Options_.MaxFrameSize) {
+                    throw std::runtime_error("RPC frame is too large");
+                }
+                need += header->Size;
+                if (WPos_ - RPos_ >= need) {
+                    *payload = std::string_view(Buffer_.data() + RPos_ + RpcFrameHeaderSize, header->Size);
+                    Skip_ = need;
+                    co_return true;
+                }
+            }
+
+            if (RPos_ == WPos_) {
+                RPos_ = WPos_ = 0;
+            }
+            if (Buffer_.size() - RPos_ < need || Buffer_.size() - WPos_ < Options_.ReadChunk / 2) {
+                memmove(Buffer_.data(), Buffer_.data() + RPos_, WPos_ - RPos_);
+                WPos_ -= RPos_;
+                RPos_ = 0;
+            }
+            if (Buffer_.size() < need) {
+                Buffer_.resize(need);
+            }
+
+            auto size = co_await Socket_.ReadSome(Buffer_.data() + WPos_, Buffer_.size() - WPos_);
+            if (size == 0) {
+                co_return false;
+            }
+            if (size > 0) {
+                WPos_ += size;
+            }
+        }
+    }
+
+private:
+    TSocket& Socket_;
+    TRpcOptions Options_;
+    std::vector<char> Buffer_;
+    size_t RPos_ = 0;
+    size_t WPos_ = 0;
+    size_t Skip_ = 0;
+};
+
+template<typename TSocket>
+class TRpcServerConnection;
+
+} // namespace NDetail
+
+class TRpcRequest {
+public:
+    uint64_t Id = 0;
+    uint32_t Method = 0;
+    std::string Payload;
+    TTime Deadline = TTime::max();
+
+    // The caller gave up: it sent a cancel frame, its deadline passed or the connection is gone.
+    // The response of a cancelled request is dropped, long handlers should check this.
+    bool Cancelled() const {
+        return Cancelled_ || (Deadline != TTime::max() && TClock::now() >= Deadline);
+    }
+
+private:
+    template<typename TSocket>
+    friend class NDetail::TRpcServerConnection;
+
+    bool Cancelled_ = false;
+};
+
+// A thrown exception is sent to the caller as an error frame with its message
+using TRpcHandler = std::function<TFuture<std::string>(const TRpcRequest&)>;
+using TRpcHandlers = std::unordered_map<uint32_t, TRpcHandler>;
+
+namespace NDetail {
+
+template<typename TSocket>
+class TRpcServerConnection {
+public:
+    TRpcServerConnection(TSocket& socket, const TRpcHandlers& handlers, const TRpcOptions& options)
+        : Socket_(socket)
+        , Handlers_(handlers)
+        , Reader_(socket, options)
+    { }
+
+    TFuture<void> Run() {
+        Writer_ = WriterTask();
+        TRpcFrameHeader header;
+        std::string_view payload;
+        std::exception_ptr error;
+        try {
+            while (!WriterDone_) {
+                bool more = co_await Reader_.Next(&header, &payload);
+                if (!more) {
+                    break;
+                }
+                Sweep();
+                if (header.Type == ERpcFrame::Request) {
+                    auto handler = Handlers_.find(header.Method);
+                    if (handler == Handlers_.end()) {
+                        Respond(ERpcFrame::Error, header.Id, "Unknown method " + std::to_string(header.Method));
+                        continue;
+                    }
+                    if (Running_.contains(header.Id)) {
+                        // the running one keeps its id, its handler and its response
+                        Respond(ERpcFrame::Error, header.Id, "Duplicate request id " + std::to_string(header.Id));
+                        continue;
+                    }
+                    TRpcRequest request;
+                    request.Id = header.Id;
+                    request.Method = header.Method;
+                    request.Payload = payload;
+                    if (header.Timeout) {
+                        request.Deadline = TClock::now() + std::chrono::milliseconds(header.Timeout);
+                    }
+                    auto task = Dispatch(handler->second, std::move(request));
+                    Running_[header.Id].Task = std::move(task);
+                } else if (header.Type == ERpcFrame::Cancel) {
+                    auto it = Running_.find(header.Id);
+                    if (it != Running_.end() && it->second.Request) {
+                        it->second.Request->Cancelled_ = true;
+                    }
+                } else {
+                    throw std::runtime_error("Unexpected RPC frame");
+                }
+            }
+        } catch (...) {
+            error = std::current_exception();
+        }
+
+        // handlers and the writer reference the connection, wait for them
+        Closing_ = true;
+        for (auto& [_, running] : Running_) {
+            if (running.Request) {
+                running.Request->Cancelled_ = true;
+            }
+        }
+        Wake();
+        Sweep();
+        while (!Running_.empty() || !WriterDone_) {
+            Drain_ = co_await Self();
+            co_await std::suspend_always{};
+            Sweep();
+        }
+        if (error) {
+            std::rethrow_exception(error);
+        }
+        co_return;
+    }
+
+private:
+    struct TRunning {
+        TFuture<void> Task;
+        TRpcRequest* Request = nullptr;
+    };
+
+    TFuture<void> Dispatch(const TRpcHandler& handler, TRpcRequest request) {
+        auto id = request.Id;
+        Running_[id].Request = &request;
+        std::string response;
+        auto type = ERpcFrame::Response;
+        try {
+            if (!request.Cancelled()) {
+                response = co_await handler(request);
+            }
+        } catch (const std::exception& ex) {
+            type = ERpcFrame::Error;
+            response = ex.what();
+        }
+        if (!request.Cancelled()) {
+            Respond(type, id, response);
+        }
+        Running_[id].Request = nullptr;
+        Finished_.push_back(id);
+        WakeDrain();
+        co_return;
+    }
+
+    void Respond(ERpcFrame type, uint64_t id, std::string_view payload) {
+        if (Closing_) {
+            return;
+        }
+        RpcAppendFrame(Output_, {.Type = type, .Id = id}, payload);
+        Wake();
+    }
+
+    // Finished dispatches are destroyed outside of their own frames
+    void Sweep() {
+        for (auto id : Finished_) {
+            Running_.erase(id);
+        }
+        Finished_.clear();
+    }
+
+    void Wake() {
+        if (WriterSuspended_) {
+            WriterSuspended_.resume();
+        }
+    }
+
+    // Resumes Run on the next loop iteration, when the caller has left its frame
+    void WakeDrain() {
+        if (Drain_) {
+            Socket_.Poller()->AddTimer(TTime{}, Drain_);
+            Drain_ = {};
+        }
+    }
+
+    TFuture<void> WriterTask() {
+        std::string pending;
+        auto* poller = Socket_.Poller();
+        try {
+            while (true) {
+                while (Output_.empty() && !Closing_) {
+                    WriterSuspended_ = co_await Self();
+                    co_await std::suspend_always{};
+                }
+                WriterSuspended_ = {};
+                if (Output_.empty()) {
+                    break;
+                }
+                // collect the responses of this loop iteration
+                co_await poller->Yield();
+                pending.clear();
+                std::swap(pending, Output_);
+                co_await TByteWriter(Socket_).Write(pending.data(), pending.size());
+            }
+        } catch (const std::exception& ) {
+            // the peer is gone, the reader will notice
+        }
+        WriterDone_ = true;
+        WakeDrain();
+        co_return;
+    }
+
+    TSocket& Socket_;
+    const TRpcHandlers& Handlers_;
+    TRpcFrameReader<TSocket> Reader_;
+    std::unordered_map<uint64_t, TRunning> Running_;
+    std::vector<uint64_t> Finished_;
+    std::string Output_;
+    bool Closing_ = false;
+    bool WriterDone_ = false;
+    std::coroutine_handle<> WriterSuspended_;
+    std::coroutine_handle<> Drain_;
+    TFuture<void> Writer_;
+};
+
+} // namespace NDetail
+
+// Serves multiplexed RPC requests on one connection until the peer closes it.
+// Every request runs its handler concurrently, responses completed during one
+// loop iteration are written together in completion order.
+template<typename TSocket>
+TFuture<void> ServeRpcConnection(TSocket& socket, const TRpcHandlers& handlers, const TRpcOptions& options = {}) {
+    NDetail::TRpcServerConnection<TSocket> connection(socket, handlers, options);
+    co_await connection.Run();
+    co_return;
+}
+
+// Accept loop on top of a listening TSocket, TPollerDrivenSocket or TSslSocket.
+// Must outlive the connections it spawns.
+template<typename TSocket>
+class TRpcServer {
+public:
+    TRpcServer(TSocket& listener, TRpcHandlers handlers, TRpcOptions options = {})
+        : Listener_(listener)
+        , Handlers_(std::move(handlers))
+        , Options_(options)
+    { }
+
+    TFuture<void> Serve() {
+        while (true) {
+            auto client = co_await Listener_.Accept();
+            Serve(std::move(client));
+        }
+        co_return;
+    }
+
+    size_t Connections() const {
+        return Connections_;
+    }
+
+private:
+    using TClient = std::decay_t<decltype(std::declval<TSocket&>().Accept().await_resume())>;
+
+    TVoidTask Serve(TClient client) {
+        Connections_++;
+        try {
+            co_await ServeRpcConnection(client, Handlers_, Options_);
+        } catch (const std::exception& ) {
+            // connection reset by peer or a protocol error, nothing to report back
+        }
+        Connections_--;
+        co_return;
+    }
+
+    TSocket& Listener_;
+    TRpcHandlers Handlers_;
+    TRpcOptions Options_;
+    size_t Connections_ = 0;
+};
+
+// Multiplexed RPC client over a connected socket. Calls issued during one loop
+// iteration are written together, responses are matched to callers by request id.
+// Destroying a pending call future cancels the call.
+template<typename TSocket>
+class TRpcClient {
+public:
+    TRpcClient(TSocket& socket, TRpcOptions options = {})
+        : Socket_(socket)
+        , Options_(options)
+        , Reader_(socket, Options_)
+    {
+        // Start tasks after fields initialization
+        Writer_ = WriterTask();
+        Receiver_ = ReceiverTask();
+    }
+
+    TRpcClient(const TRpcClient&) = delete;
+    TRpcClient& operator=(const TRpcClient&) = delete;
+
+    // Throws std::system_error(timed_out) when the deadline passes, the server
+    // is told to cancel the request. Remote errors are std::runtime_error.
+    TFuture<std::string> Call(uint32_t method, std::string_view request, TTime deadline = TTime::max()) {
+        if (Error_) {
+            std::rethrow_exception(Error_);
+        }
+        uint32_t timeout = 0;
+        if (deadline != TTime::max()) {
+            auto now = TClock::now();
+            if (deadline <= now) {
+                throw std::system_error(std::make_error_code(std::errc::timed_out));
+            }
+            auto left = std::chrono::ceil<std::chrono::milliseconds>(deadline - now).count();
+            timeout = static_cast<uint32_t>(std::min<int64_t>(left, UINT32_MAX));
+        }
+        auto id = NextId_++;
+        RpcAppendFrame(Output_, {.Type = ERpcFrame::Request, .Id = id, .Method = method, .Timeout = timeout}, request);
+        TCall call(this, id, deadline);
+        call.Attach(&Inflight_[id]);
+        Wake();
+        co_await call;
+        if (!call.Done) {
+            // resumed by the deadline timer
+            call.TimedOut = true;
+            throw std::system_error(std::make_error_code(std::errc::timed_out));
+        }
+        if (call.Error) {
+            std::rethrow_exception(call.Error);
+        }
+        co_return std::move(call.Response);
+    }
+
+    // Calls waiting for their responses
+    size_t Inflight() const {
+        return Inflight_.size();
+    }
+
+private:
+    struct TCall: NDetail::TReplyWaiter<TCall> {
+        TCall(TRpcClient* client, uint64_t id, TTime deadline)
+            : Client(client)
+            , Id(id)
+            , Deadline(deadline)
+        { }
+
+        ~TCall() {
+            if (!this->Done) {
+                if (Armed && !TimedOut) {
+                    Client->Socket_.Poller()->RemoveTimer(TimerId, Deadline);
+                }
+                // before the entry is erased
+                this->Detach();
+                Client->Abandon(Id);
+            }
+        }
+
+        void await_suspend(std::coroutine_handle<> h) {
+            this->Handle = h;
+            if (Deadline != TTime::max()) {
+                TimerId = Client->Socket_.Poller()->AddTimer(Deadline, h);
+                Armed = true;
+            }
+        }
+
+        void Resume() {
+            if (Armed) {
+                Client->Socket_.Poller()->RemoveTimer(TimerId, Deadline);
+            }
+            NDetail::TReplyWaiter<TCall>::Resume();
+        }
+
+        TRpcClient* Client;
+        uint64_t Id;
+        TTime Deadline;
+        unsigned TimerId = 0;
+        bool Armed = false;
+        bool TimedOut = false;
+        std::string Response;
+    };
+
+    void Abandon(uint64_t id) {
+        Inflight_.erase(id);
+        if (!Error_) {
+            RpcAppendFrame(Output_, {.Type = ERpcFrame::Cancel, .Id = id}, {});
+            Wake();
+        }
+    }
+
+    void Wake() {
+        if (WriterSuspended_) {
+            WriterSuspended_.resume();
+        }
+    }
+
+    TFuture<void> WriterTask() {
+        std::string pending;
+        auto* poller = Socket_.Poller();
+        try {
+            while (true) {
+                while (Output_.empty()) {
+                    WriterSuspended_ = co_await Self();
+                    co_await std::suspend_always{};
+                }
+                WriterSuspended_ = {};
+                // let the other coroutines of this loop iteration add their calls
+                co_await poller->Yield();
+                pending.clear();
+                std::swap(pending, Output_);
+                co_await TByteWriter(Socket_).Write(pending.data(), pending.size());
+            }
+        } catch (...) {
+            Fail(std::current_exception());
+        }
+        co_return;
+    }
+
+    TFuture<void> ReceiverTask() {
+        TRpcFrameHeader header;
+        std::string_view payload;
+        try {
+            while (true) {
+                bool more = co_await Reader_.Next(&header, &payload);
+                if (!more) {
+                    break;
+                }
+                if (header.Type != ERpcFrame::Response && header.Type != ERpcFrame::Error) {
+                    throw std::runtime_error("Unexpected RPC frame");
+                }
+                auto it = Inflight_.find(header.Id);
+                if (it == Inflight_.end()) {
+                    continue; // cancelled or timed out
+                }
+                auto* call = TCall::Take(it->second);
+                Inflight_.erase(it);
+                if (header.Type == ERpcFrame::Error) {
+                    call->Error = std::make_exception_ptr(std::runtime_error(std::string(payload)));
+                } else {
+                    call->Response = payload;
+                }
+                call->Resume();
+            }
+            throw std::runtime_error("Connection closed");
+        } catch (...) {
+            Fail(std::current_exception());
+        }
+        co_return;
+    }
+
+    void Fail(std::exception_ptr error) {
+        if (!Error_) {
+            Error_ = error;
+        }
+        // one at a time, a resumed caller may destroy the calls after it
+        while (!Inflight_.empty()) {
+            auto it = Inflight_.begin();
+            auto* call = TCall::Take(it->second);
+            Inflight_.erase(it);
+            call->Error = Error_;
+            call->Resume();
+        }
+    }
+
+    TSocket& Socket_;
+    TRpcOptions Options_;
+    NDetail::TRpcFrameReader<TSocket> Reader_;
+    std::string Output_;
+    std::unordered_map<uint64_t, TCall*> Inflight_;
+    uint64_t NextId_ = 1;
+    std::exception_ptr Error_;
+    std::coroutine_handle<> WriterSuspended_;
+
+    TFuture<void> Writer_;
+    TFuture<void> Receiver_;
+};
+
+} // namespace NNet
@@ -0,0 +1,56 @@
+#include <assert.h>
+#include <cmath>
+
+#include "shaper.hpp"
+
+namespace NNet {
+
+TTokenBucket::TTokenBucket(uint64_t rate, uint64_t burst, TTokenBucket* parent)
+    : Rate_(rate)
+    , Burst_(burst)
+    , Parent_(parent)
+    , Tokens_(burst)
+    , Last_(TClock::now())
+{
+    assert(rate > 0);
+}
+
+void TTokenBucket::Refill(TTime now) {
+    if (now <= Last_) {
+        return;
+    }
+    auto elapsed = std::chrono::duration<double>(now - Last_).count();
+    Tokens_ = std::min<double>(Burst_, Tokens_ + elapsed * Rate_);
+    Last_ = now;
+}
+
+uint64_t TTokenBucket::Available(TTime now) {
+    Refill(now);
+    uint64_t available = Tokens_ > 0 ? static_cast<uint64_t>(Tokens_) : 0;
+    if (Parent_) {
+        available = std::min(available, Parent_->Available(now));
+    }
+    return available;
+}
+
+void TTokenBucket::Consume(uint64_t size, TTime now) {
+    for (auto* bucket = this; bucket; bucket = bucket->Parent_) {
+        bucket->Refill(now);
+        bucket->Tokens_ -= size;
+    }
+}
+
+TTime TTokenBucket::ReadyAt(TTime now) {
+    TTime ready = now;
+    for (auto* bucket = this; bucket; bucket = bucket->Parent_) {
+        bucket->Refill(now);
+        if (bucket->Tokens_ < 0) {
+            auto wait = std::chrono::duration<double>(-bucket->Tokens_ / bucket->Rate_);
+            // round up, waking before the debt is repaid would only sleep again
+            ready = std::max(ready, now + std::chrono::ceil<std::chrono::microseconds>(wait));
+        }
+    }
+    return ready;
+}
+
+} // namespace NNet
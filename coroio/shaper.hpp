@@ -0,0 +1,123 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+
+#include "base.hpp"
+#include "corochain.hpp"
+#include "poller.hpp"
+
+namespace NNet {
+
+// Token bucket refilled lazily from the clock: Rate bytes per second, at most Burst bytes in advance.
+// Buckets form a tree (connection -> tenant -> global), every transfer is charged to the bucket
+// and all its parents. The balance may go negative, the debt delays the next transfer, so
+// the long-run rate is exact and no timers are needed besides one sleep per throttled operation.
+class TTokenBucket {
+public:
+    TTokenBucket(uint64_t rate, uint64_t burst, TTokenBucket* parent = nullptr);
+
+    // Bytes that can pass now through this bucket and its parents
+    uint64_t Available(TTime now);
+    // Charges size bytes to this bucket and its parents
+    void Consume(uint64_t size, TTime now);
+    // When the debt of this bucket and its parents is repaid, now if there is none
+    TTime ReadyAt(TTime now);
+
+    uint64_t Rate() const {
+        return Rate_;
+    }
+
+    uint64_t Burst() const {
+        return Burst_;
+    }
+
+    TTokenBucket* Parent() const {
+        return Parent_;
+    }
+
+private:
+    void Refill(TTime now);
+
+    uint64_t Rate_;
+    uint64_t Burst_;
+    TTokenBucket* Parent_;
+    double Tokens_;
+    TTime Last_;
+};
+
+// Shapes ReadSome/WriteSome of TSocket, TSslSocket or TFileHandle with token buckets,
+// a null bucket leaves the direction unlimited. While a bucket chain is in debt the
+// operation sleeps on the poller, otherwise it transfers up to the available tokens
+// but at least Quantum bytes, so slow buckets do not degrade into tiny reads and writes.
+template<typename THandle>
+class TShapedSocket {
+public:
+    using TPoller = typename THandle::TPoller;
+
+    TShapedSocket(THandle&& socket, TTokenBucket* read, TTokenBucket* write, size_t quantum = 16 * 1024)
+        : Socket_(std::move(socket))
+        , Read_(read)
+        , Write_(write)
+        , Quantum_(quantum)
+    { }
+
+    TShapedSocket(TShapedSocket&&) = default;
+    TShapedSocket& operator=(TShapedSocket&&) = default;
+
+    TValueTask<void> Connect(TTime deadline = TTime::max()) {
+        co_await Socket_.Connect(deadline);
+    }
+
+    TValueTask<ssize_t> ReadSome(void* buf, size_t size) {
+        if (Read_) {
+            auto now = TClock::now();
+            for (auto ready = Read_->ReadyAt(now); ready > now; ready = Read_->ReadyAt(now)) {
+                co_await Socket_.Poller()->Sleep(ready);
+                now = TClock::now();
+            }
+            size = Limit(Read_, size, now);
+        }
+        auto n = co_await Socket_.ReadSome(buf, size);
+        if (n > 0 && Read_) {
+            Read_->Consume(n, TClock::now());
+        }
+        co_return n;
+    }
+
+    TValueTask<ssize_t> WriteSome(const void* buf, size_t size) {
+        if (Write_) {
+            auto now = TClock::now();
+            for (auto ready = Write_->ReadyAt(now); ready > now; ready = Write_->ReadyAt(now)) {
+                co_await Socket_.Poller()->Sleep(ready);
+                now = TClock::now();
+            }
+            size = Limit(Write_, size, now);
+        }
+        auto n = co_await Socket_.WriteSome(buf, size);
+        if (n > 0 && Write_) {
+            Write_->Consume(n, TClock::now());
+        }
+        co_return n;
+    }
+
+    auto Poller() {
+        return Socket_.Poller();
+    }
+
+    THandle& Socket() {
+        return Socket_;
+    }
+
+private:
+    size_t Limit(TTokenBucket* bucket, size_t size, TTime now) const {
+        return std::min<size_t>(size, std::max<uint64_t>(bucket->Available(now), Quantum_));
+    }
+
+    THandle Socket_;
+    TTokenBucket* Read_;
+    TTokenBucket* Write_;
+    size_t Quantum_;
+};
+
+} // namespace NNet
@@ -1,7 +1,10 @@
 #include "socket.hpp"
 
 #ifndef _WIN32
+#include <netinet/tcp.h>
 #include <signal.h>
+#include <cstring>
+#include <stdexcept>
 #endif
 
 namespace NNet {
@@ -12,6 +15,127 @@ LPFN_ACCEPTEX AcceptEx;
 LPFN_GETACCEPTEXSOCKADDRS GetAcceptExSockaddrs;
 #endif
 
+namespace NDetail {
+
+int Accept(int fd, sockaddr* addr, socklen_t* len, bool* nonBlocking) {
+    while (true) {
+#if defined(__linux__) || defined(__FreeBSD__)
+        int clientfd = accept4(fd, addr, len, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        *nonBlocking = true;
+#else
+        int clientfd = accept(fd, addr, len);
+        *nonBlocking = false;
+#endif
+        if (clientfd >= 0) {
+            return clientfd;
+        }
+#ifdef _WIN32
+        int err = WSAGetLastError();
+        return -(err == WSAEWOULDBLOCK ? EAGAIN : err);
+#else
+        if (errno == EINTR || errno == ECONNABORTED) {
+            continue;
+        }
+        return errno == EWOULDBLOCK ? -EAGAIN : -errno;
+#endif
+    }
+}
+
+ssize_t ConnectWithData(int fd, std::pair<const sockaddr*, int> addr, const void* data, size_t size, bool* connected) {
+    *connected = false;
+#ifdef MSG_FASTOPEN
+    ssize_t ret = sendto(fd, data, size, MSG_FASTOPEN, addr.first, addr.second);
+    if (ret >= 0) {
+        return ret;
+    }
+    if (errno != EOPNOTSUPP) {
+        if (errno == EINTR || errno == EAGAIN || errno == EINPROGRESS) {
+            return 0; // no cookie yet, the SYN asks for one
+        }
+        throw std::system_error(errno, std::generic_category(), "sendto");
+    }
+    // disabled in the kernel, or not a TCP socket
+#else
+    (void)data;
+    (void)size;
+#endif
+    int err = connect(fd, addr.first, addr.second);
+#ifdef _WIN32
+    if (err < 0 && WSAGetLastError() != WSAEWOULDBLOCK) {
+        throw std::system_error(WSAGetLastError(), std::generic_category(), "connect");
+    }
+#else
+    if (err < 0 && !(errno == EINTR || errno == EAGAIN || errno == EINPROGRESS)) {
+        throw std::system_error(errno, std::generic_category(), "connect");
+    }
+#endif
+    *connected = err >= 0;
+    return 0;
+}
+
+void ThrowConnectError(int fd) {
+    int error = 0;
+    socklen_t len = sizeof(error);
+    if (getsockopt(fd, SOL_SOCKET, SO_ERROR, reinterpret_cast<char*>(&error), &len) < 0) {
+        error = errno;
+    }
+    if (error) {
+        throw std::system_error(error, std::generic_category(), "connect");
+    }
+}
+
+#ifndef _WIN32
+void TFdMessage::PrepareSend(const void* buf, size_t size, std::span<const int> fds) {
+    if (fds.size() > MaxFds) {
+        throw std::invalid_argument("too many descriptors");
+    }
+    Iov = {const_cast<void*>(buf), size};
+    Msg = {};
+    Msg.msg_iov = &Iov;
+    Msg.msg_iovlen = 1;
+    if (!fds.empty()) {
+        Msg.msg_control = Control;
+        Msg.msg_controllen = CMSG_SPACE(sizeof(int) * fds.size());
+        cmsghdr* cmsg = CMSG_FIRSTHDR(&Msg);
+        cmsg->cmsg_level = SOL_SOCKET;
+        cmsg->cmsg_type = SCM_RIGHTS;
+        cmsg->cmsg_len = CMSG_LEN(sizeof(int) * fds.size());
+        memcpy(CMSG_DATA(cmsg), fds.data(), sizeof(int) * fds.size());
+    }
+}
+
+void TFdMessage::PrepareRecv(void* buf, size_t size) {
+    Iov = {buf, size};
+    Msg = {};
+    Msg.msg_iov = &Iov;
+    Msg.msg_iovlen = 1;
+    Msg.msg_control = Control;
+    Msg.msg_controllen = sizeof(Control);
+}
+
+void TFdMessage::TakeFds(std::vector<int>* fds) {
+    for (cmsghdr* cmsg = CMSG_FIRSTHDR(&Msg); cmsg; cmsg = CMSG_NXTHDR(&Msg, cmsg)) {
+        if (cmsg->cmsg_level != SOL_SOCKET || cmsg->cmsg_type != SCM_RIGHTS) {
+            continue;
+        }
+        size_t count = (cmsg->cmsg_len - CMSG_LEN(0)) / sizeof(int);
+        const unsigned char* data = CMSG_DATA(cmsg);
+        for (size_t i = 0; i < count; i++) {
+            int fd;
+            memcpy(&fd, data + i * sizeof(int), sizeof(int));
+            if (fds) {
+                fds->push_back(fd);
+            } else {
+                ::close(fd);
+            }
+        }
+    }
+    // MSG_CTRUNC: the descriptors that did not fit are closed by the kernel
+}
+#endif
+
+} // namespace NDetail
+
 TInitializer::TInitializer() {
 #ifndef _WIN32
     signal(SIGPIPE, SIG_IGN);
@@ -84,22 +208,54 @@ TAddress::TAddress(sockaddr_in6 addr)
 { }
 
 TAddress::TAddress(sockaddr* addr, socklen_t len) {
-    if (len == sizeof(sockaddr_in)) {
+    if (addr->sa_family == AF_INET && len >= sizeof(sockaddr_in)) {
         sockaddr_in addr4; memcpy(&addr4, addr, sizeof(addr4));
         Addr_ = addr4;
-    } else if (len == sizeof(sockaddr_in6)) {
+    } else if (addr->sa_family == AF_INET6 && len >= sizeof(sockaddr_in6)) {
         sockaddr_in6 addr6; memcpy(&addr6, addr, sizeof(addr6));
         Addr_ = addr6;
+#ifndef _WIN32
+    } else if (addr->sa_family == AF_UNIX && len <= sizeof(sockaddr_un)) {
+        // unnamed peers of accept have just the family
+        sockaddr_un addrUn = {};
+        memcpy(&addrUn, addr, len);
+        Addr_ = addrUn;
+        UnixLen_ = len;
+#endif
     } else {
         throw std::runtime_error("Bad address size: " + std::to_string(len));
     }
 }
 
+#ifndef _WIN32
+TAddress TAddress::Unix(const std::string& path) {
+    sockaddr_un addr = {};
+    addr.sun_family = AF_UNIX;
+    if (path.empty() || path.size() >= sizeof(addr.sun_path)) {
+        throw std::runtime_error("Bad unix socket path: '" + path + "'");
+    }
+    memcpy(addr.sun_path, path.data(), path.size());
+    socklen_t len = offsetof(sockaddr_un, sun_path) + path.size() + 1;
+    if (path[0] == '@') {
+        addr.sun_path[0] = '\0';
+        len--;
+    }
+    TAddress result;
+    result.Addr_ = addr;
+    result.UnixLen_ = len;
+    return result;
+}
+#endif
+
 int TAddress::Domain() const {
     if (std::get_if<sockaddr_in>(&Addr_)) {
         return PF_INET;
     } else if (std::get_if<sockaddr_in6>(&Addr_)) {
         return PF_INET6;
+#ifndef _WIN32
+    } else if (std::get_if<sockaddr_un>(&Addr_)) {
+        return PF_UNIX;
+#endif
     } else {
         return 0;
     }
@@ -117,19 +273,23 @@ TAddress TAddress::WithPort(int port) const {
     }
 }
 
-const std::variant<sockaddr_in, sockaddr_in6>& TAddress::Addr() const { return Addr_; }
+const TAddress::TVariant& TAddress::Addr() const { return Addr_; }
 std::pair<const sockaddr*, int> TAddress::RawAddr() const {
     if (const auto* val = std::get_if<sockaddr_in>(&Addr_)) {
         return {reinterpret_cast<const sockaddr*>(val), sizeof(sockaddr_in)};
     } else if (const auto* val = std::get_if<sockaddr_in6>(&Addr_)) {
         return {reinterpret_cast<const sockaddr*>(val), sizeof(sockaddr_in6)};
+#ifndef _WIN32
+    } else if (const auto* val = std::get_if<sockaddr_un>(&Addr_)) {
+        return {reinterpret_cast<const sockaddr*>(val), UnixLen_};
+#endif
     } else {
         throw std::runtime_error("Empty variant");
     }
 }
 
 bool TAddress::operator == (const TAddress& other) const {
-    return memcmp(&Addr_, &other.Addr_, sizeof(Addr_)) == 0;
+    return memcmp(&Addr_, &other.Addr_, sizeof(Addr_)) == 0 && UnixLen_ == other.UnixLen_;
 }
 
 std::string TAddress::ToString() const {
@@ -144,6 +304,17 @@ std::string TAddress::ToString() const {
         if (r) {
             return "[" + std::string(r) + "]:" + std::to_string(ntohs(val->sin6_port));
         }
+#ifndef _WIN32
+    } else if (const auto* val = std::get_if<sockaddr_un>(&Addr_)) {
+        size_t size = UnixLen_ > offsetof(sockaddr_un, sun_path) ? UnixLen_ - offsetof(sockaddr_un, sun_path) : 0;
+        if (size == 0) {
+            return ""; // unnamed
+        }
+        if (val->sun_path[0] == '\0') {
+            return "@" + std::string(val->sun_path + 1, size - 1);
+        }
+        return std::string(val->sun_path, strnlen(val->sun_path, size));
+#endif
     }
 
     return "";
@@ -154,42 +325,39 @@ TSocketOps::TSocketOps(TPollerBase& poller, int domain, int type)
     , Fd_(Create(domain, type))
 { }
 
-TSocketOps::TSocketOps(int fd, TPollerBase& poller)
+TSocketOps::TSocketOps(int fd, TPollerBase& poller, bool nonBlocking)
     : Poller_(&poller)
-    , Fd_(Setup(fd))
+    , Fd_(Setup(fd, nonBlocking))
 { }
 
 int TSocketOps::Create(int domain, int type) {
+#if defined(__linux__) || defined(__FreeBSD__)
+    // one syscall instead of socket+fcntl+fcntl
+    auto s = socket(domain, type | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    bool nonBlocking = true;
+#else
     auto s = socket(domain, type, 0);
+    bool nonBlocking = false;
+#endif
     if (s == static_cast<decltype(s)>(-1)) {
         throw std::system_error(errno, std::generic_category(), "socket");
     }
-    return Setup(s);
+    return Setup(s, nonBlocking);
 }
 
-int TSocketOps::Setup(int s) {
+int TSocketOps::Setup(int s, [[maybe_unused]] bool nonBlocking) {
+#ifdef _WIN32
     int value;
     socklen_t len = sizeof(value);
-    [[maybe_unused]] bool isSocket = false;
-    if (getsockopt(s, SOL_SOCKET, SO_TYPE, (char*) &value, &len) == 0) {
-        value = 1;
-        isSocket = true;
-        // TODO: set for STREAM only
-        if (setsockopt(s, SOL_SOCKET, SO_KEEPALIVE, (char*) &value, len) < 0) {
-#ifdef _WIN32
-            if (WSAGetLastError() != WSAENOPROTOOPT)
-#endif
-                throw std::system_error(errno, std::generic_category(), "setsockopt");
-        }
-    }
-
-#ifdef _WIN32
     // TODO: This code works only with sockets!
     u_long mode = 1;
-    if (isSocket && ioctlsocket(s, FIONBIO, &mode) != 0) {
+    if (getsockopt(s, SOL_SOCKET, SO_TYPE, (char*) &value, &len) == 0 && ioctlsocket(s, FIONBIO, &mode) != 0) {
         throw std::system_error(WSAGetLastError(), std::system_category(), "ioctlsocket");
     }
 #else
+    if (nonBlocking) {
+        return s;
+    }
     auto flags = fcntl(s, F_GETFL, 0);
     if (flags < 0) {
         throw std::system_error(errno, std::generic_category(), "fcntl");
@@ -206,8 +374,8 @@ TSocket::TSocket(TAddress&& addr, TPollerBase& poller, int type)
     , Addr_(std::move(addr))
 { }
 
-TSocket::TSocket(const TAddress& addr, int fd, TPollerBase& poller)
-    : TSocketBase(fd, poller)
+TSocket::TSocket(const TAddress& addr, int fd, TPollerBase& poller, bool nonBlocking)
+    : TSocketBase(fd, poller, nonBlocking)
     , Addr_(addr)
 { }
 
@@ -232,6 +400,73 @@ TSocket& TSocket::operator=(TSocket&& other) {
     return *this;
 }
 
+void TSocket::SetOptions(const TSocketOptions& options) {
+    auto set = [&](int level, int name, int value, const char* what) {
+        if (setsockopt(Fd_, level, name, (char*) &value, sizeof(value)) < 0) {
+            throw std::system_error(errno, std::generic_category(), what);
+        }
+    };
+    if (options.KeepAlive) {
+        set(SOL_SOCKET, SO_KEEPALIVE, *options.KeepAlive, "SO_KEEPALIVE");
+    }
+    if (options.NoDelay) {
+        set(IPPROTO_TCP, TCP_NODELAY, *options.NoDelay, "TCP_NODELAY");
+    }
+    if (options.SendBuffer) {
+        set(SOL_SOCKET, SO_SNDBUF, *options.SendBuffer, "SO_SNDBUF");
+    }
+    if (options.RecvBuffer) {
+        set(SOL_SOCKET, SO_RCVBUF, *options.RecvBuffer, "SO_RCVBUF");
+    }
+    [[maybe_unused]] auto unsupported = [](const char* what) {
+        throw std::system_error(std::make_error_code(std::errc::no_protocol_option), what);
+    };
+    if (options.UserTimeout) {
+#ifdef TCP_USER_TIMEOUT
+        set(IPPROTO_TCP, TCP_USER_TIMEOUT, static_cast<int>(options.UserTimeout->count()), "TCP_USER_TIMEOUT");
+#else
+        unsupported("TCP_USER_TIMEOUT");
+#endif
+    }
+    if (options.Cork) {
+#if defined(TCP_CORK)
+        set(IPPROTO_TCP, TCP_CORK, *options.Cork, "TCP_CORK");
+#elif defined(TCP_NOPUSH)
+        set(IPPROTO_TCP, TCP_NOPUSH, *options.Cork, "TCP_NOPUSH");
+#else
+        unsupported("TCP_CORK");
+#endif
+    }
+    if (options.QuickAck) {
+#ifdef TCP_QUICKACK
+        set(IPPROTO_TCP, TCP_QUICKACK, *options.QuickAck, "TCP_QUICKACK");
+#else
+        unsupported("TCP_QUICKACK");
+#endif
+    }
+    if (options.BusyPoll) {
+#ifdef SO_BUSY_POLL
+        set(SOL_SOCKET, SO_BUSY_POLL, static_cast<int>(options.BusyPoll->count()), "SO_BUSY_POLL");
+#else
+        unsupported("SO_BUSY_POLL");
+#endif
+    }
+    if (options.IncomingCpu) {
+#ifdef SO_INCOMING_CPU
+        set(SOL_SOCKET, SO_INCOMING_CPU, *options.IncomingCpu, "SO_INCOMING_CPU");
+#else
+        unsupported("SO_INCOMING_CPU");
+#endif
+    }
+    if (options.FastOpen) {
+#ifdef TCP_FASTOPEN
+        set(IPPROTO_TCP, TCP_FASTOPEN, *options.FastOpen, "TCP_FASTOPEN");
+#else
+        unsupported("TCP_FASTOPEN");
+#endif
+    }
+}
+
 void TSocket::Bind() {
     auto [addr, len] = Addr_.RawAddr();
     int optval = 1;
@@ -10,13 +10,24 @@
 #include <sys/stat.h>
 #include <sys/socket.h>
 #include <sys/types.h>
+#include <sys/uio.h>
+#include <sys/un.h>
 #include <netinet/in.h>
+#include <poll.h>
 #include <unistd.h>
 #include <fcntl.h>
 #endif
 
+#include <algorithm>
+#include <chrono>
+#include <optional>
+#include <span>
+#include <string>
+#include <system_error>
 #include <variant>
+#include <vector>
 
+#include "fileop.hpp"
 #include "poller.hpp"
 
 #ifdef _WIN32
@@ -31,6 +42,11 @@ namespace NNet {
 extern LPFN_CONNECTEX ConnectEx;
 extern LPFN_ACCEPTEX AcceptEx;
 extern LPFN_GETACCEPTEXSOCKADDRS GetAcceptExSockaddrs;
+
+struct iovec {
+    void* iov_base;
+    size_t iov_len;
+};
 #endif
 
 class TInitializer {
@@ -43,13 +59,25 @@ public:
 
 class TAddress {
 public:
+#ifdef _WIN32
+    using TVariant = std::variant<sockaddr_in, sockaddr_in6>;
+#else
+    using TVariant = std::variant<sockaddr_in, sockaddr_in6, sockaddr_un>;
+#endif
+
     TAddress(const std::string& addr, int port);
     TAddress(sockaddr_in addr);
     TAddress(sockaddr_in6 addr);
     TAddress(sockaddr* addr, socklen_t len);
     TAddress() = default;
 
-    const std::variant<sockaddr_in, sockaddr_in6>& Addr() const;
+#ifndef _WIN32
+    // A Unix socket path, a leading '@' selects the Linux abstract namespace.
+    // Binding a path fails while the socket file of a previous run exists.
+    static TAddress Unix(const std::string& path);
+#endif
+
+    const TVariant& Addr() const;
     std::pair<const sockaddr*, int> RawAddr() const;
     bool operator == (const TAddress& other) const;
     int Domain() const;
@@ -58,20 +86,47 @@ public:
     std::string ToString() const;
 
 private:
-    std::variant<sockaddr_in, sockaddr_in6> Addr_ = {};
+    TVariant Addr_ = {};
+    // abstract names are not NUL-terminated, their length is a part of the address
+    socklen_t UnixLen_ = 0;
+};
+
+// Options of TSocket::SetOptions, the unset ones are not touched. Sockets are created
+// without any, so they cost no syscalls unless asked for. On Linux accepted sockets
+// inherit the options of the listening socket: setting them once on the listener
+// configures every connection for free.
+struct TSocketOptions {
+    std::optional<bool> KeepAlive;
+    std::optional<bool> NoDelay;
+    std::optional<int> SendBuffer;
+    std::optional<int> RecvBuffer;
+    // TCP_USER_TIMEOUT: how long sent data may stay unacknowledged, Linux only
+    std::optional<std::chrono::milliseconds> UserTimeout;
+    // TCP_CORK (TCP_NOPUSH on BSD): partial segments wait until the socket is uncorked
+    std::optional<bool> Cork;
+    // TCP_QUICKACK, Linux only: not sticky, the kernel may clear it after the next ack
+    std::optional<bool> QuickAck;
+    // SO_BUSY_POLL, Linux only: how long blocking reads busy poll the device queue
+    std::optional<std::chrono::microseconds> BusyPoll;
+    // SO_INCOMING_CPU, Linux only: on SO_REUSEPORT listeners, the CPU whose packets they take
+    std::optional<int> IncomingCpu;
+    // TCP_FASTOPEN on a listener: the queue of pending Fast Open handshakes.
+    // Clients send data in the SYN with Connect(data, size).
+    std::optional<int> FastOpen;
 };
 
 class TSocketOps {
 public:
     TSocketOps(TPollerBase& poller, int domain, int type);
-    TSocketOps(int fd, TPollerBase& poller);
+    // nonBlocking: the descriptor is already nonblocking (accept4 with SOCK_NONBLOCK)
+    TSocketOps(int fd, TPollerBase& poller, bool nonBlocking = false);
     TSocketOps() = default;
 
     TPollerBase* Poller() { return Poller_; }
 
 protected:
     int Create(int domain, int type);
-    int Setup(int s);
+    int Setup(int s, bool nonBlocking = false);
 
     TPollerBase* Poller_ = nullptr;
     int Fd_ = -1;
@@ -83,7 +138,7 @@ public:
     TSocketBase(TPollerBase& poller, int domain, int type): TSocketOps(poller, domain, type)
     { }
 
-    TSocketBase(int fd, TPollerBase& poller): TSocketOps(fd, poller)
+    TSocketBase(int fd, TPollerBase& poller, bool nonBlocking = false): TSocketOps(fd, poller, nonBlocking)
     { }
 
     TSocketBase() = default;
@@ -155,6 +210,20 @@ public:
         return TAwaitableWrite{Poller_,Fd_,const_cast<void*>(buf),size};
     }
 
+    // gather write, returns total number of bytes written
+    auto WritevSome(const iovec* iov, int iovcnt) {
+        struct TAwaitableWrite: public TAwaitable<TAwaitableWrite> {
+            void run() {
+                this->ret = TSockOps::writev(this->fd, static_cast<const iovec*>(this->b), this->s);
+            }
+
+            void await_suspend(std::coroutine_handle<> h) {
+                this->poller->AddWrite(this->fd, h);
+            }
+        };
+        return TAwaitableWrite{Poller_,Fd_,const_cast<iovec*>(iov),static_cast<size_t>(iovcnt)};
+    }
+
     auto Monitor() {
         struct TAwaitableClose: public TAwaitable<TAwaitableClose> {
             void run() {
@@ -223,6 +292,14 @@ public:
         return ::write(fd, buf, count);
     }
 
+    static auto writev(int fd, const iovec* iov, int iovcnt) {
+#ifdef _WIN32
+        return iovcnt > 0 ? ::write(fd, iov->iov_base, iov->iov_len) : 0;
+#else
+        return ::writev(fd, iov, iovcnt);
+#endif
+    }
+
     static auto close(int fd) {
         return ::close(fd);
     }
@@ -238,6 +315,8 @@ public:
     TFileHandle& operator=(TFileHandle&& other);
 
     TFileHandle() = default;
+
+    int Fd() const { return Fd_; }
 };
 
 class TSockOps {
@@ -250,6 +329,23 @@ public:
         return ::send(fd, static_cast<const char*>(buf), count, 0);
     }
 
+    static ssize_t writev(int fd, const iovec* iov, int iovcnt) {
+#ifdef _WIN32
+        WSABUF bufs[64];
+        DWORD count = 0;
+        DWORD sent = 0;
+        for (; count < static_cast<DWORD>(iovcnt) && count < 64; count++) {
+            bufs[count] = WSABUF{static_cast<ULONG>(iov[count].iov_len), static_cast<char*>(iov[count].iov_base)};
+        }
+        if (WSASend(fd, bufs, count, &sent, 0, nullptr, nullptr) != 0) {
+            return -1;
+        }
+        return sent;
+#else
+        return ::writev(fd, iov, iovcnt);
+#endif
+    }
+
     static auto close(int fd) {
         if (fd >= 0) {
 #ifdef _WIN32
@@ -261,6 +357,37 @@ public:
     }
 };
 
+namespace NDetail {
+
+// sendto with MSG_FASTOPEN, a plain connect where Fast Open is not available. Returns the
+// bytes that went in the SYN, *connected is set when the connect completed at once.
+ssize_t ConnectWithData(int fd, std::pair<const sockaddr*, int> addr, const void* data, size_t size, bool* connected);
+
+// Throws the pending error (SO_ERROR) of a socket whose nonblocking connect is over
+void ThrowConnectError(int fd);
+
+// accept4 with SOCK_NONBLOCK|SOCK_CLOEXEC where it exists, then *nonBlocking is set and the
+// socket needs no fcntl. Returns the descriptor or -errno, -EAGAIN when the backlog is empty.
+int Accept(int fd, sockaddr* addr, socklen_t* len, bool* nonBlocking);
+
+#ifndef _WIN32
+// sendmsg/recvmsg state of SendFds/RecvFds, prepared in place: the header points into it
+struct TFdMessage {
+    static constexpr int MaxFds = 16;
+
+    void PrepareSend(const void* buf, size_t size, std::span<const int> fds);
+    void PrepareRecv(void* buf, size_t size);
+    // Appends the received descriptors to fds, closes them when fds is null
+    void TakeFds(std::vector<int>* fds);
+
+    msghdr Msg = {};
+    iovec Iov = {};
+    alignas(cmsghdr) char Control[CMSG_SPACE(sizeof(int) * MaxFds)];
+};
+#endif
+
+} // namespace NDetail
+
 class TSocket: public TSocketBase<TSockOps> {
 public:
     using TPoller = TPollerBase;
@@ -268,7 +395,7 @@ public:
     TSocket() = default;
 
     TSocket(TAddress&& addr, TPollerBase& poller, int type = SOCK_STREAM);
-    TSocket(const TAddress& addr, int fd, TPollerBase& poller);
+    TSocket(const TAddress& addr, int fd, TPollerBase& poller, bool nonBlocking = false);
     TSocket(const TAddress& addr, TPollerBase& poller, int type = SOCK_STREAM);
 
     TSocket(TSocket&& other);
@@ -312,6 +439,49 @@ public:
         return TAwaitable{Poller_, Fd_, Addr_.RawAddr(), deadline};
     }
 
+    // TCP Fast Open: the data goes out in the SYN once the client has a cookie of the server,
+    // which saves a round trip for the first request. Returns how much of the data was sent,
+    // the rest is for WriteSome. It is 0 until the first connection got the cookie, and where
+    // Fast Open is not available, then this is a plain Connect.
+    auto Connect(const void* data, size_t size, TTime deadline = TTime::max()) {
+        struct TAwaitable {
+            bool await_ready() {
+                bool connected;
+                sent = NDetail::ConnectWithData(fd, addr, data, size, &connected);
+                return connected;
+            }
+
+            void await_suspend(std::coroutine_handle<> h) {
+                suspended = true;
+                poller->AddWrite(fd, h);
+                if (deadline != TTime::max()) {
+                    timerId = poller->AddTimer(deadline, h);
+                }
+            }
+
+            ssize_t await_resume() {
+                if (deadline != TTime::max() && poller->RemoveTimer(timerId, deadline)) {
+                    throw std::system_error(std::make_error_code(std::errc::timed_out));
+                }
+                if (suspended) {
+                    NDetail::ThrowConnectError(fd);
+                }
+                return sent;
+            }
+
+            TPollerBase* poller;
+            int fd;
+            std::pair<const sockaddr*, int> addr;
+            const void* data;
+            size_t size;
+            TTime deadline;
+            unsigned timerId = 0;
+            ssize_t sent = 0;
+            bool suspended = false;
+        };
+        return TAwaitable{Poller_, Fd_, Addr_.RawAddr(), data, size, deadline};
+    }
+
     auto Accept() {
         struct TAwaitable {
             bool await_ready() const { return false; }
@@ -319,15 +489,16 @@ public:
                 poller->AddRead(fd, h);
             }
             TSocket await_resume() {
-                char clientaddr[sizeof(sockaddr_in6)];
-                socklen_t len = sizeof(sockaddr_in6);
+                sockaddr_storage clientaddr;
+                socklen_t len = sizeof(clientaddr);
+                bool nonBlocking;
 
-                int clientfd = accept(fd, reinterpret_cast<sockaddr*>(&clientaddr[0]), &len);
+                int clientfd = NDetail::Accept(fd, reinterpret_cast<sockaddr*>(&clientaddr), &len, &nonBlocking);
                 if (clientfd < 0) {
-                    throw std::system_error(errno, std::generic_category(), "accept");
+                    throw std::system_error(-clientfd, std::generic_category(), "accept");
                 }
 
-                return TSocket{TAddress{reinterpret_cast<sockaddr*>(&clientaddr[0]), len}, clientfd, *poller};
+                return TSocket{TAddress{reinterpret_cast<sockaddr*>(&clientaddr), len}, clientfd, *poller, nonBlocking};
             }
 
             TPollerBase* poller;
@@ -337,6 +508,147 @@ public:
         return TAwaitable{Poller_, Fd_};
     }
 
+    // Accepts up to maxN pending connections per wakeup: accept4 is repeated until the backlog
+    // is empty, so a burst of connections costs one readiness event instead of one each.
+    // The backlog is drained before waiting. The result is empty after a spurious wakeup.
+    auto AcceptBatch(size_t maxN = 64) {
+        struct TAwaitable {
+            bool await_ready() {
+                Drain();
+                return !sockets.empty();
+            }
+
+            void await_suspend(std::coroutine_handle<> h) {
+                poller->AddRead(fd, h);
+            }
+
+            std::vector<TSocket> await_resume() {
+                if (sockets.empty()) {
+                    Drain();
+                }
+                return std::move(sockets);
+            }
+
+            void Drain() {
+                while (sockets.size() < maxN) {
+                    sockaddr_storage clientaddr;
+                    socklen_t len = sizeof(clientaddr);
+                    bool nonBlocking;
+                    int clientfd = NDetail::Accept(fd, reinterpret_cast<sockaddr*>(&clientaddr), &len, &nonBlocking);
+                    if (clientfd == -EAGAIN) {
+                        break;
+                    }
+                    if (clientfd < 0) {
+                        // the accepted ones are returned, the error comes back with the next call
+                        if (sockets.empty()) {
+                            throw std::system_error(-clientfd, std::generic_category(), "accept");
+                        }
+                        break;
+                    }
+                    sockets.emplace_back(TAddress{reinterpret_cast<sockaddr*>(&clientaddr), len}, clientfd, *poller, nonBlocking);
+                }
+            }
+
+            TPollerBase* poller;
+            int fd;
+            size_t maxN;
+            std::vector<TSocket> sockets = {};
+        };
+
+        return TAwaitable{Poller_, Fd_, std::max<size_t>(maxN, 1)};
+    }
+
+#ifndef _WIN32
+    // Sends data with descriptors attached to its first byte over a Unix socket, at most
+    // NDetail::TFdMessage::MaxFds of them. The size must be positive, -1 means retry as for WriteSome.
+    // The descriptors stay open in the sender.
+    auto SendFds(const void* buf, size_t size, std::span<const int> fds) {
+        struct TAwaitable {
+            bool await_ready() {
+                message.PrepareSend(buf, size, fds);
+                Run();
+                return ret >= 0;
+            }
+
+            void await_suspend(std::coroutine_handle<> h) {
+                poller->AddWrite(fd, h);
+            }
+
+            ssize_t await_resume() {
+                if (ret < 0) {
+                    Run();
+                }
+                return ret;
+            }
+
+            void Run() {
+                ret = sendmsg(fd, &message.Msg, 0);
+                if (ret < 0 && !(errno == EINTR || errno == EAGAIN)) {
+                    throw std::system_error(errno, std::generic_category(), "sendmsg");
+                }
+            }
+
+            TPollerBase* poller;
+            int fd;
+            const void* buf;
+            size_t size;
+            std::span<const int> fds;
+            NDetail::TFdMessage message = {};
+            ssize_t ret = -1;
+        };
+
+        return TAwaitable{Poller_, Fd_, buf, size, fds};
+    }
+
+    // Receives data and the descriptors that came with it, they are appended to fds with
+    // close-on-exec set. -1 means retry, 0 the end of the stream.
+    auto RecvFds(void* buf, size_t size, std::vector<int>* fds) {
+        struct TAwaitable {
+            bool await_ready() {
+                message.PrepareRecv(buf, size);
+                Run();
+                return ret >= 0;
+            }
+
+            void await_suspend(std::coroutine_handle<> h) {
+                poller->AddRead(fd, h);
+            }
+
+            ssize_t await_resume() {
+                if (ret < 0) {
+                    Run();
+                }
+                return ret;
+            }
+
+            void Run() {
+#ifdef MSG_CMSG_CLOEXEC
+                ret = recvmsg(fd, &message.Msg, MSG_CMSG_CLOEXEC);
+#else
+                ret = recvmsg(fd, &message.Msg, 0);
+#endif
+                if (ret < 0 && !(errno == EINTR || errno == EAGAIN)) {
+                    throw std::system_error(errno, std::generic_category(), "recvmsg");
+                }
+                if (ret >= 0) {
+                    message.TakeFds(fds);
+                }
+            }
+
+            TPollerBase* poller;
+            int fd;
+            void* buf;
+            size_t size;
+            std::vector<int>* fds;
+            NDetail::TFdMessage message = {};
+            ssize_t ret = -1;
+        };
+
+        return TAwaitable{Poller_, Fd_, buf, size, fds};
+    }
+#endif
+
+    void SetOptions(const TSocketOptions& options);
     void Bind();
     void Listen(int backlog = 128);
     const TAddress& Addr() const;
@@ -352,15 +664,15 @@ class TPollerDrivenSocket: public TSocket
 public:
     using TPoller = T;
 
-    TPollerDrivenSocket(TAddress addr, T& poller)
-        : TSocket(std::move(addr), poller)
+    TPollerDrivenSocket(TAddress addr, T& poller, int type = SOCK_STREAM)
+        : TSocket(std::move(addr), poller, type)
         , Poller_(&poller)
     {
         Poller_->Register(Fd_);
     }
 
-    TPollerDrivenSocket(const TAddress& addr, int fd, T& poller)
-        : TSocket(addr, fd, poller)
+    TPollerDrivenSocket(const TAddress& addr, int fd, T& poller, bool nonBlocking = false)
+        : TSocket(addr, fd, poller, nonBlocking)
         , Poller_(&poller)
     {
         Poller_->Register(Fd_);
@@ -375,6 +687,13 @@ public:
 
     TPollerDrivenSocket() = default;
 
+#ifdef __linux__
+    // TUring accepts with SOCK_NONBLOCK|SOCK_CLOEXEC
+    static constexpr bool AcceptNonBlocking = true;
+#else
+    static constexpr bool AcceptNonBlocking = false;
+#endif
+
     auto Accept() {
         struct TAwaitable {
             bool await_ready() const { return false; }
@@ -388,19 +707,60 @@ public:
                     throw std::system_error(-clientfd, std::generic_category(), "accept");
                 }
 
-                return TPollerDrivenSocket<T>{TAddress{reinterpret_cast<sockaddr*>(&addr[0]), len}, clientfd, *poller};
+                return TPollerDrivenSocket<T>{TAddress{reinterpret_cast<sockaddr*>(&addr[0]), len}, clientfd, *poller, AcceptNonBlocking};
             }
 
             T* poller;
             int fd;
 
-            char addr[2*(sizeof(sockaddr_in6)+16)] = {0}; // use additional memory for windows
+            // use additional memory for windows
+            char addr[std::max(sizeof(sockaddr_storage), 2*(sizeof(sockaddr_in6)+16))] = {0};
             socklen_t len = sizeof(addr);
         };
 
         return TAwaitable{Poller_, Fd_};
     }
 
+    // The first connection comes from the ring, the rest of the backlog, up to maxN in total,
+    // is taken with accept4 without going through the ring again
+    auto AcceptBatch(size_t maxN = 64) {
+        struct TAwaitable {
+            bool await_ready() const { return false; }
+            void await_suspend(std::coroutine_handle<> h) {
+                poller->Accept(fd, reinterpret_cast<sockaddr*>(&addr[0]), &len, h);
+            }
+
+            std::vector<TPollerDrivenSocket<T>> await_resume() {
+                int clientfd = poller->Result();
+                if (clientfd < 0) {
+                    throw std::system_error(-clientfd, std::generic_category(), "accept");
+                }
+
+                std::vector<TPollerDrivenSocket<T>> sockets;
+                sockets.emplace_back(TAddress{reinterpret_cast<sockaddr*>(&addr[0]), len}, clientfd, *poller, AcceptNonBlocking);
+                while (sockets.size() < maxN) {
+                    len = sizeof(addr);
+                    bool nonBlocking;
+                    clientfd = NDetail::Accept(fd, reinterpret_cast<sockaddr*>(&addr[0]), &len, &nonBlocking);
+                    if (clientfd < 0) {
+                        break;
+                    }
+                    sockets.emplace_back(TAddress{reinterpret_cast<sockaddr*>(&addr[0]), len}, clientfd, *poller, nonBlocking);
+                }
+                return sockets;
+            }
+
+            T* poller;
+            int fd;
+            size_t maxN;
+
+            char addr[std::max(sizeof(sockaddr_storage), 2*(sizeof(sockaddr_in6)+16))] = {0};
+            socklen_t len = sizeof(addr);
+        };
+
+        return TAwaitable{Poller_, Fd_, maxN};
+    }
+
     auto Connect(TTime deadline = TTime::max()) {
         struct TAwaitable {
             bool await_ready() const { return false; }
@@ -432,6 +792,51 @@ public:
         return TAwaitable{Poller_, Fd_, Addr().RawAddr(), deadline};
     }
 
+#ifdef __linux__
+    // The same contract as TSocket::Connect(data, size). The SYN is sent by sendto on the
+    // nonblocking socket, the handshake is awaited with a ring poll.
+    auto Connect(const void* data, size_t size, TTime deadline = TTime::max()) {
+        struct TAwaitable {
+            bool await_ready() const { return false; }
+
+            void await_suspend(std::coroutine_handle<> h) {
+                bool connected;
+                sent = NDetail::ConnectWithData(fd, addr, data, size, &connected);
+                poller->PollAdd(fd, POLLOUT, h);
+                if (deadline != TTime::max()) {
+                    timerId = poller->AddTimer(deadline, h);
+                }
+            }
+
+            ssize_t await_resume() {
+                if (deadline != TTime::max() && poller->RemoveTimer(timerId, deadline)) {
+                    poller->Cancel(fd);
+                    throw std::system_error(std::make_error_code(std::errc::timed_out));
+                }
+                int ret = poller->Result();
+                if (ret < 0) {
+                    throw std::system_error(-ret, std::generic_category(), "connect");
+                }
+                // the result is the ready mask, a failed handshake is told by the socket error
+                if (ret & (POLLERR | POLLHUP)) {
+                    NDetail::ThrowConnectError(fd);
+                }
+                return sent;
+            }
+
+            T* poller;
+            int fd;
+            std::pair<const sockaddr*, int> addr;
+            const void* data;
+            size_t size;
+            TTime deadline;
+            unsigned timerId = 0;
+            ssize_t sent = 0;
+        };
+        return TAwaitable{Poller_, Fd_, Addr().RawAddr(), data, size, deadline};
+    }
+#endif
+
     auto ReadSome(void* buf, size_t size) {
         struct TAwaitable {
             bool await_ready() const { return false; }
@@ -482,6 +887,122 @@ public:
         return TAwaitable{Poller_, Fd_, buf, size};
     }
 
+    auto WritevSome(const iovec* iov, int iovcnt) {
+        struct TAwaitable {
+            bool await_ready() const { return false; }
+            void await_suspend(std::coroutine_handle<> h) {
+                poller->Writev(fd, iov, iovcnt, h);
+            }
+
+            ssize_t await_resume() {
+                int ret = poller->Result();
+                if (ret < 0) {
+                    throw std::system_error(-ret, std::generic_category());
+                }
+                return ret;
+            }
+
+            T* poller;
+            int fd;
+
+            const iovec* iov;
+            int iovcnt;
+        };
+
+        return TAwaitable{Poller_, Fd_, iov, iovcnt};
+    }
+
+#ifdef __linux__
+    // Reads into the provided buffers of a TBufferRing (TUring), the result lists the filled
+    // ones: many per completion with bundles (TUring::Bundles), one otherwise.
+    // An empty result is the end of the stream, the buffers go back with TBufferRing::Release
+    template<typename TBuffers>
+    auto ReadBundle(TBuffers& buffers) {
+        struct TAwaitable {
+            bool await_ready() const { return false; }
+            void await_suspend(std::coroutine_handle<> h) {
+                poller->RecvBundle(fd, *buffers, h);
+            }
+
+            auto await_resume() {
+                int ret = poller->Result();
+                if (ret < 0) {
+                    throw std::system_error(-ret, std::generic_category());
+                }
+                return buffers->Take(ret, poller->ResultFlags());
+            }
+
+            T* poller;
+            int fd;
+            TBuffers* buffers;
+        };
+
+        return TAwaitable{Poller_, Fd_, &buffers};
+    }
+#endif
+
+#ifndef _WIN32
+    // The same contract as TSocket::SendFds, the message is sent in the ring
+    auto SendFds(const void* buf, size_t size, std::span<const int> fds) {
+        struct TAwaitable {
+            bool await_ready() const { return false; }
+            void await_suspend(std::coroutine_handle<> h) {
+                message.PrepareSend(buf, size, fds);
+                poller->SendMsg(fd, &message.Msg, 0, h);
+            }
+
+            ssize_t await_resume() {
+                int ret = poller->Result();
+                if (ret < 0) {
+                    throw std::system_error(-ret, std::generic_category(), "sendmsg");
+                }
+                return ret;
+            }
+
+            T* poller;
+            int fd;
+            const void* buf;
+            size_t size;
+            std::span<const int> fds;
+            NDetail::TFdMessage message = {};
+        };
+
+        return TAwaitable{Poller_, Fd_, buf, size, fds};
+    }
+
+    auto RecvFds(void* buf, size_t size, std::vector<int>* fds) {
+        struct TAwaitable {
+            bool await_ready() const { return false; }
+            void await_suspend(std::coroutine_handle<> h) {
+                message.PrepareRecv(buf, size);
+#ifdef MSG_CMSG_CLOEXEC
+                poller->RecvMsg(fd, &message.Msg, MSG_CMSG_CLOEXEC, h);
+#else
+                poller->RecvMsg(fd, &message.Msg, 0, h);
+#endif
+            }
+
+            ssize_t await_resume() {
+                int ret = poller->Result();
+                if (ret < 0) {
+                    throw std::system_error(-ret, std::generic_category(), "recvmsg");
+                }
+                message.TakeFds(fds);
+                return ret;
+            }
+
+            T* poller;
+            int fd;
+            void* buf;
+            size_t size;
+            std::vector<int>* fds;
+            NDetail::TFdMessage message = {};
+        };
+
+        return TAwaitable{Poller_, Fd_, buf, size, fds};
+    }
+#endif
+
     auto WriteSomeYield(const void* buf, size_t size) {
         return WriteSome(buf, size);
     }
@@ -563,7 +1084,80 @@ public:
         return ReadSome(buf, size);
     }
 
+#ifndef _WIN32
+    // Positional and file management operations, for pollers with native file ops (TUring)
+    static auto Openat(T& poller, int dirfd, std::string path, int flags, mode_t mode = 0644) {
+        struct TAwaitable {
+            bool await_ready() const { return false; }
+            void await_suspend(std::coroutine_handle<> h) {
+                poller->Openat(dirfd, path.c_str(), flags, mode, h);
+            }
+
+            TPollerDrivenFileHandle await_resume() {
+                int ret = poller->Result();
+                if (ret < 0) {
+                    throw std::system_error(-ret, std::generic_category(), path);
+                }
+                return TPollerDrivenFileHandle(ret, *poller);
+            }
+
+            T* poller;
+            int dirfd;
+            std::string path;
+            int flags;
+            mode_t mode;
+        };
+
+        return TAwaitable{&poller, dirfd, std::move(path), flags, mode};
+    }
+
+    static auto Open(T& poller, std::string path, int flags, mode_t mode = 0644) {
+        return Openat(poller, AT_FDCWD, std::move(path), flags, mode);
+    }
+
+    auto ReadAt(void* buf, size_t size, uint64_t offset) {
+        return Op([=, poller = Poller_, fd = Fd_](auto h) { poller->ReadAt(fd, buf, NDetail::ClampFileIo(size), offset, h); });
+    }
+
+    auto WriteAt(const void* buf, size_t size, uint64_t offset) {
+        return Op([=, poller = Poller_, fd = Fd_](auto h) { poller->WriteAt(fd, buf, NDetail::ClampFileIo(size), offset, h); });
+    }
+
+    // Durable write: the write and fsync (fdatasync by default) reach the kernel as one
+    // linked submission. Returns the bytes written and whether they are synced, a short
+    // write is not; a failed write throws its own error
+    auto WriteAtSync(const void* buf, size_t size, uint64_t offset, bool datasync = true) {
+        return NDetail::TSyncWriteOp<T>{Poller_, Fd_, buf, NDetail::ClampFileIo(size), offset, datasync};
+    }
+
+    auto Fsync() {
+        return Op([poller = Poller_, fd = Fd_](auto h) { poller->Fsync(fd, h); });
+    }
+
+    auto Fdatasync() {
+        return Op([poller = Poller_, fd = Fd_](auto h) { poller->Fdatasync(fd, h); });
+    }
+
+    auto Fallocate(int mode, uint64_t offset, uint64_t len) {
+        return Op([=, poller = Poller_, fd = Fd_](auto h) { poller->Fallocate(fd, mode, offset, len, h); });
+    }
+
+    // Closes the descriptor in the ring, the handle is empty afterwards
+    auto AsyncClose() {
+        int fd = Fd_;
+        Fd_ = -1;
+        return Op([poller = Poller_, fd](auto h) { poller->Close(fd, h); });
+    }
+
 private:
+    template<typename TSubmit>
+    auto Op(TSubmit submit) {
+        return NDetail::FileOp(Poller_, std::move(submit));
+    }
+#else
+private:
+#endif
+
     T* Poller_;
 };
 
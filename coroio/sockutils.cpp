@@ -76,6 +76,17 @@ TLine TZeroCopyLineSplitter::Pop() {
     }
 }
 
+TLine TZeroCopyLineSplitter::Pop(size_t size) {
+    if (size == 0 || Size < size) {
+        return {};
+    }
+    auto first = std::min(size, Cap - RPos);
+    TLine line { View.substr(RPos, first), View.substr(0, size - first) };
+    RPos = (RPos + size) % Cap;
+    Size -= size;
+    return line;
+}
+
 std::span<char> TZeroCopyLineSplitter::Acquire(size_t size) {
     size = std::min(size, Cap - Size);
     if (size == 0) {
@@ -2,7 +2,10 @@
 
 #include <assert.h>
 #include <span>
+#include <string>
+#include <algorithm>
 #include "corochain.hpp"
+#include "socket.hpp"
 
 namespace NNet {
 
@@ -73,6 +76,50 @@ struct TByteWriter {
         co_return;
     }
 
+    // Writes all buffers with one gather write per wakeup if the socket supports it,
+    // otherwise coalesces them into one buffer (e.g. to produce one record in TSslSocket).
+    // The iovec array is modified in place.
+    TValueTask<void> Writev(iovec* iov, int iovcnt) {
+        if constexpr (requires(TSocket& s, const iovec* v, int n) { s.WritevSome(v, n); }) {
+            static constexpr int maxIov = 1024;
+            while (iovcnt > 0 && iov->iov_len == 0) {
+                iov++; iovcnt--;
+            }
+            while (iovcnt > 0) {
+                auto size = co_await Socket.WritevSome(iov, std::min(iovcnt, maxIov));
+                if (size == 0) {
+                    throw std::runtime_error("Connection closed");
+                }
+                if (size < 0) {
+                    continue; // retry
+                }
+                while (iovcnt > 0 && static_cast<size_t>(size) >= iov->iov_len) {
+                    size -= iov->iov_len;
+                    iov++; iovcnt--;
+                }
+                if (size > 0) {
+                    iov->iov_base = static_cast<char*>(iov->iov_base) + size;
+                    iov->iov_len -= size;
+                }
+                while (iovcnt > 0 && iov->iov_len == 0) {
+                    iov++; iovcnt--;
+                }
+            }
+        } else {
+            std::string buf;
+            size_t total = 0;
+            for (int i = 0; i < iovcnt; i++) {
+                total += iov[i].iov_len;
+            }
+            buf.reserve(total);
+            for (int i = 0; i < iovcnt; i++) {
+                buf.append(static_cast<const char*>(iov[i].iov_base), iov[i].iov_len);
+            }
+            co_await Write(buf.data(), buf.size());
+        }
+        co_return;
+    }
+
 private:
     TSocket& Socket;
 };
@@ -126,6 +173,8 @@ public:
     TZeroCopyLineSplitter(int maxLen);
 
     TLine Pop();
+    // Pops exactly size bytes, empty if fewer are buffered
+    TLine Pop(size_t size);
     std::span<char> Acquire(size_t size);
     void Commit(size_t size);
     void Push(const char* p, size_t len);
@@ -1,6 +1,19 @@
 #ifdef __linux__
 #include "uring.hpp"
 
+#include <climits>
+
+#ifndef IORING_RECVSEND_BUNDLE
+// Linux 6.10, newer than the headers
+#define IORING_RECVSEND_BUNDLE (1U << 4)
+#define IORING_FEAT_RECVSEND_BUNDLE (1U << 14)
+#endif
+
+#ifndef IORING_FIXED_FD_NO_CLOEXEC
+// Linux 6.8, newer than the headers
+#define IORING_OP_FIXED_FD_INSTALL 54
+#endif
+
 namespace NNet {
 
 TUring::TUring(int queueSize)
@@ -60,14 +73,15 @@ TUring::~TUring() {
 
 void TUring::Read(int fd, void* buf, int size, std::coroutine_handle<> handle) {
     struct io_uring_sqe *sqe = GetSqe();
-    io_uring_prep_read(sqe, fd, buf, size, 0);
+    // -1 reads at the file position and advances it, like read(2), so ReadSome works on regular files
+    io_uring_prep_read(sqe, fd, buf, size, static_cast<uint64_t>(-1));
     //io_uring_prep_read_fixed(sqe, fd, Buffer_.data(), size, 0, 0);
     io_uring_sqe_set_data(sqe, handle.address());
 }
 
 void TUring::Write(int fd, const void* buf, int size, std::coroutine_handle<> handle) {
     struct io_uring_sqe *sqe = GetSqe();
-    io_uring_prep_write(sqe, fd, buf, size, 0);
+    io_uring_prep_write(sqe, fd, buf, size, static_cast<uint64_t>(-1));
     //memcpy(Buffer_.data(), buf, size);
     //io_uring_prep_write_fixed(sqe, fd, Buffer_.data(), size, 0, 0);
     io_uring_sqe_set_data(sqe, handle.address());
@@ -85,9 +99,28 @@ void TUring::Send(int fd, const void* buf, int size, std::coroutine_handle<> han
     io_uring_sqe_set_data(sqe, handle.address());
 }
 
+void TUring::SendMsg(int fd, const msghdr* msg, unsigned flags, std::coroutine_handle<> handle) {
+    struct io_uring_sqe *sqe = GetSqe();
+    io_uring_prep_sendmsg(sqe, fd, msg, flags);
+    io_uring_sqe_set_data(sqe, handle.address());
+}
+
+void TUring::RecvMsg(int fd, msghdr* msg, unsigned flags, std::coroutine_handle<> handle) {
+    struct io_uring_sqe *sqe = GetSqe();
+    io_uring_prep_recvmsg(sqe, fd, msg, flags);
+    io_uring_sqe_set_data(sqe, handle.address());
+}
+
+void TUring::Writev(int fd, const iovec* iov, int iovcnt, std::coroutine_handle<> handle) {
+    struct io_uring_sqe *sqe = GetSqe();
+    io_uring_prep_writev(sqe, fd, iov, iovcnt, static_cast<uint64_t>(-1));
+    io_uring_sqe_set_data(sqe, handle.address());
+}
+
 void TUring::Accept(int fd, sockaddr* addr, socklen_t* len, std::coroutine_handle<> handle) {
     struct io_uring_sqe *sqe = GetSqe();
-    io_uring_prep_accept(sqe, fd, addr, len, 0);
+    // the socket needs no fcntl afterwards, see TPollerDrivenSocket::Accept
+    io_uring_prep_accept(sqe, fd, addr, len, SOCK_NONBLOCK | SOCK_CLOEXEC);
     io_uring_sqe_set_data(sqe, handle.address());
 }
 
@@ -97,6 +130,226 @@ void TUring::Connect(int fd, const sockaddr* addr, socklen_t len, std::coroutine
     io_uring_sqe_set_data(sqe, handle.address());
 }
 
+void TUring::Splice(int fdIn, int fdOut, int size, std::coroutine_handle<> handle) {
+    struct io_uring_sqe *sqe = GetSqe();
+    io_uring_prep_splice(sqe, fdIn, -1, fdOut, -1, size, SPLICE_F_MOVE);
+    io_uring_sqe_set_data(sqe, handle.address());
+}
+
+void TUring::PollAdd(int fd, unsigned mask, std::coroutine_handle<> handle) {
+    struct io_uring_sqe *sqe = GetSqe();
+    io_uring_prep_poll_add(sqe, fd, mask);
+    io_uring_sqe_set_data(sqe, handle.address());
+}
+
+void TUring::ReadAt(int fd, void* buf, int size, uint64_t offset, std::coroutine_handle<> handle) {
+    struct io_uring_sqe *sqe = GetSqe();
+    io_uring_prep_read(sqe, fd, buf, size, offset);
+    io_uring_sqe_set_data(sqe, handle.address());
+}
+
+void TUring::WriteAt(int fd, const void* buf, int size, uint64_t offset, std::coroutine_handle<> handle) {
+    struct io_uring_sqe *sqe = GetSqe();
+    io_uring_prep_write(sqe, fd, buf, size, offset);
+    io_uring_sqe_set_data(sqe, handle.address());
+}
+
+void TUring::Fsync(int fd, std::coroutine_handle<> handle) {
+    struct io_uring_sqe *sqe = GetSqe();
+    io_uring_prep_fsync(sqe, fd, 0);
+    io_uring_sqe_set_data(sqe, handle.address());
+}
+
+void TUring::Fdatasync(int fd, std::coroutine_handle<> handle) {
+    struct io_uring_sqe *sqe = GetSqe();
+    io_uring_prep_fsync(sqe, fd, IORING_FSYNC_DATASYNC);
+    io_uring_sqe_set_data(sqe, handle.address());
+}
+
+void TUring::Openat(int dirfd, const char* path, int flags, mode_t mode, std::coroutine_handle<> handle) {
+    struct io_uring_sqe *sqe = GetSqe();
+    io_uring_prep_openat(sqe, dirfd, path, flags | O_CLOEXEC, mode);
+    io_uring_sqe_set_data(sqe, handle.address());
+}
+
+void TUring::Fallocate(int fd, int mode, uint64_t offset, uint64_t len, std::coroutine_handle<> handle) {
+    struct io_uring_sqe *sqe = GetSqe();
+    io_uring_prep_fallocate(sqe, fd, mode, offset, len);
+    io_uring_sqe_set_data(sqe, handle.address());
+}
+
+void TUring::Madvise(void* addr, size_t len, int advice, std::coroutine_handle<> handle) {
+    struct io_uring_sqe *sqe = GetSqe();
+    io_uring_prep_madvise(sqe, addr, len, advice);
+    io_uring_sqe_set_data(sqe, handle.address());
+}
+
+void TUring::WriteAtSync(int fd, const void* buf, int size, uint64_t offset, bool datasync, TSyncWriteResult* result, std::coroutine_handle<> handle) {
+    // both entries must be in the same submission, GetSqe may submit when the ring is full
+    if (ChangesProcessed_ < Changes_.size()) {
+        ProcessChanges();
+    }
+    if (io_uring_sq_space_left(&Ring_) < 2) {
+        Submit();
+    }
+    // the frames are aligned, the low bit tells the write from the fsync
+    uint64_t userData = SyncTag | reinterpret_cast<uint64_t>(handle.address());
+    SyncWrites_[userData] = TSyncWrite{size, result};
+    struct io_uring_sqe *sqe = GetSqe();
+    io_uring_prep_write(sqe, fd, buf, size, offset);
+    io_uring_sqe_set_data64(sqe, userData | 1);
+    sqe->flags |= IOSQE_IO_LINK;
+    sqe = GetSqe();
+    io_uring_prep_fsync(sqe, fd, datasync ? IORING_FSYNC_DATASYNC : 0);
+    io_uring_sqe_set_data64(sqe, userData);
+}
+
+void TUring::OnSyncWrite(uint64_t userData, int result) {
+    auto it = SyncWrites_.find(userData & ~1ULL);
+    if (it == SyncWrites_.end()) {
+        return;
+    }
+    auto& write = it->second;
+    if (userData & 1) {
+        write.WriteResult = result;
+    } else {
+        write.SyncResult = result;
+    }
+    if (--write.Pending > 0) {
+        return;
+    }
+    // a failed or short write cancels the fsync, its -ECANCELED says nothing of the cause
+    int r = 0;
+    if (write.WriteResult < 0) {
+        r = write.WriteResult;
+    } else {
+        *write.Result = TSyncWriteResult{write.WriteResult, false};
+        if (write.WriteResult == write.Size) {
+            r = write.SyncResult;
+            write.Result->Synced = r == 0;
+        }
+    }
+    SyncWrites_.erase(it);
+    Results_.emplace(r, 0);
+    ReadyEvents_.emplace_back(TEvent{-1, 0, std::coroutine_handle<>::from_address(reinterpret_cast<void*>(userData & ~(SyncTag | 1ULL)))});
+}
+
+void TUring::RecvMsgMultishot(int fd, msghdr* msg, TBufferRing& buffers, TMultishot& multishot) {
+    struct io_uring_sqe *sqe = GetSqe();
+    io_uring_prep_recvmsg_multishot(sqe, fd, msg, 0);
+    sqe->flags |= IOSQE_BUFFER_SELECT;
+    sqe->buf_group = buffers.Group();
+    io_uring_sqe_set_data64(sqe, multishot.UserData_);
+    multishot.Armed_ = true;
+}
+
+void TUring::RecvBundle(int fd, TBufferRing& buffers, std::coroutine_handle<> handle) {
+    struct io_uring_sqe *sqe = GetSqe();
+    // the size of a buffer, or of the bundle, is the limit
+    io_uring_prep_recv(sqe, fd, nullptr, 0, 0);
+    sqe->flags |= IOSQE_BUFFER_SELECT;
+    sqe->buf_group = buffers.Group();
+    if (Bundles()) {
+        sqe->ioprio |= IORING_RECVSEND_BUNDLE;
+    }
+    io_uring_sqe_set_data(sqe, handle.address());
+}
+
+bool TUring::Bundles() const {
+    return BundlesEnabled_ && (Ring_.features & IORING_FEAT_RECVSEND_BUNDLE);
+}
+
+void TUring::ProbeDirect() {
+    DirectProbed_ = true;
+    io_uring_probe* probe = io_uring_get_probe_ring(&Ring_);
+    if (!probe) {
+        return;
+    }
+    bool supported = io_uring_opcode_supported(probe, IORING_OP_SOCKET)
+        && io_uring_opcode_supported(probe, IORING_OP_FIXED_FD_INSTALL);
+    io_uring_free_probe(probe);
+    if (!supported || io_uring_register_files_sparse(&Ring_, DirectCount) < 0) {
+        return;
+    }
+    for (unsigned slot = DirectCount; slot > 0; slot--) {
+        FreeDirect_.push_back(slot - 1);
+    }
+}
+
+bool TUring::ConnectChain(int domain, const sockaddr* addr, socklen_t len, const void* data, int size, TConnectChain& chain) {
+    if (!DirectProbed_) {
+        ProbeDirect();
+    }
+    if (FreeDirect_.empty()) {
+        return false;
+    }
+    unsigned slot = FreeDirect_.back();
+    FreeDirect_.pop_back();
+
+    // the whole chain must be in the same submission, GetSqe may submit when the ring is full.
+    // Hard links: the close of the slot runs whatever fails before it
+    if (ChangesProcessed_ < Changes_.size()) {
+        ProcessChanges();
+    }
+    if (io_uring_sq_space_left(&Ring_) < 5) {
+        Submit();
+    }
+    uint64_t userData = ChainTag | (chain.Id_ << 2);
+    struct io_uring_sqe *sqe = GetSqe();
+    io_uring_prep_socket_direct(sqe, domain, SOCK_STREAM | SOCK_NONBLOCK, 0, slot, 0);
+    io_uring_sqe_set_data64(sqe, userData | TConnectChain::Socket);
+    sqe->flags |= IOSQE_IO_HARDLINK;
+
+    sqe = GetSqe();
+    io_uring_prep_connect(sqe, slot, addr, len);
+    io_uring_sqe_set_data64(sqe, userData | TConnectChain::Connect);
+    sqe->flags |= IOSQE_FIXED_FILE | IOSQE_IO_HARDLINK;
+
+    if (size > 0) {
+        sqe = GetSqe();
+        io_uring_prep_send(sqe, slot, data, size, MSG_NOSIGNAL);
+        io_uring_sqe_set_data64(sqe, userData | TConnectChain::Send);
+        sqe->flags |= IOSQE_FIXED_FILE | IOSQE_IO_HARDLINK;
+    }
+
+    // the regular descriptor has O_CLOEXEC
+    sqe = GetSqe();
+    io_uring_prep_rw(IORING_OP_FIXED_FD_INSTALL, sqe, slot, nullptr, 0, 0);
+    io_uring_sqe_set_data64(sqe, userData | TConnectChain::Install);
+    sqe->flags |= IOSQE_FIXED_FILE | IOSQE_IO_HARDLINK;
+
+    sqe = GetSqe();
+    io_uring_prep_close_direct(sqe, slot);
+    io_uring_sqe_set_data64(sqe, DirectTag | slot);
+    chain.Pending_ = size > 0 ? 4 : 3;
+    return true;
+}
+
+void TUring::OnChain(uint64_t userData, int result) {
+    uint64_t id = (userData & ~ChainTag) >> 2;
+    auto step = static_cast<TConnectChain::EStep>(userData & 3);
+    auto it = Chains_.find(id);
+    if (it == Chains_.end()) {
+        if (step == TConnectChain::Install && AbandonedChains_.erase(id) && result >= 0) {
+            ::close(result);
+        }
+        return;
+    }
+    auto* chain = it->second;
+    chain->Results_[step] = result;
+    if (--chain->Pending_ == 0) {
+        if (auto waiter = std::exchange(chain->Waiter_, {})) {
+            ReadyEvents_.emplace_back(TEvent{-1, 0, waiter});
+        }
+    }
+}
+
+void TUring::Close(int fd, std::coroutine_handle<> handle) {
+    struct io_uring_sqe *sqe = GetSqe();
+    io_uring_prep_close(sqe, fd);
+    io_uring_sqe_set_data(sqe, handle.address());
+}
+
 void TUring::Cancel(int fd) {
     struct io_uring_sqe *sqe = GetSqe();
     // io_uring_prep_cancel_fd(sqe, fd, 0);
@@ -110,66 +363,240 @@ void TUring::Cancel(std::coroutine_handle<> h) {
     io_uring_prep_cancel(sqe, h.address(), 0);
 }
 
-void TUring::Register(int) {
+void TUring::ProcessChanges() {
+    while (ChangesProcessed_ < Changes_.size()) {
+        TEvent ch = Changes_[ChangesProcessed_++];
+        int fd = ch.Fd;
+        if (ch.Type == (TEvent::READ|TEvent::WRITE|TEvent::RHUP) && !ch.Handle) {
+            // the descriptor is closed
+            struct io_uring_sqe *sqe = NextSqe();
+            io_uring_prep_rw(IORING_OP_ASYNC_CANCEL, sqe, fd, nullptr, 0, 0);
+            io_uring_sqe_set_data(sqe, nullptr);
+            sqe->cancel_flags = (1U << 1);
+            if (fd < static_cast<int>(Polls_.size())) {
+                RemovePoll(fd);
+                Polls_[fd].Handles = {};
+            }
+            continue;
+        }
+        if (fd >= static_cast<int>(Polls_.size())) {
+            Polls_.resize(fd + 1);
+        }
+        auto& handles = Polls_[fd].Handles;
+        if (ch.Type & TEvent::READ) {
+            handles.Read = ch.Handle;
+        }
+        if (ch.Type & TEvent::WRITE) {
+            handles.Write = ch.Handle;
+        }
+        if (ch.Type & TEvent::RHUP) {
+            handles.RHup = ch.Handle;
+        }
+        unsigned mask = Polls_[fd].Mask;
+        if (handles.Read) {
+            mask |= POLLIN;
+        }
+        if (handles.Write) {
+            mask |= POLLOUT;
+        }
+        if (handles.RHup) {
+            mask |= POLLRDHUP;
+        }
+        if (mask != Polls_[fd].Mask) {
+            ArmPoll(fd, mask);
+        }
+    }
+}
 
+void TUring::ArmPoll(int fd, unsigned mask) {
+    RemovePoll(fd);
+    struct io_uring_sqe *sqe = NextSqe();
+    io_uring_prep_poll_multishot(sqe, fd, mask);
+    io_uring_sqe_set_data64(sqe, PollUserData(fd));
+    Polls_[fd].Mask = mask;
 }
 
-int TUring::Wait(timespec ts) {
-    struct io_uring_cqe *cqe;
-    unsigned head;
-    int err;
+void TUring::RemovePoll(int fd) {
+    auto& poll = Polls_[fd];
+    if (poll.Mask) {
+        struct io_uring_sqe *sqe = NextSqe();
+        io_uring_prep_poll_remove(sqe, PollUserData(fd));
+        io_uring_sqe_set_data(sqe, nullptr);
+        poll.Mask = 0;
+    }
+    poll.Generation++;
+}
 
-    for (auto& ev : Changes_) {
-        assert(ev.Type == (TEvent::READ|TEvent::WRITE|TEvent::RHUP));
-        assert(!ev.Handle);
-        Cancel(ev.Fd);
+void TUring::OnPoll(uint64_t userData, int result, unsigned flags) {
+    int fd = static_cast<uint32_t>(userData);
+    if (fd >= static_cast<int>(Polls_.size()) || userData != PollUserData(fd)) {
+        return; // a removed request
+    }
+    auto& poll = Polls_[fd];
+    unsigned events = result;
+    if (result < 0 || !(flags & IORING_CQE_F_MORE)) {
+        // the request is over: everybody retries and the next wait arms a new one
+        poll.Mask = 0;
+        poll.Generation++;
+        events = POLLIN | POLLOUT | POLLRDHUP;
+    }
+    // the handles are taken, so several completions in one batch resume a waiter once,
+    // Wakeup keeps a re-registration and removes the rest
+    if ((events & (POLLIN | POLLHUP | POLLERR | POLLRDHUP)) && poll.Handles.Read) {
+        ReadyEvents_.emplace_back(TEvent{fd, TEvent::READ, std::exchange(poll.Handles.Read, {})});
+    }
+    if ((events & (POLLOUT | POLLHUP | POLLERR | POLLRDHUP)) && poll.Handles.Write) {
+        ReadyEvents_.emplace_back(TEvent{fd, TEvent::WRITE, std::exchange(poll.Handles.Write, {})});
+    }
+    if ((events & (POLLRDHUP | POLLHUP)) && poll.Handles.RHup) {
+        ReadyEvents_.emplace_back(TEvent{fd, TEvent::RHUP, std::exchange(poll.Handles.RHup, {})});
     }
+}
 
-    Reset();
+unsigned TUring::AddTimer(TTime deadline, THandle h) {
+    if (!KernelTimers_) {
+        return TPollerBase::AddTimer(deadline, h);
+    }
+    unsigned id = TimerId_++;
+    auto since = deadline.time_since_epoch();
+    auto sec = std::chrono::duration_cast<std::chrono::seconds>(since);
+    auto& timer = Timeouts_[id];
+    timer.Handle = h;
+    timer.Deadline = {sec.count(), std::chrono::duration_cast<std::chrono::nanoseconds>(since - sec).count()};
+    struct io_uring_sqe *sqe = GetSqe();
+    // TClock is CLOCK_MONOTONIC, the clock of the absolute timeouts
+    io_uring_prep_timeout(sqe, &timer.Deadline, 0, IORING_TIMEOUT_ABS);
+    io_uring_sqe_set_data64(sqe, TimerTag | id);
+    return id;
+}
 
-//        int nfds = 0;
-//        int timeout = 1000; // ms
-//        epoll_event outEvents[1];
+bool TUring::RemoveTimer(unsigned timerId, TTime deadline) {
+    auto it = Timeouts_.find(timerId);
+    if (it == Timeouts_.end()) {
+        for (auto& [id, handle] : FiredTimers_) {
+            if (id == timerId && handle) {
+                // fired in this batch, but the waiter is gone before its turn
+                handle = {};
+                return false;
+            }
+        }
+        // a timer of the heap or a fired one
+        return TPollerBase::RemoveTimer(timerId, deadline);
+    }
+    if (!it->second.Removed) {
+        it->second.Removed = true;
+        struct io_uring_sqe *sqe = GetSqe();
+        io_uring_prep_timeout_remove(sqe, TimerTag | timerId, 0);
+        io_uring_sqe_set_data(sqe, nullptr);
+    }
+    return false;
+}
 
-//        while ((nfds =  epoll_wait(EpollFd_, &outEvents[0], 1, timeout)) < 0) {
-//            if (errno != EINTR) {
-//                throw std::system_error(errno, std::generic_category(), "epoll_wait");
-//            }
-//        }
+void TUring::Register(int) {
 
-//        if (nfds == 1) {
-//            eventfd_t v;
-//            eventfd_read(RingFd_, &v);
-//        }
+}
 
-    struct __kernel_timespec kts = {ts.tv_sec, ts.tv_nsec};
-//        if ((err = io_uring_submit_and_wait_timeout(&Ring_, &cqe, 1, &ts, nullptr)) < 0) {
-//            if (-err != ETIME) {
-//                throw std::system_error(-err, std::generic_category(), "io_uring_wait_cqe_timeout");
-//            }
-//        }
+namespace {
 
-    Submit();
+std::chrono::nanoseconds ToDuration(timespec ts) {
+    return std::chrono::seconds(ts.tv_sec) + std::chrono::nanoseconds(ts.tv_nsec);
+}
 
-    if ((err = io_uring_wait_cqe_timeout(&Ring_, &cqe, &kts)) < 0) {
-        if (-err != ETIME) {
-            throw std::system_error(-err, std::generic_category(), "io_uring_wait_cqe_timeout");
+} // namespace
+
+bool TUring::SubmitAndWait(unsigned waitNr, std::chrono::nanoseconds timeout) {
+    auto sec = std::chrono::duration_cast<std::chrono::seconds>(timeout);
+    struct __kernel_timespec kts = {sec.count(), (timeout - sec).count()};
+    struct io_uring_cqe *cqe = nullptr;
+    unsigned ready = io_uring_sq_ready(&Ring_);
+    int err = io_uring_submit_and_wait_timeout(&Ring_, &cqe, waitNr, &kts, nullptr);
+    Stats_.Enters++;
+    if (err < 0 && -err != ETIME && -err != EINTR) {
+        throw std::system_error(-err, std::generic_category(), "io_uring_submit_and_wait_timeout");
+    }
+    Stats_.Submitted += ready - io_uring_sq_ready(&Ring_);
+    return cqe != nullptr;
+}
+
+int TUring::Wait(timespec ts) {
+    ProcessChanges();
+    Reset();
+    ChangesProcessed_ = 0;
+    Stats_.Iterations++;
+
+    auto timeout = ToDuration(ts);
+    if (timeout.count() == 0) {
+        // spinning or an expired timer: take the ready completions, entering the kernel only to submit
+        Submit();
+    } else if (MinBatch_ > 1 && MinBatchWait_ < timeout) {
+        if (!SubmitAndWait(MinBatch_, MinBatchWait_)) {
+            SubmitAndWait(1, timeout - MinBatchWait_);
         }
+    } else {
+        SubmitAndWait(MinBatch_, timeout);
     }
 
     assert(Results_.empty());
 
     int completed = 0;
-    io_uring_for_each_cqe(&Ring_, head, cqe) {
-        completed ++;
-        void* data = reinterpret_cast<void*>(cqe->user_data);
-        if (data != nullptr) {
-            Results_.push(cqe->res);
-            ReadyEvents_.emplace_back(TEvent{-1, 0, std::coroutine_handle<>::from_address(data)});
+    struct io_uring_cqe* cqes[256];
+    unsigned count;
+    while ((count = io_uring_peek_batch_cqe(&Ring_, cqes, sizeof(cqes) / sizeof(cqes[0]))) > 0) {
+        for (unsigned i = 0; i < count; i++) {
+            if (cqes[i]->user_data & MultishotTag) {
+                auto it = Multishots_.find(cqes[i]->user_data);
+                if (it != Multishots_.end()) {
+                    if (auto waiter = it->second->Complete(cqes[i]->res, cqes[i]->flags)) {
+                        ReadyEvents_.emplace_back(TEvent{-1, 0, waiter});
+                    }
+                }
+                continue;
+            }
+            if (cqes[i]->user_data & PollTag) {
+                OnPoll(cqes[i]->user_data, cqes[i]->res, cqes[i]->flags);
+                continue;
+            }
+            if (cqes[i]->user_data & ChainTag) {
+                OnChain(cqes[i]->user_data, cqes[i]->res);
+                continue;
+            }
+            if (cqes[i]->user_data & SyncTag) {
+                OnSyncWrite(cqes[i]->user_data, cqes[i]->res);
+                continue;
+            }
+            if (cqes[i]->user_data & DirectTag) {
+                FreeDirect_.push_back(static_cast<unsigned>(cqes[i]->user_data));
+                continue;
+            }
+            if (cqes[i]->user_data & TimerTag) {
+                auto it = Timeouts_.find(static_cast<unsigned>(cqes[i]->user_data));
+                if (it != Timeouts_.end()) {
+                    if (!it->second.Removed && cqes[i]->res == -ETIME) {
+                        FiredTimers_.emplace_back(it->first, it->second.Handle);
+                    }
+                    Timeouts_.erase(it);
+                }
+                continue;
+            }
+            void* data = reinterpret_cast<void*>(cqes[i]->user_data);
+            if (data != nullptr) {
+                Results_.emplace(cqes[i]->res, cqes[i]->flags);
+                ReadyEvents_.emplace_back(TEvent{-1, 0, std::coroutine_handle<>::from_address(data)});
+            }
         }
+        io_uring_cq_advance(&Ring_, count);
+        completed += count;
     }
+    Stats_.Completions += completed;
 
-    io_uring_cq_advance(&Ring_, completed);
+    // resumed from Poll like the timers of the heap
+    for (size_t i = 0; i < FiredTimers_.size(); i++) {
+        if (auto handle = std::exchange(FiredTimers_[i].second, {})) {
+            LastFiredTimer_ = FiredTimers_[i].first;
+            handle.resume();
+        }
+    }
+    FiredTimers_.clear();
 
     ProcessTimers();
 
@@ -177,16 +604,143 @@ int TUring::Wait(timespec ts) {
 }
 
 int TUring::Result() {
-    int r = Results_.front();
+    auto [r, flags] = Results_.front();
     Results_.pop();
+    ResultFlags_ = flags;
     return r;
 }
 
 void TUring::Submit() {
+    unsigned ready = io_uring_sq_ready(&Ring_);
+    if (ready == 0) {
+        return;
+    }
     int err;
-    if ((err = io_uring_submit(&Ring_) < 0)) {
+    if ((err = io_uring_submit(&Ring_)) < 0) {
         throw std::system_error(-err, std::generic_category(), "io_uring_submit");
     }
+    Stats_.Enters++;
+    Stats_.Submitted += err;
+}
+
+TMultishot::TMultishot(TUring& ring)
+    : Ring_(ring)
+    , UserData_(TUring::MultishotTag | ring.NextMultishot_++)
+{
+    Ring_.Multishots_[UserData_] = this;
+}
+
+TMultishot::~TMultishot() {
+    Ring_.Multishots_.erase(UserData_);
+    if (Armed_) {
+        struct io_uring_sqe *sqe = Ring_.GetSqe();
+        io_uring_prep_cancel64(sqe, UserData_, 0);
+        io_uring_sqe_set_data(sqe, nullptr);
+    }
+}
+
+std::coroutine_handle<> TMultishot::Complete(int result, unsigned flags) {
+    Completions_.push({result, flags});
+    if (!(flags & IORING_CQE_F_MORE)) {
+        Armed_ = false;
+    }
+    return std::exchange(Waiter_, {});
+}
+
+TConnectChain::TConnectChain(TUring& ring)
+    : Ring_(ring)
+    , Id_(ring.NextChain_++)
+{
+    Ring_.Chains_[Id_] = this;
+}
+
+TConnectChain::~TConnectChain() {
+    Ring_.Chains_.erase(Id_);
+    if (Pending_ > 0) {
+        Ring_.AbandonedChains_.insert(Id_);
+    }
+}
+
+TBufferRing::TBufferRing(TUring& ring, unsigned count, unsigned size)
+    : Ring_(ring)
+    , Count_(count)
+    , Size_(size)
+    , Group_(ring.NextBufferGroup_++)
+    , Data_(count * size)
+    , Order_(count)
+    , Tail_(count)
+{
+    int err;
+    Buffers_ = io_uring_setup_buf_ring(&Ring_.Ring_, Count_, Group_, 0, &err);
+    if (!Buffers_) {
+        throw std::system_error(-err, std::generic_category(), "io_uring_setup_buf_ring");
+    }
+    for (unsigned i = 0; i < Count_; i++) {
+        io_uring_buf_ring_add(Buffers_, Buffer(i), Size_, i, io_uring_buf_ring_mask(Count_), i);
+        Order_[i] = i;
+    }
+    io_uring_buf_ring_advance(Buffers_, Count_);
+}
+
+TBufferRing::~TBufferRing() {
+    io_uring_free_buf_ring(&Ring_.Ring_, Buffers_, Count_, Group_);
+}
+
+void TBufferRing::Release(unsigned short id) {
+    io_uring_buf_ring_add(Buffers_, Buffer(id), Size_, id, io_uring_buf_ring_mask(Count_), 0);
+    io_uring_buf_ring_advance(Buffers_, 1);
+    Order_[Tail_++ & (Count_ - 1)] = id;
+}
+
+TBundle TBufferRing::Take(int size, unsigned flags) {
+    TBundle bundle;
+    if (size <= 0 || !(flags & IORING_CQE_F_BUFFER)) {
+        // a buffer taken for nothing (the end of the stream) is given back by the next take
+        return bundle;
+    }
+    bundle.Size = size;
+    unsigned short first = flags >> IORING_CQE_BUFFER_SHIFT;
+    for (unsigned i = 0; i < Count_ && Head_ != Tail_ && Order_[Head_ & (Count_ - 1)] != first; i++) {
+        Release(Order_[Head_++ & (Count_ - 1)]);
+    }
+    for (unsigned n = (size + Size_ - 1) / Size_; n > 0 && Head_ != Tail_; n--) {
+        bundle.Ids.push_back(Order_[Head_++ & (Count_ - 1)]);
+    }
+    return bundle;
+}
+
+TValueTask<TLinkedConnect> ConnectLinked(TUring& ring, TAddress address, const void* data, size_t size) {
+    int chunk = static_cast<int>(std::min<size_t>(size, INT_MAX));
+    TConnectChain chain(ring);
+    auto raw = address.RawAddr();
+    if (!ring.ConnectChain(address.Domain(), raw.first, raw.second, data, chunk, chain)) {
+        TUring::TSocket socket(std::move(address), ring);
+        co_await socket.Connect();
+        ssize_t sent = 0;
+        if (chunk > 0) {
+            sent = co_await socket.WriteSome(data, chunk);
+        }
+        co_return TLinkedConnect{std::move(socket), sent};
+    }
+
+    co_await chain.Wait();
+    int fd = chain.Result(TConnectChain::Install);
+    // hard links run the steps after a failed one too, with errors of their own (a send after
+    // a failed connect gets EPIPE): the cause is the first failure in the order of the chain
+    std::pair<const char*, TConnectChain::EStep> steps[] = {
+        {"socket", TConnectChain::Socket}, {"connect", TConnectChain::Connect},
+        {"send", TConnectChain::Send}, {"fixed_fd_install", TConnectChain::Install}
+    };
+    for (auto [op, step] : steps) {
+        int result = chain.Result(step);
+        if (result < 0) {
+            if (fd >= 0) {
+                ::close(fd);
+            }
+            throw std::system_error(-result, std::generic_category(), op);
+        }
+    }
+    co_return TLinkedConnect{TUring::TSocket(address, fd, ring, true), chain.Result(TConnectChain::Send)};
 }
 
 std::tuple<int, int, int> TUring::Kernel() const {
@@ -1,24 +1,51 @@
 #pragma once
 
 #include "base.hpp"
+#include "fileop.hpp"
 #include "socket.hpp"
 #include "poller.hpp"
+#include "corochain.hpp"
 
 #include <liburing.h>
 #include <assert.h>
+#include <poll.h>
 #include <sys/eventfd.h>
 #include <sys/epoll.h>
 #include <sys/utsname.h>
 
+#include <algorithm>
+#include <chrono>
 #include <system_error>
 #include <iostream>
 #include <tuple>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
 #include <vector>
 #include <coroutine>
 #include <queue>
 
 namespace NNet {
 
+// Counters of the ring, Enters / Iterations is the number of syscalls per loop iteration
+struct TUringStats {
+    uint64_t Iterations = 0; // calls of Wait
+    uint64_t Enters = 0; // io_uring_enter calls, the submits of a full SQ included
+    uint64_t FullSqSubmits = 0;
+    uint64_t Submitted = 0; // SQEs
+    uint64_t Completions = 0; // CQEs
+};
+
+class TMultishot;
+class TBufferRing;
+class TConnectChain;
+
+// The buffers of a TBufferRing filled by a receive, in order: all of them are full but the last one
+struct TBundle {
+    std::vector<unsigned short> Ids;
+    size_t Size = 0; // bytes
+};
+
 class TUring: public TPollerBase {
 public:
     using TSocket = NNet::TPollerDrivenSocket<TUring>;
@@ -32,19 +59,108 @@ public:
     void Write(int fd, const void* buf, int size, std::coroutine_handle<> handle);
     void Recv(int fd, void* buf, int size, std::coroutine_handle<> handle);
     void Send(int fd, const void* buf, int size, std::coroutine_handle<> handle);
+    void Writev(int fd, const iovec* iov, int iovcnt, std::coroutine_handle<> handle);
+    // The message must stay valid until the completion, it carries SCM_RIGHTS for Unix sockets
+    void SendMsg(int fd, const msghdr* msg, unsigned flags, std::coroutine_handle<> handle);
+    void RecvMsg(int fd, msghdr* msg, unsigned flags, std::coroutine_handle<> handle);
     void Accept(int fd, struct sockaddr* addr, socklen_t* len, std::coroutine_handle<> handle);
     void Connect(int fd, const sockaddr* addr, socklen_t len, std::coroutine_handle<> handle);
+    // Moves up to size bytes between fds without copying to user space, one of them must be a pipe
+    void Splice(int fdIn, int fdOut, int size, std::coroutine_handle<> handle);
+    // One-shot wait for poll events (POLLIN, POLLOUT, ...), the result is the ready mask
+    void PollAdd(int fd, unsigned mask, std::coroutine_handle<> handle);
+    // File operations for TAsyncFile, the same set is run on threads by TFileIoPool
+    void ReadAt(int fd, void* buf, int size, uint64_t offset, std::coroutine_handle<> handle);
+    void WriteAt(int fd, const void* buf, int size, uint64_t offset, std::coroutine_handle<> handle);
+    void Fsync(int fd, std::coroutine_handle<> handle);
+    void Fdatasync(int fd, std::coroutine_handle<> handle);
+    void Openat(int dirfd, const char* path, int flags, mode_t mode, std::coroutine_handle<> handle);
+    void Close(int fd, std::coroutine_handle<> handle);
+    void Fallocate(int fd, int mode, uint64_t offset, uint64_t len, std::coroutine_handle<> handle);
+    // madvise(2) in the ring, a null handle leaves the result unread (prefetch hints)
+    void Madvise(void* addr, size_t len, int advice, std::coroutine_handle<> handle);
+    // Write linked with fsync in one submission. The result is the error of the write or of
+    // the fsync after a whole write, 0 otherwise; the count and the sync go to result, which
+    // must stay valid until the completion
+    void WriteAtSync(int fd, const void* buf, int size, uint64_t offset, bool datasync, TSyncWriteResult* result, std::coroutine_handle<> handle);
+    // Multishot recvmsg into the buffers of the ring, a completion per message until the
+    // request ends (Linux 6.0). The message must stay valid while the request is armed
+    void RecvMsgMultishot(int fd, msghdr* msg, TBufferRing& buffers, TMultishot& multishot);
+    // Recv into the buffers of the ring, a bundle (IORING_RECVSEND_BUNDLE) when Bundles() is true:
+    // one completion fills as many buffers as the socket has data for. Otherwise one buffer.
+    // The buffers consumed are the result of TBufferRing::Take(Result(), ResultFlags())
+    void RecvBundle(int fd, TBufferRing& buffers, std::coroutine_handle<> handle);
+    // The chain of ConnectLinked: IORING_OP_SOCKET into a direct descriptor, connect, send when
+    // size > 0 and the install of the descriptor as a regular one, linked in one submission.
+    // The results come to chain by their step. false when the kernel has no IORING_OP_SOCKET
+    // or IORING_OP_FIXED_FD_INSTALL (Linux 6.8) or all of the direct descriptors are taken
+    bool ConnectChain(int domain, const sockaddr* addr, socklen_t len, const void* data, int size, TConnectChain& chain);
     void Cancel(int fd);
     void Cancel(std::coroutine_handle<> h);
     void Register(int fd);
 
+    // Submits the queued SQEs and waits for completions in one io_uring_enter,
+    // then reaps all of the ready CQEs in batches
     int Wait(timespec ts = {10,0});
 
+    // Waits for at least n completions, but no longer than maxWait, before returning what is
+    // ready: fewer iterations of the loop under load for up to maxWait of latency.
+    // When nothing completes within maxWait the first completion is waited for as usual.
+    // 1, the default, returns on the first completion.
+    void SetMinBatch(unsigned n, std::chrono::microseconds maxWait) {
+        MinBatch_ = std::max(n, 1U);
+        MinBatchWait_ = maxWait;
+    }
+
+    const TUringStats& Stats() const {
+        return Stats_;
+    }
+
+    // Timers as IORING_OP_TIMEOUT requests instead of the heap of TPollerBase: the kernel keeps
+    // them and their completions come in the batch of the other completions.
+    // Applies to the sleeps and deadlines taken through TUring (Sleep on it, the deadlines of
+    // TPollerDrivenSocket<TUring>), the ones taken through TPollerBase stay on the heap
+    void SetKernelTimers(bool enabled) {
+        KernelTimers_ = enabled;
+    }
+
+    // The timeout requests in the kernel, the removed ones count until their completion
+    size_t KernelTimersSize() const {
+        return Timeouts_.size();
+    }
+
+    // Bundles are used when the kernel has them (Linux 6.10), false turns them off
+    void SetBundles(bool enabled) {
+        BundlesEnabled_ = enabled;
+    }
+
+    bool Bundles() const;
+
+    unsigned AddTimer(TTime deadline, THandle h);
+    bool RemoveTimer(unsigned timerId, TTime deadline);
+
+    auto Sleep(TTime until) {
+        return NDetail::TAwaitableSleep<TUring>{this, until};
+    }
+
+    template<typename Rep, typename Period>
+    auto Sleep(std::chrono::duration<Rep,Period> duration) {
+        return Sleep(TClock::now() + duration);
+    }
+
+    auto Yield() {
+        return Sleep(TTime{});
+    }
+
     void Poll() {
         Wait(GetTimeout());
     }
 
     int Result();
+    // The flags of the completion of the last Result, the buffer id of IOSQE_BUFFER_SELECT
+    unsigned ResultFlags() const {
+        return ResultFlags_;
+    }
 
     void Submit();
 
@@ -53,22 +169,258 @@ public:
     const std::string& KernelStr() const;
 
 private:
+    friend class TMultishot;
+    friend class TBufferRing;
+    friend class TConnectChain;
+
     io_uring_sqe* GetSqe() {
+        if (ChangesProcessed_ < Changes_.size()) {
+            ProcessChanges();
+        }
+        return NextSqe();
+    }
+
+    io_uring_sqe* NextSqe() {
         io_uring_sqe* r = io_uring_get_sqe(&Ring_);
         if (!r) {
+            Stats_.FullSqSubmits++;
             Submit();
             r = io_uring_get_sqe(&Ring_);
         }
         return r;
     }
 
+    // Queues the cancels of the closed descriptors and the polls of the readiness waits
+    // ahead of the next op, which may already use a reused descriptor number: a cancel
+    // queued after it would cancel it.
+    // The changes stay in Changes_ until the next Wait, Wakeup looks for re-registrations there
+    void ProcessChanges();
+
+    // Readiness waits (AddRead/AddWrite/AddRemoteHup) of the sockets of the readiness pollers:
+    // one multishot poll per descriptor. Like EPOLLET it reports the wakeups after it is armed,
+    // which is enough for the awaitables that try the operation before they wait.
+    // The mask only grows until the descriptor is closed, so a loop of reads does not rearm it
+    struct TPoll {
+        THandlePair Handles;
+        unsigned Mask = 0; // of the armed request, 0 if none
+        uint32_t Generation = 0; // the completions of the previous requests are dropped
+    };
+
+    uint64_t PollUserData(int fd) const {
+        return PollTag | (static_cast<uint64_t>(Polls_[fd].Generation & 0x3fffffff) << 32) | static_cast<uint32_t>(fd);
+    }
+    void ArmPoll(int fd, unsigned mask);
+    void RemovePoll(int fd);
+    void OnPoll(uint64_t userData, int result, unsigned flags);
+
+    // Registers the table of the direct descriptors on the first chain
+    void ProbeDirect();
+
+    // true when a completion is ready
+    bool SubmitAndWait(unsigned waitNr, std::chrono::nanoseconds timeout);
+
     int RingFd_;
     int EpollFd_;
     struct io_uring Ring_;
-    std::queue<int> Results_;
+    std::queue<std::pair<int, unsigned>> Results_;
+    unsigned ResultFlags_ = 0;
     std::vector<char> Buffer_;
     std::tuple<int, int, int> Kernel_;
     std::string KernelStr_;
+    unsigned MinBatch_ = 1;
+    std::chrono::microseconds MinBatchWait_{0};
+    TUringStats Stats_;
+    // user_data of the multishot requests, the coroutine handles never have the high bit
+    static constexpr uint64_t MultishotTag = 1ULL << 63;
+    static constexpr uint64_t PollTag = 1ULL << 62;
+    static constexpr uint64_t TimerTag = 1ULL << 61;
+    // the close of a direct descriptor, the slot is free after it
+    static constexpr uint64_t DirectTag = 1ULL << 60;
+    static constexpr unsigned DirectCount = 256;
+    // the steps of the connect chains: ChainTag | id << 2 | step
+    static constexpr uint64_t ChainTag = 1ULL << 59;
+    void OnChain(uint64_t userData, int result);
+    std::unordered_map<uint64_t, TConnectChain*> Chains_;
+    // destroyed before the install, its descriptor is closed on arrival
+    std::unordered_set<uint64_t> AbandonedChains_;
+    uint64_t NextChain_ = 0;
+    // the write and the fsync of WriteAtSync: SyncTag | handle, the write has the low bit
+    static constexpr uint64_t SyncTag = 1ULL << 58;
+    struct TSyncWrite {
+        int Size;
+        TSyncWriteResult* Result;
+        int WriteResult = 0;
+        int SyncResult = 0;
+        int Pending = 2;
+    };
+    void OnSyncWrite(uint64_t userData, int result);
+    std::unordered_map<uint64_t, TSyncWrite> SyncWrites_;
+    bool DirectProbed_ = false;
+    std::vector<unsigned> FreeDirect_;
+    std::vector<TPoll> Polls_;
+    size_t ChangesProcessed_ = 0;
+    bool KernelTimers_ = false;
+    bool BundlesEnabled_ = true;
+    struct TKernelTimer {
+        THandle Handle;
+        __kernel_timespec Deadline; // read by the kernel when the request is submitted
+        bool Removed = false;
+    };
+    // until the completion of the request
+    std::unordered_map<unsigned, TKernelTimer> Timeouts_;
+    std::vector<std::pair<unsigned, THandle>> FiredTimers_;
+    std::unordered_map<uint64_t, TMultishot*> Multishots_;
+    uint64_t NextMultishot_ = 0;
+    unsigned short NextBufferGroup_ = 0;
+};
+
+// The completions of a multishot request, queued until they are taken by Next.
+// The request is over and has to be resubmitted when Armed is false.
+// The destructor cancels an armed request, its late completions are dropped by the ring.
+class TMultishot {
+public:
+    struct TCompletion {
+        int Result;
+        unsigned Flags;
+    };
+
+    TMultishot(TUring& ring);
+    ~TMultishot();
+
+    TMultishot(const TMultishot&) = delete;
+    TMultishot& operator=(const TMultishot&) = delete;
+
+    bool Armed() const {
+        return Armed_;
+    }
+
+    auto Next() {
+        struct TAwaitable {
+            bool await_ready() const { return !self->Completions_.empty(); }
+            void await_suspend(std::coroutine_handle<> h) {
+                self->Waiter_ = h;
+            }
+            TCompletion await_resume() {
+                auto completion = self->Completions_.front();
+                self->Completions_.pop();
+                return completion;
+            }
+
+            TMultishot* self;
+        };
+        return TAwaitable{this};
+    }
+
+private:
+    friend class TUring;
+
+    // Returns the coroutine to resume
+    std::coroutine_handle<> Complete(int result, unsigned flags);
+
+    TUring& Ring_;
+    uint64_t UserData_;
+    bool Armed_ = false;
+    std::queue<TCompletion> Completions_;
+    std::coroutine_handle<> Waiter_;
 };
 
+// The results of a chain of TUring::ConnectChain by step, Wait resumes after the last one.
+// Destroyed before it, the chain is left to the ring, which closes the installed descriptor
+class TConnectChain {
+public:
+    enum EStep {
+        Socket,
+        Connect,
+        Send,
+        Install,
+        Steps
+    };
+
+    TConnectChain(TUring& ring);
+    ~TConnectChain();
+
+    TConnectChain(const TConnectChain&) = delete;
+    TConnectChain& operator=(const TConnectChain&) = delete;
+
+    int Result(EStep step) const {
+        return Results_[step];
+    }
+
+    auto Wait() {
+        struct TAwaitable {
+            bool await_ready() const { return self->Pending_ == 0; }
+            void await_suspend(std::coroutine_handle<> h) {
+                self->Waiter_ = h;
+            }
+            void await_resume() { }
+
+            TConnectChain* self;
+        };
+        return TAwaitable{this};
+    }
+
+private:
+    friend class TUring;
+
+    TUring& Ring_;
+    uint64_t Id_;
+    int Results_[Steps] = {};
+    int Pending_ = 0;
+    std::coroutine_handle<> Waiter_;
+};
+
+// Buffers provided to the kernel for the requests with IOSQE_BUFFER_SELECT: a completion
+// carries the id of the buffer it has filled, Release gives the buffer back to the kernel.
+// Needs Linux 5.19, the constructor throws std::system_error before
+class TBufferRing {
+public:
+    // count is a power of 2
+    TBufferRing(TUring& ring, unsigned count, unsigned size);
+    ~TBufferRing();
+
+    TBufferRing(const TBufferRing&) = delete;
+    TBufferRing& operator=(const TBufferRing&) = delete;
+
+    unsigned short Group() const {
+        return Group_;
+    }
+
+    unsigned Size() const {
+        return Size_;
+    }
+
+    char* Buffer(unsigned short id) {
+        return &Data_[id * Size_];
+    }
+
+    void Release(unsigned short id);
+
+    // The buffers consumed by a completion with size bytes. Takes them in the order of the ring,
+    // so one receive at a time may use it
+    TBundle Take(int size, unsigned flags);
+
+private:
+    TUring& Ring_;
+    unsigned Count_;
+    unsigned Size_;
+    unsigned short Group_;
+    io_uring_buf_ring* Buffers_;
+    std::vector<char> Data_;
+    // the ids in the order they are given to the kernel, which takes them from the head
+    std::vector<unsigned short> Order_;
+    unsigned Head_ = 0;
+    unsigned Tail_ = 0;
+};
+
+struct TLinkedConnect {
+    TUring::TSocket Socket;
+    ssize_t Sent = 0; // of the data passed to ConnectLinked
+};
+
+// A client stream socket in one submission instead of socket(2), fcntl, a connect and a send
+// (see TUring::ConnectChain), for the short-lived connections. Up to size bytes of data are sent
+// after the handshake, data must stay valid until the end. Falls back to socket(2), Connect and
+// WriteSome on the kernels without the chain
+TValueTask<TLinkedConnect> ConnectLinked(TUring& ring, TAddress address, const void* data = nullptr, size_t size = 0);
+
 } // namespace NNet
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <coroutine>
+#include <exception>
+#include <utility>
+
+namespace NNet {
+
+namespace NDetail {
+
+// A caller of a pipelined client suspended until the reply to its request.
+// The connection keeps a pointer to the waiter in a slot that stays in place: an element
+// of a std::deque added at the ends, or the value of a map node. A waiter that goes away
+// first (the future of the request is destroyed) nulls its slot and its reply is dropped,
+// like the reply to a request without a caller. T is the derived waiter with the reply.
+template<typename T>
+struct TReplyWaiter {
+    TReplyWaiter() = default;
+    TReplyWaiter(const TReplyWaiter&) = delete;
+    TReplyWaiter& operator=(const TReplyWaiter&) = delete;
+
+    ~TReplyWaiter() {
+        Detach();
+    }
+
+    void Attach(T** slot) {
+        *slot = static_cast<T*>(this);
+        Slot = slot;
+    }
+
+    void Detach() {
+        if (Slot) {
+            *std::exchange(Slot, nullptr) = nullptr;
+        }
+    }
+
+    // The waiter of the slot, if it is still there, no longer attached to it
+    static T* Take(T*& slot) {
+        auto* waiter = std::exchange(slot, nullptr);
+        if (waiter) {
+            waiter->Slot = nullptr;
+        }
+        return waiter;
+    }
+
+    bool await_ready() const { return Done; }
+    void await_suspend(std::coroutine_handle<> h) { Handle = h; }
+    void await_resume() const { }
+
+    void Resume() {
+        Detach();
+        Done = true;
+        if (Handle) {
+            Handle.resume();
+        }
+    }
+
+    T** Slot = nullptr;
+    std::coroutine_handle<> Handle;
+    std::exception_ptr Error;
+    bool Done = false;
+};
+
+} // namespace NDetail
+
+} // namespace NNet
@@ -0,0 +1,238 @@
+#include <array>
+#include <algorithm>
+#include <cstdio>
+
+#include <string.h>
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#include <nmmintrin.h>
+#define HAVE_CRC32C_SSE42
+#elif defined(__aarch64__) && defined(__ARM_FEATURE_CRC32)
+#include <arm_acle.h>
+#define HAVE_CRC32C_ARM
+#endif
+
+#ifndef _WIN32
+#include <dirent.h>
+#include <errno.h>
+#include <unistd.h>
+#endif
+
+#include "wal.hpp"
+
+namespace NNet {
+
+namespace {
+
+// Slicing-by-8 tables of the reflected polynomial 0x82F63B78
+constexpr auto MakeCrc32cTables() {
+    std::array<std::array<uint32_t, 256>, 8> tables{};
+    for (uint32_t i = 0; i < 256; i++) {
+        uint32_t crc = i;
+        for (int j = 0; j < 8; j++) {
+            crc = (crc >> 1) ^ (0x82F63B78 & (0 - (crc & 1)));
+        }
+        tables[0][i] = crc;
+    }
+    for (uint32_t i = 0; i < 256; i++) {
+        for (int k = 1; k < 8; k++) {
+            tables[k][i] = (tables[k-1][i] >> 8) ^ tables[0][tables[k-1][i] & 0xff];
+        }
+    }
+    return tables;
+}
+
+constexpr auto Crc32cTables = MakeCrc32cTables();
+
+uint32_t Crc32cSoftware(uint32_t crc, const unsigned char* p, size_t size) {
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    while (size >= 8) {
+        uint64_t word;
+        memcpy(&word, p, 8);
+        word ^= crc;
+        crc = Crc32cTables[7][word & 0xff] ^ Crc32cTables[6][(word >> 8) & 0xff]
+            ^ Crc32cTables[5][(word >> 16) & 0xff] ^ Crc32cTables[4][(word >> 24) & 0xff]
+            ^ Crc32cTables[3][(word >> 32) & 0xff] ^ Crc32cTables[2][(word >> 40) & 0xff]
+            ^ Crc32cTables[1][(word >> 48) & 0xff] ^ Crc32cTables[0][word >> 56];
+        p += 8;
+        size -= 8;
+    }
+#endif
+    while (size--) {
+        crc = (crc >> 8) ^ Crc32cTables[0][(crc ^ *p++) & 0xff];
+    }
+    return crc;
+}
+
+#if defined(HAVE_CRC32C_SSE42)
+__attribute__((target("sse4.2")))
+uint32_t Crc32cHardware(uint32_t crc, const unsigned char* p, size_t size) {
+    uint64_t crc64 = crc;
+    while (size >= 8) {
+        uint64_t word;
+        memcpy(&word, p, 8);
+        crc64 = _mm_crc32_u64(crc64, word);
+        p += 8;
+        size -= 8;
+    }
+    crc = static_cast<uint32_t>(crc64);
+    while (size--) {
+        crc = _mm_crc32_u8(crc, *p++);
+    }
+    return crc;
+}
+
+const bool HasCrc32cHardware = __builtin_cpu_supports("sse4.2");
+#elif defined(HAVE_CRC32C_ARM)
+uint32_t Crc32cHardware(uint32_t crc, const unsigned char* p, size_t size) {
+    while (size >= 8) {
+        uint64_t word;
+        memcpy(&word, p, 8);
+        crc = __crc32cd(crc, word);
+        p += 8;
+        size -= 8;
+    }
+    while (size--) {
+        crc = __crc32cb(crc, *p++);
+    }
+    return crc;
+}
+
+const bool HasCrc32cHardware = true;
+#endif
+
+void PutUint32(char* p, uint32_t value) {
+    for (int i = 0; i < 4; i++) {
+        p[i] = static_cast<char>(value >> (8 * i));
+    }
+}
+
+uint32_t GetUint32(const char* p) {
+    uint32_t value = 0;
+    for (int i = 0; i < 4; i++) {
+        value |= static_cast<uint32_t>(static_cast<unsigned char>(p[i])) << (8 * i);
+    }
+    return value;
+}
+
+} // namespace
+
+uint32_t Crc32c(const void* data, size_t size, uint32_t crc) {
+    auto p = static_cast<const unsigned char*>(data);
+    crc = ~crc;
+#if defined(HAVE_CRC32C_SSE42) || defined(HAVE_CRC32C_ARM)
+    if (HasCrc32cHardware) {
+        return ~Crc32cHardware(crc, p, size);
+    }
+#endif
+    return ~Crc32cSoftware(crc, p, size);
+}
+
+#ifndef _WIN32
+
+void WalAppendRecord(std::vector<char>& out, std::string_view record) {
+    size_t offset = out.size();
+    out.resize(offset + WalRecordHeaderSize + record.size());
+    char* p = out.data() + offset;
+    PutUint32(p + 4, static_cast<uint32_t>(record.size()));
+    memcpy(p + WalRecordHeaderSize, record.data(), record.size());
+    PutUint32(p, Crc32c(p + 4, 4 + record.size()));
+}
+
+size_t WalParseRecord(const char* data, size_t size, std::string_view* record) {
+    if (size < WalRecordHeaderSize) {
+        return 0;
+    }
+    uint32_t length = GetUint32(data + 4);
+    if (length > size - WalRecordHeaderSize) {
+        return 0;
+    }
+    if (GetUint32(data) != Crc32c(data + 4, 4 + length)) {
+        return 0;
+    }
+    *record = std::string_view(data + WalRecordHeaderSize, length);
+    return WalRecordHeaderSize + length;
+}
+
+size_t WalRecordSize(const char* data) {
+    return WalRecordHeaderSize + GetUint32(data + 4);
+}
+
+std::string WalSegmentPath(const std::string& dir, uint64_t firstLsn) {
+    char name[32];
+    snprintf(name, sizeof(name), "%020llu.wal", static_cast<unsigned long long>(firstLsn));
+    return dir + "/" + name;
+}
+
+TWalReader::TWalReader(std::string dir)
+    : Dir_(std::move(dir))
+{
+    DIR* d = opendir(Dir_.c_str());
+    if (!d) {
+        throw std::system_error(errno, std::generic_category(), Dir_);
+    }
+    while (auto* entry = readdir(d)) {
+        std::string_view name = entry->d_name;
+        if (name.size() != 24 || name.substr(20) != ".wal"
+            || !std::all_of(name.begin(), name.begin() + 20, [](char c) { return c >= '0' && c <= '9'; }))
+        {
+            continue;
+        }
+        Segments_.emplace_back(std::stoull(std::string(name.substr(0, 20))));
+    }
+    closedir(d);
+    std::sort(Segments_.begin(), Segments_.end());
+}
+
+bool TWalReader::Next(uint64_t* lsn, std::string_view* record) {
+    while (true) {
+        size_t n = Offset_ < Data_.size()
+            ? WalParseRecord(Data_.data() + Offset_, Data_.size() - Offset_, record)
+            : 0;
+        if (n > 0) {
+            Offset_ += n;
+            *lsn = NextLsn_++;
+            return true;
+        }
+        // the end of a segment or its torn tail
+        if (!Load()) {
+            return false;
+        }
+    }
+}
+
+bool TWalReader::Load() {
+    if (Segment_ == Segments_.size()) {
+        Data_.clear();
+        Offset_ = 0;
+        return false;
+    }
+    uint64_t firstLsn = Segments_[Segment_++];
+    auto path = WalSegmentPath(Dir_, firstLsn);
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        throw std::system_error(errno, std::generic_category(), path);
+    }
+    Data_.clear();
+    Offset_ = 0;
+    char buf[64 * 1024];
+    ssize_t n;
+    while ((n = ::read(fd, buf, sizeof(buf))) != 0) {
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            int err = errno;
+            ::close(fd);
+            throw std::system_error(err, std::generic_category(), path);
+        }
+        Data_.insert(Data_.end(), buf, buf + n);
+    }
+    ::close(fd);
+    NextLsn_ = std::max(NextLsn_, firstLsn);
+    return true;
+}
+
+#endif // _WIN32
+
+} // namespace NNet
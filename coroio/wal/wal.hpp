@@ -0,0 +1,356 @@
+#pragma once
+
+#include <chrono>
+#include <coroutine>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#endif
+
+#include "../corochain.hpp"
+#include "../fileio.hpp"
+#include "../poller.hpp"
+#include "../promises.hpp"
+
+namespace NNet {
+
+// CRC-32C (Castagnoli), SSE4.2 or ARMv8 CRC instructions when the CPU has them.
+// Pass the previous result as crc to extend a checksum over several buffers.
+uint32_t Crc32c(const void* data, size_t size, uint32_t crc = 0);
+
+#ifndef _WIN32
+
+// Record layout, little-endian:
+// Crc u32 | Size u32 | payload
+// Crc covers Size and the payload, so the zeroes of a preallocated segment never parse.
+constexpr size_t WalRecordHeaderSize = 8;
+
+void WalAppendRecord(std::vector<char>& out, std::string_view record);
+// The size of the record at data, 0 for a torn or corrupted one
+size_t WalParseRecord(const char* data, size_t size, std::string_view* record);
+// The size the header at data claims for its record, checked by WalParseRecord only
+size_t WalRecordSize(const char* data);
+// Segments are named after the LSN of their first record, so a directory listing
+// orders them and gives the LSN of every record
+std::string WalSegmentPath(const std::string& dir, uint64_t firstLsn);
+
+struct TWalOptions {
+    // a commit group that does not fit is written to a new segment
+    uint64_t SegmentSize = 64 * 1024 * 1024;
+    // reserve the whole segment with fallocate when it is created
+    bool Preallocate = true;
+    // how long the first record of a group waits for company, 0 for a single loop iteration
+    std::chrono::microseconds CommitDelay{0};
+};
+
+struct TWalStats {
+    uint64_t Records = 0;
+    uint64_t Bytes = 0;
+    // one write and one fdatasync per group
+    uint64_t Groups = 0;
+    uint64_t Segments = 0;
+};
+
+// Reads a log back at startup, blocking. Stops at the first torn record of a segment
+// and continues with the next segment.
+class TWalReader {
+public:
+    explicit TWalReader(std::string dir);
+
+    // The record stays valid until the next call
+    bool Next(uint64_t* lsn, std::string_view* record);
+
+    // The LSN to reopen the log with
+    uint64_t NextLsn() const {
+        return NextLsn_;
+    }
+
+private:
+    bool Load();
+
+    std::string Dir_;
+    std::vector<uint64_t> Segments_;
+    size_t Segment_ = 0;
+    std::vector<char> Data_;
+    size_t Offset_ = 0;
+    uint64_t NextLsn_ = 0;
+};
+
+// Write-ahead log with group commit on TUring or TFileIoPool. Append frames the record into
+// the pending group right away, the returned awaitable resumes once the record is durable and
+// gives its LSN. A single flusher writes a whole group with one write and one fdatasync
+// (a linked pair on TUring), records appended meanwhile form the next group.
+// A failed write or sync fails its group and every later append: after a failed fsync the
+// state of the file is unknown.
+//
+//   TWalReader reader(dir); // replay
+//   TWal<TUring> wal(uring, dir);
+//   co_await wal.Open(reader.NextLsn());
+//   auto lsn = co_await wal.Append(record);
+template<typename TBackend>
+class TWal {
+public:
+    TWal(TBackend& backend, std::string dir, TWalOptions options = {})
+        : Backend_(backend)
+        , DirPath_(std::move(dir))
+        , Options_(options)
+    { }
+
+    TWal(const TWal&) = delete;
+    TWal& operator=(const TWal&) = delete;
+
+    // Starts a new segment at nextLsn, TWalReader::NextLsn() of the directory (0 for a new
+    // one). The existing segments are kept, one with records at nextLsn fails with EEXIST
+    TValueTask<void> Open(uint64_t nextLsn) {
+        NextLsn_ = DurableLsn_ = nextLsn;
+        auto dir = co_await TAsyncFile<TBackend>::Open(Backend_, DirPath_, O_RDONLY | O_DIRECTORY);
+        Dir_.emplace(std::move(dir));
+        co_await OpenSegment(nextLsn);
+    }
+
+    auto Append(std::string_view record) {
+        struct TAwaitable {
+            bool await_ready() const {
+                return wal->DurableLsn_ > lsn || wal->Error_;
+            }
+
+            void await_suspend(std::coroutine_handle<> h) {
+                wal->Waiters_.emplace_back(TWaiter{lsn, h});
+            }
+
+            uint64_t await_resume() const {
+                if (wal->DurableLsn_ <= lsn) {
+                    throw std::system_error(wal->Error_, std::generic_category(), "wal");
+                }
+                return lsn;
+            }
+
+            TWal* wal;
+            uint64_t lsn;
+        };
+
+        if (Error_ || Closing_) {
+            throw std::system_error(Error_ ? Error_ : EBADF, std::generic_category(), "wal");
+        }
+        WalAppendRecord(Pending_, record);
+        Stats_.Records++;
+        if (!Flushing_) {
+            Flush();
+        }
+        return TAwaitable{this, NextLsn_++};
+    }
+
+    // Waits for the pending records, then closes the segment
+    TValueTask<void> Close() {
+        Closing_ = true;
+        if (Flushing_) {
+            co_await TCloseAwaitable{this};
+        }
+        if (Segment_) {
+            co_await Segment_->Close();
+            Segment_.reset();
+        }
+        if (Dir_) {
+            co_await Dir_->Close();
+            Dir_.reset();
+        }
+    }
+
+    // Records with a smaller LSN are durable
+    uint64_t DurableLsn() const {
+        return DurableLsn_;
+    }
+
+    const TWalStats& Stats() const {
+        return Stats_;
+    }
+
+private:
+    struct TWaiter {
+        uint64_t Lsn;
+        std::coroutine_handle<> Handle;
+    };
+
+    struct TCloseAwaitable {
+        bool await_ready() const { return false; }
+        void await_suspend(std::coroutine_handle<> h) {
+            wal->CloseWaiter_ = h;
+        }
+        void await_resume() const { }
+
+        TWal* wal;
+    };
+
+    TPollerBase& Poller() {
+        if constexpr (std::is_base_of_v<TPollerBase, TBackend>) {
+            return Backend_;
+        } else {
+            return Backend_.Poller();
+        }
+    }
+
+    TVoidTask Flush() {
+        Flushing_ = true;
+        if (Options_.CommitDelay.count() > 0) {
+            co_await Poller().Sleep(Options_.CommitDelay);
+        } else {
+            co_await Poller().Yield();
+        }
+        while (!Pending_.empty() && !Error_) {
+            Inflight_.swap(Pending_);
+            uint64_t firstLsn = DurableLsn_;
+            uint64_t lastLsn = NextLsn_;
+            try {
+                co_await Commit(firstLsn);
+                DurableLsn_ = lastLsn;
+            } catch (const std::system_error& ex) {
+                Error_ = ex.code().value();
+            }
+            Inflight_.clear();
+            Wakeup();
+        }
+        if (Error_) {
+            Pending_.clear();
+            Wakeup();
+        }
+        Flushing_ = false;
+        if (CloseWaiter_) {
+            std::exchange(CloseWaiter_, {}).resume();
+        }
+    }
+
+    TValueTask<void> Commit(uint64_t firstLsn) {
+        if (SegmentOffset_ > 0 && SegmentOffset_ + Inflight_.size() > Options_.SegmentSize) {
+            co_await Segment_->Close();
+            Segment_.reset();
+            co_await OpenSegment(firstLsn);
+        }
+        size_t done = 0;
+        bool synced = false;
+        if constexpr (requires(TBackend& b, TSyncWriteResult r) { b.WriteAtSync(0, nullptr, 0, 0, true, &r, std::coroutine_handle<>{}); }) {
+            // a short write is finished below and synced on its own
+            auto r = co_await Segment_->WriteAtSync(Inflight_.data(), Inflight_.size(), SegmentOffset_);
+            synced = r.Synced;
+            done = r.Written;
+        }
+        if (!synced) {
+            while (done < Inflight_.size()) {
+                auto n = co_await Segment_->WriteAt(Inflight_.data() + done, Inflight_.size() - done, SegmentOffset_ + done);
+                if (n <= 0) {
+                    // a regular file writes nothing only when the device is full
+                    throw std::system_error(std::make_error_code(std::errc::no_space_on_device));
+                }
+                done += n;
+            }
+            co_await Segment_->Fdatasync();
+        }
+        SegmentOffset_ += Inflight_.size();
+        Stats_.Bytes += Inflight_.size();
+        Stats_.Groups++;
+    }
+
+    TValueTask<void> OpenSegment(uint64_t firstLsn) {
+        auto path = WalSegmentPath(DirPath_, firstLsn);
+        std::optional<TAsyncFile<TBackend>> segment;
+        try {
+            segment.emplace(co_await TAsyncFile<TBackend>::Open(Backend_, path, O_WRONLY | O_CREAT | O_EXCL));
+        } catch (const std::system_error& ex) {
+            if (ex.code().value() != EEXIST) {
+                throw;
+            }
+        }
+        if (!segment) {
+            // a segment without records is left by a crash before its first commit,
+            // one with records means a wrong nextLsn and is never truncated
+            bool records = co_await HasRecord(path);
+            if (records) {
+                throw std::system_error(EEXIST, std::generic_category(), path);
+            }
+            segment.emplace(co_await TAsyncFile<TBackend>::Open(Backend_, path, O_WRONLY | O_TRUNC));
+        }
+        Segment_.emplace(std::move(*segment));
+        SegmentOffset_ = 0;
+        if (Options_.Preallocate) {
+            try {
+                co_await Segment_->Fallocate(0, 0, Options_.SegmentSize);
+            } catch (const std::system_error& ex) {
+                if (ex.code().value() != EOPNOTSUPP) {
+                    throw;
+                }
+            }
+        }
+        // the new directory entry must survive a crash too
+        co_await Dir_->Fsync();
+        Stats_.Segments++;
+    }
+
+    // Whether the segment starts with a valid record
+    TValueTask<bool> HasRecord(std::string path) {
+        auto file = co_await TAsyncFile<TBackend>::Open(Backend_, path, O_RDONLY);
+        std::vector<char> data(WalRecordHeaderSize);
+        auto n = co_await file.ReadAt(data.data(), data.size(), 0);
+        bool found = false;
+        if (n == static_cast<int>(data.size())) {
+            // the last byte first, a torn size must not allocate past the end of the file
+            size_t size = WalRecordSize(data.data());
+            char last;
+            n = co_await file.ReadAt(&last, 1, size - 1);
+            if (n == 1) {
+                data.resize(size);
+                n = co_await file.ReadAt(data.data(), size, 0);
+                std::string_view record;
+                found = WalParseRecord(data.data(), n, &record) > 0;
+            }
+        }
+        co_await file.Close();
+        co_return found;
+    }
+
+    void Wakeup() {
+        Ready_.clear();
+        size_t kept = 0;
+        for (auto& waiter : Waiters_) {
+            if (waiter.Lsn < DurableLsn_ || Error_) {
+                Ready_.emplace_back(waiter.Handle);
+            } else {
+                Waiters_[kept++] = waiter;
+            }
+        }
+        Waiters_.resize(kept);
+        // a resumed appender may append again, that goes to Waiters_ and not Ready_
+        for (auto h : Ready_) {
+            h.resume();
+        }
+    }
+
+    TBackend& Backend_;
+    std::string DirPath_;
+    TWalOptions Options_;
+    std::optional<TAsyncFile<TBackend>> Dir_;
+    std::optional<TAsyncFile<TBackend>> Segment_;
+    uint64_t SegmentOffset_ = 0;
+
+    std::vector<char> Pending_;
+    std::vector<char> Inflight_;
+    uint64_t NextLsn_ = 0;
+    uint64_t DurableLsn_ = 0;
+    std::vector<TWaiter> Waiters_;
+    std::vector<std::coroutine_handle<>> Ready_;
+    bool Flushing_ = false;
+    bool Closing_ = false;
+    int Error_ = 0;
+    std::coroutine_handle<> CloseWaiter_;
+    TWalStats Stats_;
+};
+
+#endif // _WIN32
+
+} // namespace NNet
@@ -0,0 +1,199 @@
+#include "websocket.hpp"
+
+#include <openssl/evp.h>
+#include <openssl/rand.h>
+#include <openssl/sha.h>
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define WS_HAVE_AVX2_DISPATCH
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+namespace NNet {
+
+namespace {
+
+#ifdef WS_HAVE_AVX2_DISPATCH
+__attribute__((target("avx2")))
+size_t MaskAvx2(char* data, size_t size, uint32_t key) {
+    const __m256i k = _mm256_set1_epi32(key);
+    size_t i = 0;
+    for (; i + 32 <= size; i += 32) {
+        auto* p = reinterpret_cast<__m256i*>(data + i);
+        _mm256_storeu_si256(p, _mm256_xor_si256(_mm256_loadu_si256(p), k));
+    }
+    return i;
+}
+
+bool HasAvx2() {
+    static const bool hasAvx2 = __builtin_cpu_supports("avx2");
+    return hasAvx2;
+}
+#endif
+
+// Masks the largest prefix that is a multiple of the vector width, returns its size.
+// The key phase is unchanged after a multiple of 4 bytes.
+size_t MaskVector(char* data, size_t size, uint32_t key) {
+    size_t i = 0;
+#ifdef WS_HAVE_AVX2_DISPATCH
+    if (size >= 32 && HasAvx2()) {
+        i = MaskAvx2(data, size, key);
+    }
+#endif
+#if defined(__SSE2__)
+    const __m128i k = _mm_set1_epi32(key);
+    for (; i + 16 <= size; i += 16) {
+        auto* p = reinterpret_cast<__m128i*>(data + i);
+        _mm_storeu_si128(p, _mm_xor_si128(_mm_loadu_si128(p), k));
+    }
+#elif defined(__ARM_NEON)
+    const uint32x4_t k = vdupq_n_u32(key);
+    for (; i + 16 <= size; i += 16) {
+        auto* p = reinterpret_cast<uint8_t*>(data + i);
+        vst1q_u8(p, veorq_u8(vld1q_u8(p), vreinterpretq_u8_u32(k)));
+    }
+#endif
+    return i;
+}
+
+void Base64Encode(std::string& out, const unsigned char* data, size_t size) {
+    size_t pos = out.size();
+    out.resize(pos + 4 * ((size + 2) / 3) + 1);
+    int n = EVP_EncodeBlock(reinterpret_cast<unsigned char*>(out.data() + pos), data, size);
+    out.resize(pos + n);
+}
+
+} // namespace
+
+EHttpParseStatus WsParseFrameHeader(const char* data, size_t size, TWsFrameHeader* header) {
+    if (size < 2) {
+        return EHttpParseStatus::Incomplete;
+    }
+    auto b0 = static_cast<uint8_t>(data[0]);
+    auto b1 = static_cast<uint8_t>(data[1]);
+    if (b0 & 0x70) {
+        return EHttpParseStatus::Error; // no extensions negotiated, RSV bits must be 0
+    }
+    header->Fin = b0 & 0x80;
+    header->Opcode = static_cast<EWsOpcode>(b0 & 0x0f);
+    header->Masked = b1 & 0x80;
+    uint64_t length = b1 & 0x7f;
+    size_t pos = 2;
+    if (length == 126) {
+        if (size < 4) {
+            return EHttpParseStatus::Incomplete;
+        }
+        length = (static_cast<uint64_t>(static_cast<uint8_t>(data[2])) << 8) | static_cast<uint8_t>(data[3]);
+        pos = 4;
+    } else if (length == 127) {
+        if (size < 10) {
+            return EHttpParseStatus::Incomplete;
+        }
+        length = 0;
+        for (int i = 0; i < 8; i++) {
+            length = (length << 8) | static_cast<uint8_t>(data[2 + i]);
+        }
+        if (length >> 63) {
+            return EHttpParseStatus::Error;
+        }
+        pos = 10;
+    }
+    if (header->Masked) {
+        if (size < pos + 4) {
+            return EHttpParseStatus::Incomplete;
+        }
+        memcpy(header->Mask, data + pos, 4);
+        pos += 4;
+    }
+    header->Length = length;
+    header->Size = pos;
+    return EHttpParseStatus::Done;
+}
+
+size_t WsWriteFrameHeader(char* out, bool fin, EWsOpcode opcode, uint64_t length, const uint8_t* mask) {
+    out[0] = static_cast<char>((fin ? 0x80 : 0) | static_cast<uint8_t>(opcode));
+    uint8_t maskBit = mask ? 0x80 : 0;
+    size_t pos;
+    if (length < 126) {
+        out[1] = static_cast<char>(maskBit | length);
+        pos = 2;
+    } else if (length <= 0xffff) {
+        out[1] = static_cast<char>(maskBit | 126);
+        out[2] = static_cast<char>(length >> 8);
+        out[3] = static_cast<char>(length & 0xff);
+        pos = 4;
+    } else {
+        out[1] = static_cast<char>(maskBit | 127);
+        for (int i = 0; i < 8; i++) {
+            out[2 + i] = static_cast<char>(length >> (56 - 8 * i));
+        }
+        pos = 10;
+    }
+    if (mask) {
+        memcpy(out + pos, mask, 4);
+        pos += 4;
+    }
+    return pos;
+}
+
+void WsMask(char* data, size_t size, const uint8_t mask[4], size_t offset) {
+    uint8_t k[8];
+    for (int i = 0; i < 8; i++) {
+        k[i] = mask[(offset + i) & 3];
+    }
+    uint32_t key32;
+    memcpy(&key32, k, 4);
+
+    size_t i = MaskVector(data, size, key32);
+    uint64_t key64;
+    memcpy(&key64, k, 8);
+    for (; i + 8 <= size; i += 8) {
+        uint64_t v;
+        memcpy(&v, data + i, 8);
+        v ^= key64;
+        memcpy(data + i, &v, 8);
+    }
+    for (; i < size; i++) {
+        data[i] ^= k[i & 3];
+    }
+}
+
+std::string WsAcceptKey(std::string_view key) {
+    static constexpr std::string_view guid = "258EAFA5-E914-47DA-95CA-C5AB0DC85B11";
+    std::string input;
+    input.reserve(key.size() + guid.size());
+    input.append(key);
+    input.append(guid);
+    unsigned char digest[SHA_DIGEST_LENGTH];
+    SHA1(reinterpret_cast<const unsigned char*>(input.data()), input.size(), digest);
+    std::string out;
+    Base64Encode(out, digest, sizeof(digest));
+    return out;
+}
+
+std::string WsGenerateKey() {
+    unsigned char nonce[16];
+    RAND_bytes(nonce, sizeof(nonce));
+    std::string out;
+    Base64Encode(out, nonce, sizeof(nonce));
+    return out;
+}
+
+void WsGenerateMask(uint8_t mask[4]) {
+    // RFC 6455 5.3 wants keys from a strong entropy source,
+    // they are taken from the CSPRNG in batches instead of one call per frame
+    static thread_local unsigned char pool[256];
+    static thread_local size_t pos = sizeof(pool);
+    if (pos == sizeof(pool)) {
+        RAND_bytes(pool, sizeof(pool));
+        pos = 0;
+    }
+    memcpy(mask, pool + pos, 4);
+    pos += 4;
+}
+
+} // namespace NNet
@@ -0,0 +1,353 @@
+#pragma once
+
+#include <chrono>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <vector>
+
+#include <string.h>
+
+#include "../http/parser.hpp"
+#include "../corochain.hpp"
+#include "../sockutils.hpp"
+
+namespace NNet {
+
+enum class EWsOpcode : uint8_t {
+    Continuation = 0,
+    Text = 1,
+    Binary = 2,
+    Close = 8,
+    Ping = 9,
+    Pong = 10
+};
+
+struct TWsFrameHeader {
+    bool Fin = true;
+    EWsOpcode Opcode = EWsOpcode::Text;
+    bool Masked = false;
+    uint8_t Mask[4] = {0, 0, 0, 0};
+    uint64_t Length = 0;
+    // number of bytes occupied by the header itself
+    size_t Size = 0;
+};
+
+// RFC 6455 5.2, Done fills header
+EHttpParseStatus WsParseFrameHeader(const char* data, size_t size, TWsFrameHeader* header);
+// Writes at most 14 bytes, returns the header size
+size_t WsWriteFrameHeader(char* out, bool fin, EWsOpcode opcode, uint64_t length, const uint8_t* mask = nullptr);
+// XORs data in place with the masking key, offset is the position of data in the payload.
+// Uses AVX2 when the CPU supports it, SSE2/NEON or 64-bit words otherwise.
+void WsMask(char* data, size_t size, const uint8_t mask[4], size_t offset = 0);
+// Sec-WebSocket-Accept for the given Sec-WebSocket-Key
+std::string WsAcceptKey(std::string_view key);
+// Random Sec-WebSocket-Key
+std::string WsGenerateKey();
+// Random masking key for client frames
+void WsGenerateMask(uint8_t mask[4]);
+
+struct TWsMessage {
+    EWsOpcode Opcode = EWsOpcode::Text;
+    // for Close: status code followed by the reason
+    std::string_view Payload;
+};
+
+struct TWsOptions {
+    size_t ReadChunk = 16 * 1024;
+    size_t MaxMessageSize = 16 * 1024 * 1024;
+};
+
+// WebSocket endpoint over an established TSocket, TPollerDrivenSocket or TSslSocket.
+// Frames are decoded in place in the read buffer: payloads are unmasked where they
+// lie and the fragments of a message are moved together over the headers between
+// them, so a reassembled message is returned as one view without copying.
+// Sends from several coroutines are queued and written in batches by one of them.
+template<typename TSocket>
+class TWebSocket {
+public:
+    // client endpoints mask outgoing frames and expect unmasked incoming ones
+    TWebSocket(TSocket& socket, bool client, TWsOptions options = {})
+        : Socket_(socket)
+        , Client_(client)
+        , Options_(options)
+    { }
+
+    TWebSocket(const TWebSocket&) = delete;
+    TWebSocket& operator=(const TWebSocket&) = delete;
+
+    // Server side of the opening handshake: reads the upgrade request and answers 101
+    TFuture<void> Accept() {
+        THttpRequestParser parser(Options_.ReadChunk);
+        EHttpParseStatus status;
+        while ((status = parser.Parse(Buffer_.data(), WPos_)) == EHttpParseStatus::Incomplete) {
+            if (!co_await Fill()) {
+                throw std::runtime_error("Connection closed");
+            }
+        }
+        const auto& request = parser.Message();
+        auto key = request.Headers.Get("Sec-WebSocket-Key");
+        if (status == EHttpParseStatus::Error
+            || request.Method != "GET"
+            || !HttpHasToken(request.Headers.Get("Upgrade"), "websocket")
+            || !HttpHasToken(request.Headers.Get("Connection"), "upgrade")
+            || request.Headers.Get("Sec-WebSocket-Version") != "13"
+            || key.empty())
+        {
+            std::string_view reply = "HTTP/1.1 400 Bad Request\r\nContent-Length: 0\r\nConnection: close\r\n\r\n";
+            co_await TByteWriter(Socket_).Write(reply.data(), reply.size());
+            throw std::runtime_error("Bad WebSocket upgrade request");
+        }
+        Output_.append("HTTP/1.1 101 Switching Protocols\r\nUpgrade: websocket\r\nConnection: Upgrade\r\nSec-WebSocket-Accept: ");
+        Output_.append(WsAcceptKey(key));
+        Output_.append("\r\n\r\n");
+        ParsePos_ = parser.Consumed();
+        co_await Flush();
+        co_return;
+    }
+
+    // Client side of the opening handshake
+    TFuture<void> Connect(std::string_view host, std::string_view target = "/") {
+        auto key = WsGenerateKey();
+        Output_.append("GET ");
+        Output_.append(target);
+        Output_.append(" HTTP/1.1\r\nHost: ");
+        Output_.append(host);
+        Output_.append("\r\nUpgrade: websocket\r\nConnection: Upgrade\r\nSec-WebSocket-Version: 13\r\nSec-WebSocket-Key: ");
+        Output_.append(key);
+        Output_.append("\r\n\r\n");
+        co_await Flush();
+
+        THttpReplyParser parser(Options_.ReadChunk);
+        parser.SetHeadOnly(true);
+        EHttpParseStatus status;
+        while ((status = parser.Parse(Buffer_.data(), WPos_)) == EHttpParseStatus::Incomplete) {
+            if (!co_await Fill()) {
+                throw std::runtime_error("Connection closed");
+            }
+        }
+        if (status == EHttpParseStatus::Error
+            || parser.Message().Status != 101
+            || parser.Message().Headers.Get("Sec-WebSocket-Accept") != WsAcceptKey(key))
+        {
+            throw std::runtime_error("WebSocket upgrade rejected");
+        }
+        ParsePos_ = parser.Consumed();
+        co_return;
+    }
+
+    // Next data message or Close. Pings are answered and pongs recorded on the way.
+    // The payload stays valid until the next call.
+    TFuture<TWsMessage> Receive() {
+        while (true) {
+            TWsFrameHeader header;
+            auto status = WsParseFrameHeader(Buffer_.data() + ParsePos_, WPos_ - ParsePos_, &header);
+            if (status == EHttpParseStatus::Error || (status == EHttpParseStatus::Done && header.Masked == Client_)) {
+                throw std::runtime_error("Bad WebSocket frame");
+            }
+            size_t frameSize = header.Size + header.Length;
+            if (status == EHttpParseStatus::Incomplete || WPos_ - ParsePos_ < frameSize) {
+                size_t assembled = InMessage_ ? MsgEnd_ - MsgStart_ : 0;
+                if (status == EHttpParseStatus::Done && assembled + header.Length > Options_.MaxMessageSize) {
+                    throw std::runtime_error("WebSocket message too large");
+                }
+                size_t need = status == EHttpParseStatus::Done ? frameSize : 14;
+                if (!co_await Fill(need)) {
+                    throw std::runtime_error("Connection closed");
+                }
+                continue;
+            }
+
+            char* payload = Buffer_.data() + ParsePos_ + header.Size;
+            size_t length = header.Length;
+            if (header.Masked) {
+                WsMask(payload, length, header.Mask);
+            }
+            size_t payloadPos = ParsePos_ + header.Size;
+            ParsePos_ += frameSize;
+            LastActivity_ = TClock::now();
+
+            if (static_cast<uint8_t>(header.Opcode) & 8) {
+                if (!header.Fin || length > 125) {
+                    throw std::runtime_error("Bad WebSocket control frame");
+                }
+                switch (header.Opcode) {
+                case EWsOpcode::Ping:
+                    if (!CloseSent_) {
+                        co_await Send(std::string_view(payload, length), EWsOpcode::Pong);
+                    }
+                    continue;
+                case EWsOpcode::Pong:
+                    continue;
+                case EWsOpcode::Close:
+                    if (!CloseSent_) {
+                        co_await Send(std::string_view(payload, std::min<size_t>(length, 2)), EWsOpcode::Close);
+                    }
+                    co_return TWsMessage{EWsOpcode::Close, std::string_view(payload, length)};
+                default:
+                    throw std::runtime_error("Unknown WebSocket opcode");
+                }
+            }
+
+            if (header.Opcode == EWsOpcode::Continuation) {
+                if (!InMessage_) {
+                    throw std::runtime_error("Unexpected WebSocket continuation frame");
+                }
+                if (MsgEnd_ != payloadPos) {
+                    memmove(Buffer_.data() + MsgEnd_, payload, length);
+                }
+                MsgEnd_ += length;
+            } else {
+                if (InMessage_) {
+                    throw std::runtime_error("Interleaved WebSocket message");
+                }
+                if (header.Opcode != EWsOpcode::Text && header.Opcode != EWsOpcode::Binary) {
+                    throw std::runtime_error("Unknown WebSocket opcode");
+                }
+                InMessage_ = true;
+                Opcode_ = header.Opcode;
+                MsgStart_ = payloadPos;
+                MsgEnd_ = payloadPos + length;
+            }
+            if (MsgEnd_ - MsgStart_ > Options_.MaxMessageSize) {
+                throw std::runtime_error("WebSocket message too large");
+            }
+            if (header.Fin) {
+                InMessage_ = false;
+                co_return TWsMessage{Opcode_, std::string_view(Buffer_.data() + MsgStart_, MsgEnd_ - MsgStart_)};
+            }
+        }
+    }
+
+    TFuture<void> Send(std::string_view payload, EWsOpcode opcode = EWsOpcode::Text) {
+        if (CloseSent_) {
+            throw std::runtime_error("WebSocket is closed");
+        }
+        CloseSent_ = opcode == EWsOpcode::Close;
+        char header[14];
+        if (Client_) {
+            uint8_t mask[4];
+            WsGenerateMask(mask);
+            Output_.append(header, WsWriteFrameHeader(header, true, opcode, payload.size(), mask));
+            size_t pos = Output_.size();
+            Output_.append(payload);
+            WsMask(Output_.data() + pos, payload.size(), mask);
+        } else {
+            Output_.append(header, WsWriteFrameHeader(header, true, opcode, payload.size()));
+            Output_.append(payload);
+        }
+        if (!Writing_) {
+            co_await Flush();
+        }
+        co_return;
+    }
+
+    TFuture<void> Ping(std::string_view payload = {}) {
+        return Send(payload, EWsOpcode::Ping);
+    }
+
+    TFuture<void> Close(uint16_t code = 1000, std::string_view reason = {}) {
+        std::string payload;
+        payload.push_back(static_cast<char>(code >> 8));
+        payload.push_back(static_cast<char>(code & 0xff));
+        payload.append(reason.substr(0, 123));
+        co_await Send(payload, EWsOpcode::Close);
+        co_return;
+    }
+
+    // Pings the peer every interval on the poller timers while Receive() is running.
+    // Completes with errc::timed_out when nothing arrived for two intervals,
+    // the caller is expected to drop the connection then.
+    TFuture<void> KeepAlive(std::chrono::milliseconds interval) {
+        auto* poller = Socket_.Poller();
+        LastActivity_ = TClock::now();
+        while (!CloseSent_) {
+            co_await poller->Sleep(interval);
+            if (TClock::now() - LastActivity_ >= 2 * interval) {
+                throw std::system_error(std::make_error_code(std::errc::timed_out));
+            }
+            if (!Writing_ && !CloseSent_) {
+                co_await Ping();
+            }
+        }
+        co_return;
+    }
+
+    // Bytes queued behind a write in progress
+    size_t Pending() const {
+        return Output_.size();
+    }
+
+private:
+    TFuture<void> Flush() {
+        Writing_ = true;
+        std::string pending;
+        try {
+            while (!Output_.empty()) {
+                pending.clear();
+                std::swap(pending, Output_);
+                co_await TByteWriter(Socket_).Write(pending.data(), pending.size());
+            }
+        } catch (...) {
+            Writing_ = false;
+            throw;
+        }
+        Writing_ = false;
+        co_return;
+    }
+
+    // Reads more data keeping the unconsumed part, returns false on EOF.
+    // need is the number of bytes required from ParsePos_ to complete the next frame.
+    TFuture<bool> Fill(size_t need = 0) {
+        if (Buffer_.empty()) {
+            // allocated on first read, send-only endpoints never need it
+            Buffer_.resize(Options_.ReadChunk);
+        }
+        size_t live = InMessage_ ? MsgStart_ : ParsePos_;
+        if (live == WPos_) {
+            live = ParsePos_ = WPos_ = 0;
+        }
+        if (Buffer_.size() - WPos_ < Options_.ReadChunk / 2 || Buffer_.size() < ParsePos_ + need) {
+            if (live > 0) {
+                memmove(Buffer_.data(), Buffer_.data() + live, WPos_ - live);
+                WPos_ -= live;
+                ParsePos_ -= live;
+                if (InMessage_) {
+                    MsgStart_ -= live;
+                    MsgEnd_ -= live;
+                }
+            }
+            size_t size = Buffer_.size();
+            while (size - WPos_ < Options_.ReadChunk / 2 || size < ParsePos_ + need) {
+                size *= 2;
+            }
+            Buffer_.resize(size);
+        }
+        ssize_t size;
+        do {
+            size = co_await Socket_.ReadSome(Buffer_.data() + WPos_, Buffer_.size() - WPos_);
+        } while (size < 0);
+        WPos_ += size;
+        co_return size > 0;
+    }
+
+    TSocket& Socket_;
+    bool Client_;
+    TWsOptions Options_;
+
+    std::vector<char> Buffer_;
+    size_t WPos_ = 0;
+    size_t ParsePos_ = 0;
+    // reassembled part of a fragmented message
+    bool InMessage_ = false;
+    EWsOpcode Opcode_ = EWsOpcode::Text;
+    size_t MsgStart_ = 0;
+    size_t MsgEnd_ = 0;
+
+    std::string Output_;
+    bool Writing_ = false;
+    bool CloseSent_ = false;
+    TTime LastActivity_ = TClock::now();
+};
+
+} // namespace NNet
@@ -0,0 +1,156 @@
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+#include <coroio/all.hpp>
+
+using namespace NNet;
+
+// Connection rate of a server that accepts and closes, with Accept (one connection per
+// wakeup) or with AcceptBatch (the backlog drained per wakeup). Clients run on their own
+// loop in another thread: every client connects, waits for the server to close and
+// reconnects, so the server side keeps the TIME_WAIT states and the ports do not run out.
+
+namespace {
+
+struct TOptions {
+    int Connections = 20000;
+    int Concurrency = 256;
+    int Batch = 64; // 0 for Accept
+    int Port = 8000;
+};
+
+template<typename TPoller>
+TFuture<void> client(TPoller& poller, int port, std::atomic<int>& left) {
+    char buf[1];
+    while (left.fetch_sub(1) > 0) {
+        typename TPoller::TSocket socket(TAddress{"127.0.0.1", port}, poller);
+        co_await socket.Connect();
+        while (true) {
+            auto size = co_await socket.ReadSome(buf, sizeof(buf));
+            if (size == 0) {
+                break;
+            }
+        }
+    }
+    co_return;
+}
+
+template<typename TPoller>
+void clients(const TOptions& options) {
+    TLoop<TPoller> loop;
+    std::atomic<int> left = options.Connections;
+    std::vector<TFuture<void>> futures;
+    for (int i = 0; i < options.Concurrency; i++) {
+        futures.emplace_back(client(loop.Poller(), options.Port, left));
+    }
+    TFuture<void> all = All(std::move(futures));
+    while (!all.done()) {
+        loop.Step();
+    }
+    all.await_resume(); // rethrows errors
+}
+
+template<typename TSocket>
+TVoidTask server(TSocket& listener, int batch, int& accepted, int& wakeups) {
+    try {
+        while (true) {
+            if (batch == 0) {
+                auto client = co_await listener.Accept();
+                accepted++;
+                wakeups++;
+            } else {
+                auto clients = co_await listener.AcceptBatch(batch);
+                accepted += clients.size();
+                wakeups++;
+            }
+        }
+    } catch (const std::exception& ex) {
+        std::cerr << "Accept failed: " << ex.what() << "\n";
+    }
+    co_return;
+}
+
+template<typename TPoller>
+void run(const TOptions& options) {
+    TLoop<TPoller> loop;
+    typename TPoller::TSocket listener(TAddress{"127.0.0.1", options.Port}, loop.Poller());
+    listener.Bind();
+    listener.Listen(4096);
+
+    int accepted = 0;
+    int wakeups = 0;
+    server(listener, options.Batch, accepted, wakeups);
+    auto start = TClock::now();
+    std::thread thread([&]() {
+        try {
+            clients<TPoller>(options);
+        } catch (const std::exception& ex) {
+            std::cerr << "Connect failed: " << ex.what() << "\n";
+            std::exit(1);
+        }
+    });
+    while (accepted < options.Connections) {
+        loop.Step();
+    }
+    auto elapsed = std::chrono::duration<double>(TClock::now() - start).count();
+    thread.join();
+
+    std::cout << "connections/s: " << static_cast<uint64_t>(accepted / elapsed)
+              << ", connections/accept: " << static_cast<double>(accepted) / std::max(wakeups, 1) << "\n";
+}
+
+void usage(const char* name) {
+    std::cerr << name << " [-n connections] [-c concurrency] [--batch 64 (0 for Accept)] [--port 8000] "
+              << "[--method select|poll|epoll|uring|kqueue] [--help]" << std::endl;
+    std::exit(1);
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    TInitializer init;
+    TOptions options;
+    std::string method = "epoll";
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "-n") && i < argc-1) {
+            options.Connections = std::max(1, atoi(argv[++i]));
+        } else if (!strcmp(argv[i], "-c") && i < argc-1) {
+            options.Concurrency = std::max(1, atoi(argv[++i]));
+        } else if (!strcmp(argv[i], "--batch") && i < argc-1) {
+            options.Batch = std::max(0, atoi(argv[++i]));
+        } else if (!strcmp(argv[i], "--port") && i < argc-1) {
+            options.Port = atoi(argv[++i]);
+        } else if (!strcmp(argv[i], "--method") && i < argc-1) {
+            method = argv[++i];
+        } else {
+            usage(argv[0]);
+        }
+    }
+
+    if (method == "select") {
+        run<TSelect>(options);
+    }
+    else if (method == "poll") {
+        run<TPoll>(options);
+    }
+#ifdef __linux__
+    else if (method == "epoll") {
+        run<TEPoll>(options);
+    }
+#endif
+#ifdef HAVE_URING
+    else if (method == "uring") {
+        run<TUring>(options);
+    }
+#endif
+#if defined(__APPLE__) || defined(__FreeBSD__)
+    else if (method == "kqueue") {
+        run<TKqueue>(options);
+    }
+#endif
+    else {
+        std::cerr << "Unknown method: " << method << "\n";
+    }
+    return 0;
+}
@@ -19,9 +19,20 @@ using namespace std;
 namespace {
 
 void usage(const char* name) {
-    printf("%s [-n num_pipes] [-a num_active] [-w num_writes] [-m method]\n", name);
+    printf("%s [-n num_pipes] [-a num_active] [-w num_writes] [-m method] [-b uring_min_batch] [-t uring_batch_wait_us]\n", name);
 }
 
+#ifdef HAVE_URING
+// TUring waiting for the readiness of the descriptors, with the handles of the readiness pollers
+struct TUringPoll: public TUring {
+    using TSocket = NNet::TSocket;
+    using TFileHandle = NNet::TFileHandle;
+};
+#endif
+
+unsigned uring_min_batch = 1;
+int uring_batch_wait = 50; // us
+
 struct Stat {
     int writes = 0;
     int fired = 0;
@@ -72,6 +83,11 @@ std::chrono::microseconds run_one(int num_pipes, int num_writes, int num_active)
     using TFileHandle = typename TPoller::TFileHandle;
     using TSocket = typename TPoller::TSocket;
     TLoop<TPoller> loop;
+#ifdef HAVE_URING
+    if constexpr (std::is_base_of_v<TUring, TPoller>) {
+        loop.Poller().SetMinBatch(uring_min_batch, std::chrono::microseconds(uring_batch_wait));
+    }
+#endif
 #ifdef _WIN32
     vector<TSocket> pipes;
 #else
@@ -114,6 +130,12 @@ std::chrono::microseconds run_one(int num_pipes, int num_writes, int num_active)
         handles.emplace_back(write_one(pipes[i*space+1], s));
     }
 
+#ifdef HAVE_URING
+    TUringStats stats;
+    if constexpr (std::is_base_of_v<TUring, TPoller>) {
+        stats = loop.Poller().Stats();
+    }
+#endif
     auto t1 = TClock::now();
     int xcount = 0;
     int target = (num_writes+num_active);
@@ -130,6 +152,15 @@ std::chrono::microseconds run_one(int num_pipes, int num_writes, int num_active)
          << "failures: " << s.failures << ", "
          << "out: " << s.out << endl;
     cerr << "elapsed: " <<  duration.count() << endl;
+#ifdef HAVE_URING
+    if constexpr (std::is_base_of_v<TUring, TPoller>) {
+        auto& after = loop.Poller().Stats();
+        auto iterations = std::max<uint64_t>(after.Iterations - stats.Iterations, 1);
+        cerr << "syscalls/iteration: " << static_cast<double>(after.Enters - stats.Enters) / iterations << ", "
+             << "completions/iteration: " << static_cast<double>(after.Completions - stats.Completions) / iterations << ", "
+             << "full sq submits: " << after.FullSqSubmits - stats.FullSqSubmits << endl;
+    }
+#endif
 
     return duration;
 }
@@ -170,6 +201,10 @@ int main(int argc, char** argv) {
             num_writes = atoi(argv[++i]);
         } else if (!strcmp(argv[i], "-m") && i < argc-1) {
             method = argv[++i];
+        } else if (!strcmp(argv[i], "-b") && i < argc-1) {
+            uring_min_batch = max(atoi(argv[++i]), 1);
+        } else if (!strcmp(argv[i], "-t") && i < argc-1) {
+            uring_batch_wait = atoi(argv[++i]);
         } else {
             usage(argv[0]); return 1;
         }
@@ -189,6 +224,9 @@ int main(int argc, char** argv) {
     else if (!strcmp(method, "uring")) {
         run_test<TUring>(num_pipes, num_writes, num_active);
     }
+    else if (!strcmp(method, "uring-poll")) {
+        run_test<TUringPoll>(num_pipes, num_writes, num_active);
+    }
 #endif
 #ifdef HAVE_KQUEUE
     else if (!strcmp(method, "kqueue")) {
@@ -0,0 +1,141 @@
+#include <algorithm>
+#include <chrono>
+#include <vector>
+
+#include <coroio/all.hpp>
+
+using namespace NNet;
+
+// Bulk transfer over TCP loopback on one TUring loop, with three receivers: ReadSome into one
+// buffer, ReadBundle with a buffer per completion and ReadBundle with bundles
+// (IORING_RECVSEND_BUNDLE), where one completion fills as many buffers as there is data for.
+
+namespace {
+
+struct TOptions {
+    int Megabytes = 1024;
+    int Chunk = 256 * 1024;
+    int Buffers = 64;
+    int BufferSize = 16 * 1024;
+    int Port = 8000;
+};
+
+enum class EMode {
+    Recv,
+    Ring,
+    Bundle
+};
+
+TFuture<void> writer(TUring& poller, int port, const TOptions& options) {
+    TUring::TSocket socket(TAddress{"127.0.0.1", port}, poller);
+    co_await socket.Connect();
+    std::vector<char> chunk(options.Chunk, 'b');
+    int64_t left = static_cast<int64_t>(options.Megabytes) * 1024 * 1024;
+    while (left > 0) {
+        auto size = std::min<int64_t>(left, chunk.size());
+        co_await TByteWriter(socket).Write(chunk.data(), size);
+        left -= size;
+    }
+    co_return;
+}
+
+TFuture<void> reader(TUring& poller, TUring::TSocket& listener, EMode mode, const TOptions& options, uint64_t& bytes, uint64_t& reads, uint64_t& buffers) {
+    auto client = co_await listener.Accept();
+    if (mode == EMode::Recv) {
+        std::vector<char> buffer(options.BufferSize);
+        while (true) {
+            auto size = co_await client.ReadSome(buffer.data(), buffer.size());
+            if (size == 0) {
+                break;
+            }
+            bytes += size;
+            reads++;
+            buffers++;
+        }
+        co_return;
+    }
+    TBufferRing ring(poller, options.Buffers, options.BufferSize);
+    while (true) {
+        auto bundle = co_await client.ReadBundle(ring);
+        if (bundle.Ids.empty()) {
+            break;
+        }
+        bytes += bundle.Size;
+        reads++;
+        buffers += bundle.Ids.size();
+        for (auto id : bundle.Ids) {
+            ring.Release(id);
+        }
+    }
+    co_return;
+}
+
+void bench(const char* name, EMode mode, int port, const TOptions& options) {
+    TLoop<TUring> loop;
+    loop.Poller().SetBundles(mode == EMode::Bundle);
+    TUring::TSocket listener(TAddress{"127.0.0.1", port}, loop.Poller());
+    listener.Bind();
+    listener.Listen();
+
+    uint64_t bytes = 0;
+    uint64_t reads = 0;
+    uint64_t buffers = 0;
+    auto start = TClock::now();
+    TFuture<void> r = reader(loop.Poller(), listener, mode, options, bytes, reads, buffers);
+    TFuture<void> w = writer(loop.Poller(), port, options);
+    while (!(r.done() && w.done())) {
+        loop.Step();
+    }
+    r.await_resume(); // rethrows errors
+    w.await_resume();
+    auto elapsed = std::chrono::duration<double>(TClock::now() - start).count();
+
+    auto& stats = loop.Poller().Stats();
+    double megabytes = bytes / (1024.0 * 1024.0);
+    std::cout << name << "\t" << static_cast<uint64_t>(megabytes / elapsed)
+              << "\t" << static_cast<double>(buffers) / std::max<uint64_t>(reads, 1)
+              << "\t" << stats.Completions / megabytes
+              << "\t" << static_cast<double>(stats.Enters) / megabytes << "\n";
+}
+
+void usage(const char* name) {
+    std::cerr << name << " [-n megabytes] [--chunk 262144 (bytes written at once)] [--buffers 64] "
+              << "[--buffer-size 16384] [--port 8000] [--help]" << std::endl;
+    std::exit(1);
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    TInitializer init;
+    TOptions options;
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "-n") && i < argc-1) {
+            options.Megabytes = std::max(1, atoi(argv[++i]));
+        } else if (!strcmp(argv[i], "--chunk") && i < argc-1) {
+            options.Chunk = std::max(1, atoi(argv[++i]));
+        } else if (!strcmp(argv[i], "--buffers") && i < argc-1) {
+            options.Buffers = std::max(1, atoi(argv[++i]));
+        } else if (!strcmp(argv[i], "--buffer-size") && i < argc-1) {
+            options.BufferSize = std::max(1, atoi(argv[++i]));
+        } else if (!strcmp(argv[i], "--port") && i < argc-1) {
+            options.Port = atoi(argv[++i]);
+        } else {
+            usage(argv[0]);
+        }
+    }
+    // a power of 2 for the ring
+    options.Buffers = 1 << (31 - __builtin_clz(options.Buffers));
+
+    {
+        TUring probe;
+        if (!probe.Bundles()) {
+            std::cerr << "No bundles in this kernel (Linux 6.10), the bundle run takes a buffer per completion\n";
+        }
+    }
+    std::cout << "receiver\tMB/s\tbuffers/read\tcompletions/MB\tenters/MB\n";
+    bench("recv", EMode::Recv, options.Port, options);
+    bench("ring", EMode::Ring, options.Port + 1, options);
+    bench("bundle", EMode::Bundle, options.Port + 2, options);
+    return 0;
+}
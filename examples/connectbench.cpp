@@ -0,0 +1,146 @@
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+#include <coroio/all.hpp>
+
+using namespace NNet;
+
+// Rate of short-lived client connections on TUring: connect, send a request, read the reply
+// until the server closes. "plain" is socket(2) with Connect and WriteSome, "linked" is
+// ConnectLinked, the socket, the connect and the send in one submission. The server runs
+// on its own loop in another thread and closes first, so the client ports do not run out.
+// The enters are the io_uring_enter calls of the client, "plain" makes socket(2) on top of them.
+
+namespace {
+
+struct TOptions {
+    int Connections = 20000;
+    int Concurrency = 64;
+    int Size = 64;
+    int Port = 8000;
+};
+
+TVoidTask serve(TUring::TSocket client, int size) {
+    std::vector<char> buffer(size);
+    try {
+        co_await TByteReader(client).Read(buffer.data(), size);
+        co_await TByteWriter(client).Write(buffer.data(), size);
+    } catch (const std::exception& ) {
+        // the client is gone
+    }
+    co_return;
+}
+
+TVoidTask server(TUring::TSocket& listener, int size) {
+    try {
+        while (true) {
+            auto client = co_await listener.Accept();
+            serve(std::move(client), size);
+        }
+    } catch (const std::exception& ex) {
+        std::cerr << "Accept failed: " << ex.what() << "\n";
+    }
+    co_return;
+}
+
+TFuture<void> client(TUring& poller, bool linked, const TOptions& options, std::atomic<int>& left) {
+    std::vector<char> request(options.Size, 'r');
+    std::vector<char> buffer(options.Size);
+    while (left.fetch_sub(1) > 0) {
+        TAddress address{"127.0.0.1", options.Port};
+        TUring::TSocket socket;
+        ssize_t sent = 0;
+        if (linked) {
+            auto conn = co_await ConnectLinked(poller, std::move(address), request.data(), request.size());
+            socket = std::move(conn.Socket);
+            sent = conn.Sent;
+        } else {
+            socket = TUring::TSocket(std::move(address), poller);
+            co_await socket.Connect();
+        }
+        co_await TByteWriter(socket).Write(request.data() + sent, request.size() - sent);
+        while (true) {
+            auto size = co_await socket.ReadSome(buffer.data(), buffer.size());
+            if (size == 0) {
+                break;
+            }
+        }
+    }
+    co_return;
+}
+
+void bench(const char* name, bool linked, const TOptions& options) {
+    TLoop<TUring> serverLoop;
+    TUring::TSocket listener(TAddress{"127.0.0.1", options.Port}, serverLoop.Poller());
+    listener.Bind();
+    listener.Listen(4096);
+    server(listener, options.Size);
+    std::atomic<bool> done = false;
+    std::thread thread([&]() {
+        while (!done) {
+            serverLoop.Step();
+        }
+    });
+
+    TLoop<TUring> loop;
+    std::atomic<int> left = options.Connections;
+    std::vector<TFuture<void>> futures;
+    auto start = TClock::now();
+    for (int i = 0; i < options.Concurrency; i++) {
+        futures.emplace_back(client(loop.Poller(), linked, options, left));
+    }
+    TFuture<void> all = All(std::move(futures));
+    while (!all.done()) {
+        loop.Step();
+    }
+    auto elapsed = std::chrono::duration<double>(TClock::now() - start).count();
+    done = true;
+    {
+        // wakes the server up
+        TAddress address{"127.0.0.1", options.Port};
+        int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+        auto raw = address.RawAddr();
+        ::connect(fd, raw.first, raw.second);
+        ::close(fd);
+    }
+    thread.join();
+    all.await_resume(); // rethrows errors
+
+    auto& stats = loop.Poller().Stats();
+    std::cout << name << "\t" << static_cast<uint64_t>(options.Connections / elapsed)
+              << "\t" << static_cast<double>(stats.Enters) / options.Connections
+              << "\t" << static_cast<double>(stats.Iterations) / options.Connections << "\n";
+}
+
+void usage(const char* name) {
+    std::cerr << name << " [-n connections] [-c concurrency] [-s size] [--port 8000] [--help]" << std::endl;
+    std::exit(1);
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    TInitializer init;
+    TOptions options;
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "-n") && i < argc-1) {
+            options.Connections = std::max(1, atoi(argv[++i]));
+        } else if (!strcmp(argv[i], "-c") && i < argc-1) {
+            options.Concurrency = std::max(1, atoi(argv[++i]));
+        } else if (!strcmp(argv[i], "-s") && i < argc-1) {
+            options.Size = std::max(1, atoi(argv[++i]));
+        } else if (!strcmp(argv[i], "--port") && i < argc-1) {
+            options.Port = atoi(argv[++i]);
+        } else {
+            usage(argv[0]);
+        }
+    }
+
+    std::cout << "connect\tconnections/s\tenters/connection\titerations/connection\n";
+    bench("plain", false, options);
+    options.Port++;
+    bench("linked", true, options);
+    return 0;
+}
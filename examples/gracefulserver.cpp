@@ -0,0 +1,171 @@
+#include <unordered_set>
+
+#include <coroio/all.hpp>
+
+using namespace NNet;
+
+// Echo server that shuts down gracefully without a signal thread: SIGTERM or SIGINT stop
+// accepting, the open connections get --drain seconds to finish, the rest are shut down.
+// SIGHUP stands for a configuration reload and resets the counters. A timerfd prints
+// the counters every --report seconds.
+
+namespace {
+
+struct TState {
+    bool Stopping = false;
+    bool Done = false;
+    std::unordered_set<int> Active;
+    uint64_t Accepted = 0;
+    uint64_t Bytes = 0;
+};
+
+template<typename TSocket>
+TVoidTask session(TSocket socket, TState& state) {
+    state.Active.insert(socket.Fd());
+    std::vector<char> buffer(16 * 1024);
+    try {
+        while (true) {
+            auto size = co_await socket.ReadSome(buffer.data(), buffer.size());
+            if (size == 0) {
+                break;
+            }
+            if (size < 0) {
+                continue;
+            }
+            state.Bytes += size;
+            co_await TByteWriter(socket).Write(buffer.data(), size);
+        }
+    } catch (const std::exception& ) { }
+    state.Active.erase(socket.Fd());
+    co_return;
+}
+
+template<typename TSocket>
+TVoidTask acceptor(TSocket& listener, TState& state) {
+    try {
+        while (true) {
+            auto client = co_await listener.Accept();
+            state.Accepted++;
+            session(std::move(client), state);
+        }
+    } catch (const std::exception& ex) {
+        // shutdown of the listening socket fails the pending accept
+        if (!state.Stopping) {
+            std::cerr << "Accept failed: " << ex.what() << "\n";
+        }
+    }
+    co_return;
+}
+
+template<typename TPoller>
+TVoidTask report(TPoller& poller, std::chrono::seconds interval, TState& state) {
+    TPeriodicTimer<TPoller> timer(poller, interval);
+    while (!state.Done) {
+        auto ticks = co_await timer.Wait();
+        std::cerr << "connections: " << state.Active.size() << ", accepted: " << state.Accepted
+                  << ", bytes: " << state.Bytes;
+        if (ticks > 1) {
+            std::cerr << ", missed ticks: " << ticks - 1;
+        }
+        std::cerr << "\n";
+    }
+    co_return;
+}
+
+template<typename TPoller, typename TSocket>
+TVoidTask control(TPoller& poller, TSignals<TPoller>& signals, TSocket& listener, std::chrono::seconds drain, TState& state) {
+    while (true) {
+        auto signal = co_await signals.Wait();
+        if (signal != SIGHUP) {
+            std::cerr << "Got " << strsignal(signal) << ", draining " << state.Active.size() << " connections\n";
+            break;
+        }
+        std::cerr << "Got SIGHUP, reloading\n";
+        state.Accepted = state.Bytes = 0;
+    }
+
+    state.Stopping = true;
+    ::shutdown(listener.Fd(), SHUT_RD);
+    auto deadline = TClock::now() + drain;
+    while (!state.Active.empty() && TClock::now() < deadline) {
+        co_await poller.Sleep(std::chrono::milliseconds(100));
+    }
+    if (!state.Active.empty()) {
+        std::cerr << "Closing " << state.Active.size() << " connections\n";
+        for (int fd : state.Active) {
+            ::shutdown(fd, SHUT_RDWR);
+        }
+        while (!state.Active.empty()) {
+            co_await poller.Sleep(std::chrono::milliseconds(10));
+        }
+    }
+    state.Done = true;
+    co_return;
+}
+
+template<typename TPoller>
+void run(TAddress address, std::chrono::seconds drain, std::chrono::seconds reportInterval) {
+    TLoop<TPoller> loop;
+    // before any other thread is started, they inherit the blocked signals
+    TSignals<TPoller> signals(loop.Poller(), {SIGINT, SIGTERM, SIGHUP});
+    typename TPoller::TSocket listener(std::move(address), loop.Poller());
+    listener.Bind();
+    listener.Listen();
+    std::cerr << "Listening on: " << listener.Addr().ToString() << ", pid: " << getpid() << std::endl;
+
+    TState state;
+    acceptor(listener, state);
+    report(loop.Poller(), reportInterval, state);
+    control(loop.Poller(), signals, listener, drain, state);
+    while (!state.Done) {
+        loop.Step();
+    }
+    std::cerr << "Stopped\n";
+}
+
+void usage(const char* name) {
+    std::cerr << name << " [--port 8000] [--drain 10 (seconds)] [--report 10 (seconds)] "
+              << "[--method select|poll|epoll|uring] [--help]" << std::endl;
+    std::exit(1);
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    TInitializer init;
+    int port = 8000;
+    std::chrono::seconds drain(10);
+    std::chrono::seconds report(10);
+    std::string method = "epoll";
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "--port") && i < argc-1) {
+            port = atoi(argv[++i]);
+        } else if (!strcmp(argv[i], "--drain") && i < argc-1) {
+            drain = std::chrono::seconds(atoi(argv[++i]));
+        } else if (!strcmp(argv[i], "--report") && i < argc-1) {
+            report = std::chrono::seconds(std::max(1, atoi(argv[++i])));
+        } else if (!strcmp(argv[i], "--method") && i < argc-1) {
+            method = argv[++i];
+        } else {
+            usage(argv[0]);
+        }
+    }
+
+    TAddress address{"::", port};
+    if (method == "select") {
+        run<TSelect>(address, drain, report);
+    }
+    else if (method == "poll") {
+        run<TPoll>(address, drain, report);
+    }
+    else if (method == "epoll") {
+        run<TEPoll>(address, drain, report);
+    }
+    else if (method == "uring") {
+        run<TUring>(address, drain, report);
+    }
+    else {
+        std::cerr << "Unknown method: " << method << "\n";
+    }
+    return 0;
+}
@@ -0,0 +1,187 @@
+#include <algorithm>
+#include <chrono>
+#include <vector>
+
+#include <coroio/all.hpp>
+#include <coroio/http/parser.hpp>
+
+using namespace NNet;
+
+// wrk-style load generator: keeps N keep-alive connections busy for a fixed duration,
+// optionally pipelining several requests per write
+
+namespace {
+
+struct TStat {
+    uint64_t Requests = 0;
+    uint64_t Bytes = 0;
+    uint64_t Errors = 0;
+    std::vector<uint32_t> Latencies; // microseconds
+};
+
+struct TOptions {
+    std::string Addr = "127.0.0.1";
+    int Port = 8080;
+    std::string Path = "/";
+    int Connections = 64;
+    int Duration = 10;
+    int Pipeline = 1;
+};
+
+template<typename TSocket>
+TFuture<void> connection(typename TSocket::TPoller& poller, const TOptions& options, TTime deadline, TStat& stat) {
+    std::string request = "GET " + options.Path + " HTTP/1.1\r\nHost: " + options.Addr + "\r\n\r\n";
+    std::string batch;
+    for (int i = 0; i < options.Pipeline; i++) {
+        batch += request;
+    }
+    std::vector<char> buffer(64 * 1024);
+    size_t rpos = 0, wpos = 0;
+    THttpReplyParser parser;
+
+    try {
+        TSocket socket(TAddress{options.Addr, options.Port}, poller);
+        co_await socket.Connect(TClock::now() + std::chrono::seconds(5));
+        while (TClock::now() < deadline) {
+            auto start = TClock::now();
+            co_await TByteWriter(socket).Write(batch.data(), batch.size());
+            int pending = options.Pipeline;
+            while (pending > 0) {
+                auto status = parser.Parse(buffer.data() + rpos, wpos - rpos);
+                if (status == EHttpParseStatus::Done) {
+                    auto latency = std::chrono::duration_cast<std::chrono::microseconds>(TClock::now() - start);
+                    stat.Latencies.push_back(latency.count());
+                    stat.Requests++;
+                    stat.Bytes += parser.Consumed();
+                    if (parser.Message().Status != 200) {
+                        stat.Errors++;
+                    }
+                    rpos += parser.Consumed();
+                    parser.Reset();
+                    pending--;
+                    continue;
+                }
+                if (status == EHttpParseStatus::Error || status == EHttpParseStatus::TooLarge) {
+                    throw std::runtime_error("Bad reply");
+                }
+                if (rpos == wpos) {
+                    rpos = wpos = 0;
+                } else if (buffer.size() - wpos < 4096) {
+                    memmove(buffer.data(), buffer.data() + rpos, wpos - rpos);
+                    wpos -= rpos;
+                    rpos = 0;
+                    if (buffer.size() - wpos < 4096) {
+                        buffer.resize(buffer.size() * 2);
+                    }
+                }
+                auto size = co_await socket.ReadSome(buffer.data() + wpos, buffer.size() - wpos);
+                if (size == 0) {
+                    throw std::runtime_error("Connection closed");
+                }
+                if (size > 0) {
+                    wpos += size;
+                }
+            }
+        }
+    } catch (const std::exception& ex) {
+        std::cerr << "Error: " << ex.what() << "\n";
+        stat.Errors++;
+    }
+    co_return;
+}
+
+template<typename TPoller>
+void run(const TOptions& options) {
+    TLoop<TPoller> loop;
+    TStat stat;
+    auto start = TClock::now();
+    auto deadline = start + std::chrono::seconds(options.Duration);
+    std::vector<TFuture<void>> connections;
+    for (int i = 0; i < options.Connections; i++) {
+        connections.emplace_back(connection<typename TPoller::TSocket>(loop.Poller(), options, deadline, stat));
+    }
+    while (!std::all_of(connections.begin(), connections.end(), [](auto& c) { return c.done(); })) {
+        loop.Step();
+    }
+    auto elapsed = std::chrono::duration_cast<std::chrono::duration<double>>(TClock::now() - start).count();
+
+    auto& l = stat.Latencies;
+    std::sort(l.begin(), l.end());
+    auto percentile = [&](double p) -> uint32_t {
+        return l.empty() ? 0 : l[std::min<size_t>(l.size() - 1, p * l.size())];
+    };
+    std::cout << "Running " << options.Duration << "s test @ " << options.Addr << ":" << options.Port << options.Path << "\n";
+    std::cout << "  " << options.Connections << " connections, pipeline " << options.Pipeline << "\n";
+    std::cout << "  Latency (us): p50: " << percentile(0.5)
+              << ", p90: " << percentile(0.9)
+              << ", p99: " << percentile(0.99)
+              << ", max: " << (l.empty() ? 0 : l.back()) << "\n";
+    std::cout << "  " << stat.Requests << " requests in " << elapsed << "s, "
+              << stat.Bytes / (1024.0 * 1024.0) << " MB read, " << stat.Errors << " errors\n";
+    std::cout << "Requests/sec: " << stat.Requests / elapsed << "\n";
+    std::cout << "Transfer/sec: " << stat.Bytes / (1024.0 * 1024.0) / elapsed << " MB\n";
+}
+
+void usage(const char* name) {
+    std::cerr << name << " [--addr 127.0.0.1] [--port 8080] [--path /] [-c connections] [-d seconds] [-p pipeline] "
+              << "[--method select|poll|epoll|uring|kqueue|iocp] [--help]" << std::endl;
+    std::exit(1);
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    TInitializer init;
+    TOptions options;
+    std::string method = "poll";
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "--addr") && i < argc-1) {
+            options.Addr = argv[++i];
+        } else if (!strcmp(argv[i], "--port") && i < argc-1) {
+            options.Port = atoi(argv[++i]);
+        } else if (!strcmp(argv[i], "--path") && i < argc-1) {
+            options.Path = argv[++i];
+        } else if (!strcmp(argv[i], "-c") && i < argc-1) {
+            options.Connections = atoi(argv[++i]);
+        } else if (!strcmp(argv[i], "-d") && i < argc-1) {
+            options.Duration = atoi(argv[++i]);
+        } else if (!strcmp(argv[i], "-p") && i < argc-1) {
+            options.Pipeline = std::max(1, atoi(argv[++i]));
+        } else if (!strcmp(argv[i], "--method") && i < argc-1) {
+            method = argv[++i];
+        } else {
+            usage(argv[0]);
+        }
+    }
+
+    if (method == "select") {
+        run<TSelect>(options);
+    }
+    else if (method == "poll") {
+        run<TPoll>(options);
+    }
+#ifdef HAVE_EPOLL
+    else if (method == "epoll") {
+        run<TEPoll>(options);
+    }
+#endif
+#ifdef HAVE_URING
+    else if (method == "uring") {
+        run<TUring>(options);
+    }
+#endif
+#ifdef HAVE_KQUEUE
+    else if (method == "kqueue") {
+        run<TKqueue>(options);
+    }
+#endif
+#ifdef HAVE_IOCP
+    else if (method == "iocp") {
+        run<TIOCp>(options);
+    }
+#endif
+    else {
+        std::cerr << "Unknown method: " << method << "\n";
+    }
+    return 0;
+}
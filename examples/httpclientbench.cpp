@@ -0,0 +1,189 @@
+#include <algorithm>
+#include <chrono>
+#include <vector>
+
+#include <coroio/all.hpp>
+#include <coroio/http/client.hpp>
+#include <coroio/http/server.hpp>
+
+using namespace NNet;
+
+// Drives THttpClient against the in-tree HTTP server: by default both run in the same
+// loop over loopback, with --port the client targets an already running server
+
+namespace {
+
+struct TOptions {
+    std::string Addr = "127.0.0.1";
+    int Port = 0;
+    std::string Path = "/";
+    int Concurrency = 64;
+    int Connections = 4;
+    int Pipeline = 16;
+    int Requests = 200000;
+};
+
+struct TStat {
+    uint64_t Requests = 0;
+    uint64_t Bytes = 0;
+    uint64_t Errors = 0;
+    std::vector<uint32_t> Latencies; // microseconds
+};
+
+template<typename TSocket>
+TFuture<void> worker(THttpClient<TSocket>& client, const TAddress& address, const TOptions& options, int& left, TStat& stat) {
+    THttpClientRequest request;
+    request.Target = options.Path;
+    while (left > 0) {
+        left--;
+        auto start = TClock::now();
+        try {
+            auto response = co_await client.Send(address, request);
+            while (true) {
+                auto piece = co_await response.Next();
+                if (piece.empty()) {
+                    break;
+                }
+                stat.Bytes += piece.size();
+            }
+            if (response.Status() != 200) {
+                stat.Errors++;
+            }
+        } catch (const std::exception& ex) {
+            std::cerr << "Error: " << ex.what() << "\n";
+            stat.Errors++;
+        }
+        auto latency = std::chrono::duration_cast<std::chrono::microseconds>(TClock::now() - start);
+        stat.Latencies.push_back(latency.count());
+        stat.Requests++;
+    }
+    co_return;
+}
+
+TFuture<void> handle(const THttpRequest& request, THttpResponse& response) {
+    if (request.Path == "/chunked") {
+        response.AddChunk("Hello, ");
+        response.AddChunk("World!\n");
+    } else {
+        response.SetBodyView("Hello, World!\n");
+    }
+    co_return;
+}
+
+template<typename TPoller>
+void run(const TOptions& options) {
+    using TSocket = typename TPoller::TSocket;
+    TLoop<TPoller> loop;
+
+    std::unique_ptr<TSocket> listener;
+    std::unique_ptr<THttpServer<TSocket>> server;
+    TFuture<void> serve;
+    int port = options.Port;
+    if (port == 0) {
+        port = 18080;
+        listener = std::make_unique<TSocket>(TAddress{options.Addr, port}, loop.Poller());
+        listener->Bind();
+        listener->Listen(1024);
+        server = std::make_unique<THttpServer<TSocket>>(*listener, handle);
+        serve = server->Serve();
+    }
+
+    THttpClientOptions clientOptions;
+    clientOptions.MaxConnectionsPerHost = options.Connections;
+    clientOptions.MaxPipeline = options.Pipeline;
+    THttpClient<TSocket> client(loop.Poller(), clientOptions);
+    TAddress address{options.Addr, port};
+
+    TStat stat;
+    int left = options.Requests;
+    auto start = TClock::now();
+    std::vector<TFuture<void>> workers;
+    for (int i = 0; i < options.Concurrency; i++) {
+        workers.emplace_back(worker(client, address, options, left, stat));
+    }
+    while (!std::all_of(workers.begin(), workers.end(), [](auto& w) { return w.done(); })) {
+        loop.Step();
+    }
+    auto elapsed = std::chrono::duration_cast<std::chrono::duration<double>>(TClock::now() - start).count();
+
+    auto& l = stat.Latencies;
+    std::sort(l.begin(), l.end());
+    auto percentile = [&](double p) -> uint32_t {
+        return l.empty() ? 0 : l[std::min<size_t>(l.size() - 1, p * l.size())];
+    };
+    std::cout << stat.Requests << " requests, " << options.Concurrency << " concurrent, "
+              << client.Connections() << " connections, pipeline " << options.Pipeline << "\n";
+    std::cout << "  Latency (us): p50: " << percentile(0.5)
+              << ", p90: " << percentile(0.9)
+              << ", p99: " << percentile(0.99)
+              << ", max: " << (l.empty() ? 0 : l.back()) << "\n";
+    std::cout << "  " << stat.Bytes / (1024.0 * 1024.0) << " MB of bodies, " << stat.Errors << " errors\n";
+    std::cout << "Requests/sec: " << stat.Requests / elapsed << "\n";
+}
+
+void usage(const char* name) {
+    std::cerr << name << " [--addr 127.0.0.1] [--port 0 (in-process server)] [--path /] [-c concurrency] "
+              << "[-n requests] [--connections 4] [-p pipeline] "
+              << "[--method select|poll|epoll|uring|kqueue|iocp] [--help]" << std::endl;
+    std::exit(1);
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    TInitializer init;
+    TOptions options;
+    std::string method = "poll";
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "--addr") && i < argc-1) {
+            options.Addr = argv[++i];
+        } else if (!strcmp(argv[i], "--port") && i < argc-1) {
+            options.Port = atoi(argv[++i]);
+        } else if (!strcmp(argv[i], "--path") && i < argc-1) {
+            options.Path = argv[++i];
+        } else if (!strcmp(argv[i], "-c") && i < argc-1) {
+            options.Concurrency = std::max(1, atoi(argv[++i]));
+        } else if (!strcmp(argv[i], "-n") && i < argc-1) {
+            options.Requests = atoi(argv[++i]);
+        } else if (!strcmp(argv[i], "--connections") && i < argc-1) {
+            options.Connections = std::max(1, atoi(argv[++i]));
+        } else if (!strcmp(argv[i], "-p") && i < argc-1) {
+            options.Pipeline = std::max(1, atoi(argv[++i]));
+        } else if (!strcmp(argv[i], "--method") && i < argc-1) {
+            method = argv[++i];
+        } else {
+            usage(argv[0]);
+        }
+    }
+
+    if (method == "select") {
+        run<TSelect>(options);
+    }
+    else if (method == "poll") {
+        run<TPoll>(options);
+    }
+#ifdef HAVE_EPOLL
+    else if (method == "epoll") {
+        run<TEPoll>(options);
+    }
+#endif
+#ifdef HAVE_URING
+    else if (method == "uring") {
+        run<TUring>(options);
+    }
+#endif
+#ifdef HAVE_KQUEUE
+    else if (method == "kqueue") {
+        run<TKqueue>(options);
+    }
+#endif
+#ifdef HAVE_IOCP
+    else if (method == "iocp") {
+        run<TIOCp>(options);
+    }
+#endif
+    else {
+        std::cerr << "Unknown method: " << method << "\n";
+    }
+    return 0;
+}
@@ -0,0 +1,111 @@
+#include <coroio/all.hpp>
+#include <coroio/http/server.hpp>
+
+using NNet::TAddress;
+using NNet::THttpRequest;
+using NNet::THttpResponse;
+using NNet::THttpServer;
+using NNet::TSelect;
+using NNet::TPoll;
+
+#ifdef HAVE_EPOLL
+using NNet::TEPoll;
+#endif
+#ifdef HAVE_URING
+using NNet::TUring;
+#endif
+#ifdef HAVE_KQUEUE
+using NNet::TKqueue;
+#endif
+#ifdef HAVE_IOCP
+using NNet::TIOCp;
+#endif
+
+namespace {
+
+NNet::TFuture<void> handle(const THttpRequest& request, THttpResponse& response) {
+    if (request.Path == "/echo") {
+        response.AddHeader("Content-Type", "application/octet-stream");
+        response.SetBody(std::string(request.Body));
+    } else if (request.Path == "/chunked") {
+        response.AddHeader("Content-Type", "text/plain");
+        response.AddChunk("Hello, ");
+        response.AddChunk("World!\n");
+    } else if (request.Path == "/") {
+        response.AddHeader("Content-Type", "text/plain");
+        response.SetBodyView("Hello, World!\n");
+    } else {
+        response.SetStatus(404);
+    }
+    co_return;
+}
+
+} // namespace
+
+template<typename TPoller>
+void run(TAddress address)
+{
+    NNet::TLoop<TPoller> loop;
+    typename TPoller::TSocket socket(std::move(address), loop.Poller());
+    socket.Bind();
+    socket.Listen(1024);
+    std::cerr << "Listening on: " << socket.Addr().ToString() << std::endl;
+    THttpServer server(socket, handle);
+    auto h = server.Serve();
+    loop.Loop();
+}
+
+void usage(const char* name) {
+    std::cerr << name << " [--port 8080] [--method select|poll|epoll|uring|kqueue|iocp] [--help]" << std::endl;
+    std::exit(1);
+}
+
+int main(int argc, char** argv) {
+    NNet::TInitializer init;
+    int port = 0;
+    std::string method = "select";
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "--port") && i < argc-1) {
+            port = atoi(argv[++i]);
+        } else if (!strcmp(argv[i], "--method") && i < argc-1) {
+            method = argv[++i];
+        } else if (!strcmp(argv[i], "--help")) {
+            usage(argv[0]);
+        }
+    }
+    if (port == 0) { port = 8080; }
+
+    TAddress address{"::", port};
+    std::cerr << "Method: " << method << "\n";
+
+    if (method == "select") {
+        run<TSelect>(address);
+    }
+    else if (method == "poll") {
+        run<TPoll>(address);
+    }
+#ifdef HAVE_EPOLL
+    else if (method == "epoll") {
+        run<TEPoll>(address);
+    }
+#endif
+#ifdef HAVE_URING
+    else if (method == "uring") {
+        run<TUring>(address);
+    }
+#endif
+#ifdef HAVE_KQUEUE
+    else if (method == "kqueue") {
+        run<TKqueue>(address);
+    }
+#endif
+#ifdef HAVE_IOCP
+    else if (method == "iocp") {
+        run<TIOCp>(address);
+    }
+#endif
+    else {
+        std::cerr << "Unknown method\n";
+    }
+    return 0;
+}
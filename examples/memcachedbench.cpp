@@ -0,0 +1,266 @@
+#include <algorithm>
+#include <chrono>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+#include <coroio/all.hpp>
+#include <coroio/memcached/client.hpp>
+
+using namespace NNet;
+
+// Gets/s of TMemcachedClient against the number of concurrent callers, keys are
+// sharded over several servers. By default the servers are in-process stubs,
+// --port starts the list of real servers on consecutive ports.
+
+namespace {
+
+struct TOptions {
+    std::string Addr = "127.0.0.1";
+    int Port = 0;
+    int Servers = 4;
+    int Requests = 200000;
+    int MaxCallers = 1024;
+    int Keys = 10000;
+    int ValueSize = 32;
+};
+
+struct TStats {
+    uint64_t Gets = 0;
+    uint64_t Keys = 0;
+};
+
+// Understands get, set and delete, enough for the benchmark
+template<typename TSocket>
+TVoidTask stub_connection(TSocket socket, std::unordered_map<std::string, std::string>& storage, TStats& stats) {
+    std::string buffer, out;
+    std::vector<char> chunk(64 * 1024);
+    size_t rpos = 0;
+    try {
+        while (true) {
+            auto size = co_await socket.ReadSome(chunk.data(), chunk.size());
+            if (size == 0) {
+                break;
+            }
+            if (size < 0) {
+                continue;
+            }
+            buffer.append(chunk.data(), size);
+            while (true) {
+                auto eol = buffer.find("\r\n", rpos);
+                if (eol == std::string::npos) {
+                    break;
+                }
+                std::string_view line(buffer.data() + rpos, eol - rpos);
+                std::vector<std::string_view> args;
+                while (!line.empty()) {
+                    auto p = std::min(line.find(' '), line.size());
+                    args.emplace_back(line.substr(0, p));
+                    line.remove_prefix(std::min(p + 1, line.size()));
+                }
+                if (args.empty()) {
+                    out += "ERROR\r\n";
+                    rpos = eol + 2;
+                } else if (args[0] == "get") {
+                    stats.Gets++;
+                    for (size_t i = 1; i < args.size(); i++) {
+                        stats.Keys++;
+                        auto it = storage.find(std::string(args[i]));
+                        if (it != storage.end()) {
+                            out += "VALUE " + it->first + " 0 " + std::to_string(it->second.size()) + "\r\n";
+                            out += it->second + "\r\n";
+                        }
+                    }
+                    out += "END\r\n";
+                    rpos = eol + 2;
+                } else if (args[0] == "set" && args.size() == 5) {
+                    size_t bytes = std::stoul(std::string(args[4]));
+                    if (buffer.size() < eol + 2 + bytes + 2) {
+                        break;
+                    }
+                    storage[std::string(args[1])] = buffer.substr(eol + 2, bytes);
+                    out += "STORED\r\n";
+                    rpos = eol + 2 + bytes + 2;
+                } else if (args[0] == "delete" && args.size() == 2) {
+                    out += storage.erase(std::string(args[1])) ? "DELETED\r\n" : "NOT_FOUND\r\n";
+                    rpos = eol + 2;
+                } else {
+                    out += "ERROR\r\n";
+                    rpos = eol + 2;
+                }
+            }
+            buffer.erase(0, rpos);
+            rpos = 0;
+            if (!out.empty()) {
+                co_await TByteWriter(socket).Write(out.data(), out.size());
+                out.clear();
+            }
+        }
+    } catch (const std::exception& ) { }
+    co_return;
+}
+
+template<typename TSocket>
+TFuture<void> stub_server(TSocket& listener, std::unordered_map<std::string, std::string>& storage, TStats& stats) {
+    while (true) {
+        auto client = co_await listener.Accept();
+        stub_connection(std::move(client), storage, stats);
+    }
+    co_return;
+}
+
+template<typename TSocket>
+TFuture<void> caller(TMemcachedClient<TSocket>& client, int& left, int& hits, uint32_t seed, int keys) {
+    while (left > 0) {
+        left--;
+        seed = seed * 1103515245 + 12345;
+        auto key = "key:" + std::to_string(seed % keys);
+        auto value = co_await client.Get(key);
+        hits += value.has_value();
+    }
+    co_return;
+}
+
+template<typename TPoller>
+void run(const TOptions& options) {
+    using TSocket = typename TPoller::TSocket;
+    TLoop<TPoller> loop;
+
+    std::vector<std::unique_ptr<TSocket>> listeners;
+    std::vector<std::unordered_map<std::string, std::string>> storages(options.Servers);
+    std::vector<TStats> stats(options.Servers);
+    std::vector<TFuture<void>> servers;
+    int port = options.Port;
+    if (port == 0) {
+        port = 11311;
+        for (int i = 0; i < options.Servers; i++) {
+            listeners.emplace_back(std::make_unique<TSocket>(TAddress{options.Addr, port + i}, loop.Poller()));
+            listeners.back()->Bind();
+            listeners.back()->Listen();
+            servers.emplace_back(stub_server(*listeners.back(), storages[i], stats[i]));
+        }
+    }
+
+    std::vector<std::unique_ptr<TSocket>> sockets;
+    std::vector<TSocket*> pointers;
+    for (int i = 0; i < options.Servers; i++) {
+        sockets.emplace_back(std::make_unique<TSocket>(TAddress{options.Addr, port + i}, loop.Poller()));
+        pointers.emplace_back(sockets.back().get());
+        TFuture<void> connect = [](TSocket& socket) -> TFuture<void> {
+            co_await socket.Connect(TClock::now() + std::chrono::seconds(5));
+        }(*sockets.back());
+        while (!connect.done()) {
+            loop.Step();
+        }
+        connect.await_resume();
+    }
+    TMemcachedClient<TSocket> client(pointers);
+
+    // fill half of the keys
+    std::string value(options.ValueSize, 'v');
+    std::vector<TFuture<bool>> sets;
+    for (int i = 0; i < options.Keys; i += 2) {
+        sets.emplace_back(client.Set("key:" + std::to_string(i), value));
+    }
+    while (!std::all_of(sets.begin(), sets.end(), [](auto& f) { return f.done(); })) {
+        loop.Step();
+    }
+
+    std::cout << "callers\tgets/s\thit%\tkeys/get\n";
+    for (int callers = 1; callers <= options.MaxCallers; callers *= 2) {
+        int left = options.Requests, hits = 0;
+        uint64_t gets = 0, keys = 0;
+        for (auto& s : stats) {
+            gets -= s.Gets;
+            keys -= s.Keys;
+        }
+        std::vector<TFuture<void>> futures;
+        auto start = TClock::now();
+        for (int i = 0; i < callers; i++) {
+            futures.emplace_back(caller(client, left, hits, i, options.Keys));
+        }
+        while (!std::all_of(futures.begin(), futures.end(), [](auto& f) { return f.done(); })) {
+            loop.Step();
+        }
+        for (auto& f : futures) {
+            f.await_resume(); // rethrows errors
+        }
+        auto elapsed = std::chrono::duration_cast<std::chrono::duration<double>>(TClock::now() - start).count();
+        for (auto& s : stats) {
+            gets += s.Gets;
+            keys += s.Keys;
+        }
+        std::cout << callers << "\t" << static_cast<uint64_t>(options.Requests / elapsed)
+                  << "\t" << 100 * hits / options.Requests;
+        if (gets) {
+            std::cout << "\t" << static_cast<double>(keys) / gets;
+        }
+        std::cout << "\n";
+    }
+}
+
+void usage(const char* name) {
+    std::cerr << name << " [--addr 127.0.0.1] [--port 0 (in-process stubs)] [--servers 4] [-n requests] "
+              << "[-c max_callers] [-k keys] [-s value_size] [--method select|poll|epoll|uring|kqueue|iocp] [--help]" << std::endl;
+    std::exit(1);
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    TInitializer init;
+    TOptions options;
+    std::string method = "poll";
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "--addr") && i < argc-1) {
+            options.Addr = argv[++i];
+        } else if (!strcmp(argv[i], "--port") && i < argc-1) {
+            options.Port = atoi(argv[++i]);
+        } else if (!strcmp(argv[i], "--servers") && i < argc-1) {
+            options.Servers = std::max(1, atoi(argv[++i]));
+        } else if (!strcmp(argv[i], "-n") && i < argc-1) {
+            options.Requests = atoi(argv[++i]);
+        } else if (!strcmp(argv[i], "-c") && i < argc-1) {
+            options.MaxCallers = std::max(1, atoi(argv[++i]));
+        } else if (!strcmp(argv[i], "-k") && i < argc-1) {
+            options.Keys = std::max(1, atoi(argv[++i]));
+        } else if (!strcmp(argv[i], "-s") && i < argc-1) {
+            options.ValueSize = atoi(argv[++i]);
+        } else if (!strcmp(argv[i], "--method") && i < argc-1) {
+            method = argv[++i];
+        } else {
+            usage(argv[0]);
+        }
+    }
+
+    if (method == "select") {
+        run<TSelect>(options);
+    }
+    else if (method == "poll") {
+        run<TPoll>(options);
+    }
+#ifdef HAVE_EPOLL
+    else if (method == "epoll") {
+        run<TEPoll>(options);
+    }
+#endif
+#ifdef HAVE_URING
+    else if (method == "uring") {
+        run<TUring>(options);
+    }
+#endif
+#ifdef HAVE_KQUEUE
+    else if (method == "kqueue") {
+        run<TKqueue>(options);
+    }
+#endif
+#ifdef HAVE_IOCP
+    else if (method == "iocp") {
+        run<TIOCp>(options);
+    }
+#endif
+    else {
+        std::cerr << "Unknown method: " << method << "\n";
+    }
+    return 0;
+}
@@ -0,0 +1,375 @@
+#include <memory>
+#include <vector>
+
+#include <type_traits>
+
+#ifdef __linux__
+#include <fcntl.h>
+#include <poll.h>
+#endif
+
+#include <coroio/all.hpp>
+
+using namespace NNet;
+
+// L4 TCP proxy: every accepted connection is paired with a new connection to an
+// upstream chosen round-robin or by the least number of active connections.
+// On Linux bytes are moved with splice through a pipe and never reach user space,
+// TUring submits the splices to the ring. A finished direction is half-closed with
+// shutdown(SHUT_WR) on its destination, the other direction keeps flowing.
+
+namespace {
+
+struct TUpstream {
+    TAddress Addr;
+    int Active = 0;
+    uint64_t Total = 0;
+};
+
+class TBalancer {
+public:
+    TBalancer(std::vector<TUpstream> upstreams, bool leastConnections)
+        : Upstreams_(std::move(upstreams))
+        , LeastConnections_(leastConnections)
+    { }
+
+    TUpstream& Pick() {
+        if (LeastConnections_) {
+            // the first of the least loaded upstreams after the last pick, so ties rotate
+            size_t best = Next_ % Upstreams_.size();
+            for (size_t i = 1; i < Upstreams_.size(); i++) {
+                size_t j = (Next_ + i) % Upstreams_.size();
+                if (Upstreams_[j].Active < Upstreams_[best].Active) {
+                    best = j;
+                }
+            }
+            Next_ = best + 1;
+            return Upstreams_[best];
+        }
+        return Upstreams_[Next_++ % Upstreams_.size()];
+    }
+
+    const std::vector<TUpstream>& Upstreams() const {
+        return Upstreams_;
+    }
+
+private:
+    std::vector<TUpstream> Upstreams_;
+    bool LeastConnections_;
+    size_t Next_ = 0;
+};
+
+void shutdown_socket(int fd, bool both) {
+#ifdef _WIN32
+    ::shutdown(fd, both ? SD_BOTH : SD_SEND);
+#else
+    ::shutdown(fd, both ? SHUT_RDWR : SHUT_WR);
+#endif
+}
+
+#ifdef __linux__
+struct TPipe {
+    explicit TPipe(int size) {
+        if (pipe2(Fds, O_CLOEXEC | O_NONBLOCK) < 0) {
+            throw std::system_error(errno, std::generic_category(), "pipe2");
+        }
+        fcntl(Fds[1], F_SETPIPE_SZ, size); // best effort, bounded by /proc/sys/fs/pipe-max-size
+    }
+
+    ~TPipe() {
+        close(Fds[0]);
+        close(Fds[1]);
+    }
+
+    int Fds[2];
+};
+
+// Readiness of a socket for the pollers that report it
+struct TReady {
+    bool await_ready() const { return false; }
+    void await_suspend(std::coroutine_handle<> h) {
+        if (Write) {
+            Poller->AddWrite(Fd, h);
+        } else {
+            Poller->AddRead(Fd, h);
+        }
+    }
+    void await_resume() const { }
+
+    TPollerBase* Poller;
+    int Fd;
+    bool Write;
+};
+
+ssize_t splice_some(int from, int to, size_t size) {
+    ssize_t n;
+    while ((n = splice(from, nullptr, to, nullptr, size, SPLICE_F_MOVE | SPLICE_F_NONBLOCK)) < 0 && errno == EINTR) { }
+    if (n < 0 && errno != EAGAIN) {
+        throw std::system_error(errno, std::generic_category(), "splice");
+    }
+    return n;
+}
+
+#ifdef HAVE_URING
+// Splicing a nonblocking socket fails with EAGAIN instead of waiting,
+// then the splice is retried after TUringPoll reports readiness
+struct TUringSplice {
+    bool await_ready() const { return false; }
+    void await_suspend(std::coroutine_handle<> h) {
+        Poller->Splice(In, Out, Size, h);
+    }
+    int await_resume() {
+        int ret = Poller->Result();
+        if (ret < 0 && ret != -EAGAIN) {
+            throw std::system_error(-ret, std::generic_category(), "splice");
+        }
+        return ret;
+    }
+
+    TUring* Poller;
+    int In;
+    int Out;
+    int Size;
+};
+
+struct TUringPoll {
+    bool await_ready() const { return false; }
+    void await_suspend(std::coroutine_handle<> h) {
+        Poller->PollAdd(Fd, Mask, h);
+    }
+    void await_resume() {
+        Poller->Result();
+    }
+
+    TUring* Poller;
+    int Fd;
+    unsigned Mask;
+};
+#endif
+#endif
+
+template<typename TPoller, typename TSocket>
+TFuture<void> forward_impl(TPoller& poller, TSocket& from, TSocket& to, int chunk, uint64_t& bytes) {
+#ifdef __linux__
+    TPipe pipe(chunk);
+#ifdef HAVE_URING
+    if constexpr (std::is_same_v<TPoller, TUring>) {
+        while (true) {
+            int n = co_await TUringSplice{&poller, from.Fd(), pipe.Fds[1], chunk};
+            if (n < 0) {
+                co_await TUringPoll{&poller, from.Fd(), POLLIN};
+                continue;
+            }
+            if (n == 0) {
+                break;
+            }
+            bytes += n;
+            while (n > 0) {
+                int m = co_await TUringSplice{&poller, pipe.Fds[0], to.Fd(), n};
+                if (m < 0) {
+                    co_await TUringPoll{&poller, to.Fd(), POLLOUT};
+                    continue;
+                }
+                n -= m;
+            }
+        }
+    } else
+#endif
+    {
+        while (true) {
+            auto n = splice_some(from.Fd(), pipe.Fds[1], chunk);
+            if (n < 0) {
+                co_await TReady{&poller, from.Fd(), false};
+                continue;
+            }
+            if (n == 0) {
+                break;
+            }
+            bytes += n;
+            while (n > 0) {
+                auto m = splice_some(pipe.Fds[0], to.Fd(), n);
+                if (m < 0) {
+                    co_await TReady{&poller, to.Fd(), true};
+                    continue;
+                }
+                n -= m;
+            }
+        }
+    }
+#else
+    std::vector<char> buffer(chunk);
+    while (true) {
+        auto n = co_await from.ReadSome(buffer.data(), buffer.size());
+        if (n == 0) {
+            break;
+        }
+        if (n < 0) {
+            continue;
+        }
+        bytes += n;
+        co_await TByteWriter(to).Write(buffer.data(), n);
+    }
+#endif
+    co_return;
+}
+
+// Never throws: the other direction may be suspended on the same sockets and must not be
+// destroyed, so a failure shuts both sockets down and lets it finish by itself
+template<typename TPoller, typename TSocket>
+TFuture<bool> forward(TPoller& poller, TSocket& from, TSocket& to, int chunk, uint64_t& bytes) {
+    bool ok = true;
+    try {
+        co_await forward_impl(poller, from, to, chunk, bytes);
+        shutdown_socket(to.Fd(), false);
+    } catch (const std::exception& ) {
+        shutdown_socket(from.Fd(), true);
+        shutdown_socket(to.Fd(), true);
+        ok = false;
+    }
+    co_return ok;
+}
+
+struct TStats {
+    uint64_t Sessions = 0;
+    uint64_t Failed = 0;
+    uint64_t Bytes = 0;
+};
+
+template<typename TPoller, typename TSocket>
+TVoidTask session(TPoller& poller, TSocket client, TBalancer& balancer, int chunk, TStats& stats) {
+    auto& upstream = balancer.Pick();
+    upstream.Active++;
+    upstream.Total++;
+    stats.Sessions++;
+    try {
+        TSocket server(upstream.Addr, poller);
+        co_await server.Connect(TClock::now() + std::chrono::seconds(5));
+        auto up = forward(poller, client, server, chunk, stats.Bytes);
+        auto down = forward(poller, server, client, chunk, stats.Bytes);
+        bool upOk = co_await up;
+        bool downOk = co_await down;
+        if (!upOk || !downOk) {
+            stats.Failed++;
+        }
+    } catch (const std::exception& ) {
+        stats.Failed++;
+    }
+    upstream.Active--;
+    co_return;
+}
+
+template<typename TPoller>
+TVoidTask serve(TPoller& poller, TAddress address, TBalancer& balancer, int chunk, TStats& stats) {
+    typename TPoller::TSocket listener(std::move(address), poller);
+    listener.Bind();
+    listener.Listen();
+    std::cerr << "Listening on: " << listener.Addr().ToString() << std::endl;
+    while (true) {
+        auto client = co_await listener.Accept();
+        session(poller, std::move(client), balancer, chunk, stats);
+    }
+    co_return;
+}
+
+template<typename TPoller>
+TVoidTask report(TPoller& poller, TBalancer& balancer, TStats& stats) {
+    uint64_t bytes = 0;
+    while (true) {
+        co_await poller.Sleep(std::chrono::seconds(10));
+        std::cerr << "sessions: " << stats.Sessions << ", failed: " << stats.Failed
+                  << ", Gbit/s: " << (stats.Bytes - bytes) * 8 / 10.0 / 1e9;
+        for (auto& upstream : balancer.Upstreams()) {
+            std::cerr << ", " << upstream.Addr.ToString() << ": " << upstream.Active << "/" << upstream.Total;
+        }
+        std::cerr << "\n";
+        bytes = stats.Bytes;
+    }
+    co_return;
+}
+
+template<typename TPoller>
+void run(TAddress address, TBalancer& balancer, int chunk) {
+    TLoop<TPoller> loop;
+    TStats stats;
+    serve(loop.Poller(), std::move(address), balancer, chunk, stats);
+    report(loop.Poller(), balancer, stats);
+    loop.Loop();
+}
+
+void usage(const char* name) {
+    std::cerr << name << " [--port 8100] --upstream host:port [--upstream host:port ...] "
+              << "[--policy round-robin|least-connections] [--chunk 65536] "
+              << "[--method select|poll|epoll|uring|kqueue|iocp] [--help]" << std::endl;
+    std::exit(1);
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    TInitializer init;
+    int port = 8100;
+    int chunk = 64 * 1024;
+    bool leastConnections = false;
+    std::vector<TUpstream> upstreams;
+    std::string method = "epoll";
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "--port") && i < argc-1) {
+            port = atoi(argv[++i]);
+        } else if (!strcmp(argv[i], "--upstream") && i < argc-1) {
+            std::string hostPort = argv[++i];
+            auto pos = hostPort.rfind(':');
+            if (pos == std::string::npos) {
+                usage(argv[0]);
+            }
+            upstreams.push_back({TAddress{hostPort.substr(0, pos), atoi(hostPort.c_str() + pos + 1)}});
+        } else if (!strcmp(argv[i], "--policy") && i < argc-1) {
+            std::string policy = argv[++i];
+            if (policy != "round-robin" && policy != "least-connections") {
+                usage(argv[0]);
+            }
+            leastConnections = policy == "least-connections";
+        } else if (!strcmp(argv[i], "--chunk") && i < argc-1) {
+            chunk = atoi(argv[++i]);
+        } else if (!strcmp(argv[i], "--method") && i < argc-1) {
+            method = argv[++i];
+        } else {
+            usage(argv[0]);
+        }
+    }
+    if (upstreams.empty()) {
+        usage(argv[0]);
+    }
+
+    TBalancer balancer(std::move(upstreams), leastConnections);
+    TAddress address{"::", port};
+    if (method == "select") {
+        run<TSelect>(address, balancer, chunk);
+    }
+    else if (method == "poll") {
+        run<TPoll>(address, balancer, chunk);
+    }
+#ifdef HAVE_EPOLL
+    else if (method == "epoll") {
+        run<TEPoll>(address, balancer, chunk);
+    }
+#endif
+#ifdef HAVE_URING
+    else if (method == "uring") {
+        run<TUring>(address, balancer, chunk);
+    }
+#endif
+#ifdef HAVE_KQUEUE
+    else if (method == "kqueue") {
+        run<TKqueue>(address, balancer, chunk);
+    }
+#endif
+#ifdef HAVE_IOCP
+    else if (method == "iocp") {
+        run<TIOCp>(address, balancer, chunk);
+    }
+#endif
+    else {
+        std::cerr << "Unknown method: " << method << "\n";
+    }
+    return 0;
+}
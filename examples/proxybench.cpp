@@ -0,0 +1,225 @@
+#include <algorithm>
+#include <chrono>
+#include <vector>
+
+#include <coroio/all.hpp>
+
+using namespace NNet;
+
+// Measures a TCP proxy started separately, e.g.
+//   proxy --port 8100 --upstream 127.0.0.1:8101 &
+//   proxybench --proxy 8100 --backend 8101
+// The benchmark runs the backend itself and compares talking to it directly and through the proxy:
+// ping-pong latency gives the latency added by the proxy, uploads to a sink give forwarded Gbit/s.
+// The sink acknowledges only after the upload is half-closed, which checks half-close forwarding.
+
+namespace {
+
+struct TOptions {
+    std::string Addr = "127.0.0.1";
+    int ProxyPort = 8100;
+    int BackendPort = 8101;
+    int Pings = 20000;
+    int Size = 64;
+    int Streams = 4;
+    int Megabytes = 1024;
+};
+
+// The first byte selects the mode: 'p' echoes fixed size messages, 's' counts bytes until EOF
+template<typename TSocket>
+TVoidTask backend_connection(TSocket socket, int size) {
+    std::vector<char> buffer(256 * 1024);
+    try {
+        char mode;
+        co_await TByteReader(socket).Read(&mode, 1);
+        if (mode == 'p') {
+            while (true) {
+                auto n = co_await socket.ReadSome(buffer.data(), size);
+                if (n == 0) {
+                    break;
+                }
+                if (n > 0) {
+                    co_await TByteWriter(socket).Write(buffer.data(), n);
+                }
+            }
+        } else {
+            uint64_t total = 0;
+            while (true) {
+                auto n = co_await socket.ReadSome(buffer.data(), buffer.size());
+                if (n == 0) {
+                    break;
+                }
+                if (n > 0) {
+                    total += n;
+                }
+            }
+            co_await TByteWriter(socket).Write(&total, sizeof(total));
+        }
+    } catch (const std::exception& ) { }
+    co_return;
+}
+
+template<typename TSocket>
+TVoidTask backend(TSocket& listener, int size) {
+    while (true) {
+        auto client = co_await listener.Accept();
+        backend_connection(std::move(client), size);
+    }
+    co_return;
+}
+
+template<typename TSocket>
+TFuture<std::vector<uint32_t>> pings(typename TSocket::TPoller& poller, TAddress addr, const TOptions& options) {
+    TSocket socket(std::move(addr), poller);
+    co_await socket.Connect(TClock::now() + std::chrono::seconds(5));
+    char mode = 'p';
+    co_await TByteWriter(socket).Write(&mode, 1);
+    std::vector<char> buffer(options.Size, 'x');
+    std::vector<uint32_t> latencies;
+    for (int i = 0; i < options.Pings; i++) {
+        auto start = TClock::now();
+        co_await TByteWriter(socket).Write(buffer.data(), buffer.size());
+        co_await TByteReader(socket).Read(buffer.data(), buffer.size());
+        latencies.push_back(std::chrono::duration_cast<std::chrono::microseconds>(TClock::now() - start).count());
+    }
+    std::sort(latencies.begin(), latencies.end());
+    co_return latencies;
+}
+
+template<typename TSocket>
+TFuture<void> upload(typename TSocket::TPoller& poller, TAddress addr, uint64_t bytes) {
+    TSocket socket(std::move(addr), poller);
+    co_await socket.Connect(TClock::now() + std::chrono::seconds(5));
+    char mode = 's';
+    co_await TByteWriter(socket).Write(&mode, 1);
+    std::vector<char> buffer(256 * 1024, 'x');
+    for (uint64_t sent = 0; sent < bytes; ) {
+        auto n = std::min<uint64_t>(buffer.size(), bytes - sent);
+        co_await TByteWriter(socket).Write(buffer.data(), n);
+        sent += n;
+    }
+#ifdef _WIN32
+    ::shutdown(socket.Fd(), SD_SEND);
+#else
+    ::shutdown(socket.Fd(), SHUT_WR);
+#endif
+    uint64_t received;
+    co_await TByteReader(socket).Read(&received, sizeof(received));
+    if (received != bytes) {
+        throw std::runtime_error("Sink received " + std::to_string(received) + " bytes of " + std::to_string(bytes));
+    }
+    co_return;
+}
+
+template<typename TLoop, typename TFuture>
+auto wait(TLoop& loop, TFuture& future) {
+    while (!future.done()) {
+        loop.Step();
+    }
+    return future.await_resume();
+}
+
+template<typename TPoller>
+void run(const TOptions& options) {
+    using TSocket = typename TPoller::TSocket;
+    TLoop<TPoller> loop;
+
+    TSocket listener(TAddress{options.Addr, options.BackendPort}, loop.Poller());
+    listener.Bind();
+    listener.Listen();
+    backend(listener, options.Size);
+
+    std::cout << "Ping-pong of " << options.Size << " bytes, latency (us):\n";
+    uint32_t p50[2], p99[2];
+    int i = 0;
+    for (int port : {options.BackendPort, options.ProxyPort}) {
+        auto f = pings<TSocket>(loop.Poller(), TAddress{options.Addr, port}, options);
+        auto l = wait(loop, f);
+        p50[i] = l[l.size() / 2];
+        p99[i] = l[std::min(l.size() - 1, l.size() * 99 / 100)];
+        std::cout << (i ? "  proxy:  " : "  direct: ") << "p50: " << p50[i] << ", p99: " << p99[i] << "\n";
+        i++;
+    }
+    std::cout << "  added:  p50: " << static_cast<int>(p50[1] - p50[0]) << ", p99: " << static_cast<int>(p99[1] - p99[0]) << "\n";
+
+    uint64_t bytes = static_cast<uint64_t>(options.Megabytes) * 1024 * 1024 / options.Streams;
+    std::cout << "Upload of " << options.Megabytes << " MB over " << options.Streams << " streams:\n";
+    for (int port : {options.BackendPort, options.ProxyPort}) {
+        auto start = TClock::now();
+        std::vector<TFuture<void>> streams;
+        for (int s = 0; s < options.Streams; s++) {
+            streams.emplace_back(upload<TSocket>(loop.Poller(), TAddress{options.Addr, port}, bytes));
+        }
+        auto all = All(std::move(streams));
+        wait(loop, all);
+        auto seconds = std::chrono::duration_cast<std::chrono::duration<double>>(TClock::now() - start).count();
+        std::cout << (port == options.ProxyPort ? "  proxy:  " : "  direct: ")
+                  << bytes * options.Streams * 8 / seconds / 1e9 << " Gbit/s\n";
+    }
+}
+
+void usage(const char* name) {
+    std::cerr << name << " [--addr 127.0.0.1] [--proxy 8100] [--backend 8101] [-n pings] [-s ping_size] "
+              << "[-k streams] [-m megabytes] [--method select|poll|epoll|uring|kqueue|iocp] [--help]" << std::endl;
+    std::exit(1);
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    TInitializer init;
+    TOptions options;
+    std::string method = "epoll";
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "--addr") && i < argc-1) {
+            options.Addr = argv[++i];
+        } else if (!strcmp(argv[i], "--proxy") && i < argc-1) {
+            options.ProxyPort = atoi(argv[++i]);
+        } else if (!strcmp(argv[i], "--backend") && i < argc-1) {
+            options.BackendPort = atoi(argv[++i]);
+        } else if (!strcmp(argv[i], "-n") && i < argc-1) {
+            options.Pings = std::max(1, atoi(argv[++i]));
+        } else if (!strcmp(argv[i], "-s") && i < argc-1) {
+            options.Size = std::max(1, atoi(argv[++i]));
+        } else if (!strcmp(argv[i], "-k") && i < argc-1) {
+            options.Streams = std::max(1, atoi(argv[++i]));
+        } else if (!strcmp(argv[i], "-m") && i < argc-1) {
+            options.Megabytes = std::max(1, atoi(argv[++i]));
+        } else if (!strcmp(argv[i], "--method") && i < argc-1) {
+            method = argv[++i];
+        } else {
+            usage(argv[0]);
+        }
+    }
+
+    if (method == "select") {
+        run<TSelect>(options);
+    }
+    else if (method == "poll") {
+        run<TPoll>(options);
+    }
+#ifdef HAVE_EPOLL
+    else if (method == "epoll") {
+        run<TEPoll>(options);
+    }
+#endif
+#ifdef HAVE_URING
+    else if (method == "uring") {
+        run<TUring>(options);
+    }
+#endif
+#ifdef HAVE_KQUEUE
+    else if (method == "kqueue") {
+        run<TKqueue>(options);
+    }
+#endif
+#ifdef HAVE_IOCP
+    else if (method == "iocp") {
+        run<TIOCp>(options);
+    }
+#endif
+    else {
+        std::cerr << "Unknown method: " << method << "\n";
+    }
+    return 0;
+}
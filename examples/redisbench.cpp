@@ -0,0 +1,231 @@
+#include <algorithm>
+#include <chrono>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+#include <coroio/all.hpp>
+#include <coroio/redis/client.hpp>
+
+using namespace NNet;
+
+// Ops/s of TRedisClient against the number of concurrent callers sharing one connection.
+// By default the client talks to a small in-process RESP stub, --port targets a real server.
+
+namespace {
+
+struct TOptions {
+    std::string Addr = "127.0.0.1";
+    int Port = 0;
+    int Requests = 200000;
+    int MaxCallers = 1024;
+    int ValueSize = 32;
+};
+
+void reply_bulk(std::string& out, std::string_view value) {
+    out += "$" + std::to_string(value.size()) + "\r\n";
+    out.append(value);
+    out += "\r\n";
+}
+
+// Understands PING, ECHO, GET, SET, INCR and DEL, enough for the benchmark
+template<typename TSocket>
+TVoidTask stub_connection(TSocket socket, std::unordered_map<std::string, std::string>& storage) {
+    std::vector<char> buffer(64 * 1024);
+    std::vector<TRespNode> nodes;
+    std::string out;
+    size_t rpos = 0, wpos = 0;
+    try {
+        while (true) {
+            auto size = co_await socket.ReadSome(buffer.data() + wpos, buffer.size() - wpos);
+            if (size == 0) {
+                break;
+            }
+            if (size < 0) {
+                continue;
+            }
+            wpos += size;
+            size_t consumed, need;
+            while (RespParse(buffer.data() + rpos, wpos - rpos, nodes, &consumed, &need) == ERespStatus::Done) {
+                rpos += consumed;
+                TRespValue request(nodes.data());
+                std::vector<std::string_view> args;
+                for (auto arg : request) {
+                    args.emplace_back(arg.String());
+                }
+                std::string command(args.empty() ? "" : args[0]);
+                std::transform(command.begin(), command.end(), command.begin(), ::toupper);
+                if (command == "PING") {
+                    out += "+PONG\r\n";
+                } else if (command == "ECHO" && args.size() == 2) {
+                    reply_bulk(out, args[1]);
+                } else if (command == "GET" && args.size() == 2) {
+                    auto it = storage.find(std::string(args[1]));
+                    if (it == storage.end()) {
+                        out += "$-1\r\n";
+                    } else {
+                        reply_bulk(out, it->second);
+                    }
+                } else if (command == "SET" && args.size() == 3) {
+                    storage[std::string(args[1])] = args[2];
+                    out += "+OK\r\n";
+                } else if (command == "INCR" && args.size() == 2) {
+                    auto& value = storage[std::string(args[1])];
+                    value = std::to_string(atoll(value.c_str()) + 1);
+                    out += ":" + value + "\r\n";
+                } else if (command == "DEL" && args.size() >= 2) {
+                    size_t n = 0;
+                    for (size_t i = 1; i < args.size(); i++) {
+                        n += storage.erase(std::string(args[i]));
+                    }
+                    out += ":" + std::to_string(n) + "\r\n";
+                } else {
+                    out += "-ERR unknown command '" + command + "'\r\n";
+                }
+            }
+            if (!out.empty()) {
+                co_await TByteWriter(socket).Write(out.data(), out.size());
+                out.clear();
+            }
+            memmove(buffer.data(), buffer.data() + rpos, wpos - rpos);
+            wpos -= rpos;
+            rpos = 0;
+            if (wpos == buffer.size()) {
+                buffer.resize(buffer.size() * 2);
+            }
+        }
+    } catch (const std::exception& ) { }
+    co_return;
+}
+
+template<typename TSocket>
+TFuture<void> stub_server(TSocket& listener, std::unordered_map<std::string, std::string>& storage) {
+    while (true) {
+        auto client = co_await listener.Accept();
+        stub_connection(std::move(client), storage);
+    }
+    co_return;
+}
+
+template<typename TSocket>
+TFuture<void> caller(TRedisClient<TSocket>& client, int& left, int id, const std::string& value) {
+    std::string key = "key:" + std::to_string(id);
+    while (left > 0) {
+        left--;
+        if (left & 1) {
+            co_await client.Set(key, value);
+        } else {
+            co_await client.Get(key);
+        }
+    }
+    co_return;
+}
+
+template<typename TPoller>
+void run(const TOptions& options) {
+    using TSocket = typename TPoller::TSocket;
+    TLoop<TPoller> loop;
+
+    std::unordered_map<std::string, std::string> storage;
+    std::unique_ptr<TSocket> listener;
+    TFuture<void> server;
+    int port = options.Port;
+    if (port == 0) {
+        port = 16379;
+        listener = std::make_unique<TSocket>(TAddress{options.Addr, port}, loop.Poller());
+        listener->Bind();
+        listener->Listen();
+        server = stub_server(*listener, storage);
+    }
+
+    TSocket socket(TAddress{options.Addr, port}, loop.Poller());
+    TFuture<void> connect = [](TSocket& socket) -> TFuture<void> {
+        co_await socket.Connect(TClock::now() + std::chrono::seconds(5));
+    }(socket);
+    while (!connect.done()) {
+        loop.Step();
+    }
+    connect.await_resume();
+    TRedisClient<TSocket> client(socket);
+    std::string value(options.ValueSize, 'v');
+
+    std::cout << "callers\tops/s\n";
+    for (int callers = 1; callers <= options.MaxCallers; callers *= 2) {
+        int left = options.Requests;
+        std::vector<TFuture<void>> futures;
+        auto start = TClock::now();
+        for (int i = 0; i < callers; i++) {
+            futures.emplace_back(caller(client, left, i, value));
+        }
+        while (!std::all_of(futures.begin(), futures.end(), [](auto& f) { return f.done(); })) {
+            loop.Step();
+        }
+        for (auto& f : futures) {
+            f.await_resume(); // rethrows errors
+        }
+        auto elapsed = std::chrono::duration_cast<std::chrono::duration<double>>(TClock::now() - start).count();
+        std::cout << callers << "\t" << static_cast<uint64_t>(options.Requests / elapsed) << "\n";
+    }
+}
+
+void usage(const char* name) {
+    std::cerr << name << " [--addr 127.0.0.1] [--port 0 (in-process stub)] [-n requests] [-c max_callers] "
+              << "[-s value_size] [--method select|poll|epoll|uring|kqueue|iocp] [--help]" << std::endl;
+    std::exit(1);
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    TInitializer init;
+    TOptions options;
+    std::string method = "poll";
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "--addr") && i < argc-1) {
+            options.Addr = argv[++i];
+        } else if (!strcmp(argv[i], "--port") && i < argc-1) {
+            options.Port = atoi(argv[++i]);
+        } else if (!strcmp(argv[i], "-n") && i < argc-1) {
+            options.Requests = atoi(argv[++i]);
+        } else if (!strcmp(argv[i], "-c") && i < argc-1) {
+            options.MaxCallers = std::max(1, atoi(argv[++i]));
+        } else if (!strcmp(argv[i], "-s") && i < argc-1) {
+            options.ValueSize = atoi(argv[++i]);
+        } else if (!strcmp(argv[i], "--method") && i < argc-1) {
+            method = argv[++i];
+        } else {
+            usage(argv[0]);
+        }
+    }
+
+    if (method == "select") {
+        run<TSelect>(options);
+    }
+    else if (method == "poll") {
+        run<TPoll>(options);
+    }
+#ifdef HAVE_EPOLL
+    else if (method == "epoll") {
+        run<TEPoll>(options);
+    }
+#endif
+#ifdef HAVE_URING
+    else if (method == "uring") {
+        run<TUring>(options);
+    }
+#endif
+#ifdef HAVE_KQUEUE
+    else if (method == "kqueue") {
+        run<TKqueue>(options);
+    }
+#endif
+#ifdef HAVE_IOCP
+    else if (method == "iocp") {
+        run<TIOCp>(options);
+    }
+#endif
+    else {
+        std::cerr << "Unknown method: " << method << "\n";
+    }
+    return 0;
+}
@@ -22,9 +22,9 @@ TVoidTask resolve(TResolver& resolver, std::string name, EDNSType type, int* inf
 
 template<typename TPoller>
 TFuture<void> resolve(TPoller& poller, EDNSType type) {
-    TFileHandle input{0, poller}; // stdin
+    typename TPoller::TFileHandle input{0, poller}; // stdin
     TLineReader lineReader(input, 4096);
-    TResolver<TPollerBase> resolver(poller);
+    TResolverFor<TPoller> resolver(poller);
     int inflight = 0;
     while (auto line = co_await lineReader.Read()) {
         inflight++;
@@ -49,7 +49,7 @@ void run(EDNSType type) {
 }
 
 void usage(const char* name) {
-    std::cerr << name << " [--method select|poll|epoll|kqueue] [--ipv6] [--help] < addr_file.txt" << std::endl;
+    std::cerr << name << " [--method select|poll|epoll|uring|kqueue] [--ipv6] [--help] < addr_file.txt" << std::endl;
     std::exit(1);
 }
 
@@ -0,0 +1,178 @@
+#include <algorithm>
+#include <chrono>
+#include <memory>
+#include <vector>
+
+#include <coroio/all.hpp>
+#include <coroio/rpc/rpc.hpp>
+
+using namespace NNet;
+
+// Latency and throughput of TRpcClient at high concurrency: many callers share
+// a few multiplexed connections to an in-process echo server. A handler delay
+// stands in for backend work and shows that requests run concurrently.
+
+namespace {
+
+struct TOptions {
+    int Port = 18100;
+    int Requests = 200000;
+    int Callers = 1024;
+    int Connections = 1;
+    int Size = 64;
+    int DelayUs = 0;
+    int TimeoutMs = 0;
+};
+
+struct TStat {
+    std::vector<uint32_t> Latencies; // microseconds
+    uint64_t Timeouts = 0;
+};
+
+template<typename TSocket>
+TFuture<void> caller(TRpcClient<TSocket>& client, int& left, TStat& stat, const TOptions& options) {
+    std::string payload(options.Size, 'x');
+    while (left > 0) {
+        left--;
+        auto start = TClock::now();
+        auto deadline = options.TimeoutMs ? start + std::chrono::milliseconds(options.TimeoutMs) : TTime::max();
+        try {
+            auto response = co_await client.Call(1, payload, deadline);
+            auto latency = std::chrono::duration_cast<std::chrono::microseconds>(TClock::now() - start);
+            stat.Latencies.push_back(latency.count());
+        } catch (const std::system_error& ) {
+            stat.Timeouts++;
+        }
+    }
+    co_return;
+}
+
+template<typename TPoller>
+void run(const TOptions& options) {
+    using TSocket = typename TPoller::TSocket;
+    TLoop<TPoller> loop;
+
+    TRpcHandlers handlers;
+    handlers[1] = [&](const TRpcRequest& request) -> TFuture<std::string> {
+        if (options.DelayUs) {
+            co_await loop.Poller().Sleep(std::chrono::microseconds(options.DelayUs));
+        }
+        co_return request.Payload;
+    };
+    TSocket listener(TAddress{"127.0.0.1", options.Port}, loop.Poller());
+    listener.Bind();
+    listener.Listen();
+    TRpcServer<TSocket> server(listener, handlers);
+    auto serving = server.Serve();
+
+    std::vector<std::unique_ptr<TSocket>> sockets;
+    std::vector<std::unique_ptr<TRpcClient<TSocket>>> clients;
+    for (int i = 0; i < options.Connections; i++) {
+        sockets.emplace_back(std::make_unique<TSocket>(TAddress{"127.0.0.1", options.Port}, loop.Poller()));
+        TFuture<void> connect = [](TSocket& socket) -> TFuture<void> {
+            co_await socket.Connect(TClock::now() + std::chrono::seconds(5));
+        }(*sockets.back());
+        while (!connect.done()) {
+            loop.Step();
+        }
+        connect.await_resume();
+        clients.emplace_back(std::make_unique<TRpcClient<TSocket>>(*sockets.back()));
+    }
+
+    int left = options.Requests;
+    TStat stat;
+    std::vector<TFuture<void>> futures;
+    auto start = TClock::now();
+    for (int i = 0; i < options.Callers; i++) {
+        futures.emplace_back(caller(*clients[i % clients.size()], left, stat, options));
+    }
+    while (!std::all_of(futures.begin(), futures.end(), [](auto& f) { return f.done(); })) {
+        loop.Step();
+    }
+    for (auto& f : futures) {
+        f.await_resume(); // rethrows connection errors
+    }
+    auto elapsed = std::chrono::duration_cast<std::chrono::duration<double>>(TClock::now() - start).count();
+
+    auto& l = stat.Latencies;
+    std::sort(l.begin(), l.end());
+    auto percentile = [&](double p) -> uint32_t {
+        return l.empty() ? 0 : l[std::min(l.size() - 1, static_cast<size_t>(p * l.size()))];
+    };
+    std::cout << options.Callers << " callers over " << options.Connections << " connections\n";
+    std::cout << "Requests/sec: " << static_cast<uint64_t>(l.size() / elapsed) << "\n";
+    std::cout << "  Latency (us): p50: " << percentile(0.5)
+              << ", p90: " << percentile(0.9)
+              << ", p99: " << percentile(0.99)
+              << ", p99.9: " << percentile(0.999)
+              << ", max: " << (l.empty() ? 0 : l.back()) << "\n";
+    if (stat.Timeouts) {
+        std::cout << "  Timeouts: " << stat.Timeouts << "\n";
+    }
+}
+
+void usage(const char* name) {
+    std::cerr << name << " [--port 18100] [-n requests] [-c callers] [-k connections] [-s size] "
+              << "[-d handler_delay_us] [-t timeout_ms] [--method select|poll|epoll|uring|kqueue|iocp] [--help]" << std::endl;
+    std::exit(1);
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    TInitializer init;
+    TOptions options;
+    std::string method = "poll";
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "--port") && i < argc-1) {
+            options.Port = atoi(argv[++i]);
+        } else if (!strcmp(argv[i], "-n") && i < argc-1) {
+            options.Requests = atoi(argv[++i]);
+        } else if (!strcmp(argv[i], "-c") && i < argc-1) {
+            options.Callers = std::max(1, atoi(argv[++i]));
+        } else if (!strcmp(argv[i], "-k") && i < argc-1) {
+            options.Connections = std::max(1, atoi(argv[++i]));
+        } else if (!strcmp(argv[i], "-s") && i < argc-1) {
+            options.Size = atoi(argv[++i]);
+        } else if (!strcmp(argv[i], "-d") && i < argc-1) {
+            options.DelayUs = atoi(argv[++i]);
+        } else if (!strcmp(argv[i], "-t") && i < argc-1) {
+            options.TimeoutMs = atoi(argv[++i]);
+        } else if (!strcmp(argv[i], "--method") && i < argc-1) {
+            method = argv[++i];
+        } else {
+            usage(argv[0]);
+        }
+    }
+
+    if (method == "select") {
+        run<TSelect>(options);
+    }
+    else if (method == "poll") {
+        run<TPoll>(options);
+    }
+#ifdef HAVE_EPOLL
+    else if (method == "epoll") {
+        run<TEPoll>(options);
+    }
+#endif
+#ifdef HAVE_URING
+    else if (method == "uring") {
+        run<TUring>(options);
+    }
+#endif
+#ifdef HAVE_KQUEUE
+    else if (method == "kqueue") {
+        run<TKqueue>(options);
+    }
+#endif
+#ifdef HAVE_IOCP
+    else if (method == "iocp") {
+        run<TIOCp>(options);
+    }
+#endif
+    else {
+        std::cerr << "Unknown method: " << method << "\n";
+    }
+    return 0;
+}
@@ -0,0 +1,167 @@
+#include <algorithm>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+#include <coroio/all.hpp>
+
+using namespace NNet;
+
+// Round-trip latency of a ping-pong between two loops in two threads, with blocking loops
+// and with spinning ones (TPollerBase::SetSpin). A blocking loop sleeps in the kernel between
+// messages and pays for the wakeup of its thread every time, a spinning loop keeps polling
+// and burns its core instead.
+
+namespace {
+
+struct TOptions {
+    int Messages = 100000;
+    int Size = 64;
+    int Port = 8000;
+    std::chrono::microseconds Spin{1000};
+    std::chrono::microseconds BusyPoll{0};
+};
+
+template<typename TSocket>
+TFuture<void> pong(TSocket& listener, int size) {
+    auto client = co_await listener.Accept();
+    std::vector<char> buffer(size);
+    try {
+        while (true) {
+            co_await TByteReader(client).Read(buffer.data(), size);
+            co_await TByteWriter(client).Write(buffer.data(), size);
+        }
+    } catch (const std::exception& ) {
+        // the client has closed the connection
+    }
+    co_return;
+}
+
+template<typename TPoller>
+TFuture<void> ping(TPoller& poller, int port, const TOptions& options, std::vector<double>& latencies) {
+    typename TPoller::TSocket socket(TAddress{"127.0.0.1", port}, poller);
+    socket.SetOptions({.NoDelay = true});
+    co_await socket.Connect();
+    std::vector<char> buffer(options.Size, 'p');
+    for (int i = 0; i < options.Messages; i++) {
+        auto start = TClock::now();
+        co_await TByteWriter(socket).Write(buffer.data(), options.Size);
+        co_await TByteReader(socket).Read(buffer.data(), options.Size);
+        latencies.emplace_back(std::chrono::duration<double, std::micro>(TClock::now() - start).count());
+    }
+    co_return;
+}
+
+template<typename TPoller>
+void setup(TPoller& poller, std::chrono::microseconds spin, const TOptions& options) {
+    poller.SetSpin(spin);
+#ifdef __linux__
+    if constexpr (std::is_same_v<TPoller, TEPoll>) {
+        if (options.BusyPoll.count()) {
+            poller.SetBusyPoll(options.BusyPoll);
+        }
+    }
+#endif
+}
+
+template<typename TPoller>
+void bench(const char* name, std::chrono::microseconds spin, int port, const TOptions& options) {
+    TLoop<TPoller> serverLoop;
+    setup(serverLoop.Poller(), spin, options);
+    typename TPoller::TSocket listener(TAddress{"127.0.0.1", port}, serverLoop.Poller());
+    listener.SetOptions({.NoDelay = true});
+    listener.Bind();
+    listener.Listen();
+
+    TFuture<void> server = pong(listener, options.Size);
+    std::thread thread([&]() {
+        while (!server.done()) {
+            serverLoop.Step();
+        }
+    });
+
+    std::vector<double> latencies;
+    latencies.reserve(options.Messages);
+    {
+        TLoop<TPoller> loop;
+        setup(loop.Poller(), spin, options);
+        TFuture<void> client = ping(loop.Poller(), port, options, latencies);
+        while (!client.done()) {
+            loop.Step();
+        }
+        client.await_resume(); // rethrows errors
+    }
+    thread.join();
+
+    std::sort(latencies.begin(), latencies.end());
+    std::cout << name << "\t" << latencies[latencies.size() / 2]
+              << "\t" << latencies[latencies.size() * 99 / 100]
+              << "\t" << latencies[latencies.size() * 999 / 1000] << "\n";
+}
+
+template<typename TPoller>
+void run(const TOptions& options) {
+    if (std::thread::hardware_concurrency() < 2) {
+        std::cerr << "Warning: the two spinning loops share one CPU and preempt each other\n";
+    }
+    std::cout << "mode\tp50 us\tp99 us\tp99.9 us\n";
+    bench<TPoller>("blocking", std::chrono::microseconds(0), options.Port, options);
+    bench<TPoller>("spin", options.Spin, options.Port + 1, options);
+}
+
+void usage(const char* name) {
+    std::cerr << name << " [-n messages] [-s size] [--spin 1000 (us)] [--busy-poll 0 (us, epoll)] [--port 8000] "
+              << "[--method select|poll|epoll|uring|kqueue] [--help]" << std::endl;
+    std::exit(1);
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    TInitializer init;
+    TOptions options;
+    std::string method = "epoll";
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "-n") && i < argc-1) {
+            options.Messages = std::max(1, atoi(argv[++i]));
+        } else if (!strcmp(argv[i], "-s") && i < argc-1) {
+            options.Size = std::max(1, atoi(argv[++i]));
+        } else if (!strcmp(argv[i], "--spin") && i < argc-1) {
+            options.Spin = std::chrono::microseconds(std::max(1, atoi(argv[++i])));
+        } else if (!strcmp(argv[i], "--busy-poll") && i < argc-1) {
+            options.BusyPoll = std::chrono::microseconds(atoi(argv[++i]));
+        } else if (!strcmp(argv[i], "--port") && i < argc-1) {
+            options.Port = atoi(argv[++i]);
+        } else if (!strcmp(argv[i], "--method") && i < argc-1) {
+            method = argv[++i];
+        } else {
+            usage(argv[0]);
+        }
+    }
+
+    if (method == "select") {
+        run<TSelect>(options);
+    }
+    else if (method == "poll") {
+        run<TPoll>(options);
+    }
+#ifdef __linux__
+    else if (method == "epoll") {
+        run<TEPoll>(options);
+    }
+#endif
+#ifdef HAVE_URING
+    else if (method == "uring") {
+        run<TUring>(options);
+    }
+#endif
+#if defined(__APPLE__) || defined(__FreeBSD__)
+    else if (method == "kqueue") {
+        run<TKqueue>(options);
+    }
+#endif
+    else {
+        std::cerr << "Unknown method: " << method << "\n";
+    }
+    return 0;
+}
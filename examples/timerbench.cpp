@@ -0,0 +1,82 @@
+#include <algorithm>
+#include <chrono>
+#include <vector>
+
+#include <coroio/all.hpp>
+
+using namespace NNet;
+
+// Many coroutines sleeping in a loop on TUring, with the timers on the heap of TPollerBase
+// and with IORING_OP_TIMEOUT requests (TUring::SetKernelTimers). Lateness is the time from
+// the deadline to the resume of the sleeper.
+
+namespace {
+
+struct TOptions {
+    int Timers = 10000;
+    int Rounds = 10;
+    int MaxSleep = 10; // ms
+};
+
+TFuture<void> sleeper(TUring& poller, int seed, const TOptions& options, std::vector<double>& lateness) {
+    unsigned state = seed;
+    for (int i = 0; i < options.Rounds; i++) {
+        state = state * 1103515245 + 12345;
+        auto deadline = TClock::now() + std::chrono::microseconds((state >> 8) % (options.MaxSleep * 1000));
+        co_await poller.Sleep(deadline);
+        lateness.emplace_back(std::chrono::duration<double, std::micro>(TClock::now() - deadline).count());
+    }
+    co_return;
+}
+
+void bench(const char* name, bool kernelTimers, const TOptions& options) {
+    TLoop<TUring> loop;
+    loop.Poller().SetKernelTimers(kernelTimers);
+    std::vector<double> lateness;
+    lateness.reserve(options.Timers * options.Rounds);
+    std::vector<TFuture<void>> futures;
+    auto start = TClock::now();
+    for (int i = 0; i < options.Timers; i++) {
+        futures.emplace_back(sleeper(loop.Poller(), i, options, lateness));
+    }
+    TFuture<void> all = All(std::move(futures));
+    while (!all.done()) {
+        loop.Step();
+    }
+    auto elapsed = std::chrono::duration<double>(TClock::now() - start).count();
+
+    auto& stats = loop.Poller().Stats();
+    std::sort(lateness.begin(), lateness.end());
+    std::cout << name << "\t" << static_cast<uint64_t>(lateness.size() / elapsed)
+              << "\t" << lateness[lateness.size() / 2]
+              << "\t" << lateness[lateness.size() * 99 / 100]
+              << "\t" << static_cast<double>(stats.Enters) / std::max<uint64_t>(stats.Iterations, 1) << "\n";
+}
+
+void usage(const char* name) {
+    std::cerr << name << " [-n timers] [-r rounds] [--max-sleep 10 (ms)] [--help]" << std::endl;
+    std::exit(1);
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    TInitializer init;
+    TOptions options;
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "-n") && i < argc-1) {
+            options.Timers = std::max(1, atoi(argv[++i]));
+        } else if (!strcmp(argv[i], "-r") && i < argc-1) {
+            options.Rounds = std::max(1, atoi(argv[++i]));
+        } else if (!strcmp(argv[i], "--max-sleep") && i < argc-1) {
+            options.MaxSleep = std::max(1, atoi(argv[++i]));
+        } else {
+            usage(argv[0]);
+        }
+    }
+
+    std::cout << "timers\tsleeps/s\tlate p50 us\tlate p99 us\tsyscalls/iteration\n";
+    bench("heap", false, options);
+    bench("kernel", true, options);
+    return 0;
+}
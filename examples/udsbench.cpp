@@ -0,0 +1,137 @@
+#include <algorithm>
+#include <chrono>
+#include <vector>
+
+#include <coroio/all.hpp>
+
+using namespace NNet;
+
+// Round-trip latency of a ping-pong between two sockets of one loop, over a Unix socket and
+// over TCP loopback. The difference is the cost of the TCP/IP stack on the local path,
+// which is what sidecars save by listening on a Unix socket.
+
+namespace {
+
+struct TOptions {
+    int Messages = 100000;
+    int Size = 64;
+    std::string Path = "/tmp/udsbench.sock";
+    int Port = 8000;
+};
+
+template<typename TSocket>
+TFuture<void> pong(TSocket& listener, int size) {
+    auto client = co_await listener.Accept();
+    std::vector<char> buffer(size);
+    try {
+        while (true) {
+            co_await TByteReader(client).Read(buffer.data(), size);
+            co_await TByteWriter(client).Write(buffer.data(), size);
+        }
+    } catch (const std::exception& ) {
+        // the client has closed the connection
+    }
+    co_return;
+}
+
+template<typename TPoller>
+TFuture<void> ping(TPoller& poller, TAddress address, const TOptions& options, std::vector<double>& latencies) {
+    typename TPoller::TSocket socket(std::move(address), poller);
+    co_await socket.Connect();
+    std::vector<char> buffer(options.Size, 'p');
+    for (int i = 0; i < options.Messages; i++) {
+        auto start = TClock::now();
+        co_await TByteWriter(socket).Write(buffer.data(), options.Size);
+        co_await TByteReader(socket).Read(buffer.data(), options.Size);
+        latencies.emplace_back(std::chrono::duration<double, std::micro>(TClock::now() - start).count());
+    }
+    co_return;
+}
+
+template<typename TPoller>
+void bench(const char* name, TAddress address, const TOptions& options) {
+    TLoop<TPoller> loop;
+    typename TPoller::TSocket listener(address, loop.Poller());
+    listener.Bind();
+    listener.Listen();
+
+    std::vector<double> latencies;
+    latencies.reserve(options.Messages);
+    TFuture<void> server = pong(listener, options.Size);
+    auto start = TClock::now();
+    TFuture<void> client = ping(loop.Poller(), address, options, latencies);
+    while (!client.done()) {
+        loop.Step();
+    }
+    client.await_resume(); // rethrows errors
+    auto elapsed = std::chrono::duration<double>(TClock::now() - start).count();
+
+    std::sort(latencies.begin(), latencies.end());
+    std::cout << name << "\t" << static_cast<uint64_t>(options.Messages / elapsed)
+              << "\t" << latencies[latencies.size() / 2]
+              << "\t" << latencies[latencies.size() * 99 / 100] << "\n";
+}
+
+template<typename TPoller>
+void run(const TOptions& options) {
+    std::cout << "socket\tround trips/s\tp50 us\tp99 us\n";
+    ::unlink(options.Path.c_str());
+    bench<TPoller>("unix", TAddress::Unix(options.Path), options);
+    ::unlink(options.Path.c_str());
+    bench<TPoller>("tcp", TAddress{"127.0.0.1", options.Port}, options);
+}
+
+void usage(const char* name) {
+    std::cerr << name << " [-n messages] [-s size] [--path /tmp/udsbench.sock (@name for abstract)] [--port 8000] "
+              << "[--method select|poll|epoll|uring|kqueue] [--help]" << std::endl;
+    std::exit(1);
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    TInitializer init;
+    TOptions options;
+    std::string method = "epoll";
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "-n") && i < argc-1) {
+            options.Messages = std::max(1, atoi(argv[++i]));
+        } else if (!strcmp(argv[i], "-s") && i < argc-1) {
+            options.Size = std::max(1, atoi(argv[++i]));
+        } else if (!strcmp(argv[i], "--path") && i < argc-1) {
+            options.Path = argv[++i];
+        } else if (!strcmp(argv[i], "--port") && i < argc-1) {
+            options.Port = atoi(argv[++i]);
+        } else if (!strcmp(argv[i], "--method") && i < argc-1) {
+            method = argv[++i];
+        } else {
+            usage(argv[0]);
+        }
+    }
+
+    if (method == "select") {
+        run<TSelect>(options);
+    }
+    else if (method == "poll") {
+        run<TPoll>(options);
+    }
+#ifdef __linux__
+    else if (method == "epoll") {
+        run<TEPoll>(options);
+    }
+#endif
+#ifdef HAVE_URING
+    else if (method == "uring") {
+        run<TUring>(options);
+    }
+#endif
+#if defined(__APPLE__) || defined(__FreeBSD__)
+    else if (method == "kqueue") {
+        run<TKqueue>(options);
+    }
+#endif
+    else {
+        std::cerr << "Unknown method: " << method << "\n";
+    }
+    return 0;
+}
@@ -0,0 +1,182 @@
+#include <algorithm>
+#include <chrono>
+#include <vector>
+
+#include <dirent.h>
+#include <stdlib.h>
+
+#include <coroio/all.hpp>
+#include <coroio/wal/wal.hpp>
+
+using namespace NNet;
+
+// Durable appends/s of TWal against the number of concurrent appenders. Records/fsync shows
+// how well group commit amortizes the fdatasync: with one appender every record pays for
+// its own sync, with many appenders a sync covers everything appended while the previous
+// one was in flight. Readiness pollers run the file IO on TFileIoPool, uring natively.
+
+namespace {
+
+struct TOptions {
+    std::string Dir = "/tmp";
+    int Records = 20000;
+    int RecordSize = 100;
+    int MaxAppenders = 256;
+    int Threads = 4;
+    uint64_t SegmentSize = 64 * 1024 * 1024;
+    std::chrono::microseconds CommitDelay{0};
+};
+
+template<typename TBackend>
+TFuture<void> appender(TWal<TBackend>& wal, int& left, const std::string& record, std::vector<double>& latencies) {
+    while (left > 0) {
+        left--;
+        auto start = TClock::now();
+        co_await wal.Append(record);
+        latencies.emplace_back(std::chrono::duration<double, std::micro>(TClock::now() - start).count());
+    }
+    co_return;
+}
+
+template<typename TPoller>
+void wait(TLoop<TPoller>& loop, TFuture<void>& future) {
+    while (!future.done()) {
+        loop.Step();
+    }
+    future.await_resume(); // rethrows errors
+}
+
+template<typename TPoller, typename TBackend>
+void bench(TLoop<TPoller>& loop, TBackend& backend, const TOptions& options, const std::string& dir) {
+    std::string record(options.RecordSize, 'r');
+    uint64_t nextLsn = 0;
+
+    std::cout << "appenders\tcommits/s\trecords/fsync\tMB/s\tp50 us\tp99 us\n";
+    for (int appenders = 1; appenders <= options.MaxAppenders; appenders *= 2) {
+        TWal<TBackend> wal(backend, dir, TWalOptions{.SegmentSize = options.SegmentSize, .CommitDelay = options.CommitDelay});
+        TFuture<void> open = wal.Open(nextLsn);
+        wait(loop, open);
+
+        int left = options.Records;
+        std::vector<double> latencies;
+        latencies.reserve(options.Records);
+        std::vector<TFuture<void>> futures;
+        auto start = TClock::now();
+        for (int i = 0; i < appenders; i++) {
+            futures.emplace_back(appender(wal, left, record, latencies));
+        }
+        TFuture<void> all = All(std::move(futures));
+        wait(loop, all);
+        auto elapsed = std::chrono::duration<double>(TClock::now() - start).count();
+
+        TFuture<void> close = wal.Close();
+        wait(loop, close);
+        nextLsn = wal.DurableLsn();
+
+        std::sort(latencies.begin(), latencies.end());
+        auto& stats = wal.Stats();
+        std::cout << appenders << "\t" << static_cast<uint64_t>(stats.Records / elapsed)
+                  << "\t" << static_cast<double>(stats.Records) / std::max<uint64_t>(stats.Groups, 1)
+                  << "\t" << stats.Bytes / elapsed / 1e6
+                  << "\t" << latencies[latencies.size() / 2]
+                  << "\t" << latencies[latencies.size() * 99 / 100] << "\n";
+    }
+}
+
+void remove_segments(const std::string& dir) {
+    DIR* d = opendir(dir.c_str());
+    if (!d) {
+        return;
+    }
+    while (auto* entry = readdir(d)) {
+        if (entry->d_name[0] != '.') {
+            unlink((dir + "/" + entry->d_name).c_str());
+        }
+    }
+    closedir(d);
+    rmdir(dir.c_str());
+}
+
+template<typename TPoller>
+void run(const TOptions& options) {
+    std::string dir = options.Dir + "/walbench_XXXXXX";
+    if (!mkdtemp(dir.data())) {
+        throw std::system_error(errno, std::generic_category(), dir);
+    }
+    TLoop<TPoller> loop;
+    try {
+#ifdef HAVE_URING
+        if constexpr (std::is_same_v<TPoller, TUring>) {
+            bench(loop, loop.Poller(), options, dir);
+        } else
+#endif
+        {
+            TFileIoPool pool(loop.Poller(), options.Threads);
+            bench(loop, pool, options, dir);
+        }
+    } catch (const std::exception& ex) {
+        std::cerr << "Error: " << ex.what() << "\n";
+    }
+    remove_segments(dir);
+}
+
+void usage(const char* name) {
+    std::cerr << name << " [--dir /tmp] [-n records] [-s record_size] [-c max_appenders] [--threads 4] "
+              << "[--segment 64 (MB)] [--delay 0 (us)] [--method select|poll|epoll|uring|kqueue] [--help]" << std::endl;
+    std::exit(1);
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    TInitializer init;
+    TOptions options;
+    std::string method = "epoll";
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "--dir") && i < argc-1) {
+            options.Dir = argv[++i];
+        } else if (!strcmp(argv[i], "-n") && i < argc-1) {
+            options.Records = std::max(1, atoi(argv[++i]));
+        } else if (!strcmp(argv[i], "-s") && i < argc-1) {
+            options.RecordSize = atoi(argv[++i]);
+        } else if (!strcmp(argv[i], "-c") && i < argc-1) {
+            options.MaxAppenders = std::max(1, atoi(argv[++i]));
+        } else if (!strcmp(argv[i], "--threads") && i < argc-1) {
+            options.Threads = std::max(1, atoi(argv[++i]));
+        } else if (!strcmp(argv[i], "--segment") && i < argc-1) {
+            options.SegmentSize = std::max(1, atoi(argv[++i])) * 1024ULL * 1024;
+        } else if (!strcmp(argv[i], "--delay") && i < argc-1) {
+            options.CommitDelay = std::chrono::microseconds(atoi(argv[++i]));
+        } else if (!strcmp(argv[i], "--method") && i < argc-1) {
+            method = argv[++i];
+        } else {
+            usage(argv[0]);
+        }
+    }
+
+    if (method == "select") {
+        run<TSelect>(options);
+    }
+    else if (method == "poll") {
+        run<TPoll>(options);
+    }
+#ifdef HAVE_EPOLL
+    else if (method == "epoll") {
+        run<TEPoll>(options);
+    }
+#endif
+#ifdef HAVE_URING
+    else if (method == "uring") {
+        run<TUring>(options);
+    }
+#endif
+#ifdef HAVE_KQUEUE
+    else if (method == "kqueue") {
+        run<TKqueue>(options);
+    }
+#endif
+    else {
+        std::cerr << "Unknown method: " << method << "\n";
+    }
+    return 0;
+}
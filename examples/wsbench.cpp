@@ -0,0 +1,199 @@
+#if defined(__APPLE__)
+#define _DARWIN_UNLIMITED_SELECT
+#endif
+
+#include <algorithm>
+#include <chrono>
+#include <memory>
+#include <vector>
+
+#ifndef _WIN32
+#include <sys/resource.h>
+#endif
+
+#include <coroio/all.hpp>
+#include <coroio/ws/websocket.hpp>
+
+using namespace NNet;
+
+// Broadcast throughput: one coroutine sends every message to all server endpoints,
+// each client endpoint receives them over its own socketpair
+
+namespace {
+
+struct TOptions {
+    int Connections = 100000;
+    int Messages = 10;
+    int Size = 64;
+};
+
+template<typename TSocket>
+struct TPair {
+    TPair(int fds[2], typename TSocket::TPoller& poller, TWsOptions options)
+        : ServerSocket(TAddress{}, fds[0], poller)
+        , ClientSocket(TAddress{}, fds[1], poller)
+        , Server(ServerSocket, false, options)
+        , Client(ClientSocket, true, options)
+    { }
+
+    TSocket ServerSocket;
+    TSocket ClientSocket;
+    TWebSocket<TSocket> Server;
+    TWebSocket<TSocket> Client;
+};
+
+template<typename TSocket>
+TFuture<void> handshake(TPair<TSocket>& pair) {
+    auto accept = pair.Server.Accept();
+    co_await pair.Client.Connect("localhost", "/feed");
+    co_await accept;
+    co_return;
+}
+
+template<typename TSocket>
+TFuture<void> receiver(TWebSocket<TSocket>& ws, int messages, uint64_t& received, uint64_t& bytes) {
+    for (int i = 0; i < messages; i++) {
+        auto message = co_await ws.Receive();
+        received++;
+        bytes += message.Payload.size();
+    }
+    co_return;
+}
+
+template<typename TSocket>
+TFuture<void> broadcaster(std::vector<std::unique_ptr<TPair<TSocket>>>& pairs, const TOptions& options) {
+    std::string payload(options.Size, 'x');
+    for (int i = 0; i < options.Messages; i++) {
+        for (auto& pair : pairs) {
+            co_await pair->Server.Send(payload, EWsOpcode::Binary);
+        }
+    }
+    co_return;
+}
+
+template<typename TPoller>
+void run(const TOptions& options) {
+    using TSocket = typename TPoller::TSocket;
+    TLoop<TPoller> loop;
+
+    TWsOptions wsOptions;
+    wsOptions.ReadChunk = 1024;
+    std::vector<std::unique_ptr<TPair<TSocket>>> pairs;
+    pairs.reserve(options.Connections);
+    for (int i = 0; i < options.Connections; i++) {
+        int fds[2];
+#ifdef _WIN32
+        if (socketpair(AF_INET, SOCK_STREAM, 0, fds) < 0) {
+#else
+        if (socketpair(AF_UNIX, SOCK_STREAM, 0, fds) < 0) {
+#endif
+            throw std::system_error(errno, std::generic_category(), "socketpair");
+        }
+        pairs.emplace_back(std::make_unique<TPair<TSocket>>(fds, loop.Poller(), wsOptions));
+    }
+
+    auto t0 = TClock::now();
+    std::vector<TFuture<void>> handshakes;
+    for (auto& pair : pairs) {
+        handshakes.emplace_back(handshake(*pair));
+    }
+    while (!std::all_of(handshakes.begin(), handshakes.end(), [](auto& f) { return f.done(); })) {
+        loop.Step();
+    }
+    for (auto& h : handshakes) {
+        h.await_resume(); // rethrows handshake errors
+    }
+
+    auto t1 = TClock::now();
+    uint64_t received = 0, bytes = 0;
+    std::vector<TFuture<void>> receivers;
+    for (auto& pair : pairs) {
+        receivers.emplace_back(receiver(pair->Client, options.Messages, received, bytes));
+    }
+    auto sender = broadcaster(pairs, options);
+    while (!sender.done() || !std::all_of(receivers.begin(), receivers.end(), [](auto& f) { return f.done(); })) {
+        loop.Step();
+    }
+    auto t2 = TClock::now();
+
+    auto seconds = [](auto d) { return std::chrono::duration_cast<std::chrono::duration<double>>(d).count(); };
+    std::cout << options.Connections << " connections, handshakes: " << seconds(t1 - t0) << "s\n";
+    std::cout << received << " messages of " << options.Size << " bytes in " << seconds(t2 - t1) << "s\n";
+    std::cout << "Messages/sec: " << received / seconds(t2 - t1) << "\n";
+    std::cout << "Payload MB/sec: " << bytes / (1024.0 * 1024.0) / seconds(t2 - t1) << "\n";
+}
+
+void raise_fd_limit(int connections) {
+#ifndef _WIN32
+    rlimit limit;
+    if (getrlimit(RLIMIT_NOFILE, &limit) == 0) {
+        rlim_t need = 2 * static_cast<rlim_t>(connections) + 64;
+        if (limit.rlim_cur < need) {
+            limit.rlim_cur = std::min(need, limit.rlim_max);
+            setrlimit(RLIMIT_NOFILE, &limit);
+        }
+        if (limit.rlim_cur < need) {
+            std::cerr << "Warning: open files limit " << limit.rlim_cur << " is below " << need << "\n";
+        }
+    }
+#endif
+}
+
+void usage(const char* name) {
+    std::cerr << name << " [-n connections] [-m messages] [-s size] "
+              << "[--method select|poll|epoll|uring|kqueue|iocp] [--help]" << std::endl;
+    std::exit(1);
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    TInitializer init;
+    TOptions options;
+    std::string method = "poll";
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "-n") && i < argc-1) {
+            options.Connections = atoi(argv[++i]);
+        } else if (!strcmp(argv[i], "-m") && i < argc-1) {
+            options.Messages = atoi(argv[++i]);
+        } else if (!strcmp(argv[i], "-s") && i < argc-1) {
+            options.Size = atoi(argv[++i]);
+        } else if (!strcmp(argv[i], "--method") && i < argc-1) {
+            method = argv[++i];
+        } else {
+            usage(argv[0]);
+        }
+    }
+    raise_fd_limit(options.Connections);
+
+    if (method == "select") {
+        run<TSelect>(options);
+    }
+    else if (method == "poll") {
+        run<TPoll>(options);
+    }
+#ifdef HAVE_EPOLL
+    else if (method == "epoll") {
+        run<TEPoll>(options);
+    }
+#endif
+#ifdef HAVE_URING
+    else if (method == "uring") {
+        run<TUring>(options);
+    }
+#endif
+#ifdef HAVE_KQUEUE
+    else if (method == "kqueue") {
+        run<TKqueue>(options);
+    }
+#endif
+#ifdef HAVE_IOCP
+    else if (method == "iocp") {
+        run<TIOCp>(options);
+    }
+#endif
+    else {
+        std::cerr << "Unknown method: " << method << "\n";
+    }
+    return 0;
+}
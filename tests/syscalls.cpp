@@ -0,0 +1,132 @@
+// Counts the syscalls made to set up sockets. fcntl, getsockopt and setsockopt are
+// interposed for the whole binary, so this test lives apart from ut_tests.
+#include <atomic>
+#include <stdarg.h>
+#include <stddef.h>
+#include <setjmp.h>
+
+#include <dlfcn.h>
+#include <netinet/tcp.h>
+
+#include <coroio/all.hpp>
+
+extern "C" {
+#include <cmocka.h>
+}
+
+namespace {
+
+// calls of the syscalls that used to set up every socket
+std::atomic<int> setupSyscalls = 0;
+
+template<typename TFunc>
+TFunc* next(const char* name) {
+    return reinterpret_cast<TFunc*>(dlsym(RTLD_NEXT, name));
+}
+
+} // namespace
+
+// interposed to count the calls, they forward to libc
+extern "C" int fcntl(int fd, int cmd, ...) {
+    static auto real = next<int(int, int, ...)>("fcntl");
+    setupSyscalls++;
+    va_list args;
+    va_start(args, cmd);
+    int ret;
+    switch (cmd) {
+    case F_GETFD:
+    case F_GETFL:
+    case F_GETOWN:
+        ret = real(fd, cmd);
+        break;
+    case F_GETLK:
+    case F_SETLK:
+    case F_SETLKW:
+        ret = real(fd, cmd, va_arg(args, void*));
+        break;
+    default:
+        // the rest of the commands used here take an int
+        ret = real(fd, cmd, va_arg(args, int));
+        break;
+    }
+    va_end(args);
+    return ret;
+}
+
+extern "C" int setsockopt(int fd, int level, int name, const void* value, socklen_t len) noexcept {
+    static auto real = next<int(int, int, int, const void*, socklen_t)>("setsockopt");
+    setupSyscalls++;
+    return real(fd, level, name, value, len);
+}
+
+extern "C" int getsockopt(int fd, int level, int name, void* value, socklen_t* len) noexcept {
+    static auto real = next<int(int, int, int, void*, socklen_t*)>("getsockopt");
+    setupSyscalls++;
+    return real(fd, level, name, value, len);
+}
+
+using namespace NNet;
+
+template<typename TPoller>
+void test_socket_setup_syscalls(void**) {
+    using TSocket = typename TPoller::TSocket;
+    TLoop<TPoller> loop;
+    TSocket socket(TAddress{"127.0.0.1", 0}, loop.Poller());
+    socket.SetOptions({.KeepAlive = true, .NoDelay = true});
+    socket.Bind();
+    socket.Listen();
+    sockaddr_in bound = {};
+    socklen_t boundLen = sizeof(bound);
+    assert_int_equal(getsockname(socket.Fd(), reinterpret_cast<sockaddr*>(&bound), &boundLen), 0);
+    int port = ntohs(bound.sin_port);
+
+    int before = setupSyscalls;
+    TSocket client(TAddress{"127.0.0.1", port}, loop.Poller());
+    TSocket accepted;
+    TFuture<void> h1 = [](TSocket* client) -> TFuture<void> {
+        co_await client->Connect();
+    }(&client);
+    TFuture<void> h2 = [](TSocket* socket, TSocket* accepted) -> TFuture<void> {
+        *accepted = co_await socket->Accept();
+    }(&socket, &accepted);
+    while (!(h1.done() && h2.done())) {
+        loop.Step();
+    }
+    // socket and accept4 set the flags, no options are applied by default
+    assert_int_equal(setupSyscalls - before, 0);
+
+    for (int fd : {client.Fd(), accepted.Fd()}) {
+        assert_true(fcntl(fd, F_GETFL) & O_NONBLOCK);
+        assert_true(fcntl(fd, F_GETFD) & FD_CLOEXEC);
+    }
+    // the options of the listener are inherited
+    int value = 0;
+    socklen_t len = sizeof(value);
+    assert_int_equal(getsockopt(accepted.Fd(), IPPROTO_TCP, TCP_NODELAY, &value, &len), 0);
+    assert_int_not_equal(value, 0);
+    assert_int_equal(getsockopt(accepted.Fd(), SOL_SOCKET, SO_KEEPALIVE, &value, &len), 0);
+    assert_int_not_equal(value, 0);
+    assert_int_equal(getsockopt(client.Fd(), SOL_SOCKET, SO_KEEPALIVE, &value, &len), 0);
+    assert_int_equal(value, 0);
+
+    before = setupSyscalls;
+    client.SetOptions({.NoDelay = true, .SendBuffer = 64 * 1024, .UserTimeout = std::chrono::seconds(5)});
+    assert_int_equal(setupSyscalls - before, 3);
+    assert_int_equal(getsockopt(client.Fd(), IPPROTO_TCP, TCP_USER_TIMEOUT, &value, &len), 0);
+    assert_int_equal(value, 5000);
+}
+
+#define my_unit_test4(f, a, b, c, d) \
+    { #f "(" #a ")", f<a>, NULL, NULL, NULL }, \
+    { #f "(" #b ")", f<b>, NULL, NULL, NULL }, \
+    { #f "(" #c ")", f<c>, NULL, NULL, NULL }, \
+    { #f "(" #d ")", f<d>, NULL, NULL, NULL }
+
+int main() {
+    TInitializer init;
+
+    const struct CMUnitTest tests[] = {
+        my_unit_test4(test_socket_setup_syscalls, TSelect, TPoll, TEPoll, TUring),
+    };
+    return cmocka_run_group_tests(tests, NULL, NULL);
+}
@@ -6,8 +6,21 @@
 #include <stddef.h>
 #include <setjmp.h>
 #include <signal.h>
+#ifndef _WIN32
+#include <dirent.h>
+#endif
+#ifdef __linux__
+#include <netinet/tcp.h>
+#endif
 
 #include <coroio/all.hpp>
+#include <coroio/http/client.hpp>
+#include <coroio/http/server.hpp>
+#include <coroio/memcached/client.hpp>
+#include <coroio/redis/client.hpp>
+#include <coroio/rpc/rpc.hpp>
+#include <coroio/ws/websocket.hpp>
+#include <coroio/wal/wal.hpp>
 
 extern "C" {
 #include <cmocka.h>
@@ -89,6 +102,37 @@ void test_addr6(void**) {
     assert_true(low.sin6_family == AF_INET6);
 }
 
+#ifndef _WIN32
+void test_unix_address(void**) {
+    TAddress path = TAddress::Unix("/tmp/coroio.sock");
+    assert_int_equal(path.Domain(), PF_UNIX);
+    assert_string_equal(path.ToString().c_str(), "/tmp/coroio.sock");
+    auto un = std::get<sockaddr_un>(path.Addr());
+    assert_int_equal(un.sun_family, AF_UNIX);
+    assert_string_equal(un.sun_path, "/tmp/coroio.sock");
+    assert_true(path == TAddress::Unix("/tmp/coroio.sock"));
+    assert_false(path == TAddress::Unix("/tmp/coroio2.sock"));
+
+    TAddress abstract = TAddress::Unix("@coroio");
+    assert_string_equal(abstract.ToString().c_str(), "@coroio");
+    assert_int_equal(std::get<sockaddr_un>(abstract.Addr()).sun_path[0], 0);
+    // the abstract name is not a path
+    assert_false(abstract == TAddress::Unix("coroio"));
+
+    auto [addr, len] = abstract.RawAddr();
+    TAddress copy(const_cast<sockaddr*>(addr), len);
+    assert_true(copy == abstract);
+
+    int flag = 0;
+    try {
+        TAddress::Unix(std::string(sizeof(sockaddr_un::sun_path), 'x'));
+    } catch (const std::exception& ) {
+        flag = 1;
+    }
+    assert_int_equal(flag, 1);
+}
+#endif
+
 void test_bad_addr(void**) {
     int port = getport();
     int flag = 0;
@@ -151,6 +195,139 @@ void test_accept(void**) {
     assert_memory_equal(&addr1, &addr2, 4);
 }
 
+template<typename TPoller>
+void test_accept_batch(void**) {
+    int port = getport();
+    using TSocket = typename TPoller::TSocket;
+    TLoop<TPoller> loop;
+    TSocket socket(TAddress{"127.0.0.1", port}, loop.Poller());
+    socket.Bind();
+    socket.Listen();
+
+    const int clients = 10;
+    std::vector<TSocket> connected;
+    TFuture<void> h1 = [](TPoller& poller, int port, std::vector<TSocket>* connected) -> TFuture<void> {
+        for (int i = 0; i < clients; i++) {
+            TSocket client(TAddress{"127.0.0.1", port}, poller);
+            co_await client.Connect();
+            connected->emplace_back(std::move(client));
+        }
+        co_return;
+    }(loop.Poller(), port, &connected);
+
+    while (!h1.done()) {
+        loop.Step();
+    }
+
+    // the whole backlog is pending, every batch but the last one is full
+    std::vector<size_t> batches;
+    std::vector<TSocket> accepted;
+    TFuture<void> h2 = [](TSocket* socket, std::vector<size_t>* batches, std::vector<TSocket>* accepted) -> TFuture<void> {
+        while (accepted->size() < clients) {
+            auto batch = co_await socket->AcceptBatch(4);
+            if (batch.empty()) {
+                continue;
+            }
+            batches->push_back(batch.size());
+            for (auto& client : batch) {
+                accepted->emplace_back(std::move(client));
+            }
+        }
+        co_return;
+    }(&socket, &batches, &accepted);
+
+    while (!h2.done()) {
+        loop.Step();
+    }
+
+    assert_int_equal(accepted.size(), clients);
+    assert_int_equal(batches.size(), 3);
+    assert_int_equal(batches[0], 4);
+    assert_int_equal(batches[1], 4);
+    assert_int_equal(batches[2], 2);
+#ifndef _WIN32
+    for (auto& client : accepted) {
+        assert_true(fcntl(client.Fd(), F_GETFL) & O_NONBLOCK);
+    }
+#endif
+}
+
+#ifdef __linux__
+template<typename TPoller>
+void test_fast_open(void**) {
+    int port = getport();
+    using TSocket = typename TPoller::TSocket;
+    TLoop<TPoller> loop;
+    TSocket socket(TAddress{"127.0.0.1", port}, loop.Poller());
+    socket.SetOptions({.FastOpen = 16});
+    socket.Bind();
+    socket.Listen();
+
+    TFuture<void> server = [](TSocket* socket) -> TFuture<void> {
+        for (int i = 0; i < 2; i++) {
+            auto client = co_await socket->Accept();
+            char buf[64];
+            ssize_t size;
+            do {
+                size = co_await client.ReadSome(buf, sizeof(buf));
+            } while (size < 0);
+            co_await TByteWriter(client).Write(buf, size);
+        }
+    }(&socket);
+
+    // the first connection gets the cookie, the second one may carry the request in the SYN
+    // where the kernel accepts Fast Open on the server side (net.ipv4.tcp_fastopen & 2)
+    std::vector<std::string> replies;
+    std::vector<ssize_t> sent;
+    TFuture<void> clients = [](TPoller& poller, int port, std::vector<std::string>* replies, std::vector<ssize_t>* sent) -> TFuture<void> {
+        std::string request = "request";
+        for (int i = 0; i < 2; i++) {
+            TSocket client(TAddress{"127.0.0.1", port}, poller);
+            client.SetOptions({.NoDelay = true, .Cork = false, .IncomingCpu = 0});
+            auto size = co_await client.Connect(request.data(), request.size());
+            sent->push_back(size);
+            if (size < static_cast<ssize_t>(request.size())) {
+                co_await TByteWriter(client).Write(request.data() + size, request.size() - size);
+            }
+            std::string reply(request.size(), 0);
+            co_await TByteReader(client).Read(reply.data(), reply.size());
+            replies->push_back(reply);
+        }
+    }(loop.Poller(), port, &replies, &sent);
+
+    while (!(server.done() && clients.done())) {
+        loop.Step();
+    }
+    assert_int_equal(replies.size(), 2);
+    for (int i = 0; i < 2; i++) {
+        assert_string_equal(replies[i].c_str(), "request");
+        assert_true(sent[i] >= 0 && sent[i] <= 7);
+    }
+
+    // a closed port: the error comes from the connect, not from the first read
+    int errorCode = 0;
+    TFuture<void> refused = [](TPoller& poller, int port, int* errorCode) -> TFuture<void> {
+        TSocket client(TAddress{"127.0.0.1", port}, poller);
+        try {
+            co_await client.Connect("request", 7);
+        } catch (const std::system_error& ex) {
+            *errorCode = ex.code().value();
+        }
+    }(loop.Poller(), getport(), &errorCode);
+    while (!refused.done()) {
+        loop.Step();
+    }
+    assert_int_equal(errorCode, ECONNREFUSED);
+
+    TSocket corked(TAddress{"127.0.0.1", port}, loop.Poller());
+    corked.SetOptions({.Cork = true});
+    int value = 0;
+    socklen_t len = sizeof(value);
+    assert_int_equal(getsockopt(corked.Fd(), IPPROTO_TCP, TCP_CORK, &value, &len), 0);
+    assert_int_equal(value, 1);
+}
+#endif
+
 template<typename TPoller>
 void test_write_after_connect(void**) {
     using TLoop = TLoop<TPoller>;
@@ -289,6 +466,147 @@ void test_read_write_same_socket(void**) {
     assert_string_equal(buf2, "Hello from server");
 }
 
+template<typename TPoller>
+void test_read_write_same_wakeup(void**) {
+    using TLoop = TLoop<TPoller>;
+    using TSocket = typename TPoller::TSocket;
+    int port = getport();
+    TLoop loop;
+    TSocket socket(TAddress{"127.0.0.1", port}, loop.Poller());
+    socket.Bind();
+    socket.Listen();
+    // larger than the socket buffers, so the writer has to wait
+    std::vector<char> out(8 * 1024 * 1024, 'x');
+    std::vector<char> in(out.size());
+    char reply[5] = {0};
+
+    // the wakeup of Connect starts a writer and a reader on the connected socket,
+    // the poller must keep both of them and must not drop the writer with the connect event
+    TFuture<void> h1 = [](TSocket client, std::vector<char>* out, char* reply) -> TFuture<void>
+    {
+        co_await client.Connect();
+        TByteWriter writer(client);
+        TByteReader reader(client);
+        auto w = writer.Write(out->data(), out->size());
+        auto r = reader.Read(reply, 4);
+        co_await w;
+        co_await r;
+        co_return;
+    }(TSocket(TAddress{"127.0.0.1", port}, loop.Poller()), &out, reply);
+
+    TFuture<void> h2 = [](TSocket* socket, std::vector<char>* in) -> TFuture<void>
+    {
+        TSocket clientSocket = std::move(co_await socket->Accept());
+        co_await TByteReader(clientSocket).Read(in->data(), in->size());
+        co_await TByteWriter(clientSocket).Write("done", 4);
+        co_return;
+    }(&socket, &in);
+
+    while (!(h1.done() && h2.done())) {
+        loop.Step();
+    }
+
+    assert_true(in == out);
+    assert_string_equal(reply, "done");
+}
+
+template<typename TPoller>
+void test_reader_after_writer_removed(void**) {
+    using TLoop = TLoop<TPoller>;
+    using TSocket = typename TPoller::TSocket;
+    int port = getport();
+    TLoop loop;
+    TSocket socket(TAddress{"127.0.0.1", port}, loop.Poller());
+    socket.Bind();
+    socket.Listen();
+    std::vector<char> out(8 * 1024 * 1024, 'x');
+    std::vector<char> in(out.size());
+    char reply[5] = {0};
+
+    // a writer waits on the socket, then a reader joins it: the reader must not take the
+    // writer's event away, and the reader must still be woken after the writer is done
+    TSocket client(TAddress{"127.0.0.1", port}, loop.Poller());
+    TFuture<void> connected = [](TSocket* client) -> TFuture<void> {
+        co_await client->Connect();
+    }(&client);
+    TFuture<void> server = [](TPoller& poller, TSocket* socket, std::vector<char>* in) -> TFuture<void> {
+        TSocket clientSocket = std::move(co_await socket->Accept());
+        co_await poller.Sleep(std::chrono::milliseconds(20));
+        co_await TByteReader(clientSocket).Read(in->data(), in->size());
+        co_await poller.Sleep(std::chrono::milliseconds(20));
+        co_await TByteWriter(clientSocket).Write("done", 4);
+    }(loop.Poller(), &socket, &in);
+    while (!connected.done()) {
+        loop.Step();
+    }
+    TFuture<void> writer = [](TSocket* client, std::vector<char>* out) -> TFuture<void> {
+        co_await TByteWriter(*client).Write(out->data(), out->size());
+    }(&client, &out);
+    TFuture<void> reader = [](TSocket* client, char* reply) -> TFuture<void> {
+        co_await TByteReader(*client).Read(reply, 4);
+    }(&client, reply);
+
+    auto deadline = TClock::now() + std::chrono::seconds(30);
+    while (!(writer.done() && reader.done() && server.done()) && TClock::now() < deadline) {
+        loop.Step();
+    }
+    assert_true(writer.done() && reader.done());
+    assert_true(in == out);
+    assert_string_equal(reply, "done");
+}
+
+#ifndef _WIN32
+template<typename TPoller>
+void test_removals_in_one_batch(void**) {
+    using TFileHandle = typename TPoller::TFileHandle;
+    TLoop<TPoller> loop;
+    int p[3][2];
+    for (auto& pipe : p) {
+        assert_int_equal(::pipe(pipe), 0);
+        fcntl(pipe[0], F_SETFL, fcntl(pipe[0], F_GETFL) | O_NONBLOCK);
+    }
+    TFileHandle a(p[0][0], loop.Poller());
+    TFileHandle b(p[1][0], loop.Poller());
+    TFileHandle c(p[2][0], loop.Poller());
+    int reads[3] = {0, 0, 0};
+
+    // the readers of b and c are woken together and both waits are removed in one batch,
+    // then b waits again and must be polled, a waits all the time
+    auto reader = [](TPoller& poller, TFileHandle* h, int* reads, int times) -> TFuture<void> {
+        char buf[1];
+        for (int i = 0; i < times; i++) {
+            auto size = co_await h->ReadSome(buf, 1);
+            assert_int_equal(size, 1);
+            (*reads)++;
+            co_await poller.Sleep(std::chrono::milliseconds(1));
+        }
+    };
+    TFuture<void> ra = reader(loop.Poller(), &a, &reads[0], 1);
+    TFuture<void> rb = reader(loop.Poller(), &b, &reads[1], 2);
+    TFuture<void> rc = reader(loop.Poller(), &c, &reads[2], 1);
+    TFuture<void> writer = [](TPoller& poller, int p[3][2]) -> TFuture<void> {
+        co_await poller.Sleep(std::chrono::milliseconds(10));
+        assert_int_equal(write(p[1][1], "b", 1), 1);
+        assert_int_equal(write(p[2][1], "c", 1), 1);
+        co_await poller.Sleep(std::chrono::milliseconds(20));
+        assert_int_equal(write(p[1][1], "b", 1), 1);
+        co_await poller.Sleep(std::chrono::milliseconds(20));
+        assert_int_equal(write(p[0][1], "a", 1), 1);
+    }(loop.Poller(), p);
+
+    auto deadline = TClock::now() + std::chrono::seconds(30);
+    while (!(ra.done() && rb.done() && rc.done() && writer.done()) && TClock::now() < deadline) {
+        loop.Step();
+    }
+    assert_int_equal(reads[0], 1);
+    assert_int_equal(reads[1], 2);
+    assert_int_equal(reads[2], 1);
+    for (auto& pipe : p) {
+        close(pipe[1]);
+    }
+}
+#endif
+
 template<typename TPoller>
 void test_connection_timeout(void**) {
     using TLoop = TLoop<TPoller>;
@@ -687,6 +1005,17 @@ void test_zero_copy_line_splitter(void**) {
             assert_string_equal(lines[i].data(), result.data());
         }
     }
+
+    // fixed size blocks wrap around the buffer like lines do
+    for (int i = 0; i < 1000; i++) {
+        int len = rand_(&seed) % 16 + 1;
+        std::string block(len, 'a' + i % ('z' - 'a' + 1));
+        splitter.Push(block.data(), len);
+        assert_false(splitter.Pop(len + 1));
+        auto l = splitter.Pop(len);
+        assert_int_equal(l.Size(), len);
+        assert_true(std::string(l.Part1) + std::string(l.Part2) == block);
+    }
 }
 
 void test_self_id(void**) {
@@ -743,6 +1072,79 @@ void test_resolver(void**) {
     assert_true(!addresses.empty());
 }
 
+#ifndef _WIN32
+namespace {
+
+// Answers n queries: 10.0.0.k for a name starting with the k-th letter, NXDOMAIN for 'x'
+void stub_dns(int fd, int n) {
+    for (int i = 0; i < n; i++) {
+        char buf[512];
+        sockaddr_storage from;
+        socklen_t len = sizeof(from);
+        ssize_t size = recvfrom(fd, buf, sizeof(buf), 0, reinterpret_cast<sockaddr*>(&from), &len);
+        if (size <= 14) {
+            continue;
+        }
+        bool nx = buf[13] == 'x';
+        buf[2] = 0x81; buf[3] = nx ? 0x83 : 0x80; // response, NXDOMAIN
+        buf[7] = nx ? 0 : 1; // answers
+        if (!nx) {
+            const char answer[] = {
+                static_cast<char>(0xc0), 12, // the name of the question
+                0, 1, 0, 1, 0, 0, 0, 60, 0, 4, // A, IN, ttl, length
+                10, 0, 0, static_cast<char>(buf[13] - 'a' + 1)
+            };
+            memcpy(&buf[size], answer, sizeof(answer));
+            size += sizeof(answer);
+        }
+        sendto(fd, buf, size, 0, reinterpret_cast<sockaddr*>(&from), len);
+    }
+    close(fd);
+}
+
+} // namespace
+
+template<typename TPoller>
+void test_resolver_stub(void**) {
+    int port = getport();
+    int fd = socket(AF_INET, SOCK_DGRAM, 0);
+    TAddress address{"127.0.0.1", port};
+    auto [addr, addrLen] = address.RawAddr();
+    assert_int_equal(0, bind(fd, addr, addrLen));
+    std::thread server(stub_dns, fd, 4);
+
+    TLoop<TPoller> loop;
+    TResolverFor<TPoller> resolver(address, loop.Poller());
+    auto resolve = [](auto& resolver, std::string name, std::vector<TAddress>* addresses, bool* failed) -> TFuture<void> {
+        try {
+            *addresses = co_await resolver.Resolve(name);
+        } catch (const std::exception& ) {
+            *failed = true;
+        }
+    };
+    std::vector<TAddress> addresses[4];
+    bool failed[4] = {false, false, false, false};
+    const char* names[4] = {"a.test", "b.test", "c.test", "x.test"};
+    std::vector<TFuture<void>> futures;
+    for (int i = 0; i < 4; i++) {
+        futures.emplace_back(resolve(resolver, names[i], &addresses[i], &failed[i]));
+    }
+    TFuture<void> all = All(std::move(futures));
+    while (!all.done()) {
+        loop.Step();
+    }
+    server.join();
+
+    for (int i = 0; i < 3; i++) {
+        assert_false(failed[i]);
+        assert_int_equal(addresses[i].size(), 1);
+        auto expected = TAddress{"10.0.0." + std::to_string(i + 1), 0};
+        assert_string_equal(addresses[i][0].ToString().c_str(), expected.ToString().c_str());
+    }
+    assert_true(failed[3]);
+}
+#endif
+
 template<typename TPoller>
 void test_resolve_bad_name(void**) {
     using TLoop = TLoop<TPoller>;
@@ -814,112 +1216,1990 @@ void test_read_write_full_ssl(void**) {
     assert_memory_equal(data.data(), received.data(), data.size());
 }
 
-template<typename TPoller>
-void test_future_chaining(void**) {
-    TFuture<int> intFuture = []() -> TFuture<int> {
-        co_return 1;
-    }();
-
-    TFuture<double> doubleFuture = intFuture.Apply([](int value) -> double {
-        return value * 1.5;
-    });
-
-    double val = -1;
-    [&](TFuture<double>&& f, double* val) -> TFuture<void> {
-        *val = co_await f;
-    }(std::move(doubleFuture), &val);
-
-    assert_true(std::abs(val - 1.5) < 1e-13);
+void test_token_bucket(void**) {
+    auto now = TClock::now();
+    TTokenBucket global(1000, 1000);
+    TTokenBucket tenant(4000, 2000, &global);
+    TTokenBucket connection(2000, 500, &tenant);
+    // buckets start full and only refill from the moment they were created
+    now = std::max(now, TClock::now());
+
+    assert_int_equal(connection.Available(now), 500);
+    connection.Consume(500, now);
+    assert_int_equal(connection.Available(now), 0);
+    assert_int_equal(tenant.Available(now), 500);
+    assert_int_equal(global.Available(now), 500);
+    assert_true(connection.ReadyAt(now) == now);
+
+    // a transfer above the available tokens leaves a debt in every bucket of the chain
+    connection.Consume(1000, now);
+    assert_int_equal(global.Available(now), 0);
+    // the global bucket owes 500 bytes at 1000 B/s, the connection owes 1000 at 2000 B/s
+    assert_true(connection.ReadyAt(now) == now + std::chrono::milliseconds(500));
+    // the tenant has tokens left but waits for its parent
+    assert_int_equal(tenant.Available(now), 0);
+    assert_true(tenant.ReadyAt(now) == now + std::chrono::milliseconds(500));
+
+    auto later = now + std::chrono::milliseconds(750);
+    assert_true(connection.ReadyAt(later) == later);
+    // the connection refilled 500 of its 500 burst, the global bucket only 250
+    assert_int_equal(connection.Available(later), 250);
+
+    // refill is capped by the burst
+    later += std::chrono::seconds(10);
+    assert_int_equal(connection.Available(later), 500);
+    assert_int_equal(tenant.Available(later), 1000);
+    assert_int_equal(global.Available(later), 1000);
 }
 
 template<typename TPoller>
-void test_futures_any(void**) {
+void test_shaped_socket(void**) {
     using TLoop = TLoop<TPoller>;
+    using TSocket = typename TPoller::TSocket;
+    int port = getport();
     TLoop loop;
+    TSocket socket(TAddress{"127.0.0.1", port}, loop.Poller());
+    socket.Bind();
+    socket.Listen();
 
-    int ok = 0;
-    TFuture<void> h2 = [](TPoller& poller, int* ok) -> TFuture<void> {
-        std::vector<TFuture<void>> futures;
-        futures.emplace_back([](TPoller& poller) -> TFuture<void> {
-            co_await poller.Sleep(std::chrono::milliseconds(100));
-            co_return;
-        }(poller));
-        futures.emplace_back([](TPoller& poller) -> TFuture<void> {
-            co_await poller.Sleep(std::chrono::milliseconds(200));
-            co_return;
-        }(poller));
-        futures.emplace_back([](TPoller& poller) -> TFuture<void> {
-            co_await poller.Sleep(std::chrono::milliseconds(201));
-            co_return;
-        }(poller));
-        futures.emplace_back([](TPoller& poller) -> TFuture<void> {
-            co_await poller.Sleep(std::chrono::milliseconds(202));
-            co_return;
-        }(poller));
-        co_await Any(std::move(futures));
-        *ok = 1;
+    // two connections limited to 8 MB/s each share a global limit of 4 MB/s
+    TTokenBucket global(4 * 1024 * 1024, 16 * 1024);
+    TTokenBucket c1(8 * 1024 * 1024, 16 * 1024, &global);
+    TTokenBucket c2(8 * 1024 * 1024, 16 * 1024, &global);
+    std::vector<char> data(128 * 1024, 'x');
+    size_t received = 0;
+
+    TFuture<void> server = [](TSocket* socket, size_t* received) -> TFuture<void> {
+        std::vector<TSocket> clients;
+        clients.emplace_back(co_await socket->Accept());
+        clients.emplace_back(co_await socket->Accept());
+        char buf[4096];
+        for (auto& client : clients) {
+            while (true) {
+                auto n = co_await client.ReadSome(buf, sizeof(buf));
+                if (n == 0) {
+                    break;
+                }
+                if (n > 0) {
+                    *received += n;
+                }
+            }
+        }
         co_return;
-    }(loop.Poller(), &ok);
+    }(&socket, &received);
 
-    while (!h2.done()) {
+    auto writer = [](TShapedSocket<TSocket> client, const std::vector<char>* data) -> TFuture<void> {
+        co_await client.Connect();
+        co_await TByteWriter(client).Write(data->data(), data->size());
+        co_return;
+    };
+
+    auto start = TClock::now();
+    std::vector<TFuture<void>> writers;
+    writers.emplace_back(writer(TShapedSocket<TSocket>(TSocket(TAddress{"127.0.0.1", port}, loop.Poller()), nullptr, &c1), &data));
+    writers.emplace_back(writer(TShapedSocket<TSocket>(TSocket(TAddress{"127.0.0.1", port}, loop.Poller()), nullptr, &c2), &data));
+    auto all = All(std::move(writers));
+    while (!all.done()) {
         loop.Step();
     }
-
-    while (loop.Poller().TimersSize() > 0) {
+    auto elapsed = TClock::now() - start;
+    while (!server.done()) {
         loop.Step();
     }
 
-    assert_true(ok == 1);
+    assert_int_equal(received, 2 * data.size());
+    // 256 KB at 4 MB/s take 62 ms, less the global burst and one quantum per connection
+    assert_true(elapsed >= std::chrono::milliseconds(45));
+    assert_true(elapsed < std::chrono::seconds(1));
 }
 
-template<typename TPoller>
-void test_futures_any_result(void**) {
-    using TLoop = TLoop<TPoller>;
-    TLoop loop;
+#ifndef _WIN32
+template<typename TPoller, typename TBackend>
+void async_file_roundtrip(TLoop<TPoller>& loop, TBackend& backend) {
+    std::string path = "/tmp/coroio_test_async_file_" + std::to_string(getpid());
+    std::vector<char> data(1024 * 1024);
+    for (size_t i = 0; i < data.size(); i++) {
+        data[i] = static_cast<char>(i * 31 + i / 4096);
+    }
+    std::vector<char> back(data.size());
+    std::vector<char> pages(4 * 4096);
+    bool missing = false;
+
+    TFuture<void> h = [](TBackend& backend, std::string path, std::vector<char>* data, std::vector<char>* back, std::vector<char>* pages, bool* missing) -> TFuture<void> {
+        auto file = co_await TAsyncFile<TBackend>::Open(backend, path, O_RDWR | O_CREAT | O_TRUNC);
+        co_await TByteWriter(file).Write(data->data(), data->size());
+        co_await file.Fdatasync();
+        assert_int_equal(file.Position(), data->size());
+
+        // concurrent positional reads complete independently
+        std::vector<TFuture<void>> reads;
+        for (int i = 0; i < 4; i++) {
+            reads.emplace_back([](TAsyncFile<TBackend>& file, char* page, uint64_t offset) -> TFuture<void> {
+                auto n = co_await file.ReadAt(page, 4096, offset);
+                assert_int_equal(n, 4096);
+            }(file, pages->data() + i * 4096, (3 - i) * 65536));
+        }
+        co_await All(std::move(reads));
 
-    int ok = 0;
-    TFuture<void> h2 = [](TPoller& poller, int* ok) -> TFuture<void> {
-        std::vector<TFuture<int>> futures;
-        futures.emplace_back([](TPoller& poller) -> TFuture<int> {
-            co_await poller.Sleep(std::chrono::milliseconds(204));
-            co_return 1;
-        }(poller));
-        futures.emplace_back([](TPoller& poller) -> TFuture<int> {
-            co_await poller.Sleep(std::chrono::milliseconds(100));
-            co_return 2;
-        }(poller));
-        futures.emplace_back([](TPoller& poller) -> TFuture<int> {
-            co_await poller.Sleep(std::chrono::milliseconds(201));
-            co_return 3;
-        }(poller));
-        futures.emplace_back([](TPoller& poller) -> TFuture<int> {
-            co_await poller.Sleep(std::chrono::milliseconds(202));
-            co_return 4;
-        }(poller));
-        *ok = co_await Any(std::move(futures));
+        file.Seek(0);
+        co_await TByteReader(file).Read(back->data(), back->size());
+        auto n = co_await file.ReadSome(back->data(), 1);
+        assert_int_equal(n, 0);
+        co_await file.Close();
+
+        try {
+            co_await TAsyncFile<TBackend>::Open(backend, path + ".missing", O_RDONLY);
+        } catch (const std::system_error& ex) {
+            *missing = ex.code().value() == ENOENT;
+        }
         co_return;
-    }(loop.Poller(), &ok);
+    }(backend, path, &data, &back, &pages, &missing);
 
-    while (!h2.done()) {
+    while (!h.done()) {
         loop.Step();
     }
+    unlink(path.c_str());
 
-    while (loop.Poller().TimersSize() > 0) {
-        loop.Step();
+    assert_true(back == data);
+    for (int i = 0; i < 4; i++) {
+        assert_memory_equal(pages.data() + i * 4096, data.data() + (3 - i) * 65536, 4096);
     }
-
-    assert_true(ok == 2);
+    assert_true(missing);
 }
 
 template<typename TPoller>
-void test_futures_any_same_wakeup(void**) {
-    using TLoop = TLoop<TPoller>;
-    TLoop loop;
+void test_async_file(void**) {
+    TLoop<TPoller> loop;
+    TFileIoPool pool(loop.Poller(), 2);
+    async_file_roundtrip(loop, pool);
+}
 
-    int ok = 0;
-    TFuture<void> h2 = [](TPoller& poller, int* ok) -> TFuture<void> {
-        std::vector<TFuture<void>> futures;
-        auto until = TClock::now() + std::chrono::milliseconds(100);
+template<typename TPoller, typename TBackend>
+void wal_roundtrip(TLoop<TPoller>& loop, TBackend& backend, bool preallocate) {
+    char dirTemplate[] = "/tmp/coroio_test_wal_XXXXXX";
+    assert_non_null(mkdtemp(dirTemplate));
+    std::string dir = dirTemplate;
+    auto record = [](int writer, int i) {
+        return std::string(10 + (writer * 7 + i * 13) % 200, static_cast<char>('a' + writer % 26));
+    };
+
+    const int writers = 50;
+    const int records = 10;
+    std::vector<std::string> expected(writers * records);
+    TWalStats stats;
+    TFuture<void> h = [](TBackend& backend, std::string dir, bool preallocate, auto record, std::vector<std::string>* expected, TWalStats* stats) -> TFuture<void> {
+        // small segments to rotate a few times
+        TWal<TBackend> wal(backend, dir, TWalOptions{.SegmentSize = 4096, .Preallocate = preallocate});
+        co_await wal.Open(0);
+        std::vector<TFuture<void>> appenders;
+        for (int writer = 0; writer < writers; writer++) {
+            appenders.emplace_back([](TWal<TBackend>& wal, int writer, auto record, std::vector<std::string>* expected) -> TFuture<void> {
+                for (int i = 0; i < records; i++) {
+                    auto data = record(writer, i);
+                    auto lsn = co_await wal.Append(data);
+                    assert_true(lsn < wal.DurableLsn());
+                    (*expected)[lsn] = data;
+                }
+            }(wal, writer, record, expected));
+        }
+        co_await All(std::move(appenders));
+        co_await wal.Close();
+        *stats = wal.Stats();
+        co_return;
+    }(backend, dir, preallocate, record, &expected, &stats);
+
+    while (!h.done()) {
+        loop.Step();
+    }
+
+    assert_int_equal(stats.Records, writers * records);
+    // every group commit serves many appenders
+    assert_true(stats.Groups * 5 <= stats.Records);
+    assert_true(stats.Segments > 1);
+
+    // a torn record at the tail is skipped, without preallocation it follows the last record
+    {
+        int fd = open(WalSegmentPath(dir, 0).c_str(), O_WRONLY | O_APPEND);
+        assert_true(fd >= 0);
+        assert_int_equal(write(fd, "\x10\0\0\0\x10\0\0\0torn", 12), 12);
+        close(fd);
+    }
+
+    TWalReader reader(dir);
+    uint64_t lsn;
+    std::string_view data;
+    uint64_t count = 0;
+    while (reader.Next(&lsn, &data)) {
+        assert_int_equal(lsn, count);
+        assert_true(data == expected[lsn]);
+        count++;
+    }
+    assert_int_equal(count, writers * records);
+    assert_int_equal(reader.NextLsn(), writers * records);
+
+    // a segment with records is never reopened, one without is taken over
+    {
+        int fd = open(WalSegmentPath(dir, reader.NextLsn()).c_str(), O_WRONLY | O_CREAT | O_EXCL, 0644);
+        assert_true(fd >= 0);
+        assert_int_equal(ftruncate(fd, 4096), 0);
+        close(fd);
+    }
+    int error = 0;
+    h = [](TBackend& backend, std::string dir, int* error) -> TFuture<void> {
+        TWal<TBackend> wal(backend, dir);
+        try {
+            co_await wal.Open(0);
+        } catch (const std::system_error& ex) {
+            *error = ex.code().value();
+        }
+        co_return;
+    }(backend, dir, &error);
+
+    while (!h.done()) {
+        loop.Step();
+    }
+    assert_int_equal(error, EEXIST);
+
+    // reopening continues the numbering in a new segment
+    h = [](TBackend& backend, std::string dir, uint64_t next) -> TFuture<void> {
+        TWal<TBackend> wal(backend, dir);
+        co_await wal.Open(next);
+        auto lsn = co_await wal.Append("after restart");
+        assert_int_equal(lsn, next);
+        co_await wal.Close();
+        co_return;
+    }(backend, dir, reader.NextLsn());
+
+    while (!h.done()) {
+        loop.Step();
+    }
+
+    TWalReader reopened(dir);
+    count = 0;
+    while (reopened.Next(&lsn, &data)) {
+        count++;
+    }
+    assert_int_equal(count, writers * records + 1);
+    assert_true(data == "after restart");
+
+    DIR* d = opendir(dir.c_str());
+    while (auto* entry = readdir(d)) {
+        if (entry->d_name[0] != '.') {
+            unlink((dir + "/" + entry->d_name).c_str());
+        }
+    }
+    closedir(d);
+    rmdir(dir.c_str());
+}
+
+template<typename TPoller>
+void test_wal(void**) {
+    TLoop<TPoller> loop;
+    TFileIoPool pool(loop.Poller(), 2);
+    wal_roundtrip(loop, pool, false);
+}
+#endif
+
+#ifndef _WIN32
+template<typename TPoller>
+void test_mapped_file(void**) {
+    using TSocket = typename TPoller::TSocket;
+    std::string path = "/tmp/coroio_test_mapped_file_" + std::to_string(getpid());
+    std::string data(3 * 1024 * 1024 + 123, ' ');
+    for (size_t i = 0; i < data.size(); i++) {
+        data[i] = static_cast<char>(i * 7 + i / 4096);
+    }
+    {
+        int fd = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        assert_true(fd >= 0);
+        assert_int_equal(write(fd, data.data(), data.size()), data.size());
+        close(fd);
+    }
+    TMappedFile file(path);
+    unlink(path.c_str()); // the mapping keeps the file
+    assert_int_equal(file.Size(), data.size());
+    assert_true(file.View(data.size() - 10, 100) == std::string_view(data).substr(data.size() - 10));
+    assert_true(file.View(data.size() + 10, 100).empty());
+
+    int port = getport();
+    TLoop<TPoller> loop;
+    TSocket listener(TAddress{"127.0.0.1", port}, loop.Poller());
+    listener.Bind();
+    listener.Listen();
+    TSocket client(TAddress{"127.0.0.1", port}, loop.Poller());
+
+    // the whole file sequentially with readahead, then two ranges at once
+    TFuture<void> h1 = [](TSocket& client, TPoller& poller, const TMappedFile& file) -> TFuture<void> {
+        co_await client.Connect();
+        TMappedReader reader(file, poller, 256 * 1024);
+        while (true) {
+            auto chunk = reader.Next(64 * 1024);
+            if (chunk.empty()) {
+                break;
+            }
+            co_await TByteWriter(client).Write(chunk.data(), chunk.size());
+        }
+        assert_int_equal(reader.Position(), file.Size());
+        std::array<iovec, 2> iov = {file.Iov(100, 50), file.Iov(file.Size() - 20, 1000)};
+        co_await TByteWriter(client).Writev(iov.data(), iov.size());
+        co_return;
+    }(client, loop.Poller(), file);
+
+    std::string received(data.size() + 70, ' ');
+    TFuture<void> h2 = [](TSocket& listener, std::string& received) -> TFuture<void> {
+        auto server = co_await listener.Accept();
+        co_await TByteReader(server).Read(received.data(), received.size());
+        co_return;
+    }(listener, received);
+
+    while (!(h1.done() && h2.done())) {
+        loop.Step();
+    }
+
+    assert_true(received == data + data.substr(100, 50) + data.substr(data.size() - 20));
+
+    TMappedFile empty;
+    assert_int_equal(empty.Size(), 0);
+    assert_true(empty.View(0, 10).empty());
+}
+#endif
+
+#ifndef _WIN32
+template<typename TPoller>
+void test_async_event(void**) {
+    TLoop<TPoller> loop;
+    TAsyncEvent<TPoller> event(loop.Poller());
+    const uint64_t notifications = 5;
+    uint64_t received = 0;
+
+    TFuture<void> h = [](TAsyncEvent<TPoller>& event, uint64_t notifications, uint64_t* received) -> TFuture<void> {
+        while (*received < notifications) {
+            auto n = co_await event.Wait();
+            *received += n;
+        }
+        co_return;
+    }(event, notifications, &received);
+
+    std::thread thread([&]() {
+        for (uint64_t i = 0; i < notifications; i++) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(i % 2));
+            event.Notify();
+        }
+    });
+
+    auto deadline = TClock::now() + std::chrono::seconds(5);
+    while (!h.done() && TClock::now() < deadline) {
+        loop.Step();
+    }
+    thread.join();
+    assert_true(h.done());
+    assert_int_equal(received, notifications);
+}
+#endif
+
+#ifndef _WIN32
+template<typename TPoller>
+void test_unix_socket(void**) {
+    using TSocket = typename TPoller::TSocket;
+    TLoop<TPoller> loop;
+    std::string path = "/tmp/coroio_test_" + std::to_string(getpid()) + ".sock";
+    TAddress addresses[] = {
+        TAddress::Unix(path),
+#ifdef __linux__
+        TAddress::Unix("@coroio_test_" + std::to_string(getpid())),
+#endif
+    };
+
+    for (auto& address : addresses) {
+        ::unlink(path.c_str());
+        TSocket listener(address, loop.Poller());
+        listener.Bind();
+        listener.Listen();
+        std::string received;
+
+        TFuture<void> server = [](TSocket* listener, std::string* received) -> TFuture<void> {
+            auto client = co_await listener->Accept();
+            char buf[64];
+            while (true) {
+                auto size = co_await client.ReadSome(buf, sizeof(buf));
+                if (size == 0) {
+                    break;
+                }
+                if (size > 0) {
+                    received->append(buf, size);
+                    co_await TByteWriter(client).Write(buf, size);
+                }
+            }
+            co_return;
+        }(&listener, &received);
+
+        std::string echoed;
+        TFuture<void> client = [](TPoller& poller, TAddress address, std::string* echoed) -> TFuture<void> {
+            TSocket socket(std::move(address), poller);
+            co_await socket.Connect();
+            std::string message = "hello over a unix socket";
+            co_await TByteWriter(socket).Write(message.data(), message.size());
+            echoed->resize(message.size());
+            co_await TByteReader(socket).Read(echoed->data(), echoed->size());
+            co_return;
+        }(loop.Poller(), address, &echoed);
+
+        while (!(server.done() && client.done())) {
+            loop.Step();
+        }
+        assert_string_equal(received.c_str(), "hello over a unix socket");
+        assert_string_equal(echoed.c_str(), "hello over a unix socket");
+    }
+    ::unlink(path.c_str());
+
+    // a pipe handed over SCM_RIGHTS keeps working in the receiver
+    int pair[2];
+    assert_int_equal(socketpair(AF_UNIX, SOCK_STREAM, 0, pair), 0);
+    int pipeFds[2];
+    assert_int_equal(pipe(pipeFds), 0);
+    TSocket sender(TAddress{}, pair[0], loop.Poller());
+    TSocket receiver(TAddress{}, pair[1], loop.Poller());
+    std::vector<int> fds;
+    ssize_t size = 0;
+    char byte = 0;
+
+    TFuture<void> recv = [](TSocket& receiver, char* byte, std::vector<int>* fds, ssize_t* size) -> TFuture<void> {
+        do {
+            *size = co_await receiver.RecvFds(byte, 1, fds);
+        } while (*size < 0);
+        co_return;
+    }(receiver, &byte, &fds, &size);
+
+    TFuture<void> send = [](TSocket& sender, int fd) -> TFuture<void> {
+        int sendFds[] = {fd};
+        ssize_t ret;
+        do {
+            ret = co_await sender.SendFds("x", 1, sendFds);
+        } while (ret < 0);
+        co_return;
+    }(sender, pipeFds[1]);
+
+    while (!(send.done() && recv.done())) {
+        loop.Step();
+    }
+    ::close(pipeFds[1]);
+    assert_int_equal(size, 1);
+    assert_int_equal(byte, 'x');
+    assert_int_equal(fds.size(), 1);
+    assert_int_not_equal(fds[0], pipeFds[1]);
+#ifdef __linux__
+    assert_true(fcntl(fds[0], F_GETFD) & FD_CLOEXEC);
+#endif
+    assert_int_equal(::write(fds[0], "y", 1), 1);
+    ::close(fds[0]);
+    char got = 0;
+    assert_int_equal(::read(pipeFds[0], &got, 1), 1);
+    assert_int_equal(got, 'y');
+    ::close(pipeFds[0]);
+}
+#endif
+
+template<typename TPoller>
+void test_spin(void**) {
+    using TSocket = typename TPoller::TSocket;
+    TLoop<TPoller> loop;
+    int pair[2];
+    assert_int_equal(socketpair(AF_UNIX, SOCK_STREAM, 0, pair), 0);
+    TSocket a(TAddress{}, pair[0], loop.Poller());
+    TSocket b(TAddress{}, pair[1], loop.Poller());
+
+    // the steps of a sleep that follows a wakeup: a few when blocking, many while spinning
+    auto steps = [&](std::chrono::microseconds spin) {
+        loop.Poller().SetSpin(spin);
+        TFuture<void> h = [](TSocket& b, TPoller& poller) -> TFuture<void> {
+            char c;
+            co_await TByteReader(b).Read(&c, 1);
+            co_await poller.Sleep(std::chrono::milliseconds(50));
+        }(b, loop.Poller());
+        TFuture<void> w = [](TSocket& a, TPoller& poller) -> TFuture<void> {
+            co_await poller.Sleep(std::chrono::milliseconds(1));
+            char c = 'x';
+            co_await TByteWriter(a).Write(&c, 1);
+        }(a, loop.Poller());
+        int n = 0;
+        while (!(h.done() && w.done())) {
+            loop.Step();
+            n++;
+        }
+        return n;
+    };
+
+    assert_true(steps(std::chrono::microseconds(0)) < 10);
+    assert_true(steps(std::chrono::milliseconds(20)) > 100);
+
+#ifdef __linux__
+    if constexpr (std::is_same_v<TPoller, TEPoll>) {
+        try {
+            loop.Poller().SetBusyPoll(std::chrono::microseconds(50));
+        } catch (const std::system_error& ex) {
+            // before Linux 6.9
+            assert_int_equal(ex.code().value(), ENOTTY);
+        }
+    }
+#endif
+}
+
+#ifdef __linux__
+template<typename TPoller>
+void test_signals(void**) {
+    TLoop<TPoller> loop;
+    TSignals<TPoller> signals(loop.Poller(), {SIGUSR1, SIGUSR2});
+    // pending before the wait
+    raise(SIGUSR2);
+    std::vector<int> received;
+
+    TFuture<void> h = [](TPoller& poller, TSignals<TPoller>& signals, std::vector<int>* received) -> TFuture<void> {
+        auto signal = co_await signals.Wait();
+        received->push_back(signal);
+        auto sender = [](TPoller& poller) -> TFuture<void> {
+            co_await poller.Sleep(std::chrono::milliseconds(5));
+            raise(SIGUSR1);
+        }(poller);
+        signal = co_await signals.Wait();
+        received->push_back(signal);
+        co_await sender;
+        co_return;
+    }(loop.Poller(), signals, &received);
+
+    while (!h.done()) {
+        loop.Step();
+    }
+    assert_int_equal(received.size(), 2);
+    assert_int_equal(received[0], SIGUSR2);
+    assert_int_equal(received[1], SIGUSR1);
+}
+
+template<typename TPoller>
+TValueTask<std::string> read_to_end(typename TPoller::TFileHandle& handle) {
+    std::string result;
+    char buf[1024];
+    while (true) {
+        auto size = co_await handle.ReadSome(buf, sizeof(buf));
+        if (size == 0) {
+            break;
+        }
+        if (size > 0) {
+            result.append(buf, size);
+        }
+    }
+    co_return result;
+}
+
+template<typename TPoller>
+void test_process(void**) {
+    TLoop<TPoller> loop;
+    std::string out, err;
+    int status = 0, killed = 0;
+    std::vector<int> statuses;
+    bool missing = false;
+
+    TFuture<void> h = [](TPoller& poller, std::string* out, std::string* err, int* status, int* killed, std::vector<int>* statuses, bool* missing) -> TFuture<void> {
+        TProcess<TPoller> process(poller, {"/bin/sh", "-c", "tr a-z A-Z; echo err >&2; exit 3"}, TProcessOptions{.PipeStderr = true});
+        co_await TByteWriter(process.Stdin()).Write("hello", 5);
+        process.CloseStdin();
+        *out = co_await read_to_end<TPoller>(process.Stdout());
+        *err = co_await read_to_end<TPoller>(process.Stderr());
+        *status = co_await process.Wait();
+
+        TProcess<TPoller> sleeper(poller, {"sleep", "10"}, TProcessOptions{.PipeStdin = false, .PipeStdout = false});
+        sleeper.Kill();
+        *killed = co_await sleeper.Wait();
+
+        // many children at once, each awaited through its pidfd
+        std::vector<std::unique_ptr<TProcess<TPoller>>> children;
+        for (int i = 0; i < 64; i++) {
+            children.emplace_back(std::make_unique<TProcess<TPoller>>(poller,
+                std::vector<std::string>{"/bin/sh", "-c", "exit " + std::to_string(i % 7)},
+                TProcessOptions{.PipeStdin = false, .PipeStdout = false}));
+        }
+        for (auto& child : children) {
+            auto code = co_await child->Wait();
+            statuses->push_back(code);
+        }
+
+        try {
+            TProcess<TPoller> process(poller, {"/nonexistent/coroio-test"});
+        } catch (const std::system_error& ex) {
+            *missing = ex.code().value() == ENOENT;
+        }
+        co_return;
+    }(loop.Poller(), &out, &err, &status, &killed, &statuses, &missing);
+
+    while (!h.done()) {
+        loop.Step();
+    }
+    assert_string_equal(out.c_str(), "HELLO");
+    assert_string_equal(err.c_str(), "err\n");
+    assert_int_equal(status, 3);
+    assert_int_equal(killed, -SIGTERM);
+    assert_int_equal(statuses.size(), 64);
+    for (int i = 0; i < 64; i++) {
+        assert_int_equal(statuses[i], i % 7);
+    }
+    assert_true(missing);
+}
+
+template<typename TPoller>
+void test_periodic_timer(void**) {
+    TLoop<TPoller> loop;
+    TPeriodicTimer<TPoller> timer(loop.Poller(), std::chrono::milliseconds(5));
+    uint64_t ticks = 0;
+    auto start = TClock::now();
+
+    TFuture<void> h = [](TPeriodicTimer<TPoller>& timer, uint64_t* ticks) -> TFuture<void> {
+        while (*ticks < 4) {
+            auto n = co_await timer.Wait();
+            *ticks += n;
+        }
+        co_return;
+    }(timer, &ticks);
+
+    while (!h.done()) {
+        loop.Step();
+    }
+    auto elapsed = TClock::now() - start;
+    assert_true(ticks >= 4);
+    assert_true(elapsed >= std::chrono::milliseconds(19));
+    assert_true(elapsed < std::chrono::seconds(1));
+    // timerfd ticks do not use the timer heap of the poller
+    assert_int_equal(loop.Poller().TimersSize(), 0);
+}
+#endif
+
+void test_crc32c(void**) {
+    assert_int_equal(Crc32c("", 0), 0);
+    assert_int_equal(Crc32c("123456789", 9), 0xE3069283);
+    std::string zeros(32, '\0');
+    assert_int_equal(Crc32c(zeros.data(), zeros.size()), 0x8A9136AA);
+
+    // against the bitwise definition, for every tail length and alignment
+    std::string data(300, ' ');
+    for (size_t i = 0; i < data.size(); i++) {
+        data[i] = static_cast<char>(i * 131 + 7);
+    }
+    for (size_t offset = 0; offset < 8; offset++) {
+        for (size_t size = 0; size + offset <= data.size(); size += 1 + size / 16) {
+            uint32_t crc = ~0u;
+            for (size_t i = offset; i < offset + size; i++) {
+                crc ^= static_cast<unsigned char>(data[i]);
+                for (int k = 0; k < 8; k++) {
+                    crc = (crc >> 1) ^ (0x82F63B78 & (0 - (crc & 1)));
+                }
+            }
+            assert_int_equal(Crc32c(data.data() + offset, size), ~crc);
+            // extending a checksum equals checksumming the concatenation
+            uint32_t half = Crc32c(data.data() + offset, size / 2);
+            assert_int_equal(Crc32c(data.data() + offset + size / 2, size - size / 2, half), ~crc);
+        }
+    }
+}
+
+void test_http_parse_request(void**) {
+    std::string data =
+        "POST /path/to?x=1 HTTP/1.1\r\n"
+        "Host: example.com\r\n"
+        "Content-Length: 5\r\n"
+        "X-Test:  value \r\n"
+        "\r\n"
+        "helloGET / HTTP/1.0\r\n\r\n";
+    THttpRequestParser parser;
+    assert_true(parser.Parse(data.data(), data.size()) == EHttpParseStatus::Done);
+    const auto& request = parser.Message();
+    assert_true(request.Method == "POST");
+    assert_true(request.Target == "/path/to?x=1");
+    assert_true(request.Path == "/path/to");
+    assert_true(request.Query == "x=1");
+    assert_int_equal(request.VersionMinor, 1);
+    assert_true(request.Headers.Get("host") == "example.com");
+    assert_true(request.Headers.Get("X-TEST") == "value");
+    assert_true(request.Body == "hello");
+    assert_true(request.KeepAlive);
+
+    size_t consumed = parser.Consumed();
+    parser.Reset();
+    assert_true(parser.Parse(data.data() + consumed, data.size() - consumed) == EHttpParseStatus::Done);
+    assert_true(parser.Message().Method == "GET");
+    assert_int_equal(parser.Message().VersionMinor, 0);
+    assert_false(parser.Message().KeepAlive);
+    assert_int_equal(consumed + parser.Consumed(), data.size());
+
+    // over the limits: the body is told from the head by HeadDone()
+    THttpRequestParser limited(96, 4);
+    assert_true(limited.Parse(data.data(), data.size()) == EHttpParseStatus::TooLarge);
+    assert_true(limited.HeadDone());
+    std::string head = "GET / HTTP/1.1\r\nX-Long: " + std::string(100, 'x') + "\r\n\r\n";
+    limited.Reset();
+    assert_true(limited.Parse(head.data(), head.size()) == EHttpParseStatus::TooLarge);
+    assert_false(limited.HeadDone());
+    limited.Reset();
+    assert_true(limited.Parse(head.data(), 100) == EHttpParseStatus::TooLarge);
+    assert_false(limited.HeadDone());
+}
+
+void test_http_parse_incremental(void**) {
+    std::string data =
+        "PUT /upload HTTP/1.1\r\n"
+        "Content-Length: 10\r\n"
+        "\r\n"
+        "0123456789";
+    // feed the message byte by byte through a buffer that moves on every call
+    std::vector<std::string> copies;
+    THttpRequestParser parser;
+    EHttpParseStatus status = EHttpParseStatus::Incomplete;
+    for (size_t i = 1; i <= data.size(); i++) {
+        copies.emplace_back(data.substr(0, i));
+        status = parser.Parse(copies.back().data(), i);
+        if (i < data.size()) {
+            assert_true(status == EHttpParseStatus::Incomplete);
+        }
+    }
+    assert_true(status == EHttpParseStatus::Done);
+    assert_true(parser.Message().Method == "PUT");
+    assert_true(parser.Message().Headers.Get("Content-Length") == "10");
+    assert_true(parser.Message().Body == "0123456789");
+    assert_int_equal(parser.Consumed(), data.size());
+}
+
+void test_http_parse_chunked(void**) {
+    std::string data =
+        "POST / HTTP/1.1\r\n"
+        "Transfer-Encoding: chunked\r\n"
+        "\r\n"
+        "5\r\nhello\r\n"
+        "7;ext=1\r\n, world\r\n"
+        "0\r\n"
+        "\r\n";
+    THttpRequestParser parser;
+    assert_true(parser.Parse(data.data(), data.size()) == EHttpParseStatus::Done);
+    assert_true(parser.Message().Chunked);
+    assert_true(parser.Message().Body == "hello, world");
+    assert_int_equal(parser.Consumed(), data.size());
+
+    std::string bad =
+        "POST / HTTP/1.1\r\n"
+        "Transfer-Encoding: chunked\r\n"
+        "Content-Length: 3\r\n"
+        "\r\n";
+    parser.Reset();
+    assert_true(parser.Parse(bad.data(), bad.size()) == EHttpParseStatus::Error);
+
+    // chunked must be the last coding, of all of the lines together
+    for (std::string encoding : {"gzip", "chunked, gzip", "chunked\r\nTransfer-Encoding: gzip"}) {
+        bad = "POST / HTTP/1.1\r\nTransfer-Encoding: " + encoding + "\r\n\r\n";
+        parser.Reset();
+        assert_true(parser.Parse(bad.data(), bad.size()) == EHttpParseStatus::Error);
+    }
+    data =
+        "POST / HTTP/1.1\r\n"
+        "Transfer-Encoding: gzip\r\n"
+        "Transfer-Encoding: chunked\r\n"
+        "\r\n"
+        "0\r\n"
+        "\r\n";
+    parser.Reset();
+    assert_true(parser.Parse(data.data(), data.size()) == EHttpParseStatus::Done);
+    assert_true(parser.Message().Chunked);
+}
+
+void test_http_parse_reply(void**) {
+    std::string data =
+        "HTTP/1.1 404 Not Found\r\n"
+        "Connection: close\r\n"
+        "\r\n"
+        "missing";
+    THttpReplyParser parser;
+    assert_true(parser.Parse(data.data(), data.size()) == EHttpParseStatus::Incomplete);
+    assert_true(parser.Finish(data.data(), data.size()) == EHttpParseStatus::Done);
+    assert_int_equal(parser.Message().Status, 404);
+    assert_true(parser.Message().Reason == "Not Found");
+    assert_false(parser.Message().KeepAlive);
+    assert_true(parser.Message().Body == "missing");
+}
+
+template<typename TPoller>
+void test_http_server_pipelined(void**) {
+    using TLoop = TLoop<TPoller>;
+    using TSocket = typename TPoller::TSocket;
+
+    int port = getport();
+    TLoop loop;
+    TSocket socket(NNet::TAddress{"127.0.0.1", port}, loop.Poller());
+    socket.Bind();
+    socket.Listen();
+
+    THttpServer server(socket, [](const THttpRequest& request, THttpResponse& response) -> TFuture<void> {
+        if (request.Path == "/big") {
+            response.SetBody(std::string(100000, 'x'));
+        } else {
+            response.SetBody(std::string(request.Path));
+        }
+        co_return;
+    });
+    auto serve = server.Serve();
+
+    std::vector<std::string> bodies;
+    TSocket client(NNet::TAddress{"127.0.0.1", port}, loop.Poller());
+    TFuture<void> h = [](TSocket& client, std::vector<std::string>& bodies) -> TFuture<void>
+    {
+        co_await client.Connect();
+        std::string requests =
+            "GET /a HTTP/1.1\r\n\r\n"
+            "GET /big HTTP/1.1\r\n\r\n"
+            "GET /c HTTP/1.1\r\nConnection: close\r\n\r\n";
+        co_await TByteWriter(client).Write(requests.data(), requests.size());
+        std::string received;
+        char buf[4096];
+        ssize_t size;
+        while ((size = co_await client.ReadSome(buf, sizeof(buf))) != 0) {
+            if (size > 0) {
+                received.append(buf, size);
+            }
+        }
+        size_t pos = 0;
+        THttpReplyParser parser;
+        while (pos < received.size()) {
+            if (parser.Parse(received.data() + pos, received.size() - pos) != EHttpParseStatus::Done) {
+                break;
+            }
+            bodies.emplace_back(parser.Message().Body);
+            pos += parser.Consumed();
+            parser.Reset();
+        }
+        co_return;
+    }(client, bodies);
+
+    while (!h.done()) {
+        loop.Step();
+    }
+
+    assert_int_equal(bodies.size(), 3);
+    assert_true(bodies[0] == "/a");
+    assert_true(bodies[1] == std::string(100000, 'x'));
+    assert_true(bodies[2] == "/c");
+}
+
+template<typename TPoller>
+void test_http_server_too_large(void**) {
+    using TLoop = TLoop<TPoller>;
+    using TSocket = typename TPoller::TSocket;
+
+    int port = getport();
+    TLoop loop;
+    TSocket socket(NNet::TAddress{"127.0.0.1", port}, loop.Poller());
+    socket.Bind();
+    socket.Listen();
+
+    int handled = 0;
+    THttpServer server(socket, [&](const THttpRequest& request, THttpResponse& response) -> TFuture<void> {
+        handled++;
+        co_return;
+    }, THttpServerOptions{.MaxBodySize = 10});
+    auto serve = server.Serve();
+
+    int status = 0;
+    TSocket client(NNet::TAddress{"127.0.0.1", port}, loop.Poller());
+    TFuture<void> h = [](TSocket& client, int& status) -> TFuture<void>
+    {
+        co_await client.Connect();
+        std::string request = "POST / HTTP/1.1\r\nContent-Length: 100\r\n\r\n";
+        co_await TByteWriter(client).Write(request.data(), request.size());
+        std::string received;
+        char buf[4096];
+        ssize_t size;
+        while ((size = co_await client.ReadSome(buf, sizeof(buf))) != 0) {
+            if (size > 0) {
+                received.append(buf, size);
+            }
+        }
+        THttpReplyParser parser;
+        assert_true(parser.Finish(received.data(), received.size()) == EHttpParseStatus::Done);
+        status = parser.Message().Status;
+        co_return;
+    }(client, status);
+
+    while (!h.done()) {
+        loop.Step();
+    }
+
+    assert_int_equal(status, 413);
+    assert_int_equal(handled, 0);
+}
+
+template<typename TPoller>
+void test_http_server_ssl(void**) {
+    using TLoop = TLoop<TPoller>;
+    using TSocket = typename TPoller::TSocket;
+
+    int port = getport();
+    TLoop loop;
+    TSocket socket(NNet::TAddress{"127.0.0.1", port}, loop.Poller());
+    socket.Bind();
+    socket.Listen();
+
+    std::string body;
+    TFuture<void> h1 = [](TSocket& server) -> TFuture<void>
+    {
+        TSslContext ctx = TSslContext::ServerFromMem(testMemCert, testMemKey);
+        auto client = std::move(co_await server.Accept());
+        auto sslClient = TSslSocket(std::move(client), ctx);
+        co_await sslClient.AcceptHandshake();
+        auto handler = [](const THttpRequest& request, THttpResponse& response) {
+            response.AddChunk(std::string(request.Path));
+            response.AddChunk("!");
+        };
+        co_await ServeHttpConnection(sslClient, handler);
+        co_return;
+    }(socket);
+
+    TSocket client(NNet::TAddress{"127.0.0.1", port}, loop.Poller());
+    TFuture<void> h2 = [](TSocket&& client, std::string& body) -> TFuture<void>
+    {
+        TSslContext ctx = TSslContext::Client();
+        auto sslClient = TSslSocket(std::move(client), ctx);
+        co_await sslClient.Connect();
+        std::string request = "GET /secure HTTP/1.1\r\nConnection: close\r\n\r\n";
+        co_await TByteWriter(sslClient).Write(request.data(), request.size());
+        std::vector<char> buffer(4096);
+        size_t wpos = 0;
+        THttpReplyParser parser;
+        while (parser.Parse(buffer.data(), wpos) == EHttpParseStatus::Incomplete) {
+            auto size = co_await sslClient.ReadSome(buffer.data() + wpos, buffer.size() - wpos);
+            if (size == 0) {
+                break;
+            }
+            wpos += std::max<ssize_t>(size, 0);
+        }
+        body = parser.Message().Body;
+        co_return;
+    }(std::move(client), body);
+
+    while (!(h1.done() && h2.done())) {
+        loop.Step();
+    }
+
+    assert_true(body == "/secure!");
+}
+
+void test_http_chunk_decoder(void**) {
+    std::string data = "5\r\nhello\r\n7;ext=1\r\n, world\r\n0\r\nTrailer: x\r\n\r\n";
+    // feed in small pieces keeping unconsumed input, as a streaming reader does
+    THttpChunkDecoder decoder;
+    std::string body, input;
+    EHttpParseStatus status = EHttpParseStatus::Incomplete;
+    for (size_t i = 0; i < data.size() && status != EHttpParseStatus::Done; i += 3) {
+        input.append(data.substr(i, 3));
+        while (true) {
+            size_t consumed = 0;
+            std::string_view payload;
+            status = decoder.Decode(input.data(), input.size(), &consumed, &payload);
+            assert_true(status != EHttpParseStatus::Error);
+            body.append(payload);
+            input.erase(0, consumed);
+            if (status == EHttpParseStatus::Done || payload.empty()) {
+                break;
+            }
+        }
+    }
+    assert_true(status == EHttpParseStatus::Done);
+    assert_true(body == "hello, world");
+    assert_true(input.empty());
+}
+
+template<typename TPoller>
+void test_http_client_pipelined(void**) {
+    using TLoop = TLoop<TPoller>;
+    using TSocket = typename TPoller::TSocket;
+
+    int port = getport();
+    TLoop loop;
+    TSocket socket(NNet::TAddress{"127.0.0.1", port}, loop.Poller());
+    socket.Bind();
+    socket.Listen();
+
+    THttpServer server(socket, [](const THttpRequest& request, THttpResponse& response) -> TFuture<void> {
+        if (request.Path == "/chunked") {
+            for (int i = 0; i < 100; i++) {
+                response.AddChunk(std::string(1000, 'a' + i % 26));
+            }
+        } else {
+            response.SetBody(std::string(request.Path) + std::string(request.Body));
+        }
+        co_return;
+    });
+    auto serve = server.Serve();
+
+    THttpClientOptions options;
+    options.MaxConnectionsPerHost = 2;
+    options.MaxPipeline = 8;
+    THttpClient<TSocket> client(loop.Poller(), options);
+    TAddress address{"127.0.0.1", port};
+
+    std::vector<std::string> bodies(20);
+    std::vector<TFuture<void>> requests;
+    for (int i = 0; i < 20; i++) {
+        requests.emplace_back([](THttpClient<TSocket>& client, const TAddress& address, int i, std::string& body) -> TFuture<void> {
+            std::string target = "/" + std::to_string(i);
+            THttpClientRequest request;
+            request.Method = "POST";
+            request.Target = target;
+            request.Body = "!";
+            auto [response, data] = co_await client.Fetch(address, request);
+            assert_int_equal(response.Status(), 200);
+            body = std::move(data);
+            co_return;
+        }(client, address, i, bodies[i]));
+    }
+
+    std::string chunked;
+    TFuture<void> h = [](THttpClient<TSocket>& client, const TAddress& address, std::string& body) -> TFuture<void> {
+        THttpClientRequest request;
+        request.Target = "/chunked";
+        auto response = co_await client.Send(address, request);
+        assert_true(response.Head().Chunked);
+        while (true) {
+            auto piece = co_await response.Next();
+            if (piece.empty()) {
+                break;
+            }
+            body.append(piece);
+        }
+        co_return;
+    }(client, address, chunked);
+
+    while (!(h.done() && std::all_of(requests.begin(), requests.end(), [](auto& r) { return r.done(); }))) {
+        loop.Step();
+    }
+
+    for (int i = 0; i < 20; i++) {
+        assert_true(bodies[i] == "/" + std::to_string(i) + "!");
+    }
+    assert_int_equal(chunked.size(), 100000);
+    assert_true(chunked[0] == 'a' && chunked[99999] == 'a' + 99 % 26);
+    assert_true(client.Connections() <= 2);
+}
+
+template<typename TPoller>
+void test_http_client_head(void**) {
+    using TLoop = TLoop<TPoller>;
+    using TSocket = typename TPoller::TSocket;
+
+    int port = getport();
+    TLoop loop;
+    TSocket socket(NNet::TAddress{"127.0.0.1", port}, loop.Poller());
+    socket.Bind();
+    socket.Listen();
+
+    THttpServer server(socket, [](const THttpRequest& request, THttpResponse& response) -> TFuture<void> {
+        response.SetBody("payload" + std::string(request.Path));
+        co_return;
+    });
+    auto serve = server.Serve();
+
+    // one connection: the GET is pipelined behind the HEAD, whose reply has Content-Length
+    // but no body, so the reply of the GET follows its head directly
+    THttpClientOptions options;
+    options.MaxConnectionsPerHost = 1;
+    options.MaxPipeline = 8;
+    THttpClient<TSocket> client(loop.Poller(), options);
+    TAddress address{"127.0.0.1", port};
+
+    std::string headBody = "unset", getBody;
+    auto fetch = [](THttpClient<TSocket>& client, const TAddress& address, std::string method, std::string target, std::string& body) -> TFuture<void> {
+        THttpClientRequest request;
+        request.Method = method;
+        request.Target = target;
+        auto [response, data] = co_await client.Fetch(address, request);
+        assert_int_equal(response.Status(), 200);
+        body = std::move(data);
+        co_return;
+    };
+    TFuture<void> head = fetch(client, address, "HEAD", "/head", headBody);
+    TFuture<void> get = fetch(client, address, "GET", "/get", getBody);
+
+    while (!(head.done() && get.done())) {
+        loop.Step();
+    }
+
+    assert_true(headBody.empty());
+    assert_true(getBody == "payload/get");
+    assert_int_equal(client.Connections(), 1);
+}
+
+template<typename TPoller>
+void test_http_client_dropped(void**) {
+    using TLoop = TLoop<TPoller>;
+    using TSocket = typename TPoller::TSocket;
+
+    int port = getport();
+    TLoop loop;
+    TSocket socket(NNet::TAddress{"127.0.0.1", port}, loop.Poller());
+    socket.Bind();
+    socket.Listen();
+
+    int served = 0;
+    THttpServer server(socket, [&](const THttpRequest& request, THttpResponse& response) -> TFuture<void> {
+        served++;
+        response.SetBody(std::string(request.Path));
+        co_return;
+    });
+    auto serve = server.Serve();
+
+    THttpClientOptions options;
+    options.MaxConnectionsPerHost = 1;
+    options.MaxPipeline = 8;
+    THttpClient<TSocket> client(loop.Poller(), options);
+    TAddress address{"127.0.0.1", port};
+    THttpClientRequest request;
+
+    request.Target = "/first";
+    TFuture<THttpClientResponse<TSocket>> first = client.Send(address, request);
+    while (!first.done()) {
+        loop.Step();
+    }
+    auto response = first.await_resume();
+
+    // queued behind the first one, waiting for their turns after their requests are written
+    int failures = 0;
+    auto fetch = [](THttpClient<TSocket>& client, const TAddress& address, std::string target, std::string& body, int& failures) -> TFuture<void> {
+        THttpClientRequest request;
+        request.Target = target;
+        try {
+            auto [_, data] = co_await client.Fetch(address, request);
+            body = std::move(data);
+        } catch (const std::system_error& ) {
+            failures++;
+        }
+    };
+    std::string thirdBody, lastBody;
+    request.Target = "/second";
+    std::optional<TFuture<THttpClientResponse<TSocket>>> dropped = client.Send(address, request);
+    TFuture<void> third = fetch(client, address, "/third", thirdBody, failures);
+    while (served < 3) {
+        loop.Step();
+    }
+    dropped.reset();
+
+    // the connection is failed by the dropped request, the pipeline behind it gets the error
+    TFuture<void> rest = [](THttpClientResponse<TSocket>& response, int& failures) -> TFuture<void> {
+        try {
+            co_await response.ReadAll();
+        } catch (const std::system_error& ) {
+            failures++;
+        }
+    }(response, failures);
+    while (!(rest.done() && third.done())) {
+        loop.Step();
+    }
+    assert_int_equal(failures, 2);
+
+    TFuture<void> last = fetch(client, address, "/last", lastBody, failures);
+    while (!last.done()) {
+        loop.Step();
+    }
+    assert_int_equal(failures, 2);
+    assert_true(lastBody == "/last");
+    assert_int_equal(client.Connections(), 1);
+}
+
+template<typename TPoller>
+void test_http_client_deadline(void**) {
+    using TLoop = TLoop<TPoller>;
+    using TSocket = typename TPoller::TSocket;
+
+    int port = getport();
+    TLoop loop;
+    TSocket socket(NNet::TAddress{"127.0.0.1", port}, loop.Poller());
+    socket.Bind();
+    socket.Listen();
+
+    auto& poller = loop.Poller();
+    THttpServer server(socket, [&](const THttpRequest& request, THttpResponse& response) -> TFuture<void> {
+        if (request.Path == "/slow") {
+            co_await poller.Sleep(std::chrono::milliseconds(500));
+        }
+        response.SetBody("ok");
+        co_return;
+    });
+    auto serve = server.Serve();
+
+    THttpClient<TSocket> client(loop.Poller());
+    TAddress address{"127.0.0.1", port};
+    bool timedOut = false;
+    std::string body;
+    TFuture<void> h = [](THttpClient<TSocket>& client, const TAddress& address, bool& timedOut, std::string& body) -> TFuture<void> {
+        THttpClientRequest request;
+        request.Target = "/slow";
+        request.Deadline = TClock::now() + std::chrono::milliseconds(50);
+        try {
+            co_await client.Fetch(address, request);
+        } catch (const std::system_error& ex) {
+            timedOut = ex.code() == std::errc::timed_out;
+        }
+        // a fresh connection replaces the one closed by the timeout
+        request.Target = "/";
+        request.Deadline = TTime::max();
+        auto [response, data] = co_await client.Fetch(address, request);
+        body = std::move(data);
+        co_return;
+    }(client, address, timedOut, body);
+
+    auto start = TClock::now();
+    while (!h.done()) {
+        loop.Step();
+    }
+
+    assert_true(timedOut);
+    assert_true(body == "ok");
+    assert_true(TClock::now() - start < std::chrono::milliseconds(400));
+}
+
+void test_ws_accept_key(void**) {
+    // RFC 6455 1.3
+    assert_true(WsAcceptKey("dGhlIHNhbXBsZSBub25jZQ==") == "s3pPLMBiTxaQ9kYGzzhZRbK+xOo=");
+    assert_int_equal(WsGenerateKey().size(), 24);
+}
+
+void test_ws_mask(void**) {
+    const uint8_t mask[4] = {0x12, 0x34, 0x56, 0x78};
+    uint32_t seed = 31337;
+    for (size_t size : {0, 1, 3, 7, 15, 16, 31, 32, 33, 63, 100, 1000}) {
+        for (size_t offset = 0; offset < 4; offset++) {
+            std::vector<char> data(size);
+            for (auto& ch : data) {
+                ch = rand_(&seed);
+            }
+            auto expected = data;
+            for (size_t i = 0; i < size; i++) {
+                expected[i] ^= mask[(offset + i) & 3];
+            }
+            WsMask(data.data(), size, mask, offset);
+            assert_memory_equal(data.data(), expected.data(), size);
+        }
+    }
+}
+
+void test_ws_frame_header(void**) {
+    const uint8_t mask[4] = {1, 2, 3, 4};
+    for (uint64_t length : {0ULL, 125ULL, 126ULL, 65535ULL, 65536ULL, 1ULL << 40}) {
+        char buf[14];
+        size_t size = WsWriteFrameHeader(buf, false, EWsOpcode::Binary, length, mask);
+        for (size_t i = 0; i < size; i++) {
+            TWsFrameHeader header;
+            assert_true(WsParseFrameHeader(buf, i, &header) == EHttpParseStatus::Incomplete);
+        }
+        TWsFrameHeader header;
+        assert_true(WsParseFrameHeader(buf, size, &header) == EHttpParseStatus::Done);
+        assert_int_equal(header.Size, size);
+        assert_int_equal(header.Length, length);
+        assert_false(header.Fin);
+        assert_true(header.Opcode == EWsOpcode::Binary);
+        assert_true(header.Masked);
+        assert_memory_equal(header.Mask, mask, 4);
+    }
+}
+
+template<typename TPoller>
+void test_ws_echo(void**) {
+    using TLoop = TLoop<TPoller>;
+    using TSocket = typename TPoller::TSocket;
+
+    int port = getport();
+    TLoop loop;
+    TSocket socket(NNet::TAddress{"127.0.0.1", port}, loop.Poller());
+    socket.Bind();
+    socket.Listen();
+
+    std::vector<std::string> received;
+    TFuture<void> h1 = [](TSocket& server, std::vector<std::string>& received) -> TFuture<void>
+    {
+        auto client = std::move(co_await server.Accept());
+        TWebSocket ws(client, false);
+        co_await ws.Accept();
+        while (true) {
+            auto message = co_await ws.Receive();
+            if (message.Opcode == EWsOpcode::Close) {
+                break;
+            }
+            received.emplace_back(message.Payload);
+            co_await ws.Send(message.Payload, message.Opcode);
+        }
+        co_return;
+    }(socket, received);
+
+    std::vector<std::string> echoed;
+    TSocket client(NNet::TAddress{"127.0.0.1", port}, loop.Poller());
+    TFuture<void> h2 = [](TSocket& client, std::vector<std::string>& echoed) -> TFuture<void>
+    {
+        co_await client.Connect();
+        TWebSocket ws(client, true);
+        co_await ws.Connect("localhost", "/");
+
+        co_await ws.Send("hello");
+        auto message = co_await ws.Receive();
+        echoed.emplace_back(message.Payload);
+
+        // fragmented message with a ping between the fragments, written as raw frames
+        std::string big(100000, 'b');
+        std::string frames;
+        char header[14];
+        const uint8_t mask[4] = {9, 8, 7, 6};
+        auto append = [&](bool fin, EWsOpcode opcode, std::string_view payload) {
+            frames.append(header, WsWriteFrameHeader(header, fin, opcode, payload.size(), mask));
+            size_t pos = frames.size();
+            frames.append(payload);
+            WsMask(frames.data() + pos, payload.size(), mask);
+        };
+        append(false, EWsOpcode::Text, "frag1-");
+        append(true, EWsOpcode::Ping, "p");
+        append(false, EWsOpcode::Continuation, big);
+        append(true, EWsOpcode::Continuation, "-frag3");
+        co_await TByteWriter(client).Write(frames.data(), frames.size());
+        message = co_await ws.Receive();
+        echoed.emplace_back(message.Payload);
+
+        co_await ws.Close();
+        auto close = co_await ws.Receive();
+        assert_true(close.Opcode == EWsOpcode::Close);
+        co_return;
+    }(client, echoed);
+
+    while (!(h1.done() && h2.done())) {
+        loop.Step();
+    }
+
+    std::string expected = "frag1-" + std::string(100000, 'b') + "-frag3";
+    assert_int_equal(received.size(), 2);
+    assert_true(received[0] == "hello");
+    assert_true(received[1] == expected);
+    assert_int_equal(echoed.size(), 2);
+    assert_true(echoed[0] == "hello");
+    assert_true(echoed[1] == expected);
+}
+
+void test_resp_parse(void**) {
+    std::vector<TRespNode> nodes;
+    size_t consumed = 0, need = 0;
+
+    std::string data = "*3\r\n$3\r\nfoo\r\n:-42\r\n*2\r\n+OK\r\n$-1\r\n";
+    assert_true(RespParse(data.data(), data.size(), nodes, &consumed, &need) == ERespStatus::Done);
+    assert_int_equal(consumed, data.size());
+    TRespValue root(nodes.data());
+    assert_true(root.Type() == ERespType::Array);
+    assert_int_equal(root.Size(), 3);
+    assert_true(root[0].String() == "foo");
+    assert_int_equal(root[1].Integer(), -42);
+    assert_int_equal(root[2].Size(), 2);
+    assert_true(root[2][0].String() == "OK");
+    assert_true(root[2][1].IsNull());
+
+    // every proper prefix is incomplete, need never exceeds the full size
+    for (size_t i = 0; i < data.size(); i++) {
+        assert_true(RespParse(data.data(), i, nodes, &consumed, &need) == ERespStatus::Incomplete);
+        assert_true(need > i && need <= data.size());
+    }
+
+    std::string resp3 = "|1\r\n+ttl\r\n:3600\r\n%2\r\n+a\r\n,1.5\r\n+b\r\n#t\r\n";
+    assert_true(RespParse(resp3.data(), resp3.size(), nodes, &consumed, &need) == ERespStatus::Done);
+    TRespValue map(nodes.data());
+    assert_true(map.Type() == ERespType::Map);
+    assert_int_equal(map.Size(), 4);
+    assert_true(map[1].Double() == 1.5);
+    assert_true(map[3].Boolean());
+
+    std::string big = "$100000\r\n";
+    assert_true(RespParse(big.data(), big.size(), nodes, &consumed, &need) == ERespStatus::Incomplete);
+    assert_int_equal(need, big.size() + 100002);
+
+    std::string bad = "?oops\r\n";
+    assert_true(RespParse(bad.data(), bad.size(), nodes, &consumed, &need) == ERespStatus::Error);
+}
+
+template<typename TPoller>
+void test_redis_pipelining(void**) {
+    using TLoop = TLoop<TPoller>;
+    using TSocket = typename TPoller::TSocket;
+
+    int port = getport();
+    TLoop loop;
+    TSocket socket(NNet::TAddress{"127.0.0.1", port}, loop.Poller());
+    socket.Bind();
+    socket.Listen();
+
+    // echoes the argument of every command, counts reads to observe batching
+    int reads = 0;
+    TFuture<void> server = [](TSocket& listener, int& reads) -> TFuture<void> {
+        auto client = co_await listener.Accept();
+        std::vector<char> buffer(64 * 1024);
+        std::vector<TRespNode> nodes;
+        size_t wpos = 0;
+        while (true) {
+            auto size = co_await client.ReadSome(buffer.data() + wpos, buffer.size() - wpos);
+            if (size <= 0) {
+                break;
+            }
+            reads++;
+            wpos += size;
+            size_t rpos = 0, consumed, need;
+            std::string out;
+            while (RespParse(buffer.data() + rpos, wpos - rpos, nodes, &consumed, &need) == ERespStatus::Done) {
+                rpos += consumed;
+                auto arg = TRespValue(nodes.data())[1].String();
+                out += "$" + std::to_string(arg.size()) + "\r\n" + std::string(arg) + "\r\n";
+            }
+            memmove(buffer.data(), buffer.data() + rpos, wpos - rpos);
+            wpos -= rpos;
+            co_await TByteWriter(client).Write(out.data(), out.size());
+        }
+        co_return;
+    }(socket, reads);
+
+    TSocket client(NNet::TAddress{"127.0.0.1", port}, loop.Poller());
+    TFuture<void> connect = [](TSocket& client) -> TFuture<void> {
+        co_await client.Connect();
+    }(client);
+    while (!connect.done()) {
+        loop.Step();
+    }
+
+    TRedisClient<TSocket> redis(client);
+    std::vector<std::string> replies(100);
+    std::vector<TFuture<void>> callers;
+    for (int i = 0; i < 100; i++) {
+        callers.emplace_back([](TRedisClient<TSocket>& redis, int i, std::string& reply) -> TFuture<void> {
+            auto value = co_await redis.Get("k" + std::to_string(i));
+            reply = *value;
+            co_return;
+        }(redis, i, replies[i]));
+    }
+    assert_int_equal(redis.Inflight(), 100);
+
+    while (!std::all_of(callers.begin(), callers.end(), [](auto& c) { return c.done(); })) {
+        loop.Step();
+    }
+
+    for (int i = 0; i < 100; i++) {
+        assert_true(replies[i] == "k" + std::to_string(i));
+    }
+    // all commands were issued in one loop iteration and went out with one write
+    assert_int_equal(reads, 1);
+
+    // a caller gone before its reply: the reply is dropped, the next one goes to the next caller
+    std::string reply;
+    {
+        TFuture<std::optional<std::string>> gone = redis.Get("gone");
+        assert_int_equal(redis.Inflight(), 1);
+    }
+    TFuture<void> after = [](TRedisClient<TSocket>& redis, std::string& reply) -> TFuture<void> {
+        reply = *co_await redis.Get("after");
+        co_return;
+    }(redis, reply);
+    while (!after.done()) {
+        loop.Step();
+    }
+    assert_true(reply == "after");
+    assert_int_equal(redis.Inflight(), 0);
+}
+
+void test_memcached_ring(void**) {
+    std::vector<std::string> servers = {"10.0.0.1:11211", "10.0.0.2:11211", "10.0.0.3:11211", "10.0.0.4:11211"};
+    TConsistentHash ring(servers);
+    std::vector<int> counts(servers.size());
+    std::vector<size_t> owners;
+    for (int i = 0; i < 10000; i++) {
+        auto owner = ring.Find("key:" + std::to_string(i));
+        owners.push_back(owner);
+        counts[owner]++;
+    }
+    for (auto count : counts) {
+        assert_true(count > 1500 && count < 3500);
+    }
+
+    // keys of the remaining servers stay where they were
+    servers.pop_back();
+    TConsistentHash smaller(servers);
+    for (int i = 0; i < 10000; i++) {
+        if (owners[i] != 3) {
+            assert_int_equal(smaller.Find("key:" + std::to_string(i)), owners[i]);
+        }
+    }
+
+    TMemcachedValueHeader header;
+    assert_true(MemcachedParseValue("VALUE foo 5 3 77", &header));
+    assert_true(header.Key == "foo");
+    assert_int_equal(header.Flags, 5);
+    assert_int_equal(header.Bytes, 3);
+    assert_int_equal(header.Cas, 77);
+    assert_false(MemcachedParseValue("VALUE foo 5", &header));
+    assert_true(MemcachedValidKey("user:42"));
+    assert_false(MemcachedValidKey("two words"));
+    assert_false(MemcachedValidKey(std::string(251, 'k')));
+}
+
+template<typename TPoller>
+void test_memcached_batching(void**) {
+    using TLoop = TLoop<TPoller>;
+    using TSocket = typename TPoller::TSocket;
+
+    int port = getport();
+    TLoop loop;
+    TSocket socket(NNet::TAddress{"127.0.0.1", port}, loop.Poller());
+    socket.Bind();
+    socket.Listen();
+
+    // odd keys are stored, records every command line
+    std::vector<std::string> commands;
+    TFuture<void> server = [](TSocket& listener, std::vector<std::string>& commands) -> TFuture<void> {
+        auto client = co_await listener.Accept();
+        TLineReader reader(client, 1024);
+        while (true) {
+            auto line = co_await reader.Read();
+            if (!line) {
+                break;
+            }
+            std::string command = std::string(line.Part1) + std::string(line.Part2);
+            command.resize(command.size() - 2);
+            commands.push_back(command);
+            std::string out;
+            if (command.starts_with("get ")) {
+                std::istringstream keys(command.substr(4));
+                std::string key;
+                while (keys >> key) {
+                    if ((key.back() - '0') % 2) {
+                        out += "VALUE " + key + " 0 " + std::to_string(key.size()) + "\r\n" + key + "\r\n";
+                    }
+                }
+                out += "END\r\n";
+            } else if (command.starts_with("set ")) {
+                co_await reader.Read(); // data block
+                out += "STORED\r\n";
+            } else {
+                out += "ERROR\r\n";
+            }
+            co_await TByteWriter(client).Write(out.data(), out.size());
+        }
+        co_return;
+    }(socket, commands);
+
+    TSocket client(NNet::TAddress{"127.0.0.1", port}, loop.Poller());
+    TFuture<void> connect = [](TSocket& client) -> TFuture<void> {
+        co_await client.Connect();
+    }(client);
+    while (!connect.done()) {
+        loop.Step();
+    }
+
+    TMemcachedClient<TSocket> memcached({&client});
+    std::vector<std::optional<std::string>> values(20);
+    std::vector<TFuture<void>> callers;
+    for (int i = 0; i < 20; i++) {
+        callers.emplace_back([](TMemcachedClient<TSocket>& memcached, int i, std::optional<std::string>& value) -> TFuture<void> {
+            // every key is asked twice
+            auto key = "k" + std::to_string(i % 10);
+            value = co_await memcached.Get(key);
+            co_return;
+        }(memcached, i, values[i]));
+    }
+    TFuture<bool> set = memcached.Set("x", "value");
+    TFuture<void> unknown = [](TMemcachedClient<TSocket>& memcached) -> TFuture<void> {
+        co_await memcached.Incr("x", 1);
+    }(memcached);
+    TFuture<void> last = [](TMemcachedClient<TSocket>& memcached, std::optional<std::string>& value) -> TFuture<void> {
+        value = co_await memcached.Get("k1");
+    }(memcached, values[0]);
+
+    while (!last.done()) {
+        loop.Step();
+    }
+
+    // gets before the set went out as one command, the order of commands is kept
+    assert_int_equal(commands.size(), 4);
+    assert_true(commands[0].starts_with("get "));
+    assert_int_equal(std::count(commands[0].begin(), commands[0].end(), ' '), 10);
+    assert_true(commands[1] == "set x 0 0 5");
+    assert_true(commands[2] == "incr x 1");
+    assert_true(commands[3] == "get k1");
+    for (int i = 1; i < 20; i++) {
+        assert_true(callers[i].done());
+        if (i % 2) {
+            assert_true(values[i] == "k" + std::to_string(i % 10));
+        } else {
+            assert_false(values[i].has_value());
+        }
+    }
+    assert_true(values[0] == "k1");
+    assert_true(set.await_resume());
+    assert_true(unknown.done());
+    try {
+        unknown.await_resume();
+        assert_true(false);
+    } catch (const std::runtime_error& e) {
+        assert_string_equal(e.what(), "ERROR");
+    }
+
+    // callers gone before their replies: one shares its key with a live caller, one is a set
+    auto get = [](TMemcachedClient<TSocket>& memcached, std::string key, std::optional<std::string>& value) -> TFuture<void> {
+        value = co_await memcached.Get(key);
+    };
+    std::optional<std::string> shared, after;
+    TFuture<void> live = get(memcached, "k3", shared);
+    {
+        TFuture<std::optional<std::string>> gone = memcached.Get("k3");
+        TFuture<bool> goneSet = memcached.Set("y", "value");
+    }
+    TFuture<void> next = get(memcached, "k5", after);
+    while (!(live.done() && next.done())) {
+        loop.Step();
+    }
+    assert_true(shared == "k3");
+    assert_true(after == "k5");
+    assert_int_equal(commands.size(), 7);
+}
+
+template<typename TPoller>
+void test_memcached_too_large(void**) {
+    using TLoop = TLoop<TPoller>;
+    using TSocket = typename TPoller::TSocket;
+
+    int port = getport();
+    TLoop loop;
+    TSocket socket(NNet::TAddress{"127.0.0.1", port}, loop.Poller());
+    socket.Bind();
+    socket.Listen();
+
+    // a value over MaxValueSize, and over the buffer of the client too
+    TFuture<void> server = [](TSocket& listener) -> TFuture<void> {
+        auto client = co_await listener.Accept();
+        TLineReader reader(client, 1024);
+        co_await reader.Read();
+        std::string out = "VALUE big 0 4000\r\n" + std::string(4000, 'x') + "\r\nEND\r\n";
+        co_await TByteWriter(client).Write(out.data(), out.size());
+        co_await reader.Read();
+        co_return;
+    }(socket);
+
+    TSocket client(NNet::TAddress{"127.0.0.1", port}, loop.Poller());
+    TFuture<void> connect = [](TSocket& client) -> TFuture<void> {
+        co_await client.Connect();
+    }(client);
+    while (!connect.done()) {
+        loop.Step();
+    }
+
+    TMemcachedClient<TSocket> memcached({&client}, TMemcachedOptions{.MaxValueSize = 100});
+    std::string error;
+    TFuture<void> get = [](TMemcachedClient<TSocket>& memcached, std::string& error) -> TFuture<void> {
+        try {
+            co_await memcached.Get("big");
+        } catch (const std::runtime_error& e) {
+            error = e.what();
+        }
+    }(memcached, error);
+    while (!get.done()) {
+        loop.Step();
+    }
+    assert_string_equal(error.c_str(), "Memcached value too large");
+}
+
+void test_rpc_frame(void**) {
+    std::string out;
+    RpcAppendFrame(out, {.Type = ERpcFrame::Request, .Id = 0x0102030405060708ULL, .Method = 7, .Timeout = 250}, "payload");
+    assert_int_equal(out.size(), RpcFrameHeaderSize + 7);
+    TRpcFrameHeader header;
+    assert_true(RpcParseFrameHeader(out.data(), &header));
+    assert_true(header.Type == ERpcFrame::Request);
+    assert_true(header.Id == 0x0102030405060708ULL);
+    assert_int_equal(header.Method, 7);
+    assert_int_equal(header.Timeout, 250);
+    assert_int_equal(header.Size, 7);
+    out[4] = 42;
+    assert_false(RpcParseFrameHeader(out.data(), &header));
+}
+
+template<typename TPoller>
+void test_rpc_multiplexing(void**) {
+    using TLoop = TLoop<TPoller>;
+    using TSocket = typename TPoller::TSocket;
+
+    int port = getport();
+    TLoop loop;
+    TSocket socket(NNet::TAddress{"127.0.0.1", port}, loop.Poller());
+    socket.Bind();
+    socket.Listen();
+
+    int cancelled = 0;
+    TRpcHandlers handlers;
+    // sleeps for payload milliseconds, later requests complete first
+    handlers[1] = [&](const TRpcRequest& request) -> TFuture<std::string> {
+        co_await loop.Poller().Sleep(std::chrono::milliseconds(std::stoi(request.Payload)));
+        co_return "reply " + request.Payload;
+    };
+    handlers[2] = [](const TRpcRequest& request) -> TFuture<std::string> {
+        throw std::runtime_error("failed " + request.Payload);
+        co_return "";
+    };
+    handlers[3] = [&](const TRpcRequest& request) -> TFuture<std::string> {
+        while (!request.Cancelled()) {
+            co_await loop.Poller().Sleep(std::chrono::milliseconds(5));
+        }
+        cancelled++;
+        co_return "";
+    };
+    TRpcServer<TSocket> server(socket, handlers);
+    auto serving = server.Serve();
+
+    TSocket client(NNet::TAddress{"127.0.0.1", port}, loop.Poller());
+    TFuture<void> connect = [](TSocket& client) -> TFuture<void> {
+        co_await client.Connect();
+    }(client);
+    while (!connect.done()) {
+        loop.Step();
+    }
+    TRpcClient<TSocket> rpc(client);
+
+    std::vector<std::string> order;
+    std::vector<TFuture<void>> callers;
+    for (int delay : {60, 40, 20, 0}) {
+        callers.emplace_back([](TRpcClient<TSocket>& rpc, int delay, std::vector<std::string>& order) -> TFuture<void> {
+            auto payload = std::to_string(delay);
+            auto reply = co_await rpc.Call(1, payload);
+            assert_true(reply == "reply " + payload);
+            order.push_back(reply);
+        }(rpc, delay, order));
+    }
+    std::string error, timeout;
+    callers.emplace_back([](TRpcClient<TSocket>& rpc, std::string& error) -> TFuture<void> {
+        try {
+            co_await rpc.Call(2, "x");
+        } catch (const std::runtime_error& ex) {
+            error = ex.what();
+        }
+    }(rpc, error));
+    callers.emplace_back([](TRpcClient<TSocket>& rpc, std::string& timeout) -> TFuture<void> {
+        try {
+            co_await rpc.Call(3, "", TClock::now() + std::chrono::milliseconds(10));
+        } catch (const std::system_error& ex) {
+            timeout = ex.what();
+        }
+    }(rpc, timeout));
+    // cancelled by destroying the call
+    {
+        auto abandoned = rpc.Call(3, "");
+        assert_int_equal(rpc.Inflight(), 7);
+    }
+    assert_int_equal(rpc.Inflight(), 6);
+
+    while (!std::all_of(callers.begin(), callers.end(), [](auto& c) { return c.done(); }) || cancelled < 2) {
+        loop.Step();
+    }
+    for (auto& c : callers) {
+        c.await_resume();
+    }
+
+    // all requests were in flight at once, responses matched by id
+    assert_int_equal(order.size(), 4);
+    assert_true(order[0] == "reply 0");
+    assert_true(order[3] == "reply 60");
+    assert_true(error == "failed x");
+    assert_false(timeout.empty());
+    assert_int_equal(rpc.Inflight(), 0);
+    assert_int_equal(server.Connections(), 1);
+
+    // a lost connection fails the calls one at a time, the first one resumed destroys the other
+    int closingPort = getport();
+    TSocket closingListener(NNet::TAddress{"127.0.0.1", closingPort}, loop.Poller());
+    closingListener.Bind();
+    closingListener.Listen();
+    TFuture<void> closing = [](TSocket& listener) -> TFuture<void> {
+        auto client = co_await listener.Accept();
+        char buffer[1024];
+        co_await client.ReadSome(buffer, sizeof(buffer));
+        co_return; // closes the connection
+    }(closingListener);
+    TSocket closingClient(NNet::TAddress{"127.0.0.1", closingPort}, loop.Poller());
+    connect = [](TSocket& client) -> TFuture<void> {
+        co_await client.Connect();
+    }(closingClient);
+    while (!connect.done()) {
+        loop.Step();
+    }
+    TRpcClient<TSocket> lost(closingClient);
+    int failures = 0;
+    std::optional<TFuture<void>> first, second;
+    auto call = [](TRpcClient<TSocket>& rpc, std::optional<TFuture<void>>& other, int& failures) -> TFuture<void> {
+        try {
+            co_await rpc.Call(1, "0");
+        } catch (const std::exception&) {
+            failures++;
+            other.reset();
+        }
+    };
+    first.emplace(call(lost, second, failures));
+    second.emplace(call(lost, first, failures));
+    while (lost.Inflight() > 0) {
+        loop.Step();
+    }
+    assert_int_equal(failures, 1);
+}
+
+template<typename TPoller>
+void test_rpc_duplicate_id(void**) {
+    using TLoop = TLoop<TPoller>;
+    using TSocket = typename TPoller::TSocket;
+
+    int port = getport();
+    TLoop loop;
+    TSocket socket(NNet::TAddress{"127.0.0.1", port}, loop.Poller());
+    socket.Bind();
+    socket.Listen();
+
+    TRpcHandlers handlers;
+    handlers[1] = [&](const TRpcRequest& request) -> TFuture<std::string> {
+        co_await loop.Poller().Sleep(std::chrono::milliseconds(std::stoi(request.Payload)));
+        co_return "reply " + request.Payload;
+    };
+    TRpcServer<TSocket> server(socket, handlers);
+    auto serving = server.Serve();
+
+    // a peer reusing the id of a request still in its handler
+    std::vector<std::pair<ERpcFrame, std::string>> frames;
+    TFuture<void> peer = [](TSocket socket, std::vector<std::pair<ERpcFrame, std::string>>& frames) -> TFuture<void> {
+        co_await socket.Connect();
+        std::string out;
+        RpcAppendFrame(out, {.Type = ERpcFrame::Request, .Id = 7, .Method = 1}, "20");
+        RpcAppendFrame(out, {.Type = ERpcFrame::Request, .Id = 7, .Method = 1}, "0");
+        co_await TByteWriter(socket).Write(out.data(), out.size());
+        NDetail::TRpcFrameReader<TSocket> reader(socket, TRpcOptions{});
+        TRpcFrameHeader header;
+        std::string_view payload;
+        while (frames.size() < 2) {
+            bool more = co_await reader.Next(&header, &payload);
+            assert_true(more);
+            assert_int_equal(header.Id, 7);
+            frames.emplace_back(header.Type, std::string(payload));
+        }
+    }(TSocket(NNet::TAddress{"127.0.0.1", port}, loop.Poller()), frames);
+
+    while (!peer.done()) {
+        loop.Step();
+    }
+    peer.await_resume();
+    assert_true(frames[0].first == ERpcFrame::Error);
+    assert_true(frames[0].second == "Duplicate request id 7");
+    assert_true(frames[1].first == ERpcFrame::Response);
+    assert_true(frames[1].second == "reply 20");
+}
+
+template<typename TPoller>
+void test_future_chaining(void**) {
+    TFuture<int> intFuture = []() -> TFuture<int> {
+        co_return 1;
+    }();
+
+    TFuture<double> doubleFuture = intFuture.Apply([](int value) -> double {
+        return value * 1.5;
+    });
+
+    double val = -1;
+    [&](TFuture<double>&& f, double* val) -> TFuture<void> {
+        *val = co_await f;
+    }(std::move(doubleFuture), &val);
+
+    assert_true(std::abs(val - 1.5) < 1e-13);
+}
+
+template<typename TPoller>
+void test_futures_any(void**) {
+    using TLoop = TLoop<TPoller>;
+    TLoop loop;
+
+    int ok = 0;
+    TFuture<void> h2 = [](TPoller& poller, int* ok) -> TFuture<void> {
+        std::vector<TFuture<void>> futures;
+        futures.emplace_back([](TPoller& poller) -> TFuture<void> {
+            co_await poller.Sleep(std::chrono::milliseconds(100));
+            co_return;
+        }(poller));
+        futures.emplace_back([](TPoller& poller) -> TFuture<void> {
+            co_await poller.Sleep(std::chrono::milliseconds(200));
+            co_return;
+        }(poller));
+        futures.emplace_back([](TPoller& poller) -> TFuture<void> {
+            co_await poller.Sleep(std::chrono::milliseconds(201));
+            co_return;
+        }(poller));
+        futures.emplace_back([](TPoller& poller) -> TFuture<void> {
+            co_await poller.Sleep(std::chrono::milliseconds(202));
+            co_return;
+        }(poller));
+        co_await Any(std::move(futures));
+        *ok = 1;
+        co_return;
+    }(loop.Poller(), &ok);
+
+    while (!h2.done()) {
+        loop.Step();
+    }
+
+    while (loop.Poller().TimersSize() > 0) {
+        loop.Step();
+    }
+
+    assert_true(ok == 1);
+}
+
+template<typename TPoller>
+void test_futures_any_result(void**) {
+    using TLoop = TLoop<TPoller>;
+    TLoop loop;
+
+    int ok = 0;
+    TFuture<void> h2 = [](TPoller& poller, int* ok) -> TFuture<void> {
+        std::vector<TFuture<int>> futures;
+        futures.emplace_back([](TPoller& poller) -> TFuture<int> {
+            co_await poller.Sleep(std::chrono::milliseconds(204));
+            co_return 1;
+        }(poller));
+        futures.emplace_back([](TPoller& poller) -> TFuture<int> {
+            co_await poller.Sleep(std::chrono::milliseconds(100));
+            co_return 2;
+        }(poller));
+        futures.emplace_back([](TPoller& poller) -> TFuture<int> {
+            co_await poller.Sleep(std::chrono::milliseconds(201));
+            co_return 3;
+        }(poller));
+        futures.emplace_back([](TPoller& poller) -> TFuture<int> {
+            co_await poller.Sleep(std::chrono::milliseconds(202));
+            co_return 4;
+        }(poller));
+        *ok = co_await Any(std::move(futures));
+        co_return;
+    }(loop.Poller(), &ok);
+
+    while (!h2.done()) {
+        loop.Step();
+    }
+
+    while (loop.Poller().TimersSize() > 0) {
+        loop.Step();
+    }
+
+    assert_true(ok == 2);
+}
+
+template<typename TPoller>
+void test_futures_any_same_wakeup(void**) {
+    using TLoop = TLoop<TPoller>;
+    TLoop loop;
+
+    int ok = 0;
+    TFuture<void> h2 = [](TPoller& poller, int* ok) -> TFuture<void> {
+        std::vector<TFuture<void>> futures;
+        auto until = TClock::now() + std::chrono::milliseconds(100);
         futures.emplace_back([](TPoller& poller, TTime until, int* ok) -> TFuture<void> {
             co_await poller.Sleep(until);
             (*ok)++;
@@ -1094,6 +3374,77 @@ void test_uring_read_resume(void**) {
     assert_true(h.done());
 }
 
+void test_uring_async_file(void**) {
+    TLoop<TUring> loop;
+    async_file_roundtrip(loop, loop.Poller());
+}
+
+void test_uring_wal(void**) {
+    TLoop<TUring> loop;
+    wal_roundtrip(loop, loop.Poller(), true);
+}
+
+void test_uring_file_ops(void**) {
+    TLoop<TUring> loop;
+    std::string path = "/tmp/coroio_test_uring_file_ops_" + std::to_string(getpid());
+    std::string back(12, ' ');
+    std::string seq;
+    struct stat st = {};
+    bool closed = false;
+
+    TFuture<void> h = [](TUring& uring, std::string path, std::string* back, std::string* seq, struct stat* st, bool* closed) -> TFuture<void> {
+        auto file = co_await TUring::TFileHandle::Open(uring, path, O_RDWR | O_CREAT | O_TRUNC);
+        co_await file.Fallocate(0, 0, 1024 * 1024);
+        fstat(file.Fd(), st);
+
+        auto ret = co_await file.WriteAtSync("world", 5, 4096);
+        assert_int_equal(ret.Written, 5);
+        assert_true(ret.Synced);
+        ret = co_await file.WriteAtSync("hello", 5, 0, false);
+        assert_int_equal(ret.Written, 5);
+        assert_true(ret.Synced);
+
+        // the error of the write, not -ECANCELED of the fsync it cancels
+        auto readonly = co_await TUring::TFileHandle::Open(uring, path, O_RDONLY);
+        int error = 0;
+        try {
+            co_await readonly.WriteAtSync("hello", 5, 0);
+        } catch (const std::system_error& ex) {
+            error = ex.code().value();
+        }
+        assert_int_equal(error, EBADF);
+        co_await readonly.AsyncClose();
+        auto n = co_await file.ReadAt(back->data(), 5, 4096);
+        assert_int_equal(n, 5);
+        n = co_await file.ReadAt(back->data() + 6, 5, 0);
+        assert_int_equal(n, 5);
+
+        // plain reads follow the file position
+        for (int i = 0; i < 5; i++) {
+            char c;
+            n = co_await file.ReadSome(&c, 1);
+            assert_int_equal(n, 1);
+            *seq += c;
+        }
+
+        co_await file.Fsync();
+        co_await file.Fdatasync();
+        co_await file.AsyncClose();
+        *closed = file.Fd() < 0;
+        co_return;
+    }(loop.Poller(), path, &back, &seq, &st, &closed);
+
+    while (!h.done()) {
+        loop.Step();
+    }
+    unlink(path.c_str());
+
+    assert_int_equal(st.st_size, 1024 * 1024);
+    assert_string_equal(back.c_str(), "world hello ");
+    assert_string_equal(seq.c_str(), "hello");
+    assert_true(closed);
+}
+
 void test_uring_no_sqe(void** ) {
     TUring uring(1);
     char rbuf[1] = {'k'};
@@ -1109,6 +3460,273 @@ void test_uring_no_sqe(void** ) {
     }
 }
 
+void test_uring_writev_position(void** ) {
+    TLoop<TUring> loop;
+    std::string path = "/tmp/coroio_test_uring_writev_" + std::to_string(getpid());
+    int fd = open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+    assert_true(fd >= 0);
+    TFuture<void> h = [](TUring& uring, int fd) -> TFuture<void> {
+        // at the file position, after the plain write
+        assert_int_equal(write(fd, "abc", 3), 3);
+        TUring::TSocket file(fd, uring);
+        char d[] = "de", f[] = "f";
+        iovec iov[] = {{d, 2}, {f, 1}};
+        auto n = co_await file.WritevSome(iov, 2);
+        assert_int_equal(n, 3);
+        co_return;
+    }(loop.Poller(), fd);
+    while (!h.done()) {
+        loop.Step();
+    }
+    h.await_resume();
+    char back[7] = {};
+    int check = open(path.c_str(), O_RDONLY);
+    assert_int_equal(read(check, back, 6), 6);
+    close(check);
+    unlink(path.c_str());
+    assert_string_equal(back, "abcdef");
+}
+
+void test_uring_kernel_timers(void** ) {
+    TLoop<TUring> loop;
+    loop.Poller().SetKernelTimers(true);
+    std::vector<int> order;
+    auto sleeper = [](TUring& poller, int ms, std::vector<int>* order) -> TFuture<void> {
+        co_await poller.Sleep(std::chrono::milliseconds(ms));
+        order->push_back(ms);
+    };
+    auto start = TClock::now();
+    std::vector<TFuture<void>> futures;
+    futures.emplace_back(sleeper(loop.Poller(), 30, &order));
+    futures.emplace_back(sleeper(loop.Poller(), 10, &order));
+    futures.emplace_back(sleeper(loop.Poller(), 0, &order));
+    futures.emplace_back(sleeper(loop.Poller(), 20, &order));
+    assert_int_equal(loop.Poller().KernelTimersSize(), 4);
+    {
+        // removed from the kernel when they are abandoned: the first one is due
+        // before the others are over and must not be resumed, the second one
+        // would stay in the kernel long after them
+        TFuture<void> abandoned = sleeper(loop.Poller(), 15, &order);
+        TFuture<void> longer = sleeper(loop.Poller(), 10000, &order);
+        assert_int_equal(loop.Poller().KernelTimersSize(), 6);
+        loop.Step();
+    }
+    TFuture<void> all = All(std::move(futures));
+    while (!all.done() || loop.Poller().KernelTimersSize() > 0) {
+        assert_true(TClock::now() - start < std::chrono::seconds(5));
+        loop.Step();
+    }
+    assert_int_equal(loop.Poller().TimersSize(), 0); // nothing on the heap either
+    assert_true(TClock::now() - start >= std::chrono::milliseconds(30));
+    assert_true((order == std::vector<int>{0, 10, 20, 30}));
+}
+
+void test_uring_connect_linked(void** ) {
+    TLoop<TUring> loop;
+    int port = getport();
+    TUring::TSocket listener(TAddress{"127.0.0.1", port}, loop.Poller());
+    listener.Bind();
+    listener.Listen();
+    TFuture<void> server = [](TUring::TSocket& listener) -> TFuture<void> {
+        while (true) {
+            auto client = co_await listener.Accept();
+            char buf[5];
+            co_await TByteReader(client).Read(buf, sizeof(buf));
+            co_await TByteWriter(client).Write("world", 5);
+        }
+    }(listener);
+    int connections = 0;
+    bool refused = false;
+    TFuture<void> client = [](TUring& poller, int port, int* connections, bool* refused) -> TFuture<void> {
+        // more connections than direct descriptors, the slots are reused
+        for (int i = 0; i < 300; i++) {
+            auto conn = co_await ConnectLinked(poller, TAddress{"127.0.0.1", port}, "hello", 5);
+            assert_int_equal(conn.Sent, 5);
+            char buf[5];
+            co_await TByteReader(conn.Socket).Read(buf, sizeof(buf));
+            assert_memory_equal(buf, "world", 5);
+            (*connections)++;
+        }
+        // without data
+        auto conn = co_await ConnectLinked(poller, TAddress{"127.0.0.1", port});
+        assert_int_equal(conn.Sent, 0);
+        co_await TByteWriter(conn.Socket).Write("hello", 5);
+        char buf[5];
+        co_await TByteReader(conn.Socket).Read(buf, sizeof(buf));
+        (*connections)++;
+        try {
+            auto bad = co_await ConnectLinked(poller, TAddress{"127.0.0.1", port + 1000}, "hello", 5);
+        } catch (const std::system_error& ex) {
+            *refused = ex.code().value() == ECONNREFUSED;
+        }
+    }(loop.Poller(), port, &connections, &refused);
+    while (!client.done()) {
+        loop.Step();
+    }
+    client.await_resume();
+    assert_int_equal(connections, 301);
+    assert_true(refused);
+}
+
+void test_uring_connect_linked_abandoned(void** ) {
+    TLoop<TUring> loop;
+    int port = getport();
+    TUring::TSocket listener(TAddress{"127.0.0.1", port}, loop.Poller());
+    listener.Bind();
+    listener.Listen();
+    {
+        // destroyed with the chain in flight: the ring closes the installed descriptor
+        auto abandoned = ConnectLinked(loop.Poller(), TAddress{"127.0.0.1", port}, "hello", 5);
+    }
+    std::string received;
+    TFuture<void> server = [](TUring::TSocket& listener, std::string* received) -> TFuture<void> {
+        auto client = co_await listener.Accept();
+        char buf[16];
+        while (true) {
+            auto size = co_await client.ReadSome(buf, sizeof(buf));
+            if (size == 0) {
+                break;
+            }
+            received->append(buf, size);
+        }
+    }(listener, &received);
+    auto deadline = TClock::now() + std::chrono::seconds(10);
+    while (!server.done() && TClock::now() < deadline) {
+        loop.Step();
+    }
+    assert_true(server.done());
+    assert_string_equal(received.c_str(), "hello");
+}
+
+void test_uring_bundles(void** ) {
+    for (bool bundles : {true, false}) {
+        TLoop<TUring> loop;
+        loop.Poller().SetBundles(bundles);
+        int port = getport();
+        TUring::TSocket listener(TAddress{"127.0.0.1", port}, loop.Poller());
+        listener.Bind();
+        listener.Listen();
+        std::vector<char> data(1024 * 1024);
+        for (size_t i = 0; i < data.size(); i++) {
+            data[i] = i % 251;
+        }
+        std::vector<char> received;
+        TFuture<void> reader = [](TUring& poller, TUring::TSocket& listener, std::vector<char>& received) -> TFuture<void> {
+            auto client = co_await listener.Accept();
+            TBufferRing buffers(poller, 16, 4096);
+            while (true) {
+                auto bundle = co_await client.ReadBundle(buffers);
+                if (bundle.Ids.empty()) {
+                    break;
+                }
+                size_t left = bundle.Size;
+                for (auto id : bundle.Ids) {
+                    size_t size = std::min<size_t>(left, buffers.Size());
+                    received.insert(received.end(), buffers.Buffer(id), buffers.Buffer(id) + size);
+                    left -= size;
+                    buffers.Release(id);
+                }
+                assert_int_equal(left, 0);
+            }
+        }(loop.Poller(), listener, received);
+        TFuture<void> writer = [](TUring& poller, int port, const std::vector<char>& data) -> TFuture<void> {
+            TUring::TSocket socket(TAddress{"127.0.0.1", port}, poller);
+            co_await socket.Connect();
+            co_await TByteWriter(socket).Write(data.data(), data.size());
+        }(loop.Poller(), port, data);
+        while (!(reader.done() && writer.done())) {
+            loop.Step();
+        }
+        reader.await_resume();
+        assert_true(data == received);
+    }
+}
+
+void test_uring_readiness(void** ) {
+    TLoop<TUring> loop;
+    int port = getport();
+    // readiness sockets on the server side, ring ones on the client side, in one ring
+    NNet::TSocket listener(TAddress{"127.0.0.1", port}, loop.Poller());
+    listener.Bind();
+    listener.Listen();
+    TFuture<void> server = [](NNet::TSocket& listener) -> TFuture<void> {
+        auto client = co_await listener.Accept();
+        TLineReader reader(client, 1024);
+        auto line = co_await reader.Read();
+        std::string echo = std::string(line.Part1) + std::string(line.Part2);
+        co_await TByteWriter(client).Write(echo.data(), echo.size());
+    }(listener);
+    std::string answer;
+    TFuture<void> client = [](TUring& poller, int port, std::string* answer) -> TFuture<void> {
+        TUring::TSocket socket(TAddress{"127.0.0.1", port}, poller);
+        co_await socket.Connect();
+        const char hello[] = "hello\n";
+        co_await TByteWriter(socket).Write(hello, sizeof(hello) - 1);
+        char buf[6];
+        co_await TByteReader(socket).Read(buf, sizeof(buf));
+        answer->assign(buf, sizeof(buf));
+    }(loop.Poller(), port, &answer);
+    while (!(server.done() && client.done())) {
+        loop.Step();
+    }
+    assert_string_equal(answer.c_str(), "hello\n");
+
+    // a writer waits for the buffer of the socket drained by the reader
+    int pair[2];
+    assert_int_equal(socketpair(AF_UNIX, SOCK_STREAM, 0, pair), 0);
+    NNet::TSocket a(TAddress{}, pair[0], loop.Poller());
+    NNet::TSocket b(TAddress{}, pair[1], loop.Poller());
+    std::vector<char> data(4 * 1024 * 1024);
+    for (size_t i = 0; i < data.size(); i++) {
+        data[i] = i % 251;
+    }
+    std::vector<char> received(data.size());
+    TFuture<void> writer = [](NNet::TSocket& a, const std::vector<char>& data) -> TFuture<void> {
+        co_await TByteWriter(a).Write(data.data(), data.size());
+    }(a, data);
+    TFuture<void> reader = [](NNet::TSocket& b, std::vector<char>& received) -> TFuture<void> {
+        co_await TByteReader(b).Read(received.data(), received.size());
+    }(b, received);
+    while (!(writer.done() && reader.done())) {
+        loop.Step();
+    }
+    assert_true(data == received);
+}
+
+void test_uring_stats(void** ) {
+    TUring uring(256);
+    char rbuf[2] = {'k', 'k'};
+    int p[2]; assert_int_equal(0, pipe(p));
+    int q[2]; assert_int_equal(0, pipe(q));
+    assert_int_equal(1, write(p[1], rbuf, 1));
+    uring.Read(p[0], &rbuf[0], 1, nullptr);
+    // the submit and the wait are one syscall
+    assert_int_equal(1, uring.Wait());
+    assert_int_equal(1, uring.Stats().Iterations);
+    assert_int_equal(1, uring.Stats().Enters);
+    assert_int_equal(1, uring.Stats().Submitted);
+    assert_int_equal(1, uring.Stats().Completions);
+    // nothing to submit and no wait
+    assert_int_equal(0, uring.Wait({0, 0}));
+    assert_int_equal(2, uring.Stats().Iterations);
+    assert_int_equal(1, uring.Stats().Enters);
+
+    // one of the two reads is ready: the batch is waited for up to maxWait only
+    uring.SetMinBatch(2, std::chrono::milliseconds(20));
+    assert_int_equal(1, write(p[1], rbuf, 1));
+    uring.Read(p[0], &rbuf[0], 1, nullptr);
+    uring.Read(q[0], &rbuf[1], 1, nullptr);
+    auto start = TClock::now();
+    assert_int_equal(1, uring.Wait({5, 0}));
+    auto elapsed = TClock::now() - start;
+    assert_true(elapsed >= std::chrono::milliseconds(20));
+    assert_true(elapsed < std::chrono::seconds(1));
+    assert_int_equal(1, write(q[1], rbuf, 1));
+    assert_int_equal(1, uring.Wait({5, 0}));
+    assert_int_equal(3, uring.Stats().Completions);
+    close(p[0]); close(p[1]); close(q[0]); close(q[1]);
+}
+
 template<typename TPoller>
 void test_remote_disconnect(void**) {
     bool changed = false;
@@ -1193,16 +3811,33 @@ int main() {
     const struct CMUnitTest tests[] = {
         cmocka_unit_test(test_addr),
         cmocka_unit_test(test_addr6),
+#ifndef _WIN32
+        cmocka_unit_test(test_unix_address),
+#endif
         cmocka_unit_test(test_bad_addr),
         cmocka_unit_test(test_timespec),
         cmocka_unit_test(test_line_splitter),
         cmocka_unit_test(test_zero_copy_line_splitter),
+        cmocka_unit_test(test_token_bucket),
+        cmocka_unit_test(test_crc32c),
         cmocka_unit_test(test_self_id),
         cmocka_unit_test(test_resolv_nameservers),
+        cmocka_unit_test(test_http_parse_request),
+        cmocka_unit_test(test_http_parse_incremental),
+        cmocka_unit_test(test_http_parse_chunked),
+        cmocka_unit_test(test_http_parse_reply),
+        cmocka_unit_test(test_http_chunk_decoder),
+        cmocka_unit_test(test_ws_accept_key),
+        cmocka_unit_test(test_ws_mask),
+        cmocka_unit_test(test_ws_frame_header),
+        cmocka_unit_test(test_resp_parse),
+        cmocka_unit_test(test_memcached_ring),
+        cmocka_unit_test(test_rpc_frame),
         my_unit_poller(test_listen),
         my_unit_poller(test_timeout),
         my_unit_poller(test_timeout2),
         my_unit_poller(test_accept),
+        my_unit_poller(test_accept_batch),
         my_unit_poller(test_write_after_connect),
         my_unit_poller(test_write_after_accept),
         my_unit_poller(test_connection_timeout),
@@ -1210,21 +3845,60 @@ int main() {
         my_unit_poller(test_connection_refused_on_write),
         my_unit_poller(test_connection_refused_on_read),
         my_unit_poller(test_read_write_same_socket),
+        my_unit_poller(test_read_write_same_wakeup),
+        my_unit_poller(test_reader_after_writer_removed),
+#ifndef _WIN32
+        my_unit_poller(test_removals_in_one_batch),
+#endif
         my_unit_poller(test_read_write_full),
         my_unit_poller(test_read_write_struct),
         my_unit_poller(test_read_write_lines),
+        my_unit_poller(test_shaped_socket),
         my_unit_poller(test_future_chaining),
         my_unit_poller(test_futures_any),
         my_unit_poller(test_futures_any_result),
         my_unit_poller(test_futures_any_same_wakeup),
         my_unit_poller(test_futures_all),
+        my_unit_poller(test_http_server_pipelined),
+        my_unit_poller(test_http_server_too_large),
+        my_unit_poller(test_http_client_pipelined),
+        my_unit_poller(test_http_client_head),
+        my_unit_poller(test_http_client_dropped),
+        my_unit_poller(test_http_client_deadline),
+        my_unit_poller(test_ws_echo),
+        my_unit_poller(test_redis_pipelining),
+        my_unit_poller(test_memcached_batching),
+        my_unit_poller(test_memcached_too_large),
+        my_unit_poller(test_rpc_multiplexing),
+        my_unit_poller(test_rpc_duplicate_id),
 #ifndef _WIN32
+        my_unit_poller(test_unix_socket),
+        my_unit_poller(test_spin),
         my_unit_test2(test_read_write_full_ssl, TSelect, TPoll),
+        my_unit_test2(test_http_server_ssl, TSelect, TPoll),
+        my_unit_test2(test_async_file, TSelect, TPoll),
+        my_unit_test2(test_wal, TSelect, TPoll),
+        my_unit_test2(test_mapped_file, TSelect, TPoll),
+        my_unit_test2(test_async_event, TSelect, TPoll),
 #endif
         my_unit_test2(test_resolver, TSelect, TPoll),
+#ifndef _WIN32
+        my_unit_poller(test_resolver_stub),
+#endif
         my_unit_test2(test_resolve_bad_name, TSelect, TPoll),
 #ifdef __linux__
         my_unit_test2(test_remote_disconnect, TPoll, TEPoll),
+        my_unit_test(test_async_file, TEPoll),
+        my_unit_test(test_wal, TEPoll),
+        my_unit_test2(test_mapped_file, TEPoll, TUring),
+        my_unit_test2(test_async_event, TEPoll, TUring),
+        my_unit_poller(test_signals),
+        my_unit_poller(test_periodic_timer),
+        my_unit_poller(test_process),
+        my_unit_poller(test_fast_open),
+        cmocka_unit_test(test_uring_async_file),
+        cmocka_unit_test(test_uring_file_ops),
+        cmocka_unit_test(test_uring_wal),
         cmocka_unit_test(test_uring_create),
         cmocka_unit_test(test_uring_write),
         cmocka_unit_test(test_uring_read),
@@ -1232,6 +3906,13 @@ int main() {
         cmocka_unit_test(test_uring_write_resume),
         cmocka_unit_test(test_uring_read_resume),
         cmocka_unit_test(test_uring_no_sqe),
+        cmocka_unit_test(test_uring_stats),
+        cmocka_unit_test(test_uring_readiness),
+        cmocka_unit_test(test_uring_writev_position),
+        cmocka_unit_test(test_uring_kernel_timers),
+        cmocka_unit_test(test_uring_connect_linked),
+        cmocka_unit_test(test_uring_connect_linked_abandoned),
+        cmocka_unit_test(test_uring_bundles),
         // cmocka_unit_test(test_uring_cancel), // temporary disable
 #endif
     };